@@ -0,0 +1,107 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+
+#include "pihm.h"
+
+#ifdef _OPENMP
+void BindThreads (int bind)
+{
+#if defined(__linux__)
+    cpu_set_t       mask;
+    int             cpus[CPU_SETSIZE];
+    int             ncpu = 0;
+    int             k;
+
+    if (bind == BIND_NONE)
+    {
+        return;
+    }
+
+    /* Threads are bound to CPUs the process is allowed to run on */
+    sched_getaffinity (0, sizeof (cpu_set_t), &mask);
+    for (k = 0; k < CPU_SETSIZE; k++)
+    {
+        if (CPU_ISSET (k, &mask))
+        {
+            cpus[ncpu++] = k;
+        }
+    }
+
+    /* Bind each thread of the thread pool. Close binding places consecutive
+     * threads on consecutive CPUs. Spread binding distributes threads evenly
+     * over all CPUs, and thus over all sockets */
+#pragma omp parallel num_threads(nthreads)
+    {
+        cpu_set_t       set;
+        int             tid;
+        int             cpu;
+
+        tid = omp_get_thread_num ();
+        cpu = (bind == BIND_CLOSE) ?
+            cpus[tid % ncpu] : cpus[(tid * ncpu / nthreads) % ncpu];
+
+        CPU_ZERO (&set);
+        CPU_SET (cpu, &set);
+        sched_setaffinity (0, sizeof (cpu_set_t), &set);
+    }
+
+    PIHMprintf (VL_VERBOSE, " %d threads bound to CPUs (%s).\n", nthreads,
+        (bind == BIND_CLOSE) ? "close" : "spread");
+#else
+    if (bind != BIND_NONE)
+    {
+        PIHMprintf (VL_NORMAL,
+            "Warning: Thread binding is not supported on this system.\n");
+    }
+#endif
+}
+
+void FirstTouch (void *ptr, int nmemb, size_t size)
+{
+    int             i;
+
+    /* Pages are placed on the memory of the thread that touches them first.
+     * Touching with the static schedule of element loops places the data of
+     * each element near the thread that updates it */
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < nmemb; i++)
+    {
+        memset ((char *)ptr + (size_t)i * size, 0, size);
+    }
+}
+
+void FirstTouchVector (N_Vector CV_Y)
+{
+    double         *y;
+    int             i;
+
+    y = NV_DATA (CV_Y);
+
+    /* Hydrologic states are touched in the same way as they are updated in
+     * element and river loops */
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < nelem; i++)
+    {
+        y[SURF(i)] = 0.0;
+        y[UNSAT(i)] = 0.0;
+        y[GW(i)] = 0.0;
+    }
+
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < nriver; i++)
+    {
+        y[RIVSTG(i)] = 0.0;
+        y[RIVGW(i)] = 0.0;
+    }
+
+    /* Pages of other state variables are placed by the static schedule of
+     * vector operations */
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < NSV; i++)
+    {
+        y[i] = 0.0;
+    }
+}
+#endif
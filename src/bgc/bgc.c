@@ -2,12 +2,10 @@
 
 void DailyBgc (pihm_struct pihm, int t)
 {
-
-    int             i;
+    int             b;
+    int             nblk;
     double          co2lvl;
-    double          dayl, prev_dayl;
     double          ndep, nfix;
-    spa_data        spa, prev_spa;
 
     /* Get co2 and ndep */
     if (spinup_mode)      /* Spinup mode */
@@ -28,7 +26,7 @@ void DailyBgc (pihm_struct pihm, int t)
         }
         else
         {
-            co2lvl = GetCO2 (pihm->forc.co2[0], t);
+            co2lvl = GetCO2 (&pihm->forc.co2[0], t);
         }
 
         /* Ndep handling */
@@ -40,177 +38,243 @@ void DailyBgc (pihm_struct pihm, int t)
         }
         else
         {
-            ndep = GetNdep (pihm->forc.ndep[0], t);
+            ndep = GetNdep (&pihm->forc.ndep[0], t);
             ndep = ndep / 365.0;
             nfix = pihm->ndepctrl.nfix / 365.0;
         }
     }
 
-    /* Calculate daylengths */
-    SunPos (t, pihm->siteinfo.latitude, pihm->siteinfo.longitude,
-        pihm->siteinfo.elevation, pihm->siteinfo.tavg, &spa);
-    SunPos (t - DAYINSEC, pihm->siteinfo.latitude, pihm->siteinfo.longitude,
-        pihm->siteinfo.elevation, pihm->siteinfo.tavg, &prev_spa);
-
-    dayl = (spa.sunset - spa.sunrise) * 3600.0;
-    dayl = (dayl < 0.0) ? dayl + 24.0 * 3600.0 : dayl;
-
-    prev_dayl = (prev_spa.sunset - prev_spa.sunrise) * 3600.0;
-    prev_dayl = (prev_dayl < 0.0) ? prev_dayl + 24.0 * 3600.0 : prev_dayl;
+    /* Elements are processed in blocks, in the order of EPC types, so that
+     * elements in a block mostly share EPC constants and phenology branches.
+     * Photosynthesis and decomposition rate scalars of all elements in a
+     * block are calculated together */
+    nblk = (nelem + NOAH_BLOCK - 1) / NOAH_BLOCK;
 
 #ifdef _OPENMP
-#pragma omp parallel for
+    KernelStart (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[BGC_KERNEL]);
+#pragma omp parallel for schedule(runtime) \
+    num_threads(pihm->ctrl.kernel[BGC_KERNEL].nthreads)
 #endif
-    for (i = 0; i < nelem; i++)
+    for (b = 0; b < nblk; b++)
     {
-        int         k;
-        daily_struct *daily;
-        epconst_struct *epc;
-        epvar_struct *epv;
-        soil_struct *soil;
-        wstate_struct *ws;
-        estate_struct *es;
-        eflux_struct *ef;
-        pstate_struct *ps;
-        cstate_struct *cs;
-        cflux_struct *cf;
-        nstate_struct *ns;
-        nflux_struct *nf;
-        ntemp_struct *nt;
-        solute_struct *nsol;
-        psn_struct *psn_sun, *psn_shade;
-        summary_struct *summary;
-        double      vwc;
-        int         annual_alloc;
-
-        daily = &pihm->elem[i].daily;
-        epc = &pihm->elem[i].epc;
-        epv = &pihm->elem[i].epv;
-        soil = &pihm->elem[i].soil;
-        ws = &pihm->elem[i].ws;
-        es = &pihm->elem[i].es;
-        ef = &pihm->elem[i].ef;
-        ps = &pihm->elem[i].ps;
-        cs = &pihm->elem[i].cs;
-        cf = &pihm->elem[i].cf;
-        ns = &pihm->elem[i].ns;
-        nf = &pihm->elem[i].nf;
-        nt = &pihm->elem[i].nt;
-        nsol = &pihm->elem[i].nsol;
-        psn_sun = &pihm->elem[i].psn_sun;
-        psn_shade = &pihm->elem[i].psn_shade;
-        summary = &pihm->elem[i].summary;
-
-        /* Determine daylengths */
-        epv->dayl = dayl;
-        epv->prev_dayl = prev_dayl;
-
-        /* Determine CO2 level */
-        ps->co2 = co2lvl;
-
-        PrecisionControl (cs, ns);
-
-        /* Zero all the flux variables */
-        MakeZeroFluxStruct (cf, nf);
-
-        /* Phenology fluxes */
-        Phenology (epc, epv, cs, cf, ns, nf, daily);
-
-        /* Test for the annual allocation day */
-        if (epv->offset_flag == 1 && epv->offset_counter == 1)
-        {
-            annual_alloc = 1;
-        }
-        else
-        {
-            annual_alloc = 0;
-        }
+        bgcblk_struct   blk;
+        int             i, k, l;
 
-        /* Calculate leaf area index, sun and shade fractions, and specific
-         * leaf area for sun and shade canopy fractions, then calculate
-         * canopy radiation interception and transmission */
-        RadTrans (cs, ef, ps, epc, epv, daily);
+        blk.nlane = ((b + 1) * NOAH_BLOCK <= nelem) ?
+            NOAH_BLOCK : nelem - b * NOAH_BLOCK;
+        blk.npsn = 0;
+        blk.ndcmp = 0;
 
-        /* Soil water potential */
-        vwc = daily->avg_sh2o[0] * ps->sldpth[0];
-        if (ps->nsoil > 1)
+        for (l = 0; l < blk.nlane; l++)
         {
-            for (k = 1; k < ps->nsoil; k++)
+            daily_struct *daily;
+            epconst_struct *epc;
+            epvar_struct *epv;
+            soil_struct *soil;
+            eflux_struct *ef;
+            pstate_struct *ps;
+            cstate_struct *cs;
+            cflux_struct *cf;
+            nstate_struct *ns;
+            nflux_struct *nf;
+            double      vwc;
+
+            i = pihm->bgc_order[b * NOAH_BLOCK + l];
+            blk.elem[l] = i;
+
+            /* Elements that have reached steady state are retired from
+             * spinup */
+            blk.skip[l] = (spinup_mode && pihm->elem[i].spinup.steady);
+            if (blk.skip[l])
             {
-                vwc += daily->avg_sh2o[k] * ps->sldpth[k];
+                /* Mineral N fluxes of the day before retirement have been
+                 * transported. Retired elements no longer exchange mineral N
+                 * with plants and soil pools, so that mineral N only changes
+                 * by transport and the N balance holds */
+                pihm->elem[i].nf.ndep_to_sminn = 0.0;
+                pihm->elem[i].nf.nfix_to_sminn = 0.0;
+                pihm->elem[i].nsol.snksrc = 0.0;
+                continue;
             }
-        }
-        vwc /= soil->depth;
 
-        SoilPsi (soil, vwc, &epv->psi);
+            daily = &pihm->elem[i].daily;
+            epc = &pihm->elem[i].epc;
+            epv = &pihm->elem[i].epv;
+            soil = &pihm->elem[i].soil;
+            ef = &pihm->elem[i].ef;
+            ps = &pihm->elem[i].ps;
+            cs = &pihm->elem[i].cs;
+            cf = &pihm->elem[i].cf;
+            ns = &pihm->elem[i].ns;
+            nf = &pihm->elem[i].nf;
 
-        /* Maintenance respiration */
-        MaintResp (epc, epv, cs, cf, ns, daily);
+            /* Determine daylengths */
+            epv->dayl = DayLength (&pihm->forc, i, t);
+            epv->prev_dayl = DayLength (&pihm->forc, i, t - DAYINSEC);
 
-        /* Begin canopy bio-physical process simulation */
-        if (cs->leafc && epv->dayl)
-        {
-            /* Conductance */
-            CanopyCond (epc, epv, ef, ps, soil, daily);
-        }
+            /* Determine CO2 level */
+            ps->co2 = co2lvl;
 
-        /* Do photosynthesis only when it is part of the current growth
-         * season, as * defined by the remdays_curgrowth flag.  This keeps the
-         * occurrence of * new growth consistent with the treatment of
-         * litterfall and allocation */
-        if (cs->leafc && !epv->dormant_flag && epv->dayl)
-        {
-            TotalPhotosynthesis (epc, epv, ps, cf, psn_sun, psn_shade, daily);
+            PrecisionControl (cs, ns);
+
+            /* Zero all the flux variables */
+            MakeZeroFluxStruct (cf, nf);
+
+            /* Phenology fluxes */
+            Phenology (epc, epv, cs, cf, ns, nf, daily);
+
+            /* Test for the annual allocation day */
+            if (epv->offset_flag == 1 && epv->offset_counter == 1)
+            {
+                blk.annual_alloc[l] = 1;
+            }
+            else
+            {
+                blk.annual_alloc[l] = 0;
+            }
+
+            /* Calculate leaf area index, sun and shade fractions, and
+             * specific leaf area for sun and shade canopy fractions, then
+             * calculate canopy radiation interception and transmission */
+            RadTrans (cs, ef, ps, epc, epv, daily);
+
+            /* Soil water potential */
+            vwc = daily->avg_sh2o[0] * ps->sldpth[0];
+            if (ps->nsoil > 1)
+            {
+                for (k = 1; k < ps->nsoil; k++)
+                {
+                    vwc += daily->avg_sh2o[k] * ps->sldpth[k];
+                }
+            }
+            vwc /= soil->depth;
+
+            SoilPsi (soil, vwc, &epv->psi);
+
+            /* Maintenance respiration */
+            MaintResp (epc, epv, cs, cf, ns, daily);
+
+            /* Begin canopy bio-physical process simulation */
+            if (cs->leafc && epv->dayl)
+            {
+                /* Conductance */
+                CanopyCond (epc, epv, ef, ps, soil, daily);
+            }
+
+            /* Do photosynthesis only when it is part of the current growth
+             * season, as * defined by the remdays_curgrowth flag.  This
+             * keeps the occurrence of * new growth consistent with the
+             * treatment of litterfall and allocation */
+            blk.psn_on[l] = (cs->leafc && !epv->dormant_flag && epv->dayl);
+            if (blk.psn_on[l])
+            {
+                PsnInput (epc, epv, ps, &pihm->elem[i].psn_sun,
+                    &pihm->elem[i].psn_shade, daily);
+                blk.psn[blk.npsn++] = &pihm->elem[i].psn_sun;
+                blk.psn[blk.npsn++] = &pihm->elem[i].psn_shade;
+            }
+            else
+            {
+                epv->assim_sun = epv->assim_shade = 0.0;
+            }
+
+            nf->ndep_to_sminn = ndep;
+            nf->nfix_to_sminn = nfix;
+
+            blk.epv[blk.ndcmp] = epv;
+            blk.tsoil[blk.ndcmp] = daily->avg_stc[0] - TFREEZ;
+            blk.ndcmp++;
         }
-        else
+
+        /* Photosynthesis of sunlit and shaded canopy fractions, and
+         * decomposition rate scalars of the block */
+        PhotosynthesisBlk (&blk);
+
+        DecompScalarBlk (&blk);
+
+        for (l = 0; l < blk.nlane; l++)
         {
-            epv->assim_sun = epv->assim_shade = 0.0;
-        }
+            epconst_struct *epc;
+            epvar_struct *epv;
+            pstate_struct *ps;
+            cstate_struct *cs;
+            cflux_struct *cf;
+            nstate_struct *ns;
+            nflux_struct *nf;
+            ntemp_struct *nt;
+            solute_struct *nsol;
+            summary_struct *summary;
+
+            if (blk.skip[l])
+            {
+                continue;
+            }
 
-        nf->ndep_to_sminn = ndep;
-        nf->nfix_to_sminn = nfix;
+            i = blk.elem[l];
 
-        /* Daily litter and soil decomp and nitrogen fluxes */
-        Decomp (daily->avg_stc[0] - TFREEZ, epc, epv, cs, cf, ns, nf, nt);
+            epc = &pihm->elem[i].epc;
+            epv = &pihm->elem[i].epv;
+            ps = &pihm->elem[i].ps;
+            cs = &pihm->elem[i].cs;
+            cf = &pihm->elem[i].cf;
+            ns = &pihm->elem[i].ns;
+            nf = &pihm->elem[i].nf;
+            nt = &pihm->elem[i].nt;
+            nsol = &pihm->elem[i].nsol;
+            summary = &pihm->elem[i].summary;
 
-        /* Allocation gets called whether or not this is a current growth day,
-         * because the competition between decomp immobilization fluxes and
-         * plant growth N demand is resolved here. On days with no growth, no
-         * allocation occurs, but immobilization fluxes are updated
-         * normally */
-        DailyAllocation (cf, cs, nf, ns, epc, epv, nt);
+            if (blk.psn_on[l])
+            {
+                TotalPhotosynthesis (epv, ps, cf, &pihm->elem[i].psn_sun,
+                    &pihm->elem[i].psn_shade);
+            }
 
-        /* Growth respiration */
-        GrowthResp (epc, cf);
+            /* Daily litter and soil decomp and nitrogen fluxes */
+            Decomp (epc, epv, cs, cf, ns, nf, nt);
 
-        /* Update of carbon state variables */
-        DailyCarbonStateUpdate (cf, cs, annual_alloc, epc->woody,
-            epc->evergreen);
+            /* Allocation gets called whether or not this is a current growth
+             * day, because the competition between decomp immobilization
+             * fluxes and plant growth N demand is resolved here. On days
+             * with no growth, no allocation occurs, but immobilization
+             * fluxes are updated normally */
+            DailyAllocation (cf, cs, nf, ns, epc, epv, nt);
 
-        /* Update of nitrogen state variables */
-        DailyNitrogenStateUpdate (nf, ns, nsol, annual_alloc, epc->woody,
-            epc->evergreen);
+            /* Growth respiration */
+            GrowthResp (epc, cf);
 
-        /* Calculate mortality fluxes and update state variables */
-        /* This is done last, with a special state update procedure, to ensure
-         * that pools don't go negative due to mortality fluxes conflicting
-         * with other proportional fluxes */
-        Mortality (epc, cs, cf, ns, nf);
+            /* Update of carbon state variables */
+            DailyCarbonStateUpdate (cf, cs, blk.annual_alloc[l], epc->woody,
+                epc->evergreen);
 
-        /* Test for carbon balance */
-        CheckCarbonBalance (cs, &epv->old_c_balance);
+            /* Update of nitrogen state variables */
+            DailyNitrogenStateUpdate (nf, ns, nsol, blk.annual_alloc[l],
+                epc->woody, epc->evergreen);
 
-        /* Nitrogen balance is checked outside DailyBgc function because a bgc
-         * cycle is not finished until N transport is caluculated by CVODE */
-        //CheckNitrogenBalance (ns, &epv->old_n_balance);
+            /* Calculate mortality fluxes and update state variables */
+            /* This is done last, with a special state update procedure, to
+             * ensure that pools don't go negative due to mortality fluxes
+             * conflicting with other proportional fluxes */
+            Mortality (epc, cs, cf, ns, nf);
 
-        /* Calculate carbon summary variables */
-        CSummary (cf, cs, summary);
+            /* Test for carbon balance */
+            CheckCarbonBalance (cs, &epv->old_c_balance);
 
-        if (spinup_mode)
-        {
-            pihm->elem[i].spinup.soilc += summary->soilc;
-            pihm->elem[i].spinup.totalc += summary->totalc;
+            /* Nitrogen balance is checked outside DailyBgc function because
+             * a bgc cycle is not finished until N transport is caluculated
+             * by CVODE */
+            //CheckNitrogenBalance (ns, &epv->old_n_balance);
+
+            /* Calculate carbon summary variables */
+            CSummary (cf, cs, summary);
+
+            if (spinup_mode)
+            {
+                pihm->elem[i].spinup.soilc += summary->soilc;
+                pihm->elem[i].spinup.totalc += summary->totalc;
+            }
         }
     }
+#ifdef _OPENMP
+    KernelEnd (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[BGC_KERNEL]);
+#endif
 }
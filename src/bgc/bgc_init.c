@@ -75,7 +75,35 @@ void InitBgc (elem_struct *elem, const epctbl_struct *epctbl)
     }
 }
 
-void InitBgcVar (elem_struct *elem, river_struct *riv, N_Vector CV_Y)
+void InitBgcOrder (const elem_struct *elem, int *order)
+{
+    int             i;
+    int             n;
+    int             evergreen;
+    int             type;
+
+    /* Elements are ordered by EPC type, evergreen types first, so that
+     * consecutive elements in daily BGC share EPC constants and phenology
+     * branches. Elements of the same type keep their original order */
+    n = 0;
+    for (evergreen = 1; evergreen >= 0; evergreen--)
+    {
+        for (type = 1; type <= NLCTYPE; type++)
+        {
+            for (i = 0; i < nelem; i++)
+            {
+                if (elem[i].attrib.lc_type == type &&
+                    elem[i].epc.evergreen == evergreen)
+                {
+                    order[n] = i;
+                    n++;
+                }
+            }
+        }
+    }
+}
+
+void InitBgcVar (elem_struct *elem, river_struct *riv)
 {
     int             i;
 
@@ -88,9 +116,6 @@ void InitBgcVar (elem_struct *elem, river_struct *riv, N_Vector CV_Y)
         elem[i].epv.annavg_t2m = elem[i].ps.tbot;
         elem[i].nsol.snksrc = 0.0;
 
-        NV_Ith (CV_Y, SURFN(i)) = elem[i].ns.surfn;
-        NV_Ith (CV_Y, SMINN(i)) = elem[i].ns.sminn;
-
         elem[i].nt.surfn0 = elem[i].ns.surfn;
         elem[i].nt.sminn0 = elem[i].ns.sminn;
     }
@@ -100,8 +125,5 @@ void InitBgcVar (elem_struct *elem, river_struct *riv, N_Vector CV_Y)
         riv[i].ns.streamn = riv[i].restart_input.streamn;
         riv[i].ns.sminn = riv[i].restart_input.sminn;
         riv[i].nf.sminn_leached = 0.0;
-
-        NV_Ith (CV_Y, STREAMN(i)) = riv[i].ns.streamn;
-        NV_Ith (CV_Y, RIVBEDN(i)) = riv[i].ns.sminn;
     }
 }
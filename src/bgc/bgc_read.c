@@ -126,16 +126,51 @@ void ReadBgc (char *fn, ctrl_struct *ctrl, co2control_struct *co2,
     NextLine (bgc_file, cmdstr, &lno);
     ctrl->prtvrbl[SMINN_CTRL] = ReadPrtCtrl (cmdstr, "SMINN", fn, lno);
 
-    NextLine (bgc_file, cmdstr, &lno);
-    ctrl->prtvrbl[LEAFC_CTRL] = ReadPrtCtrl (cmdstr, "LEAFC", fn, lno);
+    /* Optional outputs and spinup controls */
+    ctrl->spinup_replay = 0;
+    ctrl->spinup_coupled = 1;
 
     NextLine (bgc_file, cmdstr, &lno);
-    ctrl->prtvrbl[LIVESTEMC_CTRL] =
-        ReadPrtCtrl (cmdstr, "LIVESTEMC", fn, lno);
+    while (strcasecmp (cmdstr, "EOF") != 0)
+    {
+        char            optstr[MAXSTRING];
 
-    NextLine (bgc_file, cmdstr, &lno);
-    ctrl->prtvrbl[DEADSTEMC_CTRL] =
-        ReadPrtCtrl (cmdstr, "DEADSTEMC", fn, lno);
+        sscanf (cmdstr, "%s", optstr);
+
+        if (strcasecmp (optstr, "LEAFC") == 0)
+        {
+            ctrl->prtvrbl[LEAFC_CTRL] = ReadPrtCtrl (cmdstr, "LEAFC", fn,
+                lno);
+        }
+        else if (strcasecmp (optstr, "LIVESTEMC") == 0)
+        {
+            ctrl->prtvrbl[LIVESTEMC_CTRL] = ReadPrtCtrl (cmdstr, "LIVESTEMC",
+                fn, lno);
+        }
+        else if (strcasecmp (optstr, "DEADSTEMC") == 0)
+        {
+            ctrl->prtvrbl[DEADSTEMC_CTRL] = ReadPrtCtrl (cmdstr, "DEADSTEMC",
+                fn, lno);
+        }
+        else if (strcasecmp (optstr, "SPINUP_REPLAY") == 0)
+        {
+            ReadKeyword (cmdstr, "SPINUP_REPLAY", &ctrl->spinup_replay, 'i',
+                fn, lno);
+        }
+        else if (strcasecmp (optstr, "SPINUP_COUPLED") == 0)
+        {
+            ReadKeyword (cmdstr, "SPINUP_COUPLED", &ctrl->spinup_coupled, 'i',
+                fn, lno);
+        }
+        else
+        {
+            PIHMprintf (VL_ERROR, "Error: Unknown keyword \"%s\".\n", optstr);
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", fn, lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+
+        NextLine (bgc_file, cmdstr, &lno);
+    }
 
     fclose (bgc_file);
 }
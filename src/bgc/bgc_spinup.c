@@ -1,38 +1,372 @@
 #include "pihm.h"
 
-void BgcSpinup (pihm_struct pihm, N_Vector CV_Y, void *cvode_mem)
+void BgcSpinup (pihm_struct pihm, N_Vector CV_Y, void *cvode_mem,
+    char *outputdir, FILE *watbal)
 {
     int             i;
     int             spinyears = 0;
     int             first_spin_cycle = 1;
     int             steady;
+    int             replay = 0;
     double          metyears;
+    char            fn[MAXSTRING];
+    char            drv_fn[MAXSTRING];
+    FILE           *drv_file = NULL;
+    bgcdrv_struct  *drv = NULL;
 
     metyears =
         (pihm->ctrl.endtime - pihm->ctrl.starttime) / DAYINSEC / 365;
 
+    CheckStrLen (snprintf (fn, MAXSTRING, "%s%s_Spinup.txt", outputdir,
+        project), fn);
+
+    for (i = 0; i < nelem; i++)
+    {
+        pihm->elem[i].spinup.soilc_prev = 0.0;
+        pihm->elem[i].spinup.totalc_prev = 0.0;
+        pihm->elem[i].spinup.dsoilc = BADVAL;
+        pihm->elem[i].spinup.steady = 0;
+        pihm->elem[i].spinup.steady_year = -1;
+    }
+
+    /* In driver replay spinup, daily drivers of the first cycle are cached,
+     * and later cycles only run BGC and mineral N transport from the
+     * cache */
+    if (pihm->ctrl.spinup_replay)
+    {
+        CheckStrLen (snprintf (drv_fn, MAXSTRING, "%s%s_Spinup.drv",
+            outputdir, project), drv_fn);
+        drv_file = fopen (drv_fn, "wb");
+        CheckFile (drv_file, drv_fn);
+
+        /* Drivers of the day, and cached drivers of the same day that are
+         * compared with the final coupled cycle */
+        drv = (bgcdrv_struct *)malloc (2 * nelem * sizeof (bgcdrv_struct));
+
+        StartBgcDrv (pihm->elem);
+    }
+
     do
     {
-        PIHMprintf (VL_NORMAL, "Spinup year: %6d\n", spinyears + 1);
+        PIHMprintf (VL_NORMAL, "Spinup year: %6d%s\n", spinyears + 1,
+            replay ? " (driver replay)" : "");
 
         ResetSpinupStat (pihm->elem);
 
-        for (i = 0; i < pihm->ctrl.nstep; i++)
+        if (!replay)
         {
-            PIHM (pihm, cvode_mem, CV_Y, pihm->ctrl.tout[i],
-                pihm->ctrl.tout[i + 1]);
+            for (i = 0; i < pihm->ctrl.nstep; i++)
+            {
+                PIHM (pihm, cvode_mem, CV_Y, pihm->ctrl.tout[i],
+                    pihm->ctrl.tout[i + 1], outputdir, project, 0.0, watbal);
+
+                if (drv_file != NULL &&
+                    (pihm->ctrl.tout[i + 1] - pihm->ctrl.starttime) %
+                    DAYINSEC == 0)
+                {
+                    RecordBgcDrv (pihm->elem, drv, drv_file);
+                }
+            }
+
+            /* Reset solver parameters */
+            SetCVodeParam (pihm, cvode_mem, CV_Y);
+
+            if (drv_file != NULL)
+            {
+                fclose (drv_file);
+                drv_file = fopen (drv_fn, "rb");
+                CheckFile (drv_file, drv_fn);
+
+                replay = 1;
+            }
         }
+        else
+        {
+            int             t;
+
+            rewind (drv_file);
 
-        /* Reset solver parameters */
-        SetCVodeParam (pihm, cvode_mem, CV_Y);
+            for (t = pihm->ctrl.starttime + DAYINSEC;
+                t <= pihm->ctrl.endtime; t += DAYINSEC)
+            {
+                ReplayBgcDrv (pihm, drv, drv_file, t);
+            }
+        }
 
         spinyears += metyears;
 
         steady = CheckBgcSS (pihm->elem, pihm->siteinfo.area,first_spin_cycle,
             pihm->ctrl.endtime - pihm->ctrl.starttime, spinyears);
 
+        /* Report is rewritten every spinup cycle so that progress of long
+         * spinup runs can be monitored */
+        PrtSpinupStat (fn, pihm->elem, spinyears, steady);
+
         first_spin_cycle = 0;
-    } while (spinyears < pihm->ctrl.maxspinyears);
+    } while (spinyears < pihm->ctrl.maxspinyears && !steady);
+
+    if (pihm->ctrl.spinup_replay)
+    {
+        /* A final fully coupled cycle brings hydrology and mineral N, which
+         * was transported from the cache, back in balance. Its drivers are
+         * compared with the cached drivers of the first cycle, which shows
+         * how much driver replay departs from coupled spinup */
+        if (replay && pihm->ctrl.spinup_coupled)
+        {
+            double          diff[8] = { 0.0, 0.0, 0.0, 0.0,
+                0.0, 0.0, 0.0, 0.0 };
+            int             ndrv = 0;
+            int             k;
+
+            PIHMprintf (VL_NORMAL, "Spinup year: %6d (coupled)\n",
+                spinyears + 1);
+
+            rewind (drv_file);
+            StartBgcDrv (pihm->elem);
+
+            for (i = 0; i < nelem; i++)
+            {
+                pihm->elem[i].nt.surfn0 = pihm->elem[i].ns.surfn;
+                pihm->elem[i].nt.sminn0 = pihm->elem[i].ns.sminn;
+            }
+            SetCVodeParam (pihm, cvode_mem, CV_Y);
+
+            ResetSpinupStat (pihm->elem);
+
+            for (i = 0; i < pihm->ctrl.nstep; i++)
+            {
+                PIHM (pihm, cvode_mem, CV_Y, pihm->ctrl.tout[i],
+                    pihm->ctrl.tout[i + 1], outputdir, project, 0.0, watbal);
+
+                if ((pihm->ctrl.tout[i + 1] - pihm->ctrl.starttime) %
+                    DAYINSEC == 0)
+                {
+                    CompareBgcDrv (pihm->elem, drv, drv_file, diff);
+                    ndrv++;
+                }
+            }
+
+            SetCVodeParam (pihm, cvode_mem, CV_Y);
+
+            spinyears += metyears;
+
+            steady = CheckBgcSS (pihm->elem, pihm->siteinfo.area, 0,
+                pihm->ctrl.endtime - pihm->ctrl.starttime, spinyears);
+
+            PrtSpinupStat (fn, pihm->elem, spinyears, steady);
+
+            for (k = 4; k < 8; k++)
+            {
+                diff[k] /= (ndrv > 0) ? (double)ndrv * nelem : 1.0;
+            }
+
+            PIHMprintf (VL_NORMAL,
+                "Differences between coupled and replayed drivers "
+                "(mean, maximum):\n"
+                "  daytime air temperature %.3lf, %.3lf K\n"
+                "  top soil temperature %.3lf, %.3lf K\n"
+                "  soil moisture %.4lf, %.4lf m3 m-3\n"
+                "  daily mineral N transport %.3le, %.3le kg N m-2\n",
+                diff[4], diff[0], diff[5], diff[1], diff[6], diff[2],
+                diff[7], diff[3]);
+        }
+
+        fclose (drv_file);
+        remove (drv_fn);
+        free (drv);
+    }
+}
+
+void StartBgcDrv (elem_struct *elem)
+{
+    int             i;
+
+    for (i = 0; i < nelem; i++)
+    {
+        elem[i].spinup.n0 = elem[i].ns.surfn + elem[i].ns.sminn;
+        elem[i].spinup.nin = elem[i].nf.ndep_to_sminn +
+            elem[i].nf.nfix_to_sminn + elem[i].nsol.snksrc * DAYINSEC;
+    }
+}
+
+static void GetBgcDrv (elem_struct *elem, bgcdrv_struct *drv)
+{
+    int             i;
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < nelem; i++)
+    {
+        int             k;
+        double          avail;
+        const daily_struct *daily;
+
+        daily = &elem[i].daily;
+
+        drv[i].avg_sfctmp = daily->avg_sfctmp;
+        drv[i].tday = daily->tday;
+        drv[i].tnight = daily->tnight;
+        drv[i].avg_stc0 = daily->avg_stc[0];
+        drv[i].avg_soldn = daily->avg_soldn;
+        drv[i].avg_albedo = daily->avg_albedo;
+        drv[i].avg_q2d = daily->avg_q2d;
+        drv[i].avg_ch = daily->avg_ch;
+        drv[i].avg_sfcprs = daily->avg_sfcprs;
+        for (k = 0; k < MAXLYR; k++)
+        {
+            drv[i].avg_sh2o[k] = daily->avg_sh2o[k];
+        }
+
+        /* Mineral N transport is cached as the fraction of mineral N
+         * available in the day (storage at the start of the day plus inputs)
+         * that is gained by transport, so that it scales with mineral N in
+         * replay cycles */
+        avail = elem[i].spinup.n0 + elem[i].spinup.nin;
+        drv[i].ntrans = (avail > 0.0) ?
+            (elem[i].ns.surfn + elem[i].ns.sminn - avail) / avail : 0.0;
+
+        /* Inputs of the next day are set by DailyBgc of this day */
+        elem[i].spinup.n0 = elem[i].ns.surfn + elem[i].ns.sminn;
+        elem[i].spinup.nin = elem[i].nf.ndep_to_sminn +
+            elem[i].nf.nfix_to_sminn + elem[i].nsol.snksrc * DAYINSEC;
+    }
+}
+
+void RecordBgcDrv (elem_struct *elem, bgcdrv_struct *drv, FILE *drv_file)
+{
+    GetBgcDrv (elem, drv);
+
+    if (fwrite (drv, sizeof (bgcdrv_struct), nelem, drv_file) !=
+        (size_t)nelem)
+    {
+        PIHMprintf (VL_ERROR, "Error writing BGC driver cache.\n");
+        PIHMexit (EXIT_FAILURE);
+    }
+}
+
+void CompareBgcDrv (elem_struct *elem, bgcdrv_struct *drv, FILE *drv_file,
+    double *diff)
+{
+    int             i, k;
+    const bgcdrv_struct *cache;
+
+    /* Drivers of the day are compared with cached drivers of the same day.
+     * Maximum absolute differences of daytime air temperature, top layer
+     * soil temperature, soil moisture of all layers, and mineral N transport
+     * are stored in diff[0-3], and their sums in diff[4-7] */
+    cache = &drv[nelem];
+    if (fread (&drv[nelem], sizeof (bgcdrv_struct), nelem, drv_file) !=
+        (size_t)nelem)
+    {
+        PIHMprintf (VL_ERROR, "Error reading BGC driver cache.\n");
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    /* Mineral N transport is compared in kg N m-2, as the difference between
+     * coupled transport of the day and the transport that replay would apply
+     * to mineral N available in the same day. It is compared before
+     * GetBgcDrv moves available mineral N to the next day */
+    for (i = 0; i < nelem; i++)
+    {
+        double          avail;
+        double          d;
+
+        avail = elem[i].spinup.n0 + elem[i].spinup.nin;
+        d = fabs (elem[i].ns.surfn + elem[i].ns.sminn - avail -
+            cache[i].ntrans * avail);
+
+        diff[3] = (d > diff[3]) ? d : diff[3];
+        diff[7] += d;
+    }
+
+    GetBgcDrv (elem, drv);
+
+    for (i = 0; i < nelem; i++)
+    {
+        double          d[3];
+
+        d[0] = fabs (drv[i].tday - cache[i].tday);
+        d[1] = fabs (drv[i].avg_stc0 - cache[i].avg_stc0);
+        d[2] = 0.0;
+        for (k = 0; k < MAXLYR; k++)
+        {
+            d[2] = (fabs (drv[i].avg_sh2o[k] - cache[i].avg_sh2o[k]) > d[2]) ?
+                fabs (drv[i].avg_sh2o[k] - cache[i].avg_sh2o[k]) : d[2];
+        }
+
+        for (k = 0; k < 3; k++)
+        {
+            diff[k] = (d[k] > diff[k]) ? d[k] : diff[k];
+            diff[k + 4] += d[k];
+        }
+    }
+}
+
+void ReplayBgcDrv (pihm_struct pihm, bgcdrv_struct *drv, FILE *drv_file,
+    int t)
+{
+    int             i;
+
+    if (fread (drv, sizeof (bgcdrv_struct), nelem, drv_file) !=
+        (size_t)nelem)
+    {
+        PIHMprintf (VL_ERROR, "Error reading BGC driver cache.\n");
+        PIHMexit (EXIT_FAILURE);
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < nelem; i++)
+    {
+        int             k;
+        double          n0, nin;
+        double          frac;
+        elem_struct    *elem;
+
+        elem = &pihm->elem[i];
+
+        elem->daily.avg_sfctmp = drv[i].avg_sfctmp;
+        elem->daily.tday = drv[i].tday;
+        elem->daily.tnight = drv[i].tnight;
+        elem->daily.avg_stc[0] = drv[i].avg_stc0;
+        elem->daily.avg_soldn = drv[i].avg_soldn;
+        elem->daily.avg_albedo = drv[i].avg_albedo;
+        elem->daily.avg_q2d = drv[i].avg_q2d;
+        elem->daily.avg_ch = drv[i].avg_ch;
+        elem->daily.avg_sfcprs = drv[i].avg_sfcprs;
+        for (k = 0; k < MAXLYR; k++)
+        {
+            elem->daily.avg_sh2o[k] = drv[i].avg_sh2o[k];
+        }
+
+        /* Mineral N inputs and transport of the day. Leaching is accounted
+         * the same way as in coupled cycles */
+        n0 = elem->ns.surfn + elem->ns.sminn;
+        nin = elem->nf.ndep_to_sminn + elem->nf.nfix_to_sminn +
+            elem->nsol.snksrc * DAYINSEC;
+
+        frac = 1.0 + drv[i].ntrans;
+        frac = (frac > 0.0) ? frac : 0.0;
+
+        elem->ns.sminn += nin;
+        elem->ns.sminn = (elem->ns.sminn > 0.0) ? elem->ns.sminn : 0.0;
+        elem->ns.surfn *= frac;
+        elem->ns.sminn *= frac;
+
+        elem->ns.nleached_snk += n0 + nin - (elem->ns.surfn + elem->ns.sminn);
+
+        elem->nt.surfn0 = elem->ns.surfn;
+        elem->nt.sminn0 = elem->ns.sminn;
+
+        /* Test for nitrogen balance */
+        CheckNitrogenBalance (&elem->ns, &elem->epv.old_n_balance);
+    }
+
+    DailyBgc (pihm, t - DAYINSEC);
+
+    first_balance = 0;
 }
 
 void ResetSpinupStat (elem_struct *elem)
@@ -50,39 +384,72 @@ int CheckBgcSS (elem_struct *elem, double total_area, int first_cycle,
     int totalt, int spinyears)
 {
     int             i;
+    int             nsteady = 0;
     double          t1;
     double          soilc = 0.0;
     double          totalc = 0.0;
     int             steady;
     static double   soilc_prev = 0.0;
 
-    /* Convert soilc and totalc to average daily soilc */
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < nelem; i++)
+    {
+        spinup_struct  *spinup;
+
+        spinup = &elem[i].spinup;
+
+        /* Retired elements keep their last average soilc and totalc */
+        if (spinup->steady)
+        {
+            continue;
+        }
+
+        /* Convert soilc and totalc to average daily soilc */
+        spinup->soilc /= (double)(totalt / DAYINSEC);
+        spinup->totalc /= (double)(totalt / DAYINSEC);
+
+        if (!first_cycle)
+        {
+            spinup->dsoilc = (spinup->soilc - spinup->soilc_prev) /
+                (double)(totalt / DAYINSEC / 365);
+
+            /* Check if element reaches steady state */
+            if (fabs (spinup->dsoilc) < SPINUP_TOLERANCE)
+            {
+                spinup->steady = 1;
+                spinup->steady_year = spinyears;
+            }
+        }
+
+        spinup->soilc_prev = spinup->soilc;
+        spinup->totalc_prev = spinup->totalc;
+    }
+
     for (i = 0; i < nelem; i++)
     {
-        soilc += elem[i].spinup.soilc * elem[i].topo.area /
-            (double)(totalt / DAYINSEC) / total_area;
-        totalc += elem[i].spinup.totalc * elem[i].topo.area /
-            (double)(totalt / DAYINSEC) / total_area;
+        soilc += elem[i].spinup.soilc_prev * elem[i].topo.area / total_area;
+        totalc += elem[i].spinup.totalc_prev * elem[i].topo.area / total_area;
+        nsteady += elem[i].spinup.steady;
     }
 
     if (!first_cycle)
     {
         t1 = (soilc - soilc_prev) / (double)(totalt / DAYINSEC / 365);
 
-        /* Check if domain reaches steady state */
-        steady = (fabs (t1) < SPINUP_TOLERANCE);
-
         PIHMprintf (VL_NORMAL,
                 "spinyears = %d soilc_prev = %lg soilc = %lg pdif = %lg\n",
                 spinyears, soilc_prev, soilc, t1);
-    }
-    else
-    {
-        steady = 0;
+        PIHMprintf (VL_NORMAL, "%d of %d elements reach steady state.\n",
+            nsteady, nelem);
     }
 
     soilc_prev = soilc;
 
+    /* Domain reaches steady state when all elements do */
+    steady = (nsteady == nelem);
+
     if (steady)
     {
         PIHMprintf (VL_NORMAL, "Reaches steady state after %d year.\n",
@@ -91,3 +458,30 @@ int CheckBgcSS (elem_struct *elem, double total_area, int first_cycle,
 
     return (steady);
 }
+
+void PrtSpinupStat (char *fn, const elem_struct *elem, int spinyears,
+    int steady)
+{
+    int             i;
+    FILE           *fp;
+
+    fp = fopen (fn, "w");
+    CheckFile (fp, fn);
+
+    fprintf (fp, "# Spinup years: %d\n", spinyears);
+    fprintf (fp, "# Domain steady state: %s\n", steady ? "yes" : "no");
+    fprintf (fp, "%-8s%-8s%-14s%-16s%-16s%-16s\n", "ELEM", "STEADY",
+        "STEADY_YEAR", "SOILC", "TOTALC", "DSOILC");
+
+    /* Average daily soil and total C [kgC m-2] of the last cycle, and soil C
+     * change rate [kgC m-2 year-1] */
+    for (i = 0; i < nelem; i++)
+    {
+        fprintf (fp, "%-8d%-8d%-14d%-16.8lf%-16.8lf%-16.8lf\n", i + 1,
+            elem[i].spinup.steady, elem[i].spinup.steady_year,
+            elem[i].spinup.soilc_prev, elem[i].spinup.totalc_prev,
+            elem[i].spinup.dsoilc);
+    }
+
+    fclose (fp);
+}
@@ -1,12 +1,14 @@
 #include "pihm.h"
 
-void Decomp (double tsoil, const epconst_struct *epc, epvar_struct *epv,
+void Decomp (const epconst_struct *epc, const epvar_struct *epv,
     cstate_struct *cs, cflux_struct *cf, nstate_struct *ns, nflux_struct *nf,
     ntemp_struct *nt)
 {
-    double          rate_scalar, t_scalar, w_scalar;
-    double          tk;
-    double          minpsi, maxpsi;
+    /*
+     * Decomposition rate scalars are calculated by DecompScalarBlk for all
+     * elements in a block before this function is called
+     */
+    double          rate_scalar;
     double          rfl1s1, rfl2s2, rfl4s3, rfs1s2, rfs2s3, rfs3s4;
     double          kl1_base, kl2_base, kl4_base;
     double          ks1_base, ks2_base, ks3_base, ks4_base, kfrag_base;
@@ -21,57 +23,7 @@ void Decomp (double tsoil, const epconst_struct *epc, epvar_struct *epv,
     int             nlimit;
     double          ratio;
 
-    /* Calculate the rate constant scalar for soil temperature, assuming that
-     * the base rate constants are assigned for non-moisture limiting
-     * conditions at 25 C. The function used here is taken from Lloyd, J., and
-     * J.A. Taylor, 1994. On the temperature dependence of soil respiration.
-     * Functional Ecology, 8:315-323.
-     * This equation is a modification of their eqn. 11, changing the base
-     * temperature from 10 C to 25 C, since most of the microcosm studies used
-     * to get the base decomp rates were controlled at 25 C. */
-    /* No decomp processes for tsoil < -10.0 C */
-    if (tsoil < -10.0)
-    {
-        t_scalar = 0.0;
-    }
-    else
-    {
-        tk = tsoil + 273.15;
-        t_scalar = exp (308.56 * ((1.0 / 71.02) - (1.0 / (tk - 227.13))));
-    }
-
-    /* Calculate the rate constant scalar for soil water content. Uses the log
-     * relationship with water potential given in Andren, O., and K.
-     * Paustian, 1987. Barley straw decomposition in the field: a comparison
-     * of models. Ecology, 68(5):1190-1200 and supported by data in Orchard,
-     * V.A., and F.J. Cook, 1983. Relationship between soil respiration and
-     * soil moisture. Soil Biol. Biochem., 15(4):447-453. */
-    /* Set the maximum and minimum values for water potential limits (MPa) */
-    minpsi = -10.0;
-    maxpsi = -0.005;
-
-    /* No decomp below the minimum soil water potential */
-    if (epv->psi < minpsi)
-    {
-        w_scalar = 0.0;
-    }
-    else if (epv->psi > maxpsi)
-    {
-        w_scalar = 1.0;
-    }
-    else
-    {
-        w_scalar = log (minpsi / epv->psi) / log (minpsi / maxpsi);
-    }
-
-    /* Calculate the final rate scalar as the product of the temperature and
-     * water scalars */
-    rate_scalar = w_scalar * t_scalar;
-
-    /* Assign output variables */
-    epv->t_scalar = t_scalar;
-    epv->w_scalar = w_scalar;
-    epv->rate_scalar = rate_scalar;
+    rate_scalar = epv->rate_scalar;
 
     /* Calculate compartment C:N ratios */
     if (ns->litr1n > 0.0)
@@ -305,3 +257,72 @@ void Decomp (double tsoil, const epconst_struct *epc, epvar_struct *epv,
     nt->psoil4c_loss = psoil4c_loss;
     nt->kl4 = kl4;
 }
+
+void DecompScalarBlk (bgcblk_struct *blk)
+{
+    /*
+     * Decomposition rate scalars of all lanes of a block. The lane loop is
+     * free of branches, so that the compiler can vectorize it
+     */
+    int             k;
+    int             n;
+    const double    minpsi = -10.0;
+    const double    maxpsi = -0.005;
+    double          tsoil[NOAH_BLOCK];
+    double          psi[NOAH_BLOCK];
+    double          t_scalar[NOAH_BLOCK];
+    double          w_scalar[NOAH_BLOCK];
+
+    n = blk->ndcmp;
+
+    for (k = 0; k < n; k++)
+    {
+        tsoil[k] = blk->tsoil[k];
+        psi[k] = blk->epv[k]->psi;
+    }
+
+    for (k = 0; k < n; k++)
+    {
+        double          tk;
+        double          psi_lim;
+
+        /* Calculate the rate constant scalar for soil temperature, assuming
+         * that the base rate constants are assigned for non-moisture limiting
+         * conditions at 25 C. The function used here is taken from Lloyd,
+         * J., and J.A. Taylor, 1994. On the temperature dependence of soil
+         * respiration. Functional Ecology, 8:315-323.
+         * This equation is a modification of their eqn. 11, changing the
+         * base temperature from 10 C to 25 C, since most of the microcosm
+         * studies used to get the base decomp rates were controlled at
+         * 25 C. */
+        /* No decomp processes for tsoil < -10.0 C. Temperature is limited
+         * before the exponential so that no overflow occurs in discarded
+         * lanes */
+        tk = ((tsoil[k] > -10.0) ? tsoil[k] : -10.0) + 273.15;
+        t_scalar[k] = exp (308.56 * ((1.0 / 71.02) - (1.0 / (tk - 227.13))));
+        t_scalar[k] = (tsoil[k] < -10.0) ? 0.0 : t_scalar[k];
+
+        /* Calculate the rate constant scalar for soil water content. Uses
+         * the log relationship with water potential given in Andren, O., and
+         * K. Paustian, 1987. Barley straw decomposition in the field: a
+         * comparison of models. Ecology, 68(5):1190-1200 and supported by
+         * data in Orchard, V.A., and F.J. Cook, 1983. Relationship between
+         * soil respiration and soil moisture. Soil Biol. Biochem.,
+         * 15(4):447-453. */
+        /* Water potential is limited between the minimum and maximum
+         * values (MPa), which gives no decomp below the minimum and full
+         * decomp above the maximum */
+        psi_lim = (psi[k] > minpsi) ? psi[k] : minpsi;
+        psi_lim = (psi_lim < maxpsi) ? psi_lim : maxpsi;
+        w_scalar[k] = log (minpsi / psi_lim) / log (minpsi / maxpsi);
+    }
+
+    /* Assign output variables. The final rate scalar is the product of the
+     * temperature and water scalars */
+    for (k = 0; k < n; k++)
+    {
+        blk->epv[k]->t_scalar = t_scalar[k];
+        blk->epv[k]->w_scalar = w_scalar[k];
+        blk->epv[k]->rate_scalar = w_scalar[k] * t_scalar[k];
+    }
+}
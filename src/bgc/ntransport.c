@@ -1,45 +1,28 @@
 #include "pihm.h"
 
-void NTransport (pihm_struct pihm)
+#define NT_TOL          1.0E-6
+
+void NTransport (elem_struct *elem, river_struct *riv, tracer_struct *ntrans,
+    double stepsize)
 {
     int             i;
 
     /*
-     * Calculate solute N concentrantions
+     * Mineral N is transported as a single tracer. Deposition, fixation, and
+     * BGC sources and sinks are added to element subsurfaces
      */
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
     for (i = 0; i < nelem; i++)
     {
-        elem_struct *elem;
-        int         j;
-        double      strg;
-
-        elem = &pihm->elem[i];
-
-        /* Initialize N fluxes */
-        elem->nsol.infilflux = 0.0;
-        for (j = 0; j < NUM_EDGE; j++)
-        {
-            elem->nsol.ovlflux[j] = 0.0;
-            elem->nsol.subflux[j] = 0.0;
-        }
-
-        /* Element surface */
-        strg = elem->ws.surf;
-        elem->nsol.conc_surf = (strg > 0.0) ?
-            elem->ns.surfn / strg / 1000.0 : 0.0;
-        elem->nsol.conc_surf = (elem->nsol.conc_surf > 0.0) ?
-            elem->nsol.conc_surf : 0.0;
-
-        /* Element subsurface */
-        strg = (elem->ws.unsat + elem->ws.gw) * elem->soil.porosity +
-            elem->soil.depth * elem->soil.smcmin;
-        elem->nsol.conc_subsurf = (strg > 0.0) ?
-            elem->ns.sminn / strg / 1000.0 : 0.0;
-        elem->nsol.conc_subsurf = (elem->nsol.conc_subsurf > 0.0) ?
-            elem->nsol.conc_subsurf : 0.0;
+        ntrans->x[TR_SURF (i)] = elem[i].ns.surfn;
+        ntrans->x[TR_SUB (i)] = elem[i].ns.sminn;
+
+        ntrans->src[TR_SURF (i)] = 0.0;
+        ntrans->src[TR_SUB (i)] =
+            (elem[i].nf.ndep_to_sminn + elem[i].nf.nfix_to_sminn) /
+            DAYINSEC + elem[i].nsol.snksrc;
     }
 
 #ifdef _OPENMP
@@ -47,81 +30,59 @@ void NTransport (pihm_struct pihm)
 #endif
     for (i = 0; i < nriver; i++)
     {
-        river_struct *riv;
-        int         j;
-        double      strg;
-
-        riv = &pihm->riv[i];
-
-        /* Initialize N fluxes */
-        for (j = 0; j < NUM_RIVFLX; j++)
-        {
-            riv->nsol.flux[j] = 0.0;
-        }
-
-        /* River stream */
-        strg = riv->ws.stage;
-        riv->nsol.conc_stream = (strg > 0.0) ?
-            riv->ns.streamn / strg / 1000.0 : 0.0;
-        riv->nsol.conc_stream = (riv->nsol.conc_stream > 0.0) ?
-            riv->nsol.conc_stream : 0.0;
-
-        /* River bed */
-        strg = riv->ws.gw * riv->matl.porosity +
-            riv->matl.bedthick * riv->matl.smcmin;
-        riv->nsol.conc_bed = (strg > 0.0) ?
-            riv->ns.sminn / strg / 1000.0 : 0.0;
-        riv->nsol.conc_bed = (riv->nsol.conc_bed > 0.0) ?
-            riv->nsol.conc_bed : 0.0;
+        ntrans->x[TR_STREAM (i)] = riv[i].ns.streamn;
+        ntrans->x[TR_BED (i)] = riv[i].ns.sminn;
+
+        ntrans->src[TR_STREAM (i)] = 0.0;
+        ntrans->src[TR_BED (i)] = 0.0;
+    }
+
+    /* Evapotranspiration leaves mineral N behind */
+    TracerSinks (elem, 0, ntrans);
+
+    if (debug_mode)
+    {
+        CheckTracerSpecies (elem, riv, stepsize, ntrans);
+    }
+
+    TracerTransport (elem, riv, stepsize, ntrans);
+
+    /* Mineral N in the domain changes only by sources, sinks, and outflows
+     * through the outlet */
+    if (debug_mode && ntrans->errmax > NT_TOL)
+    {
+        PIHMprintf (VL_ERROR,
+            "Error: Mineral N is not conserved after %.0lf s.\n"
+            "The relative balance error is %.3le.\n", ntrans->time,
+            ntrans->errmax);
+        PIHMexit (EXIT_FAILURE);
     }
 
     /*
-     * Calculate solute fluxes
+     * Update N states and leaching
      */
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
     for (i = 0; i < nelem; i++)
     {
-        elem_struct *elem;
-        elem_struct *nabr;
-        int         j;
-
-        elem = &pihm->elem[i];
-
-        /* Infiltration */
-        elem->nsol.infilflux = elem->wf.infil * 1000.0 *
-            ((elem->wf.infil > 0.0) ?  elem->nsol.conc_surf :
-            MOBILEN_PROPORTION * elem->nsol.conc_subsurf);
-
-        /* Element to element */
-        for (j = 0; j < NUM_EDGE; j++)
-        {
-            if (elem->nabr[j] > 0)
-            {
-                nabr = &pihm->elem[elem->nabr[j] - 1];
-
-                elem->nsol.subflux[j] = elem->wf.subsurf[j] * 1000.0 *
-                    ((elem->wf.subsurf[j] > 0.0) ?
-                    MOBILEN_PROPORTION * elem->nsol.conc_subsurf :
-                    MOBILEN_PROPORTION * nabr->nsol.conc_subsurf);
-
-                elem->nsol.ovlflux[j] = elem->wf.ovlflow[j] * 1000.0 *
-                    ((elem->wf.ovlflow[j] > 0.0) ?
-                    MOBILEN_PROPORTION * elem->nsol.conc_surf :
-                    MOBILEN_PROPORTION * nabr->nsol.conc_surf);
-            }
-            else if (elem->nabr[j] < 0)
-            {
-                /* Do nothing. River-element interactions are calculated
-                 * later */
-            }
-            else                        /* Boundary condition flux */
-            {
-                elem->nsol.ovlflux[j] = 0.0;
-                elem->nsol.subflux[j] = 0.0;
-            }
-        }
+        elem[i].ns.surfn = ntrans->x[TR_SURF (i)];
+        elem[i].ns.sminn = ntrans->x[TR_SUB (i)];
+
+        elem[i].nsol.conc_surf = (ntrans->strg[TR_SURF (i)] > 0.0) ?
+            elem[i].ns.surfn / ntrans->strg[TR_SURF (i)] / 1000.0 : 0.0;
+        elem[i].nsol.conc_subsurf = (ntrans->strg[TR_SUB (i)] > 0.0) ?
+            elem[i].ns.sminn / ntrans->strg[TR_SUB (i)] / 1000.0 : 0.0;
+
+        elem[i].ns.nleached_snk +=
+            (elem[i].nt.surfn0 + elem[i].nt.sminn0) -
+            (elem[i].ns.surfn + elem[i].ns.sminn) +
+            elem[i].nf.ndep_to_sminn / DAYINSEC * stepsize +
+            elem[i].nf.nfix_to_sminn / DAYINSEC * stepsize +
+            elem[i].nsol.snksrc * stepsize;
+
+        elem[i].nt.surfn0 = elem[i].ns.surfn;
+        elem[i].nt.sminn0 = elem[i].ns.sminn;
     }
 
 #ifdef _OPENMP
@@ -129,121 +90,22 @@ void NTransport (pihm_struct pihm)
 #endif
     for (i = 0; i < nriver; i++)
     {
-        river_struct *riv;
-        river_struct *down;
-        elem_struct  *left;
-        elem_struct  *right;
-        int         j;
-
-        riv = &pihm->riv[i];
-
-        /* Downstream and upstream */
-        if (riv->down > 0)
-        {
-            down = &pihm->riv[riv->down - 1];
-
-            /* Stream */
-            riv->nsol.flux[DOWN_CHANL2CHANL] =
-                riv->wf.rivflow[DOWN_CHANL2CHANL] * 1000.0 *
-                ((riv->wf.rivflow[DOWN_CHANL2CHANL] > 0.0) ?
-                riv->nsol.conc_stream : down->nsol.conc_stream);
-
-            down->nsol.flux[UP_CHANL2CHANL] =
-                -riv->nsol.flux[DOWN_CHANL2CHANL];
-
-            /* Bed */
-            riv->nsol.flux[DOWN_AQUIF2AQUIF] =
-                riv->wf.rivflow[DOWN_AQUIF2AQUIF] * 1000.0 *
-                ((riv->wf.rivflow[DOWN_AQUIF2AQUIF] > 0.0) ?
-                MOBILEN_PROPORTION * riv->nsol.conc_bed :
-                MOBILEN_PROPORTION * down->nsol.conc_bed);
-
-            down->nsol.flux[UP_AQUIF2AQUIF] =
-                -riv->nsol.flux[DOWN_AQUIF2AQUIF];
-        }
-        else
-        {
-            riv->nsol.flux[DOWN_CHANL2CHANL] =
-                riv->wf.rivflow[DOWN_CHANL2CHANL] * 1000.0 *
-                riv->nsol.conc_stream;
-
-            riv->nsol.flux[DOWN_AQUIF2AQUIF] = 0.0;
-        }
-
-        /* Left and right banks */
-        left = &pihm->elem[riv->leftele - 1];
-        right = &pihm->elem[riv->rightele - 1];
-
-        if (riv->leftele > 0)
-        {
-            riv->nsol.flux[LEFT_SURF2CHANL] =
-                riv->wf.rivflow[LEFT_SURF2CHANL] * 1000.0 *
-                ((riv->wf.rivflow[LEFT_SURF2CHANL] > 0.0) ?
-                riv->nsol.conc_stream :
-                MOBILEN_PROPORTION * left->nsol.conc_surf);
-
-            riv->nsol.flux[LEFT_AQUIF2CHANL] =
-                riv->wf.rivflow[LEFT_AQUIF2CHANL] * 1000.0 *
-                ((riv->wf.rivflow[LEFT_AQUIF2CHANL] > 0.0) ?
-                riv->nsol.conc_stream :
-                MOBILEN_PROPORTION * left->nsol.conc_subsurf);
-
-            riv->nsol.flux[LEFT_AQUIF2AQUIF] =
-                riv->wf.rivflow[LEFT_AQUIF2AQUIF] * 1000.0 *
-                ((riv->wf.rivflow[LEFT_AQUIF2AQUIF] > 0.0) ?
-                MOBILEN_PROPORTION * riv->nsol.conc_bed :
-                MOBILEN_PROPORTION * left->nsol.conc_subsurf);
-
-            for (j = 0; j < NUM_EDGE; j++)
-            {
-                if (left->nabr[j] == - (i + 1))
-                {
-                    left->nsol.ovlflux[j] = -riv->nsol.flux[LEFT_SURF2CHANL];
-                    left->nsol.subflux[j] =
-                        -(riv->nsol.flux[LEFT_AQUIF2CHANL] +
-                        riv->nsol.flux[LEFT_AQUIF2AQUIF]);
-                    break;
-                }
-            }
-
-        }
-
-        if (riv->rightele > 0)
-        {
-            riv->nsol.flux[RIGHT_SURF2CHANL] =
-                riv->wf.rivflow[RIGHT_SURF2CHANL] * 1000.0 *
-                ((riv->wf.rivflow[RIGHT_SURF2CHANL] > 0.0) ?
-                riv->nsol.conc_stream :
-                MOBILEN_PROPORTION * right->nsol.conc_surf);
-
-            riv->nsol.flux[RIGHT_AQUIF2CHANL] =
-                riv->wf.rivflow[RIGHT_AQUIF2CHANL] * 1000.0 *
-                ((riv->wf.rivflow[RIGHT_AQUIF2CHANL] > 0.0) ?
-                riv->nsol.conc_stream :
-                MOBILEN_PROPORTION * right->nsol.conc_subsurf);
-
-            riv->nsol.flux[RIGHT_AQUIF2AQUIF] =
-                riv->wf.rivflow[RIGHT_AQUIF2AQUIF] * 1000.0 *
-                ((riv->wf.rivflow[RIGHT_AQUIF2AQUIF] > 0.0) ?
-                MOBILEN_PROPORTION * riv->nsol.conc_bed :
-                MOBILEN_PROPORTION * right->nsol.conc_subsurf);
-
-            for (j = 0; j < NUM_EDGE; j++)
-            {
-                if (right->nabr[j] == - (i + 1))
-                {
-                    right->nsol.ovlflux[j] =
-                        -riv->nsol.flux[RIGHT_SURF2CHANL];
-                    right->nsol.subflux[j] =
-                        -(riv->nsol.flux[RIGHT_AQUIF2CHANL] +
-                        riv->nsol.flux[RIGHT_AQUIF2AQUIF]);
-                    break;
-                }
-            }
-        }
-
-        riv->nsol.flux[CHANL_LKG] = riv->wf.rivflow[CHANL_LKG] * 1000.0 *
-            ((riv->wf.rivflow[CHANL_LKG] > 0.0) ?
-            riv->nsol.conc_stream : MOBILEN_PROPORTION * riv->nsol.conc_bed);
+        riv[i].ns.streamn = ntrans->x[TR_STREAM (i)];
+        riv[i].ns.sminn = ntrans->x[TR_BED (i)];
+
+        riv[i].nsol.conc_stream = (ntrans->strg[TR_STREAM (i)] > 0.0) ?
+            riv[i].ns.streamn / ntrans->strg[TR_STREAM (i)] / 1000.0 : 0.0;
+        riv[i].nsol.conc_bed = (ntrans->strg[TR_BED (i)] > 0.0) ?
+            riv[i].ns.sminn / ntrans->strg[TR_BED (i)] / 1000.0 : 0.0;
     }
 }
+
+void PrtNTransStats (const tracer_struct *ntrans)
+{
+    PIHMprintf (VL_NORMAL, "Mineral N transport:\n");
+    PIHMprintf (VL_NORMAL, "  Mineral N in the domain %.6le kg N, net sources "
+        "%.6le, outflows %.6le\n", ntrans->mass[0],
+        ntrans->gain[0], ntrans->loss[0]);
+    PIHMprintf (VL_NORMAL, "  Maximum relative balance error %.2le\n",
+        ntrans->errmax);
+}
@@ -1,20 +1,19 @@
 #include "pihm.h"
 
-void TotalPhotosynthesis (const epconst_struct *epc, epvar_struct *epv,
-    const pstate_struct *ps, cflux_struct *cf, psn_struct *psn_sun,
-    psn_struct *psn_shade, daily_struct *daily)
+void PsnInput (const epconst_struct *epc, const epvar_struct *epv,
+    const pstate_struct *ps, psn_struct *psn_sun, psn_struct *psn_shade,
+    const daily_struct *daily)
 {
     /*
-     * This function is a wrapper and replacement for the photosynthesis code
-     * which used to be in the central bgc.c code. At Mott Jolly's request,
-     * all of the science code is being moved into funtions.
+     * Set the input variables of sunlit and shaded canopy fraction
+     * photosynthesis. Photosynthesis of all elements in a block is then
+     * calculated together by PhotosynthesisBlk
      */
     double          tday;
 
     tday = daily->tday - TFREEZ;
 
     /* SUNLIT canopy fraction photosynthesis */
-    /* Set the input variables */
     psn_sun->c3 = epc->c3_flag;
     psn_sun->co2 = ps->co2;
     psn_sun->pa = daily->avg_sfcprs;
@@ -27,18 +26,6 @@ void TotalPhotosynthesis (const epconst_struct *epc, epvar_struct *epv,
     psn_sun->g = epv->gl_t_wv_sun * 1.0e6 / (1.6 * 8.3143 * (tday + TFREEZ));
     psn_sun->dlmr = epv->dlmr_area_sun;
 
-    /* Calculate photosynthesis for sunlit leaves */
-    Photosynthesis (psn_sun);
-
-    epv->assim_sun = psn_sun->A;
-
-    /* For the final flux assignment, the assimilation output needs to have
-     * the maintenance respiration rate added, this sum multiplied by the
-     * projected leaf area in the relevant canopy fraction, and this total
-     * converted from umol/m2/s -> kgC/m2/d */
-    cf->psnsun_to_cpool = (epv->assim_sun + epv->dlmr_area_sun) *
-        ps->plaisun * epv->dayl * 12.011e-9;
-
     /* SHADED canopy fraction photosynthesis */
     psn_shade->c3 = epc->c3_flag;
     psn_shade->co2 = ps->co2;
@@ -52,22 +39,33 @@ void TotalPhotosynthesis (const epconst_struct *epc, epvar_struct *epv,
     psn_shade->g =
         epv->gl_t_wv_shade * 1.0e6 / (1.6 * 8.3143 * (tday + TFREEZ));
     psn_shade->dlmr = epv->dlmr_area_shade;
-    /* Calculate photosynthesis for shaded leaves */
-    Photosynthesis (psn_shade);
+}
 
-    epv->assim_shade = psn_shade->A;
+void TotalPhotosynthesis (epvar_struct *epv, const pstate_struct *ps,
+    cflux_struct *cf, const psn_struct *psn_sun, const psn_struct *psn_shade)
+{
+    epv->assim_sun = psn_sun->A;
 
     /* For the final flux assignment, the assimilation output needs to have
      * the maintenance respiration rate added, this sum multiplied by the
      * projected leaf area in the relevant canopy fraction, and this total
      * converted from umol/m2/s -> kgC/m2/d */
+    cf->psnsun_to_cpool = (epv->assim_sun + epv->dlmr_area_sun) *
+        ps->plaisun * epv->dayl * 12.011e-9;
+
+    epv->assim_shade = psn_shade->A;
+
     cf->psnshade_to_cpool = (epv->assim_shade + epv->dlmr_area_shade) *
         ps->plaishade * epv->dayl * 12.011e-9;
 }
 
-void Photosynthesis (psn_struct *psn)
+void PhotosynthesisBlk (bgcblk_struct *blk)
 {
     /*
+     * Photosynthesis of all lanes of a block. Lane inputs are gathered into
+     * contiguous arrays, and the lane loop is free of branches, so that the
+     * compiler can vectorize it.
+     *
      * The following variables are assumed to be defined in the psn struct
      * at the time of the function call:
      * c3         (flag) set to 1 for C3 model, 0 for C4 model
@@ -102,7 +100,7 @@ void Photosynthesis (psn_struct *psn)
      * make up the enzyme, as listed in the Handbook of Biochemistry,
      * Proteins, Vol III, p. 510, which references: Kuehn and McFadden,
      * Biochemistry, 8:2403, 1969 */
-    static double   fnr = 7.16; /* kg Rub/kg NRub */
+    const double    fnr = 7.16; /* kg Rub/kg NRub */
 
     /* the following enzyme kinetic constants are from:
      * Woodrow, I.E., and J.A. Berry, 1980. Enzymatic regulation of
@@ -118,145 +116,190 @@ void Photosynthesis (psn_struct *psn)
      * All other parameters, including the q10's for Kc and Ko are the same as
      * in Woodrow and Berry. */
 
-    static double   Kc25 = 404.0;       /* (ubar) MM const carboxylase,
+    const double    Kc25 = 404.0;       /* (ubar) MM const carboxylase,
                                             25 deg C */
-    static double   q10Kc = 2.1;        /* (DIM) Q_10 for Kc */
-    static double   Ko25 = 248.0;       /* (mbar) MM const oxygenase,
+    const double    q10Kc = 2.1;        /* (DIM) Q_10 for Kc */
+    const double    Ko25 = 248.0;       /* (mbar) MM const oxygenase,
                                             25 deg C */
-    static double   q10Ko = 1.2;        /* (DIM) Q_10 for Ko */
-    static double   act25 = 3.6;        /* (umol/mgRubisco/min) Rubisco
+    const double    q10Ko = 1.2;        /* (DIM) Q_10 for Ko */
+    const double    act25 = 3.6;        /* (umol/mgRubisco/min) Rubisco
                                             activity */
-    static double   q10act = 2.4;       /* (DIM) Q_10 for Rubisco activity */
-    static double   pabs = 0.85;        /* (DIM) fPAR effectively absorbed by
+    const double    q10act = 2.4;       /* (DIM) Q_10 for Rubisco activity */
+    const double    pabs = 0.85;        /* (DIM) fPAR effectively absorbed by
                                             PSII */
 
-    /* local variables */
-    double          t;          /* (deg C) temperature */
-    double          tk;         /* (K) absolute temperature */
-    double          Kc;         /* (Pa) MM constant for carboxylase reaction*/
-    double          Ko;         /* (Pa) MM constant for oxygenase reaction */
-    double          act;        /* (umol CO2/kgRubisco/s) Rubisco activity */
-    double          Jmax;       /* (umol/m2/s) max rate electron transport */
-    double          ppe;        /* (mol/mol) photons absorbed by PSII per e-
-                                    transported */
-    double          Vmax, J, gamma, Ca, Rd, O2, g;
-    double          a, b, c, det;
-    double          Av, Aj, A;
-
-    /* begin by assigning local variables */
-    g = psn->g;
-    t = psn->t;
-    tk = t + 273.15;
-    Rd = psn->dlmr;
-
-    /* convert atmospheric CO2 from ppm --> Pa */
-    Ca = psn->co2 * psn->pa / 1e6;
-
-    /* set parameters for C3 vs C4 model */
-    if (psn->c3)
-    {
-        ppe = 2.6;
-    }
-    else                        /* C4 */
-    {
-        ppe = 3.5;
-        Ca *= 10.0;
-    }
-    psn->Ca = Ca;
-
-    /* calculate atmospheric O2 in Pa, assumes 21% O2 by volume */
-    psn->O2 = O2 = 0.21 * psn->pa;
-
-    /* correct kinetic constants for temperature, and do unit conversions */
-    Ko = Ko25 * pow (q10Ko, (t - 25.0) / 10.0);
-    psn->Ko = Ko = Ko * 100.0;  /* mbar --> Pa */
-    if (t > 15.0)
-    {
-        Kc = Kc25 * pow (q10Kc, (t - 25.0) / 10.0);
-        act = act25 * pow (q10act, (t - 25.0) / 10.0);
-    }
-    else
+    int             k;
+    int             n;
+    int             nneg;
+    int             c3[2 * NOAH_BLOCK];
+    double          pa[2 * NOAH_BLOCK];
+    double          co2[2 * NOAH_BLOCK];
+    double          tt[2 * NOAH_BLOCK];
+    double          lnc[2 * NOAH_BLOCK];
+    double          flnr[2 * NOAH_BLOCK];
+    double          ppfd[2 * NOAH_BLOCK];
+    double          gg[2 * NOAH_BLOCK];
+    double          dlmr[2 * NOAH_BLOCK];
+    double          ci[2 * NOAH_BLOCK];
+    double          o2[2 * NOAH_BLOCK];
+    double          ca[2 * NOAH_BLOCK];
+    double          gam[2 * NOAH_BLOCK];
+    double          kc[2 * NOAH_BLOCK];
+    double          ko[2 * NOAH_BLOCK];
+    double          vmax[2 * NOAH_BLOCK];
+    double          jmax[2 * NOAH_BLOCK];
+    double          jj[2 * NOAH_BLOCK];
+    double          av[2 * NOAH_BLOCK];
+    double          aj[2 * NOAH_BLOCK];
+    double          aa[2 * NOAH_BLOCK];
+
+    n = blk->npsn;
+
+    /* Gather lane inputs */
+    for (k = 0; k < n; k++)
     {
-        Kc = Kc25 * pow (1.8 * q10Kc, (t - 15.0) / 10.0) / q10Kc;
-        act = act25 * pow (1.8 * q10act, (t - 15.0) / 10.0) / q10act;
+        c3[k] = blk->psn[k]->c3;
+        pa[k] = blk->psn[k]->pa;
+        co2[k] = blk->psn[k]->co2;
+        tt[k] = blk->psn[k]->t;
+        lnc[k] = blk->psn[k]->lnc;
+        flnr[k] = blk->psn[k]->flnr;
+        ppfd[k] = blk->psn[k]->ppfd;
+        gg[k] = blk->psn[k]->g;
+        dlmr[k] = blk->psn[k]->dlmr;
     }
-    psn->Kc = Kc = Kc * 0.10;   /* ubar --> Pa */
-    act = act * 1e6 / 60.0;     /* umol/mg/min --> umol/kg/s */
-
-    /* calculate gamma (Pa), assumes Vomax/Vcmax = 0.21 */
-    psn->gamma = gamma = 0.5 * 0.21 * Kc * psn->O2 / Ko;
-
-    /* calculate Vmax from leaf nitrogen data and Rubisco activity */
-
-    /* kg Nleaf   kg NRub    kg Rub      umol            umol
-     * -------- X -------  X ------- X ---------   =   --------
-     *  m2         kg Nleaf   kg NRub   kg RUB * s       m2 * s
-     *
-     * (lnc)  X  (flnr)  X  (fnr)  X   (act)     =    (Vmax) */
-    psn->Vmax = Vmax = psn->lnc * psn->flnr * fnr * act;
-
-    /* calculate Jmax = f(Vmax), reference:
-     * Wullschleger, S.D., 1993.  Biochemical limitations to carbon
-     * assimilation in C3 plants - A retrospective analysis of the A/Ci curves
-     * from 109 species. Journal of Experimental Botany, 44:907-920. */
-    psn->Jmax = Jmax = 2.1 * Vmax;
-
-    /* calculate J = f(Jmax, ppfd), reference:
-     * de Pury and Farquhar 1997 Plant Cell and Env. */
-    a = 0.7;
-    b = -Jmax - (psn->ppfd * pabs / ppe);
-    c = Jmax * psn->ppfd * pabs / ppe;
-    psn->J = J = (-b - sqrt (b * b - 4.0 * a * c)) / (2.0 * a);
-
-    /* solve for Av and Aj using the quadratic equation, substitution for Ci
-     * from A = g(Ca-Ci) into the equations from Farquhar and von Caemmerer:
-     *
-     *        Vmax (Ci - gamma)
-     * Av =  -------------------   -   Rd
-     *        Ci + Kc (1 + O2/Ko)
-     *
-     *          J (Ci - gamma)
-     * Aj  =  -------------------  -   Rd
-     *        4.5 Ci + 10.5 gamma
-     */
-
-    /* quadratic solution for Av */
-    a = -1.0 / g;
-    b = Ca + (Vmax - Rd) / g + Kc * (1.0 + O2 / Ko);
-    c = Vmax * (gamma - Ca) + Rd * (Ca + Kc * (1.0 + O2 / Ko));
 
-    if ((det = b * b - 4.0 * a * c) < 0.0)
+    nneg = 0;
+    for (k = 0; k < n; k++)
     {
-        PIHMprintf (VL_ERROR,
-            "ERROR: negative root error in psn routine\n");
-        PIHMexit (EXIT_FAILURE);
+        double          t;      /* (deg C) temperature */
+        double          Kc;     /* (Pa) MM constant for carboxylase
+                                 * reaction */
+        double          Ko;     /* (Pa) MM constant for oxygenase reaction */
+        double          act;    /* (umol CO2/kgRubisco/s) Rubisco activity */
+        double          Jmax;   /* (umol/m2/s) max rate electron transport */
+        double          ppe;    /* (mol/mol) photons absorbed by PSII per e-
+                                 * transported */
+        double          Vmax, J, gamma, Ca, Rd, O2, g;
+        double          a, b, c, det;
+        double          warm;
+        double          A;
+
+        /* begin by assigning local variables */
+        g = gg[k];
+        t = tt[k];
+        Rd = dlmr[k];
+
+        /* set parameters for C3 vs C4 model, and convert atmospheric CO2
+         * from ppm --> Pa */
+        ppe = (c3[k]) ? 2.6 : 3.5;
+        Ca = co2[k] * pa[k] / 1e6;
+        Ca = (c3[k]) ? Ca : Ca * 10.0;
+        ca[k] = Ca;
+
+        /* calculate atmospheric O2 in Pa, assumes 21% O2 by volume */
+        o2[k] = O2 = 0.21 * pa[k];
+
+        /* correct kinetic constants for temperature, and do unit
+         * conversions. Below 15 deg C, q10's are increased by 1.8 and
+         * referenced to 15 deg C */
+        Ko = Ko25 * pow (q10Ko, (t - 25.0) / 10.0);
+        ko[k] = Ko = Ko * 100.0;       /* mbar --> Pa */
+        warm = (t > 15.0);
+        Kc = Kc25 * pow ((warm) ? q10Kc : 1.8 * q10Kc,
+            (warm) ? (t - 25.0) / 10.0 : (t - 15.0) / 10.0);
+        Kc = (warm) ? Kc : Kc / q10Kc;
+        act = act25 * pow ((warm) ? q10act : 1.8 * q10act,
+            (warm) ? (t - 25.0) / 10.0 : (t - 15.0) / 10.0);
+        act = (warm) ? act : act / q10act;
+        kc[k] = Kc = Kc * 0.10;        /* ubar --> Pa */
+        act = act * 1e6 / 60.0;         /* umol/mg/min --> umol/kg/s */
+
+        /* calculate gamma (Pa), assumes Vomax/Vcmax = 0.21 */
+        gam[k] = gamma = 0.5 * 0.21 * Kc * O2 / Ko;
+
+        /* calculate Vmax from leaf nitrogen data and Rubisco activity */
+
+        /* kg Nleaf   kg NRub    kg Rub      umol            umol
+         * -------- X -------  X ------- X ---------   =   --------
+         *  m2         kg Nleaf   kg NRub   kg RUB * s       m2 * s
+         *
+         * (lnc)  X  (flnr)  X  (fnr)  X   (act)     =    (Vmax) */
+        vmax[k] = Vmax = lnc[k] * flnr[k] * fnr * act;
+
+        /* calculate Jmax = f(Vmax), reference:
+         * Wullschleger, S.D., 1993.  Biochemical limitations to carbon
+         * assimilation in C3 plants - A retrospective analysis of the A/Ci
+         * curves from 109 species. Journal of Experimental Botany,
+         * 44:907-920. */
+        jmax[k] = Jmax = 2.1 * Vmax;
+
+        /* calculate J = f(Jmax, ppfd), reference:
+         * de Pury and Farquhar 1997 Plant Cell and Env. */
+        a = 0.7;
+        b = -Jmax - (ppfd[k] * pabs / ppe);
+        c = Jmax * ppfd[k] * pabs / ppe;
+        jj[k] = J = (-b - sqrt (b * b - 4.0 * a * c)) / (2.0 * a);
+
+        /* solve for Av and Aj using the quadratic equation, substitution for
+         * Ci from A = g(Ca-Ci) into the equations from Farquhar and von
+         * Caemmerer:
+         *
+         *        Vmax (Ci - gamma)
+         * Av =  -------------------   -   Rd
+         *        Ci + Kc (1 + O2/Ko)
+         *
+         *          J (Ci - gamma)
+         * Aj  =  -------------------  -   Rd
+         *        4.5 Ci + 10.5 gamma
+         */
+
+        /* quadratic solution for Av */
+        a = -1.0 / g;
+        b = Ca + (Vmax - Rd) / g + Kc * (1.0 + O2 / Ko);
+        c = Vmax * (gamma - Ca) + Rd * (Ca + Kc * (1.0 + O2 / Ko));
+
+        det = b * b - 4.0 * a * c;
+        nneg += (det < 0.0);
+
+        av[k] = (-b + sqrt (det)) / (2.0 * a);
+
+        /* quadratic solution for Aj */
+        a = -4.5 / g;
+        b = 4.5 * Ca + 10.5 * gamma + J / g - 4.5 * Rd / g;
+        c = J * (gamma - Ca) + Rd * (4.5 * Ca + 10.5 * gamma);
+
+        det = b * b - 4.0 * a * c;
+        nneg += (det < 0.0);
+
+        aj[k] = (-b + sqrt (det)) / (2.0 * a);
+
+        /* estimate A as the minimum of (Av,Aj) */
+        aa[k] = A = (av[k] < aj[k]) ? av[k] : aj[k];
+        ci[k] = Ca - (A / g);
     }
 
-    psn->Av = Av = (-b + sqrt (det)) / (2.0 * a);
-
-    /* quadratic solution for Aj */
-    a = -4.5 / g;
-    b = 4.5 * Ca + 10.5 * gamma + J / g - 4.5 * Rd / g;
-    c = J * (gamma - Ca) + Rd * (4.5 * Ca + 10.5 * gamma);
-
-    if ((det = b * b - 4.0 * a * c) < 0.0)
+    if (nneg > 0)
     {
         PIHMprintf (VL_ERROR,
             "ERROR: negative root error in psn routine\n");
         PIHMexit (EXIT_FAILURE);
     }
 
-    psn->Aj = Aj = (-b + sqrt (det)) / (2.0 * a);
-
-    /* estimate A as the minimum of (Av,Aj) */
-    if (Av < Aj)
-    {
-        A = Av;
-    }
-    else
+    /* Scatter lane outputs */
+    for (k = 0; k < n; k++)
     {
-        A = Aj;
+        blk->psn[k]->Ca = ca[k];
+        blk->psn[k]->O2 = o2[k];
+        blk->psn[k]->Ko = ko[k];
+        blk->psn[k]->Kc = kc[k];
+        blk->psn[k]->gamma = gam[k];
+        blk->psn[k]->Vmax = vmax[k];
+        blk->psn[k]->Jmax = jmax[k];
+        blk->psn[k]->J = jj[k];
+        blk->psn[k]->Av = av[k];
+        blk->psn[k]->Aj = aj[k];
+        blk->psn[k]->A = aa[k];
+        blk->psn[k]->Ci = ci[k];
     }
-    psn->A = A;
-    psn->Ci = Ca - (A / g);
 }
@@ -169,16 +169,32 @@ void RestartOutput (cstate_struct *cs, nstate_struct *ns, epvar_struct *epv,
 void ReadBgcIC (char *fn, elem_struct *elem, river_struct *riv)
 {
     FILE           *init_file;
+    rsthdr_struct   hdr;
+    int             sec;
     int             i;
 
-    init_file = fopen (fn, "rb");
-    CheckFile (init_file, fn);
+    init_file = OpenRestartRd (fn, RST_BGC_SEC, sizeof (bgcic_struct),
+        sizeof (river_bgcic_struct), &hdr, &sec);
+    if (NULL == init_file)
+    {
+        /* Restart files written by earlier versions have no header */
+        init_file = fopen (fn, "rb");
+        CheckFile (init_file, fn);
+    }
     PIHMprintf (VL_VERBOSE, " Reading %s\n", fn);
 
     for (i = 0; i < nelem; i++)
     {
-        fread (&elem[i].restart_input, sizeof (bgcic_struct), 1,
-            init_file);
+        if (sec >= 0)
+        {
+            ReadRestartRec (init_file, &hdr, sec, RST_ELEM, i,
+                &elem[i].restart_input);
+        }
+        else
+        {
+            fread (&elem[i].restart_input, sizeof (bgcic_struct), 1,
+                init_file);
+        }
 
         /* If simulation is accelerated spinup, adjust soil C pool sizes if
          * needed */
@@ -198,8 +214,16 @@ void ReadBgcIC (char *fn, elem_struct *elem, river_struct *riv)
 
     for (i = 0; i < nriver; i++)
     {
-        fread (&riv[i].restart_input, sizeof (river_bgcic_struct), 1,
-            init_file);
+        if (sec >= 0)
+        {
+            ReadRestartRec (init_file, &hdr, sec, RST_RIV, i,
+                &riv[i].restart_input);
+        }
+        else
+        {
+            fread (&riv[i].restart_input, sizeof (river_bgcic_struct), 1,
+                init_file);
+        }
     }
 
     fclose (init_file);
@@ -208,10 +232,12 @@ void ReadBgcIC (char *fn, elem_struct *elem, river_struct *riv)
 void WriteBgcIC (char *restart_fn, elem_struct *elem, river_struct *riv)
 {
     int         i;
+    int         sec;
     FILE       *restart_file;
+    rsthdr_struct hdr;
 
-    restart_file = fopen (restart_fn, "wb");
-    CheckFile (restart_file, restart_fn);
+    restart_file = OpenRestartWr (restart_fn, RST_BGC_SEC,
+        sizeof (bgcic_struct), sizeof (river_bgcic_struct), &hdr, &sec);
     PIHMprintf (VL_VERBOSE, "Writing BGC initial conditions.\n");
 
     for (i = 0; i < nelem; i++)
@@ -234,8 +260,8 @@ void WriteBgcIC (char *restart_fn, elem_struct *elem, river_struct *riv)
             elem[i].restart_output.soil4n *= KS4_ACC;
         }
 
-        fwrite (&(elem[i].restart_output), sizeof (bgcic_struct), 1,
-            restart_file);
+        WriteRestartRec (restart_file, &hdr, sec, RST_ELEM, i,
+            &elem[i].restart_output);
     }
 
     for (i = 0; i < nriver; i++)
@@ -243,7 +269,62 @@ void WriteBgcIC (char *restart_fn, elem_struct *elem, river_struct *riv)
         riv[i].restart_output.streamn = riv[i].ns.streamn;
         riv[i].restart_output.sminn = riv[i].ns.sminn;
 
-        fwrite (&(riv[i].restart_output), sizeof (river_bgcic_struct), 1,
-            restart_file);
+        WriteRestartRec (restart_file, &hdr, sec, RST_RIV, i,
+            &riv[i].restart_output);
+    }
+
+    fclose (restart_file);
+
+    if (debug_mode)
+    {
+        CheckBgcIC (restart_fn, elem, riv);
+    }
+}
+
+void CheckBgcIC (char *restart_fn, const elem_struct *elem,
+    const river_struct *riv)
+{
+    FILE           *restart_file;
+    rsthdr_struct   hdr;
+    int             sec;
+    int             i;
+    bgcic_struct    elem_rec;
+    river_bgcic_struct riv_rec;
+
+    /* Records read back from the restart file must be identical to the
+     * records that were written */
+    restart_file = OpenRestartRd (restart_fn, RST_BGC_SEC,
+        sizeof (bgcic_struct), sizeof (river_bgcic_struct), &hdr, &sec);
+    CheckFile (restart_file, restart_fn);
+
+    for (i = 0; i < nelem; i++)
+    {
+        ReadRestartRec (restart_file, &hdr, sec, RST_ELEM, i, &elem_rec);
+        if (memcmp (&elem_rec, &elem[i].restart_output,
+            sizeof (bgcic_struct)) != 0)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error: BGC restart record of Element %d in %s differs "
+                "from the written record.\n", i + 1, restart_fn);
+            PIHMexit (EXIT_FAILURE);
+        }
+    }
+
+    for (i = 0; i < nriver; i++)
+    {
+        ReadRestartRec (restart_file, &hdr, sec, RST_RIV, i, &riv_rec);
+        if (memcmp (&riv_rec, &riv[i].restart_output,
+            sizeof (river_bgcic_struct)) != 0)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error: BGC restart record of River Segment %d in %s "
+                "differs from the written record.\n", i + 1, restart_fn);
+            PIHMexit (EXIT_FAILURE);
+        }
     }
+
+    fclose (restart_file);
+
+    PIHMprintf (VL_NORMAL, " BGC restart records of %d elements and %d "
+        "river segments are read back identically.\n", nelem, nriver);
 }
@@ -269,44 +269,37 @@ void InitCycles (elem_struct *elem, river_struct *riv,
 void WriteCyclesIC (char *restart_fn, elem_struct *elem, river_struct *riv)
 {
     int             i, j;
+    int             sec;
     FILE           *restart_file;
+    rsthdr_struct   hdr;
+    cyclesic_struct restart;
+    river_cyclesic_struct riv_restart;
 
-    restart_file = fopen (restart_fn, "wb");
-    CheckFile (restart_file, restart_fn);
+    restart_file = OpenRestartWr (restart_fn, RST_CYCLES_SEC,
+        sizeof (cyclesic_struct), sizeof (river_cyclesic_struct), &hdr, &sec);
     PIHMprintf (VL_VERBOSE, "Writing Cycles initial conditions.\n");
 
     for (i = 0; i < nelem; i++)
     {
         for (j = 0; j < MAXLYR; j++)
         {
-            fwrite (&elem[i].soil.SOC_Mass[j], sizeof (double), 1, restart_file);
-        }
-        for (j = 0; j < MAXLYR; j++)
-        {
-            fwrite (&elem[i].soil.SON_Mass[j], sizeof (double), 1, restart_file);
-        }
-        for (j = 0; j < MAXLYR; j++)
-        {
-            fwrite (&elem[i].soil.MBC_Mass[j], sizeof (double), 1, restart_file);
-        }
-        for (j = 0; j < MAXLYR; j++)
-        {
-            fwrite (&elem[i].soil.MBN_Mass[j], sizeof (double), 1, restart_file);
-        }
-        for (j = 0; j < MAXLYR; j++)
-        {
-            fwrite (&elem[i].soil.NO3[j], sizeof (double), 1, restart_file);
-        }
-        for (j = 0; j < MAXLYR; j++)
-        {
-            fwrite (&elem[i].soil.NH4[j], sizeof (double), 1, restart_file);
+            restart.SOC_Mass[j] = elem[i].soil.SOC_Mass[j];
+            restart.SON_Mass[j] = elem[i].soil.SON_Mass[j];
+            restart.MBC_Mass[j] = elem[i].soil.MBC_Mass[j];
+            restart.MBN_Mass[j] = elem[i].soil.MBN_Mass[j];
+            restart.NO3[j] = elem[i].soil.NO3[j];
+            restart.NH4[j] = elem[i].soil.NH4[j];
         }
+
+        WriteRestartRec (restart_file, &hdr, sec, RST_ELEM, i, &restart);
     }
 
     for (i = 0; i < nriver; i++)
     {
-       fwrite (&riv[i].NO3sol.soluteMass, sizeof (double), 1, restart_file);
-       fwrite (&riv[i].NH4sol.soluteMass, sizeof (double), 1, restart_file);
+        riv_restart.NO3_Mass = riv[i].NO3sol.soluteMass;
+        riv_restart.NH4_Mass = riv[i].NH4sol.soluteMass;
+
+        WriteRestartRec (restart_file, &hdr, sec, RST_RIV, i, &riv_restart);
     }
 
     fclose (restart_file);
@@ -984,22 +984,46 @@ int CropExist (char *cropName, const croptbl_struct *croptbl)
 void ReadCyclesIC (char *fn, elem_struct *elem, river_struct *riv)
 {
     FILE           *init_file;
+    rsthdr_struct   hdr;
+    int             sec;
     int             i;
 
-    init_file = fopen (fn, "rb");
-    CheckFile (init_file, fn);
+    init_file = OpenRestartRd (fn, RST_CYCLES_SEC, sizeof (cyclesic_struct),
+        sizeof (river_cyclesic_struct), &hdr, &sec);
+    if (NULL == init_file)
+    {
+        /* Restart files written by earlier versions have no header */
+        init_file = fopen (fn, "rb");
+        CheckFile (init_file, fn);
+    }
     PIHMprintf (VL_VERBOSE, " Reading %s\n", fn);
 
     for (i = 0; i < nelem; i++)
     {
-        fread (&elem[i].cycles_restart, sizeof (cyclesic_struct), 1,
-            init_file);
+        if (sec >= 0)
+        {
+            ReadRestartRec (init_file, &hdr, sec, RST_ELEM, i,
+                &elem[i].cycles_restart);
+        }
+        else
+        {
+            fread (&elem[i].cycles_restart, sizeof (cyclesic_struct), 1,
+                init_file);
+        }
     }
 
     for (i = 0; i < nriver; i++)
     {
-        fread (&riv[i].cycles_restart, sizeof (river_cyclesic_struct), 1,
-            init_file);
+        if (sec >= 0)
+        {
+            ReadRestartRec (init_file, &hdr, sec, RST_RIV, i,
+                &riv[i].cycles_restart);
+        }
+        else
+        {
+            fread (&riv[i].cycles_restart, sizeof (river_cyclesic_struct), 1,
+                init_file);
+        }
     }
 
     fclose (init_file);
@@ -0,0 +1,392 @@
+#include "pihm.h"
+
+void RunEnsemble (pihm_struct pihm, char *outputdir)
+{
+    ens_struct      ens;
+    char            fn[MAXSTRING];
+    int             i, k;
+#ifdef _OPENMP
+    double          start_omp;
+#else
+    clock_t         start;
+#endif
+
+    /* Read ensemble description file */
+    CheckStrLen (snprintf (fn, MAXSTRING, "input/%s/%s.ens", project,
+        project), fn);
+    ReadEns (fn, &ens);
+
+#ifdef _NOAH_
+    /* Members share meteorological forcing, which is interpolated every
+     * LSM_STEP */
+    if (pihm->ctrl.lsm_adapt)
+    {
+        PIHMprintf (VL_NORMAL, "Warning: Adaptive land surface steps are not "
+            "supported in ensemble mode, and are turned off.\n");
+        pihm->ctrl.lsm_adapt = 0;
+    }
+#endif
+
+    /* Initialize ensemble members */
+    InitEns (pihm, &ens, outputdir);
+
+#if defined(_BGC_) || defined (_CYCLES_)
+    first_balance = 1;
+#endif
+
+    PIHMprintf (VL_VERBOSE, "\n\nSolving ODE system for %d ensemble members"
+        " ... \n\n", ens.nmember);
+
+#ifdef _OPENMP
+    start_omp = omp_get_wtime ();
+#else
+    start = clock ();
+#endif
+
+    for (i = 0; i < pihm->ctrl.nstep; i++)
+    {
+        double          cputime;
+
+#ifdef _OPENMP
+        cputime = omp_get_wtime () - start_omp;
+#else
+        cputime = ((double)(clock () - start)) / CLOCKS_PER_SEC;
+#endif
+
+        /* Forcing is shared by all members, so interpolate it once before
+         * the members are advanced. IntrplForcing calls inside PIHM are then
+         * read-only */
+        IntrplEnsForcing (pihm, pihm->ctrl.tout[i]);
+
+        /* Members are scheduled dynamically across threads. Element loops
+         * inside each member run serially within the nested region */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+        for (k = 0; k < ens.nmember; k++)
+        {
+            member_struct  *member;
+            long int        ncfn0, nni0;
+
+            member = &ens.member[k];
+
+            ncfn0 = member->ncfn;
+            nni0 = member->nni;
+
+            PIHM (member->pihm, member->cvode_mem, member->CV_Y,
+                pihm->ctrl.tout[i], pihm->ctrl.tout[i + 1], member->outputdir,
+                member->name, cputime, member->watbal);
+
+            CVodeGetNumNonlinSolvConvFails (member->cvode_mem,
+                &member->ncfn);
+            CVodeGetNumNonlinSolvIters (member->cvode_mem,
+                &member->nni);
+
+            /* Variable CVode Max Step (to reduce oscillations) */
+            if ((member->ncfn - ncfn0 > pihm->ctrl.nncfn ||
+                member->nni - nni0 > pihm->ctrl.nnimax) &&
+                member->maxstep > pihm->ctrl.stmin)
+            {
+                member->maxstep /= pihm->ctrl.decr;
+                CVodeSetMaxStep (member->cvode_mem,
+                    (realtype)member->maxstep);
+            }
+            if (member->ncfn == ncfn0 &&
+                member->maxstep < pihm->ctrl.maxstep &&
+                member->nni - nni0 < pihm->ctrl.nnimin)
+            {
+                member->maxstep *= pihm->ctrl.incr;
+                CVodeSetMaxStep (member->cvode_mem,
+                    (realtype)member->maxstep);
+            }
+
+            /* Write init files */
+            if (pihm->ctrl.write_ic &&
+                (pihm->ctrl.tout[i] - pihm->ctrl.starttime) %
+                pihm->ctrl.prtvrbl[IC_CTRL] == 0)
+            {
+                PrtInit (member->pihm->elem, member->pihm->riv, member->name,
+                    pihm->ctrl.tout[i]);
+            }
+        }
+    }
+
+    for (k = 0; k < ens.nmember; k++)
+    {
+        long int        nst, nfe;
+
+        CVodeGetNumSteps (ens.member[k].cvode_mem, &nst);
+        CVodeGetNumRhsEvals (ens.member[k].cvode_mem, &nfe);
+
+        PIHMprintf (VL_NORMAL, "%s: nst = %-6ld nfe  = %-6ld "
+            "nni = %-6ld ncfn = %-6ld\n", ens.member[k].name, nst, nfe,
+            ens.member[k].nni, ens.member[k].ncfn);
+#ifdef _NOAH_
+        PrtFrzStats (ens.member[k].pihm->elem);
+#endif
+    }
+
+    FreeEns (&ens);
+}
+
+void ReadEns (char *filename, ens_struct *ens)
+{
+    char            cmdstr[MAXSTRING];
+    FILE           *ens_file;           /* Pointer to .ens file */
+    int             lno = 0;
+    int             i;
+
+    ens_file = fopen (filename, "r");
+    CheckFile (ens_file, filename);
+    PIHMprintf (VL_VERBOSE, " Reading %s\n", filename);
+
+    NextLine (ens_file, cmdstr, &lno);
+    ReadKeyword (cmdstr, "NUM_MEMBER", &ens->nmember, 'i', filename, lno);
+
+    if (ens->nmember < 1)
+    {
+        PIHMprintf (VL_ERROR,
+            "Error: Ensemble should contain at least one member.\n");
+        PIHMprintf (VL_ERROR, "Error reading %s near Line %d.\n", filename,
+            lno);
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    ens->member =
+        (member_struct *)malloc (ens->nmember * sizeof (member_struct));
+
+    for (i = 0; i < ens->nmember; i++)
+    {
+        NextLine (ens_file, cmdstr, &lno);
+        ReadKeyword (cmdstr, "MEMBER", ens->member[i].name, 's', filename,
+            lno);
+    }
+
+    fclose (ens_file);
+}
+
+void InitEns (pihm_struct pihm, ens_struct *ens, char *outputdir)
+{
+    int             k;
+
+    for (k = 0; k < ens->nmember; k++)
+    {
+        member_struct  *member;
+
+        member = &ens->member[k];
+
+        if (k == 0)
+        {
+            /* The first member owns the input tables and forcing */
+            member->pihm = pihm;
+        }
+        else
+        {
+            /* Other members share input tables and forcing with the first
+             * member. Element, river, and output structures are allocated
+             * by Initialize and MapOutput */
+            member->pihm = (pihm_struct)malloc (sizeof *member->pihm);
+            *member->pihm = *pihm;
+            member->pihm->forc.shared = 1;
+        }
+
+        CheckStrLen (snprintf (member->pihm->filename.calib, MAXSTRING,
+            "input/%s/%s.calib", project, member->name),
+            member->pihm->filename.calib);
+        ReadCalib (member->pihm->filename.calib, &member->pihm->cal);
+
+        if (k > 0 && (member->pihm->cal.prcp != pihm->cal.prcp ||
+            member->pihm->cal.sfctmp != pihm->cal.sfctmp))
+        {
+            PIHMprintf (VL_ERROR, "Error: Ensemble member %s has different "
+                "precipitation or temperature scenario from member %s.\n",
+                member->name, ens->member[0].name);
+            PIHMprintf (VL_ERROR,
+                "Forcing is shared by all ensemble members.\n");
+            PIHMexit (EXIT_FAILURE);
+        }
+
+        member->CV_Y = N_VNew (NSV);
+#ifdef _OPENMP
+        if (member->pihm->ctrl.first_touch)
+        {
+            FirstTouchVector (member->CV_Y);
+        }
+#endif
+
+        Initialize (member->pihm, member->CV_Y);
+
+        /* Create member output directory and output structures */
+        CheckStrLen (snprintf (member->outputdir, MAXSTRING, "%s%s/",
+            outputdir, member->name), member->outputdir);
+        CreateOutputDir (member->outputdir);
+
+        MapOutput (member->name, member->pihm, member->outputdir);
+
+        InitOutputFile (member->pihm->prtctrl, member->pihm->ctrl.nprint,
+            member->pihm->ctrl.ascii, member->pihm->prtctrlT,
+            member->pihm->ctrl.nprintT, member->pihm->ctrl.tecplot);
+
+        if (member->pihm->ctrl.waterB)
+        {
+            char            fn[MAXSTRING];
+
+            CheckStrLen (snprintf (fn, MAXSTRING, "%s%s_WaterBalance.plt",
+                member->outputdir, member->name), fn);
+            member->watbal = fopen (fn, "w");
+            CheckFile (member->watbal, fn);
+        }
+        else
+        {
+            member->watbal = NULL;
+        }
+
+        /* Allocate memory for solver */
+        member->cvode_mem = CVodeCreate (CV_BDF, CV_NEWTON);
+        if (member->cvode_mem == NULL)
+        {
+            PIHMprintf (VL_ERROR, "Error in allocating memory for solver.\n");
+            PIHMexit (EXIT_FAILURE);
+        }
+
+        SetCVodeParam (member->pihm, member->cvode_mem, member->CV_Y);
+
+        member->maxstep = member->pihm->ctrl.maxstep;
+        member->ncfn = 0;
+        member->nni = 0;
+    }
+
+}
+
+void IntrplEnsForcing (pihm_struct pihm, int t)
+{
+    forc_struct    *forc;
+    int             k;
+
+    forc = &pihm->forc;
+
+    /* Boundary conditions are applied every model step */
+    for (k = 0; k < forc->nbc; k++)
+    {
+        IntrplForcing (&forc->bc[k], t, 1);
+    }
+
+    for (k = 0; k < forc->nriverbc; k++)
+    {
+        IntrplForcing (&forc->riverbc[k], t, 1);
+    }
+
+    /* Meteorological and LAI forcing are applied every land surface step */
+    if ((t - pihm->ctrl.starttime) % pihm->ctrl.etstep == 0)
+    {
+        for (k = 0; k < forc->nmeteo; k++)
+        {
+            IntrplForcing (&forc->meteo[k], t, NUM_METEO_VAR);
+        }
+
+#ifdef _NOAH_
+        if (pihm->ctrl.rad_mode > 0)
+        {
+            for (k = 0; k < forc->nrad; k++)
+            {
+                IntrplForcing (&forc->rad[k], t, 2);
+            }
+        }
+#endif
+
+#if !defined(_CYCLES_) && !defined(_BGC_)
+        for (k = 0; k < forc->nlai; k++)
+        {
+            IntrplForcing (&forc->lai[k], t, 1);
+        }
+#endif
+    }
+
+#ifdef _BGC_
+    /* CO2 and nitrogen deposition are applied every day */
+    if ((t - pihm->ctrl.starttime) % DAYINSEC == 0)
+    {
+        if (pihm->co2.varco2)
+        {
+            IntrplForcing (&forc->co2[0], t - DAYINSEC, 1);
+        }
+
+        if (pihm->ndepctrl.varndep)
+        {
+            IntrplForcing (&forc->ndep[0], t - DAYINSEC, 1);
+        }
+    }
+#endif
+}
+
+void FreeEns (ens_struct *ens)
+{
+    int             i, k;
+
+    for (k = 0; k < ens->nmember; k++)
+    {
+        member_struct  *member;
+        pihm_struct     pihm;
+
+        member = &ens->member[k];
+        pihm = member->pihm;
+
+        N_VDestroy (member->CV_Y);
+        CVodeFree (&member->cvode_mem);
+
+        if (member->watbal != NULL)
+        {
+            fclose (member->watbal);
+        }
+
+        /* The first member, which owns the shared input tables and forcing,
+         * is freed by FreeData */
+        if (k > 0)
+        {
+            free (pihm->ctrl.tout);
+
+            for (i = 0; i < pihm->ctrl.nprint; i++)
+            {
+                free (pihm->prtctrl[i].var);
+                free (pihm->prtctrl[i].buffer);
+                fclose (pihm->prtctrl[i].datfile);
+                if (pihm->ctrl.ascii)
+                {
+                    fclose (pihm->prtctrl[i].txtfile);
+                }
+            }
+            if (pihm->ctrl.tecplot)
+            {
+                for (i = 0; i < pihm->ctrl.nprintT; i++)
+                {
+                    fclose (pihm->prtctrlT[i].datfile);
+                }
+            }
+            if (pihm->vgtbl != NULL)
+            {
+                FreeVgTbl (pihm->vgtbl, pihm->soiltbl.number);
+            }
+#ifdef _DAILY_
+            FreeDailyAcc (&pihm->dacc);
+#endif
+#ifdef _BGC_
+            free (pihm->bgc_order);
+            FreeTracer (&pihm->ntrans);
+#endif
+            if (pihm->ctrl.water_age)
+            {
+                FreeTracer (&pihm->age);
+            }
+#ifdef _NOAH_
+            free (pihm->forc.solgeo.zenith);
+            free (pihm->forc.solgeo.azimuth);
+            FreeLsmStep (&pihm->ctrl.lsm);
+#endif
+            free (pihm->elem);
+            free (pihm->riv);
+            free (pihm);
+        }
+    }
+
+    free (ens->member);
+}
@@ -21,7 +21,7 @@ void ApplyBC (forc_struct *forc, elem_struct *elem, river_struct *riv, int t)
 
 void ApplyForcing (forc_struct *forc, elem_struct *elem, int t
 #ifdef _NOAH_
-    , ctrl_struct *ctrl, siteinfo_struct *siteinfo
+    , ctrl_struct *ctrl
 #endif
     )
 {
@@ -30,7 +30,7 @@ void ApplyForcing (forc_struct *forc, elem_struct *elem, int t
      */
     ApplyMeteoForc (forc, elem, t
 #ifdef _NOAH_
-        , ctrl->rad_mode, siteinfo
+        , ctrl->rad_mode
 #endif
         );
 
@@ -51,7 +51,7 @@ void ApplyElemBC (forc_struct *forc, elem_struct *elem, int t)
         IntrplForcing (&forc->bc[k], t, 1);
     }
 
-    for (i = 0; i < nelem; i++)
+    for (i = 0; i < NLOCALELEM; i++)
     {
         for (j = 0; j < NUM_EDGE; j++)
         {
@@ -73,13 +73,14 @@ void ApplyElemBC (forc_struct *forc, elem_struct *elem, int t)
 
 void ApplyMeteoForc (forc_struct *forc, elem_struct *elem, int t
 #ifdef _NOAH_
-    , int rad_mode, siteinfo_struct *siteinfo
+    , int rad_mode
 #endif
     )
 {
     int             i, k;
 #ifdef _NOAH_
-    spa_data        spa;
+    const double   *zenith = forc->solgeo.zenith;
+    const double   *azimuth = forc->solgeo.azimuth;
 #endif
 
     /*
@@ -104,9 +105,8 @@ void ApplyMeteoForc (forc_struct *forc, elem_struct *elem, int t
             }
         }
 
-        /* Calculate Sun position for topographic solar radiation */
-        SunPos (t, siteinfo->latitude, siteinfo->longitude,
-            siteinfo->elevation, siteinfo->tavg, &spa);
+        /* Sun position of each element for topographic solar radiation */
+        ElemSolarPos (forc, t, forc->solgeo.zenith, forc->solgeo.azimuth);
     }
 #endif
 
@@ -141,7 +141,7 @@ void ApplyMeteoForc (forc_struct *forc, elem_struct *elem, int t
             }
 
             elem[i].ef.soldn = TopoRadn (elem[i].ef.soldir, elem[i].ef.soldif,
-                spa.zenith, spa.azimuth180, elem[i].topo.slope,
+                zenith[i], azimuth[i], elem[i].topo.slope,
                 elem[i].topo.aspect, elem[i].topo.h_phi, elem[i].topo.svf);
             elem[i].ef.soldn = (elem[i].ef.soldn > 0.0) ?
                 elem[i].ef.soldn : 0.0;
@@ -227,7 +227,7 @@ void ApplyRiverBC (forc_struct *forc, river_struct *riv, int t)
         IntrplForcing (&forc->riverbc[k], t, 1);
     }
 
-    for (i = 0; i < nriver; i++)
+    for (i = 0; i < NLOCALRIV; i++)
     {
         if (riv[i].attrib.riverbc_type > 0)
         {
@@ -238,10 +238,25 @@ void ApplyRiverBC (forc_struct *forc, river_struct *riv, int t)
 }
 
 void IntrplForcing (tsdata_struct *ts, int t, int nvrbl)
+{
+    if (t == ts->t_intrpl)
+    {
+        /* Series has already been interpolated to model time t (e.g., by
+         * another ensemble member sharing the same forcing) */
+        return;
+    }
+
+    IntrplValue (ts, t, nvrbl, ts->value);
+    ts->t_intrpl = t;
+}
+
+void IntrplValue (const tsdata_struct *ts, int t, int nvrbl, double *value)
 {
     int             j;
     int             first, middle, last;
 
+    /* Interpolate series to time t without changing the series, e.g., to
+     * look ahead of model time */
     if (t < ts->ftime[0])
     {
         PIHMprintf (VL_ERROR,
@@ -268,7 +283,7 @@ void IntrplForcing (tsdata_struct *ts, int t, int nvrbl)
             {
                 for (j = 0; j < nvrbl; j++)
                 {
-                    ts->value[j] = ((double)(ts->ftime[middle] - t) *
+                    value[j] = ((double)(ts->ftime[middle] - t) *
                         ts->data[middle - 1][j] +
                         (double)(t - ts->ftime[middle - 1]) *
                         ts->data[middle][j]) /
@@ -110,6 +110,9 @@ typedef struct topo_struct
  *                                        cross-section [m2 m-2]
  * areafh                   double      macropore area fraction on a
  *                                        horizontal cross-section [m2 m-2]
+ * vgtbl                    vgtbl_struct*
+ *                                      lookup tables of van Genuchten
+ *                                        functions (NULL if not used)
  * ---------------------------------------------------------------------------
  * Variables below only used in Flux-PIHM
  * ---------------------------------------------------------------------------
@@ -138,6 +141,7 @@ typedef struct soil_struct
     double          kmacv;
     double          areafv;
     double          areafh;
+    const vgtbl_struct *vgtbl;
 #ifdef _NOAH_
     double          csoil;
     double          quartz;
@@ -486,6 +490,10 @@ typedef struct epconst_struct
  *                                        groundwater [-]
  * satdpth                  double[]    depth of groundwater in each soil
  *                                        layer [m]
+ * nfrz                     int         number of supercooled water solves
+ *                                        using lookup tables
+ * nfrz_fallback            int         number of table solves that fall back
+ *                                        to the original iterations
  * ---------------------------------------------------------------------------
  * Variables below only used in Flux-PIHM-BGC
  * ---------------------------------------------------------------------------
@@ -564,6 +572,8 @@ typedef struct pstate_struct
     double          tbot;
     double          gwet;
     double          satdpth[MAXLYR];
+    int             nfrz;
+    int             nfrz_fallback;
 #endif
 #ifdef _BGC_
     double          co2;
@@ -703,6 +713,32 @@ typedef struct wflux_struct
 #endif
 } wflux_struct;
 
+/*****************************************************************************
+ * Water ages
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * surf                     double      mean age of surface water [day]
+ * unsat                    double      mean age of unsaturated zone water
+ *                                        [day]
+ * gw                       double      mean age of groundwater [day]
+ * surf_ttd                 double[]    fraction of surface water in each
+ *                                        age bin [-]
+ * unsat_ttd                double[]    fraction of unsaturated zone water in
+ *                                        each age bin [-]
+ * gw_ttd                   double[]    fraction of groundwater in each age
+ *                                        bin [-]
+ ****************************************************************************/
+typedef struct age_struct
+{
+    double          surf;
+    double          unsat;
+    double          gw;
+    double          surf_ttd[MAXAGEBIN];
+    double          unsat_ttd[MAXAGEBIN];
+    double          gw_ttd[MAXAGEBIN];
+} age_struct;
+
 /*****************************************************************************
  * Water states
  * ---------------------------------------------------------------------------
@@ -1140,6 +1176,7 @@ typedef struct bgcic_struct
     double          soil2n;
     double          soil3n;
     double          soil4n;
+    double          surfn;
     double          sminn;
     double          retransn;
     double          npool;
@@ -1165,8 +1202,50 @@ typedef struct spinup_struct
     double          totalc_prev;
     double          soilc;
     double          totalc;
+    double          dsoilc;
     int             steady;
+    int             steady_year;
+    double          n0;
+    double          nin;
 } spinup_struct;
+
+/*****************************************************************************
+ * Daily drivers of BGC cached for driver replay spinup
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * avg_sfctmp               double      daily average air temperature [K]
+ * tday                     double      daytime average air temperature [K]
+ * tnight                   double      nighttime average air temperature [K]
+ * avg_stc0                 double      daily average top layer soil
+ *                                        temperature [K]
+ * avg_soldn                double      daytime average downward solar
+ *                                        radiation [W m-2]
+ * avg_albedo               double      daytime average surface albedo [-]
+ * avg_q2d                  double      daytime average mixing ratio deficit
+ *                                        [kg kg-1]
+ * avg_ch                   double      daytime average surface exchange
+ *                                        coefficient [m s-1]
+ * avg_sfcprs               double      daytime average air pressure [Pa]
+ * avg_sh2o                 double[]    daily average unfrozen soil moisture
+ *                                        content [m3 m-3]
+ * ntrans                   double      fraction of available mineral N
+ *                                        gained by transport in the day [-]
+ ****************************************************************************/
+typedef struct bgcdrv_struct
+{
+    double          avg_sfctmp;
+    double          tday;
+    double          tnight;
+    double          avg_stc0;
+    double          avg_soldn;
+    double          avg_albedo;
+    double          avg_q2d;
+    double          avg_ch;
+    double          avg_sfcprs;
+    double          avg_sh2o[MAXLYR];
+    double          ntrans;
+} bgcdrv_struct;
 #endif
 
 #ifdef _CYCLES_
@@ -1202,8 +1281,6 @@ typedef struct solute_struct
  * ---------------------------------------------------------------------------
  * Variables                Type        Description
  * ==========               ==========  ====================
- * counter                  int         counter used for averaging
- * daylight_counter         int         counter used for daytime averaging
  * avg_surf                 double      daily average surface water level [m]
  * avg_unsat                double      daily average unsaturated water
  *                                        storage [m]
@@ -1236,8 +1313,6 @@ typedef struct solute_struct
  ****************************************************************************/
 typedef struct daily_struct
 {
-    int             counter;
-    int             daylight_counter;
     double          avg_surf;
     double          avg_unsat;
     double          avg_gw;
@@ -2526,6 +2601,7 @@ typedef struct elem_struct
     wstate_struct   ws;
     wstate_struct   ws0;
     wflux_struct    wf;
+    age_struct      age;
     estate_struct   es;
     eflux_struct    ef;
     pstate_struct   ps;
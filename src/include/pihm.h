@@ -23,6 +23,13 @@
 #include <omp.h>
 #endif
 
+#ifdef _MPI_
+#include <mpi.h>
+#if defined(_BGC_) || defined(_CYCLES_) || defined(_RT_)
+#error "MPI domain decomposition only supports the PIHM hydrology module."
+#endif
+#endif
+
 #define VERSION     "0.2.0-alpha"
 /*
  * SUNDIAL Header Files
@@ -42,6 +49,11 @@
 #include "cvode_dense.h"        /* CVDENSE header file */
 /* CVSPGMR linear header file */
 #include "cvode_spgmr.h"
+#ifdef _MPI_
+/* Parallel N_Vector and band-block-diagonal preconditioner */
+#include "nvector_parallel.h"
+#include "cvode_bbdpre.h"
+#endif
 
 /* Definition of type N_Vector */
 #ifdef _CVODE_OMP
@@ -60,6 +72,9 @@
 
 #include "pihm_const.h"
 #include "pihm_input_struct.h"
+#ifdef _RT_
+#include "rt.h"
+#endif
 #include "elem_struct.h"
 #include "river_struct.h"
 #include "pihm_struct.h"
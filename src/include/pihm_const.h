@@ -43,6 +43,50 @@
 /* Maximum number of output files */
 #define MAXPRINT    1024
 
+#ifdef _MPI_
+/* Half-bandwidth of band-block-diagonal preconditioner */
+#define BBD_BANDWIDTH   2
+
+/* Number of element (river) states exchanged with neighboring ranks */
+#define NUM_HALO_ELEM_VAR   3
+#define NUM_HALO_RIV_VAR    2
+
+/* Number of send buffers per neighboring rank in subcatchment mode. Received
+ * states lag behind by at most two model steps */
+#define NUM_EXCHANGE_SLOT   3
+#endif
+
+#ifdef _OPENMP
+/* Element and river loops with tunable OpenMP schedules */
+#define NUM_KERNEL          6
+#define VERTFLOW_KERNEL     0
+#define LATFLOW_KERNEL      1
+#define RIVFLOW_KERNEL      2
+#define ET_KERNEL           3
+#define NOAH_KERNEL         4
+#define BGC_KERNEL          5
+
+/* Number of calls each candidate schedule is timed for, and number of calls
+ * after which a kernel is tuned again */
+#define NUM_TUNE_CALL       10
+#define RETUNE_INTERVAL     5000
+
+/* Thread binding */
+#define BIND_NONE           0
+#define BIND_CLOSE          1
+#define BIND_SPREAD         2
+#endif
+
+/* Restart files */
+#define RST_MAGIC       "PIHMRST"       /* file signature */
+#define RST_VERSION     1       /* restart format version */
+#define RST_MAXSEC      8       /* maximum number of module sections */
+#define RST_ALIGN       4096    /* alignment of module sections [byte] */
+#define RST_BGC_SEC     1       /* BGC section */
+#define RST_CYCLES_SEC  2       /* Cycles section */
+#define RST_ELEM        0       /* element record */
+#define RST_RIV         1       /* river segment record */
+
 /* Meteorological forcing related */
 #define NUM_METEO_VAR   7       /* number of meteo forcing variables */
 #define PRCP_TS         0       /* index of precipitation forcing */
@@ -60,6 +104,23 @@
 #define SOLDIR_TS   0           /* index of direct solar radiation forcing */
 #define SOLDIF_TS   1           /* index of diffused solar radiation forcing*/
 
+/* Solar position tables */
+#define SOLTBL_MINSTEP  900     /* minimum interval of solar position table
+                                 * [s] */
+#define SOL_ANCHOR_RES  0.5     /* default size of anchor cells [degree] */
+#define SOLVAL_DAYS     15      /* interval between validation days [day] */
+#define SOLVAL_STEP     1800    /* interval between validation times [s] */
+#define SOLVAL_TOL      0.1     /* tolerance of solar zenith angle error
+                                 * [degree] */
+
+/* Adaptive land surface steps */
+#define LSM_TOL         25.0    /* default tolerance of energy balance
+                                 * residual [W m-2] */
+#define LSM_MAXFACT     4       /* default ratio of maximum land surface step
+                                 * to LSM_STEP */
+#define NUM_HELD_FLUX   4       /* number of fluxes compared for realized
+                                 * residuals */
+
 /* Number of edges of an element */
 #define NUM_EDGE    3
 
@@ -79,9 +140,43 @@
 #define RIVGRADMIN  0.05        /* minimum river hydarulic gradient [m m-1] */
 #define CMCFACTR    2E-4        /* canopy water capacity per LAI [m] */
 
+/* Lookup tables of van Genuchten functions */
+#define KR_FN       0           /* relative hydraulic conductivity */
+#define PSI_FN      1           /* pressure head */
+#define DPSI_FN     2           /* derivative of pressure head to
+                                 * saturation ratio */
+#define NUM_VGFN    3           /* number of tabulated functions */
+#define VGTBL_NBIN  20          /* number of binades of each side */
+#define VGTBL_MINSUB 4          /* minimum number of intervals in a
+                                 * binade */
+#define VGTBL_MAXSUB 4096       /* maximum number of intervals in a
+                                 * binade */
+#define VGTBL_TOL   1.0E-4      /* default tolerance of relative error [-] */
+#define VGTBL_FLOOR 1.0E-12     /* function values below which absolute
+                                 * errors are used */
+#define VGTBL_NVERIFY 100000    /* number of verification points */
+
+/* Supercooled liquid water solver of Flux-PIHM */
+#define FRZTBL_NT   52          /* number of intervals of log supercooling */
+#define FRZTBL_NS   32          /* number of intervals of saturation ratio */
+#define FRZTBL_LNMIN -13.0      /* minimum log supercooling, log of
+                                 * (TFREEZ - T) / T [-] */
+#define FRZTBL_LNMAX 0.0        /* maximum log supercooling [-] */
+#define FRZTBL_NITER 100        /* number of iterations to build tables */
+#define FRZ_NITER   4           /* number of iterations of the fast path */
+#define FRZ_TOL     1.0E-6      /* convergence tolerance of liquid water
+                                 * content [m3 m-3] */
+
+/* Water age distributions */
+#define MAXAGEBIN   20          /* maximum number of age bins */
+#define AGE_BINW    30.0        /* default width of age bins [day] */
+
 /* Maximum of soil layers in Flux-PIHM */
 #define MAXLYR      11
 
+/* Number of elements processed together by the Noah LSM */
+#define NOAH_BLOCK  8
+
 /* Land cover parameters */
 #define NLCTYPE     40          /* number of land cover types */
 #define ISURBAN     13          /* land cover type representing urban */
@@ -298,6 +393,19 @@
 #define RIVGWTEC_CTRL           71
 #define IC_CTRL					72
 #define WB_CTRL					73
+#define AGE_SURF_CTRL           74
+#define AGE_UNSAT_CTRL          75
+#define AGE_GW_CTRL             76
+#define AGE_RIVSTG_CTRL         77
+#define AGE_RIVGW_CTRL          78
+#define LEAFC_CTRL              79
+#define LIVESTEMC_CTRL          80
+#define DEADSTEMC_CTRL          81
+#define TTD_SURF_CTRL           82
+#define TTD_UNSAT_CTRL          83
+#define TTD_GW_CTRL             84
+#define TTD_RIVSTG_CTRL         85
+#define TTD_RIVGW_CTRL          86
 #ifdef _CYCLES_
 #define MAXOP               100
 
@@ -354,6 +462,7 @@ extern int          verbose_mode;
 extern int          debug_mode;
 extern int          corr_mode;
 extern int          spinup_mode;
+extern int          ensemble_mode;
 extern char         project[MAXSTRING];
 extern int          nelem;
 extern int          nriver;
@@ -363,5 +472,12 @@ extern int          nthreads;
 #if defined(_BGC_) || defined (_CYCLES_)
 extern int          first_balance;
 #endif
+#ifdef _MPI_
+extern int          mpi_rank;
+extern int          mpi_size;
+extern int          nelem_halo;
+extern int          nriver_halo;
+extern int          subcat_mode;
+#endif
 
 #endif
@@ -3,25 +3,39 @@
 
 #define _ARITH_
 
-#ifdef _BGC_
-#define NSV             5 * nelem + 4 * nriver
-#else
 #define NSV             3 * nelem + 2 * nriver
-#endif
 
+#ifdef _MPI_
+/* State variables of each element (river segment) are stored contiguously
+ * so that the band-block-diagonal preconditioner captures the vertical
+ * coupling within an element */
+#define SURF(i)         3 * (i)
+#define UNSAT(i)        3 * (i) + 1
+#define GW(i)           3 * (i) + 2
+#define RIVSTG(i)       3 * nelem + 2 * (i)
+#define RIVGW(i)        3 * nelem + 2 * (i) + 1
+
+/* Local elements (river segments) include owned and halo ones */
+#define NLOCALELEM      (nelem + nelem_halo)
+#define NLOCALRIV       (nriver + nriver_halo)
+#else
 #define SURF(i)         i
 #define UNSAT(i)        i + nelem
 #define GW(i)           i + 2 * nelem
 #define RIVSTG(i)       i + 3 * nelem
 #define RIVGW(i)        i + 3 * nelem + nriver
 
-#ifdef _BGC_
-#define SURFN(i)        i + 3 * nelem + 2 * nriver
-#define SMINN(i)        i + 4 * nelem + 2 * nriver
-#define STREAMN(i)      i + 5 * nelem + 2 * nriver
-#define RIVBEDN(i)      i + 5 * nelem + 3 * nriver
+#define NLOCALELEM      nelem
+#define NLOCALRIV       nriver
 #endif
 
+/* Compartments of tracer transport */
+#define TR_SURF(i)      (i)
+#define TR_SUB(i)       ((i) + nelem)
+#define TR_STREAM(i)    ((i) + 2 * nelem)
+#define TR_BED(i)       ((i) + 2 * nelem + nriver)
+#define TR_UNSAT(i)     ((i) + 2 * nelem + 2 * nriver)
+
 /*
  * Function Declarations
  */
@@ -29,13 +43,13 @@ void            ApplyBC (forc_struct *, elem_struct *, river_struct *, int);
 void            ApplyElemBC (forc_struct *, elem_struct *, int);
 void            ApplyForcing (forc_struct *, elem_struct *, int
 #ifdef _NOAH_
-    , ctrl_struct *, siteinfo_struct *
+    , ctrl_struct *
 #endif
     );
 void            ApplyLAI (forc_struct *, elem_struct *, int);
 void            ApplyMeteoForc (forc_struct *, elem_struct *, int
 #ifdef _NOAH_
-    , int, siteinfo_struct *
+    , int
 #endif
     );
 void            ApplyRiverBC (forc_struct *, river_struct *, int);
@@ -44,25 +58,76 @@ double          AvgKV (double, double, double, double, double, double, double,
     double);
 double          AvgYsfc (double, double, double);
 double          AvgY (double, double, double);
+#ifdef _MPI_
+void            AddLocal (int, int *, int *, int *);
+#endif
+#ifdef _MPI_
+int             BBDLocalODE (long int, realtype, N_Vector, N_Vector, void *);
+void            Bisect (sortkey_struct *, int, const double *,
+    const double *, int, int, int *);
+#endif
+#ifdef _OPENMP
+void            BindThreads (int);
+#endif
+void            BuildTriGrid (int, const double *, const double *,
+    trigrid_struct *);
+void            BuildVgTbl (vgtbl_struct *, double, double, double);
 void            BKInput (char *, char *);
 void            CalcModelStep (ctrl_struct *);
 void            CheckFile (FILE *, char *);
+void            CheckStrLen (int, const char *);
+void            CheckTracerSpecies (const elem_struct *, const river_struct *,
+    double, const tracer_struct *);
+#ifdef _MPI_
+int             CompareKey (const void *, const void *);
+#endif
 void            CorrectElevation (elem_struct *, river_struct *);
 int             CountLine (FILE *, char *, int, ...);
 int             CountOccurance (FILE *, char *);
 void            CreateOutputDir (char *);
+#ifdef _MPI_
+void            Decompose (pihm_struct, char *);
+#endif
 double          DhByDl (double *, double *, double *);
+double          DPsi (double, double, double);
+double          DPsiDSmc (const soil_struct *, double);
 double          EffKH (double, double, double, double, double, double);
 double          EffKinf (double, double, int, double, double, double);
 double          EffKV (double, int, double, double, double);
 double          FieldCapacity (double, double, double, double, double);
+#ifdef _MPI_
+void            ExchangeRequest (int, const int *, int, const int *,
+    const int *, int *, int **, int *, int **);
+#endif
+#ifdef _MPI_
+void            FinishBoundaryExchange (pihm_struct, int);
+#endif
 void            FindLine (FILE *, char *, int *, const char *);
+#ifdef _OPENMP
+void            FirstTouch (void *, int, size_t);
+void            FirstTouchVector (N_Vector);
+#endif
 void            FreeData (pihm_struct);
+void            FreeTracer (tracer_struct *);
+void            FreeTriGrid (trigrid_struct *);
+void            FreeVgTbl (vgtbl_struct *, int);
 void            FrictSlope (elem_struct *, river_struct *, int, double *,
     double *);
+#ifdef _MPI_
+void            FreeDecomp (decomp_struct *);
+#endif
+void            FreeEns (ens_struct *);
+#ifdef _MPI_
+long int        GlobalLength (long int);
+int             HaloComm (long int, realtype, N_Vector, void *);
+#endif
 void            Hydrol (pihm_struct);
 void            Initialize (pihm_struct, N_Vector);
+#ifdef _MPI_
+void            InitBoundaryState (pihm_struct);
+#endif
 void            InitEFlux (eflux_struct *);
+void            InitEns (pihm_struct, ens_struct *, char *);
 void            InitEState (estate_struct *);
 void            InitForcing (elem_struct *, forc_struct *,
     const calib_struct *
@@ -70,6 +135,13 @@ void            InitForcing (elem_struct *, forc_struct *,
     , int, int
 #endif
     );
+#ifdef _MPI_
+void            InitHalo (decomp_struct *, int, int, const int *,
+    const int *, int, int, const int *, const int *);
+#endif
+#ifdef _OPENMP
+void            InitKernel (ctrl_struct *);
+#endif
 void            InitLC (elem_struct *, const lctbl_struct *,
     const calib_struct *);
 void            InitMeshStruct (elem_struct *, const meshtbl_struct *);
@@ -87,28 +159,53 @@ void            InitSoil (elem_struct *, const soiltbl_struct *,
     const calib_struct *);
 void            InitSurfL (elem_struct *, river_struct *, const meshtbl_struct *);
 void            InitTopo (elem_struct *, const meshtbl_struct *);
+void            InitTracer (const elem_struct *, const river_struct *, int,
+    const double *, int, tracer_struct *);
 void            InitVar (elem_struct *, river_struct *, N_Vector);
+void            InitVgTbl (elem_struct *, const soiltbl_struct *,
+    const calib_struct *, const ctrl_struct *, vgtbl_struct *);
 void            InitWFlux (wflux_struct *);
 void            InitWState (wstate_struct *);
+void            InitWaterAge (elem_struct *, river_struct *,
+    const ctrl_struct *, tracer_struct *);
 void            IntcpSnowET (int, double, pihm_struct);
 void            IntrplForcing (tsdata_struct *, int, int);
+void            IntrplEnsForcing (pihm_struct, int);
+void            IntrplValue (const tsdata_struct *, int, int, double *);
 double          KrFunc (double, double, double);
+double          KrFuncSoil (const soil_struct *, double);
 void            LateralFlow (pihm_struct);
+int             LocalODE (realtype, N_Vector, N_Vector, void *);
+#ifdef _MPI_
+void            LocalizeTbl (pihm_struct, int, int, const int *,
+    const int *);
+#endif
+int             LocateTri (const trigrid_struct *, double, double, int, int);
 int             MacroporeStatus (double, double, double, double, double,
     double);
 void            MapOutput (char *, pihm_struct, char *);
 void            MassBalance (wstate_struct *, wstate_struct *, wflux_struct *,
     double *, const soil_struct *, double, double);
+#ifdef _OPENMP
+void            KernelEnd (int, kernel_struct *);
+void            KernelStart (int, kernel_struct *);
+#endif
 double          MonthlyLAI (int, int);
 double          MonthlyMF (int);
 double          MonthlyRL (int, int);
-#ifdef _CVODE_OMP
+void            MonotoneSlope (const double *, const double *, int, double *);
+#if defined(_MPI_)
+#define N_VNew(N)       N_VNew_Parallel(SolverComm (), N, GlobalLength (N))
+#elif defined(_OPENMP)
 #define N_VNew(N)       N_VNew_OpenMP(N, nthreads)
 #else
-#define N_VNew(N)       N_VNew_Serial(N);
+#define N_VNew(N)       N_VNew_Serial(N)
 #endif
 void            NextLine (FILE *, char *, int *);
-#ifdef _CVODE_OMP
+#if defined(_MPI_)
+#define NV_DATA         NV_DATA_P
+#define NV_Ith          NV_Ith_P
+#elif defined(_OPENMP)
 #define NV_DATA         NV_DATA_OMP
 #define NV_Ith          NV_Ith_OMP
 #else
@@ -118,46 +215,79 @@ void            NextLine (FILE *, char *, int *);
 int             ODE (realtype, N_Vector, N_Vector, void *);
 double          OverlandFlow (double, double, double, double, double);
 double          OLFEleToRiv (double, double, double, double, double, double);
+FILE           *OpenRestartRd (char *, int, int, int, rsthdr_struct *,
+    int *);
+FILE           *OpenRestartWr (char *, int, int, int, rsthdr_struct *,
+    int *);
 void            ParseCmdLineParam(int, char *[], char *);
 #define PIHMexit(...)  _PIHMexit(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__)
 void            _PIHMexit (const char *, int, const char *, int);
 #define PIHMprintf(...)   _PIHMprintf(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__)
 void            _PIHMprintf (const char *, int, const char *, int,
     const char *, ...);
+#ifdef _MPI_
+void            PartitionMesh (const meshtbl_struct *, int *);
+void            PartitionSubcat (pihm_struct, int *, int *, int *);
+#endif
 void            PIHM(pihm_struct, void *, N_Vector, int, int, char *, char *, double, FILE *);
 pihm_t_struct   PIHMTime(int);
 void            PrintData (prtctrl_struct *, int, int, int, int);
 void            PrintDataTecplot (prtctrlT_struct *, int, int, int);
+void            PrtAgeStats (const ctrl_struct *, const tracer_struct *,
+    double);
+#ifdef _OPENMP
+void            PinKernel (ctrl_struct *);
+void            PrtKernel (FILE *, ctrl_struct *, int);
+#endif
 void            PrtInit (elem_struct *, river_struct *, char *, int);
+#ifdef _MPI_
+void            PrtInitPar (elem_struct *, river_struct *, char *, int,
+    const decomp_struct *);
+#endif
 void			PrintStats (void *, FILE *);
 void			PrintWaterBalance (FILE *, int, int, int, elem_struct *, int, river_struct *, int);
 double          Psi (double, double, double);
+double          PsiSoil (const soil_struct *, double);
 double          PtfAlpha (double, double, double, double, int);
 double          PtfBeta (double, double, double, double, int);
 double          PtfKV (double, double, double, double, int);
 double          PtfThetaR (double, double, double, double, int);
 double          PtfThetaS (double, double, double, double, int);
 double          Qtz (int);
+void            ReadAgeCtrl (char *, ctrl_struct *, char *, int);
 void            ReadAlloc (char *, pihm_struct);
 void            ReadAtt (char *, atttbl_struct *);
 void            ReadBC (char *, forc_struct *);
 void            ReadCalib (char *, calib_struct *);
+void            ReadEns (char *, ens_struct *);
 void            ReadForc (char *, forc_struct *);
 void            ReadGeol (char *, geoltbl_struct *);
 void            ReadIC (char *, elem_struct *, river_struct *);
+#ifdef _MPI_
+void            ReadICPar (char *, elem_struct *, river_struct *,
+    const decomp_struct *);
+#endif
 int             ReadKeyword (char *, char *, void *, char, char *, int);
 void            ReadLAI (char *, forc_struct *, const atttbl_struct *);
 void            ReadLC (char *, lctbl_struct *);
 void            ReadMesh (char *, meshtbl_struct *);
+void            ReadOmpCtrl (char *, ctrl_struct *, char *, int);
 void            ReadPara (char *, ctrl_struct *);
+void            ReadRestartRec (FILE *, const rsthdr_struct *, int, int, int,
+    void *);
 int             ReadPrtCtrl (char *, char *, char *, int);
 void            ReadRiv (char *, rivtbl_struct *, shptbl_struct *,
     matltbl_struct *, forc_struct *);
 void            ReadSoil (char *, soiltbl_struct *);
+void            ReadSoilTblCtrl (char *, ctrl_struct *, char *, int);
 void            ReadSunpara(char *, ctrl_struct *);
 int             ReadTS (char *, int *, double *, int);
 int             Readable (char *);
+#ifdef _MPI_
+void            RecvBoundaryState (pihm_struct, int);
+#endif
 void            RiverFlow (pihm_struct);
+void            RunEnsemble (pihm_struct, char *);
 void            RiverToEle (river_struct *, elem_struct *, elem_struct *,
     int, double, double *, double *, double *);
 double          _RivWdthAreaPerim (int, int, double, double);
@@ -165,16 +295,55 @@ double          _RivWdthAreaPerim (int, int, double, double);
 #define RivEqWid(...)   _RivWdthAreaPerim(RIVER_WDTH, __VA_ARGS__)
 #define RivPerim(...)   _RivWdthAreaPerim(RIVER_PERIM, __VA_ARGS__)
 void            SaturationIC (elem_struct *, river_struct *);
+#ifdef _OPENMP
+const char     *ScheduleName (omp_sched_t);
+#endif
+#ifdef _MPI_
+void            SendBoundaryState (pihm_struct, int);
+#endif
 void            SetCVodeParam (pihm_struct, void *, N_Vector);
+#ifdef _MPI_
+void            SetHaloLag (decomp_struct *, const int *);
+#endif
+#ifdef _OPENMP
+void            SetTrial (kernel_struct *, int);
+#endif
+#ifdef _MPI_
+MPI_Comm        SolverComm (void);
+#endif
 int             SoilTex (double, double);
 void            SolveCVode (int, int *, int, int, double, void *, N_Vector, char *, char *);
 int             StrTime (const char *);
 void            Summary (pihm_struct, N_Vector, double);
 double          SurfH (double);
+void            TracerSinks (const elem_struct *, int, tracer_struct *);
+void            TracerStorage (const elem_struct *, const river_struct *,
+    tracer_struct *);
+void            TracerTransport (const elem_struct *, const river_struct *,
+    double, tracer_struct *);
+#ifdef _MPI_
+void            UnpackHalo (const halo_struct *, elem_struct *,
+    river_struct *);
+#endif
 void            UpdPrintVar (prtctrl_struct *, int, int);
 void            UpdPrintVarT (prtctrlT_struct *, int);
+#ifdef _MPI_
+int             UpstreamRank (int, int, const int *);
+#endif
+void            VerifyVgTbl (const vgtbl_struct *, int);
 void            VerticalFlow (pihm_struct);
+double          VgFunc (int, double, double, double);
+double          VgRelErr (double, double);
+double          VgTblNode (int, int);
+double          VgTblValue (const vgtbl_struct *, int, double);
+void            WaterAge (elem_struct *, river_struct *, ctrl_struct *,
+    tracer_struct *);
 double          WiltingPoint (double, double, double, double);
+void            WriteRestartRec (FILE *, const rsthdr_struct *, int, int, int,
+    const void *);
+#ifdef _MPI_
+void            WritePartition (char *, const int *, const int *);
+#endif
 
 /*
  * Noah functions
@@ -182,6 +351,7 @@ double          WiltingPoint (double, double, double, double);
 #ifdef _NOAH_
 void            AlCalc (pstate_struct *, double, int);
 double          AvgElev (elem_struct *);
+void            BuildFrzTbl (vgtbl_struct *, double, double);
 double          CSnow (double);
 void            CalHum (pstate_struct *, estate_struct *);
 void            CalcLatFlx (const pstate_struct *, wflux_struct *, double);
@@ -189,9 +359,11 @@ void            CalcSlopeAspect (elem_struct *, const meshtbl_struct *);
 void            CanRes (wstate_struct *, estate_struct *, eflux_struct *,
     pstate_struct *, const soil_struct *,
     const epconst_struct *);
+double          DayLength (const forc_struct *, int, int);
 void            DEvap (const wstate_struct *, wflux_struct *,
     const pstate_struct *, const lc_struct *, const soil_struct *);
 void            DefSldpth (double *, int *, double *, double, const double *, int);
+void            ElemSolarPos (const forc_struct *, int, double *, double *);
 void            Evapo (wstate_struct *, wflux_struct *, pstate_struct *,
     const lc_struct *, soil_struct *,
 #ifdef _CYCLES_
@@ -200,25 +372,49 @@ void            Evapo (wstate_struct *, wflux_struct *, pstate_struct *,
     double);
 int             FindLayer (const double *, int, double);
 int             FindWT (const double *, int, double, double *);
+void            FreeLsmStep (lsmstep_struct *);
+void            FreeSolar (forc_struct *);
+double          FrH2O (double, double, double, const soil_struct *,
+    pstate_struct *);
+int             FrH2ONewton (double, double, double, double, double, double,
+    int, double *);
 double          FrozRain (double, double);
+double          FrzTblValue (const vgtbl_struct *, double, double, double,
+    double);
 double          GWTransp (double, double *, int, int);
 void            HRT (wstate_struct *, estate_struct *, eflux_struct *,
     pstate_struct *, const lc_struct *, const soil_struct *, double *,
     double, double, double, double, double *, double *, double *);
+void            InitAnchor (forc_struct *, const atttbl_struct *, double);
 void            InitLsm (elem_struct *, const ctrl_struct *,
     const noahtbl_struct *, const calib_struct *);
+void            InitLsmBlk (lsmblk_struct *, int);
+void            InitLsmStep (ctrl_struct *, int);
+void            InitSolTbl (soltbl_struct *, int, int);
+void            InitSolar (forc_struct *, const atttbl_struct *,
+    const siteinfo_struct *, const ctrl_struct *);
+void            LocalSunPos (double, double, double, double, double,
+    double *, double *);
+double          LocalDayLength (double, double, double, double);
+void            LsmHeld (lsmstep_struct *, const eflux_struct *, int);
+void            LsmStats (ctrl_struct *);
+void            LsmStep (const forc_struct *, const elem_struct *,
+    ctrl_struct *, int);
+int             LsmStepDue (const ctrl_struct *, int);
 void            NoPac (wstate_struct *, wflux_struct *, estate_struct *,
     eflux_struct *, pstate_struct *, lc_struct *, soil_struct *,
 #ifdef _CYCLES_
     comm_struct *, residue_struct *,
 #endif
-    double, double);
+    double, double, lsmblk_struct *, int);
 void            Noah (pihm_struct);
 void            NoahHydrol (elem_struct *, double);
 void            PcpDrp (wstate_struct *, wflux_struct *, const lc_struct *,
     double, double);
 void            Penman (wflux_struct *, estate_struct *, eflux_struct *,
     pstate_struct *, double *, double, int, int);
+void            PrtFrzStats (const elem_struct *);
+void            PrtLsmStats (const ctrl_struct *);
 double          Pslhs (double);
 double          Pslhu (double);
 double          Pslmu (double);
@@ -227,12 +423,12 @@ double          Psphs (double);
 double          Psphu (double);
 double          Pspms (double);
 double          Pspmu (double);
+void            ReadLatLon (char *, atttbl_struct *);
 void            ReadLsm (char *, siteinfo_struct *, ctrl_struct *,
     noahtbl_struct *);
 void            ReadRad (char *, forc_struct *);
 void            RootDist (const double *, int, int, double *);
-void            Rosr12 (double *, double *, double *, double *, double *,
-    double *, int);
+void            Rosr12 (lsmblk_struct *);
 void            SfcDifOff (pstate_struct *, const lc_struct *, double, double,
     int);
 void            SFlx (wstate_struct *, wflux_struct *, estate_struct *,
@@ -241,7 +437,9 @@ void            SFlx (wstate_struct *, wflux_struct *, estate_struct *,
 #ifdef _CYCLES_
     comm_struct *, residue_struct *,
 #endif
-    int);
+    int, lsmblk_struct *, int);
+void            SFlxEnd (const wflux_struct *, estate_struct *, eflux_struct *,
+    const pstate_struct *, const lsmblk_struct *, int);
 void            SRT (wstate_struct *, wflux_struct *, pstate_struct *,
     const soil_struct *,
 #ifdef _CYCLES_
@@ -250,29 +448,35 @@ void            SRT (wstate_struct *, wflux_struct *, pstate_struct *,
     double *, double *, double *, double *, double *);
 void            ShFlx (wstate_struct *, estate_struct *, eflux_struct *,
     pstate_struct *, const lc_struct *, const soil_struct *, double, double,
-    double, double);
+    double, double, lsmblk_struct *, int);
 void            SmFlx (wstate_struct *, wflux_struct *, pstate_struct *,
     const soil_struct *,
 #ifdef _CYCLES_
     residue_struct *,
 #endif
-    double );
+    double, lsmblk_struct *, int);
 double          SnFrac (double, double, double, double);
 void            SnkSrc (double *, double, double, double *,
-    const soil_struct *, const double *, double, int, double);
+    const soil_struct *, pstate_struct *, double, int, double);
 void            SnoPac (wstate_struct *, wflux_struct *, estate_struct *,
     eflux_struct *, pstate_struct *, lc_struct *, soil_struct *,
 #ifdef _CYCLES_
     comm_struct *, residue_struct *,
 #endif
-    int, double, double, double, double);
+    int, double, double, double, double, lsmblk_struct *, int);
+void            SolarPos (const soltbl_struct *, int, double *, double *,
+    double *, double *);
 void            SnowNew (const estate_struct *, double, pstate_struct *);
 void            SnowPack (double, double, double *, double *, double, double);
 double          Snowz0 (double, double, double);
-void            SStep (wstate_struct *, wflux_struct *, pstate_struct *,
-    const soil_struct *, double *, double *, double *, double *, double *,
+void            SStep (wflux_struct *, const pstate_struct *, const double *,
+    const double *, const double *, const double *, double, lsmblk_struct *,
+    int);
+void            SStepEnd (wstate_struct *, wflux_struct *,
+    const pstate_struct *, const soil_struct *, const lsmblk_struct *, int,
     double);
-void            SunPos (int, double, double, double, double, spa_data *);
+void            SunPos (int, double, double, double, double, int,
+    spa_data *);
 double          TBnd (double, double, const double *, double, int, int);
 double          TDfCnd (double, double, double, double, double);
 double          TmpAvg (double, double, double, const double *, int);
@@ -281,12 +485,17 @@ double          TopoRadn (double, double, double, double, double, double,
 double          TotalArea (elem_struct *);
 void            Transp (const wstate_struct *, wflux_struct *,
     const pstate_struct *, const lc_struct *, const soil_struct *);
+void            ValidateSolar (const forc_struct *, const atttbl_struct *,
+    const siteinfo_struct *);
+double          WrapAngle (double);
 void            WDfCnd (double *, double *, double, double, int,
     const soil_struct *, const pstate_struct *);
 #endif
 
 #ifdef _DAILY_
 void            DailyVar (int, int, pihm_struct);
+void            FreeDailyAcc (dailyacc_struct *);
+void            InitDailyAcc (dailyacc_struct *);
 void            InitDailyStruct (pihm_struct);
 #endif
 
@@ -444,13 +653,16 @@ void            WriteCyclesIC (char *, elem_struct *, river_struct *);
 #ifdef _BGC_
 void            BackgroundLitterfall (const epconst_struct *, epvar_struct *,
     const cstate_struct *, cflux_struct *, nflux_struct *);
-void            BgcSpinup (pihm_struct, N_Vector, void *);
+void            BgcSpinup (pihm_struct, N_Vector, void *, char *, FILE *);
 void            CanopyCond (const epconst_struct *, epvar_struct *,
     const eflux_struct *, const pstate_struct *, const soil_struct *,
     const daily_struct *);
+void            CheckBgcIC (char *, const elem_struct *, const river_struct *);
 int             CheckBgcSS (elem_struct *, double, int, int, int);
 void            CheckCarbonBalance (cstate_struct *, double *);
 void            CheckNitrogenBalance (nstate_struct *, double *);
+void            CompareBgcDrv (elem_struct *, bgcdrv_struct *, FILE *,
+    double *);
 void            CSummary (cflux_struct *, cstate_struct *, summary_struct *);
 void            DailyAllocation (cflux_struct *, const cstate_struct *,
     nflux_struct *, const nstate_struct *, const epconst_struct *,
@@ -460,20 +672,22 @@ void            DailyCarbonStateUpdate (cflux_struct *, cstate_struct *, int,
     int, int);
 void            DailyNitrogenStateUpdate (nflux_struct *, nstate_struct *,
     solute_struct *, int, int, int);
-void            Decomp (double, const epconst_struct *, epvar_struct *,
+void            Decomp (const epconst_struct *, const epvar_struct *,
     cstate_struct *, cflux_struct *, nstate_struct *, nflux_struct *,
     ntemp_struct *);
+void            DecompScalarBlk (bgcblk_struct *);
 void            EvergreenPhenology (const epconst_struct *, epvar_struct *,
     cstate_struct *);
 void            FRootLitFall (const epconst_struct *, double, cflux_struct *,
     nflux_struct *);
 void            FirstDay (elem_struct *, river_struct *,
     const cninit_struct *);
-double          GetCO2 (tsdata_struct, int);
-double          GetNdep (tsdata_struct, int);
+double          GetCO2 (tsdata_struct *, int);
+double          GetNdep (tsdata_struct *, int);
 void            GrowthResp (epconst_struct *, cflux_struct *);
 void            InitBgc (elem_struct *, const epctbl_struct *);
-void            InitBgcVar (elem_struct *, river_struct *, N_Vector);
+void            InitBgcOrder (const elem_struct *, int *);
+void            InitBgcVar (elem_struct *, river_struct *);
 void            LeafLitFall (const epconst_struct *, double, cflux_struct *,
     nflux_struct *);
 void            LivewoodTurnover (const epconst_struct *, epvar_struct *,
@@ -485,7 +699,8 @@ void            MaintResp (const epconst_struct *, epvar_struct *,
 void            MakeZeroFluxStruct (cflux_struct *, nflux_struct *);
 void            Mortality (const epconst_struct *, cstate_struct *,
     cflux_struct *, nstate_struct *, nflux_struct *);
-void            NTransport (pihm_struct);
+void            NTransport (elem_struct *, river_struct *, tracer_struct *,
+    double);
 void            OffsetLitterfall (const epconst_struct *, epvar_struct *,
     const cstate_struct *, cflux_struct *, nflux_struct *);
 void            OnsetGrowth (const epconst_struct *, const epvar_struct *,
@@ -494,8 +709,12 @@ void            OnsetGrowth (const epconst_struct *, const epvar_struct *,
 void            Phenology (const epconst_struct *, epvar_struct *,
     cstate_struct *, cflux_struct *, nstate_struct *, nflux_struct *,
     const daily_struct *);
-void            Photosynthesis (psn_struct *);
+void            PhotosynthesisBlk (bgcblk_struct *);
 void            PrecisionControl (cstate_struct *cs, nstate_struct *ns);
+void            PrtNTransStats (const tracer_struct *);
+void            PrtSpinupStat (char *, const elem_struct *, int, int);
+void            PsnInput (const epconst_struct *, const epvar_struct *,
+    const pstate_struct *, psn_struct *, psn_struct *, const daily_struct *);
 void            RadTrans (const cstate_struct *, eflux_struct *,
     pstate_struct *, const epconst_struct *, epvar_struct *,
     const daily_struct *);
@@ -504,6 +723,8 @@ void            ReadBgc (char *, ctrl_struct *, co2control_struct *,
     ndepcontrol_struct *, cninit_struct *, char *, char *);
 void            ReadBgcIC (char *, elem_struct *, river_struct *);
 void            ReadEPC (epctbl_struct *);
+void            RecordBgcDrv (elem_struct *, bgcdrv_struct *, FILE *);
+void            ReplayBgcDrv (pihm_struct, bgcdrv_struct *, FILE *, int);
 void            ResetSpinupStat (elem_struct *);
 void            RestartInput (cstate_struct *, nstate_struct *,
     epvar_struct *, bgcic_struct *);
@@ -512,11 +733,21 @@ void            RestartOutput (cstate_struct *, nstate_struct *,
 void            SeasonDecidPhenology (const epconst_struct *, epvar_struct *,
     const daily_struct *);
 void            SoilPsi (const soil_struct *, double, double *);
-void            TotalPhotosynthesis (const epconst_struct *, epvar_struct *,
-    const pstate_struct *, cflux_struct *, psn_struct *, psn_struct *,
-    daily_struct *);
+void            StartBgcDrv (elem_struct *);
+void            TotalPhotosynthesis (epvar_struct *, const pstate_struct *,
+    cflux_struct *, const psn_struct *, const psn_struct *);
 void            WriteBgcIC (char *, elem_struct *, river_struct *);
 void            ZeroSrcSnk (cstate_struct *, nstate_struct *,
     summary_struct *);
 #endif
+
+#ifdef _RT_
+/*
+ * RT functions
+ */
+void            chem_alloc (char *, const pihm_struct, Chem_Data, realtype);
+void            fluxtrans (realtype, realtype, const pihm_struct, Chem_Data);
+void            InitialChemFile (char *, char *, int, int *);
+void            PrintChem (char *, char *, Chem_Data, realtype);
+#endif
 #endif
@@ -21,6 +21,8 @@
  * sunpara                  char[]      sudials cvode control parameter file name
  * lsm                      char[]      land surface module control file name
  * rad                      char[]      radiation forcing file name
+ * latlon                   char[]      element latitude and longitude file
+ *                                        name
  * bgc                      char[]      bgc module control file name
  * co2                      char[]      co2 forcing file name
  * ndep                     char[]      nitrogen deposition forcing file name
@@ -46,6 +48,7 @@ typedef struct filename_struct
 #ifdef _NOAH_
     char            lsm[MAXSTRING];
     char            rad[MAXSTRING];
+    char            latlon[MAXSTRING];
 #endif
 #ifdef _CYCLES_
     char            cycles[MAXSTRING];
@@ -173,6 +176,12 @@ typedef struct meshtbl_struct
  *                                        0: use climatological values;
  *                                        else: use forcing file
  * source                   int*        element source forcing type
+ * ---------------------------------------------------------------------------
+ * Variables below only used in Flux-PIHM
+ * ---------------------------------------------------------------------------
+ * lat                      double*     element latitude [degree] (NULL: use
+ *                                        domain latitude and longitude)
+ * lon                      double*     element longitude [degree]
  ****************************************************************************/
 typedef struct atttbl_struct
 {
@@ -183,6 +192,10 @@ typedef struct atttbl_struct
     int            *meteo;
     int            *lai;
     int            *source;
+#ifdef _NOAH_
+    double         *lat;
+    double         *lon;
+#endif
 } atttbl_struct;
 
 /*****************************************************************************
@@ -263,6 +276,43 @@ typedef struct soiltbl_struct
 #endif
 } soiltbl_struct;
 
+/*****************************************************************************
+ * Lookup tables of van Genuchten functions of a soil type. Nodes are placed
+ * in binades of saturation ratio (side 0) and one minus saturation ratio
+ * (side 1), with the same number of equally spaced nodes in each binade
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * alpha                    double      alpha from van Genuchten eqn [m-1]
+ * beta                     double      beta (n) from van Genuchten eqn [-]
+ * nsub                     int         number of intervals in a binade
+ * nnode                    int         number of nodes of each side
+ * value                    double*[][] function values at nodes
+ * slope                    double*[][] monotone cubic slopes at nodes
+ * err                      double[]    maximum relative error of each
+ *                                        function [-]
+ * ---------------------------------------------------------------------------
+ * Variables below only used in Flux-PIHM
+ * ---------------------------------------------------------------------------
+ * frz                      double*     liquid water saturation ratio at
+ *                                        equilibrium, tabulated against log
+ *                                        supercooling and total saturation
+ *                                        ratio [-]
+ ****************************************************************************/
+typedef struct vgtbl_struct
+{
+    double          alpha;
+    double          beta;
+    int             nsub;
+    int             nnode;
+    double         *value[NUM_VGFN][2];
+    double         *slope[NUM_VGFN][2];
+    double          err[NUM_VGFN];
+#ifdef _NOAH_
+    double         *frz;
+#endif
+} vgtbl_struct;
+
 /*****************************************************************************
  * Geology parameter
  * ---------------------------------------------------------------------------
@@ -374,6 +424,8 @@ typedef struct lctbl_struct
  * ftime                    double*     forcing time
  * data                     double**    forcing values at forcing time
  * value                    double*     forcing values at model time t
+ * t_intrpl                 int         model time at which value was last
+ *                                        interpolated
  * zlvl_wind                double      height above groundof wind
  *                                        observations [m]
  ****************************************************************************/
@@ -383,9 +435,86 @@ typedef struct tsdata_struct
     int            *ftime;
     double        **data;
     double         *value;
+    int             t_intrpl;
     double          zlvl_wind;
 } tsdata_struct;
 
+#ifdef _NOAH_
+/*****************************************************************************
+ * Solar position table of an anchor location. Solar positions are stored at
+ * fixed intervals from 00:00 UTC of the first day, and sunrise and sunset
+ * times are stored for each day
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * latitude                 double      latitude [degree]
+ * longitude                double      longitude [degree]
+ * elevation                double      elevation [m]
+ * tavg                     double      annual average temperature
+ * t0                       int         time of first node [s]
+ * step                     int         interval between nodes [s]
+ * nday                     int         number of days
+ * nnode                    int         number of nodes
+ * zenith                   double*     solar zenith angle [degree]
+ * azimuth                  double*     solar azimuth angle, westward from
+ *                                        south [degree]
+ * ha                       double*     observer hour angle [degree]
+ * decl                     double*     geocentric declination [degree]
+ * sunrise                  double*     sunrise time (UTC) [hour]
+ * sunset                   double*     sunset time (UTC) [hour]
+ * decl_day                 double*     geocentric declination at 00:00 UTC
+ *                                        [degree]
+ ****************************************************************************/
+typedef struct soltbl_struct
+{
+    double          latitude;
+    double          longitude;
+    double          elevation;
+    double          tavg;
+    int             t0;
+    int             step;
+    int             nday;
+    int             nnode;
+    double         *zenith;
+    double         *azimuth;
+    double         *ha;
+    double         *decl;
+    double         *sunrise;
+    double         *sunset;
+    double         *decl_day;
+} soltbl_struct;
+
+/*****************************************************************************
+ * Solar geometry of elements. Solar positions of an element are corrected
+ * from those of its anchor for differences in latitude and longitude
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * corr                     int         flag to correct anchor solar
+ *                                        positions
+ * anchor                   int*        anchor (solar position table) of each
+ *                                        element
+ * sinlat                   double*     sine of element latitude
+ * coslat                   double*     cosine of element latitude
+ * dlon                     double*     longitude of element minus longitude
+ *                                        of anchor [degree]
+ * zenith                   double*     solar zenith angle of each element at
+ *                                        the current forcing step [degree]
+ * azimuth                  double*     solar azimuth angle of each element at
+ *                                        the current forcing step [degree]
+ ****************************************************************************/
+typedef struct solgeo_struct
+{
+    int             corr;
+    int            *anchor;
+    double         *sinlat;
+    double         *coslat;
+    double         *dlon;
+    double         *zenith;
+    double         *azimuth;
+} solgeo_struct;
+#endif
+
 /*****************************************************************************
  * Forcing structure
  * ---------------------------------------------------------------------------
@@ -414,6 +543,14 @@ typedef struct tsdata_struct
  *                                      co2 forcing series
  * ndep                     tsdata_struct*
  *                                      nitrogen deposition forcing series
+ * nsol                     int         number of solar position tables
+ * sol                      soltbl_struct*
+ *                                      solar position tables of anchors
+ * solgeo                   solgeo_struct
+ *                                      solar geometry of elements
+ * shared                   int         flag that forcing series have been
+ *                                        initialized by another ensemble
+ *                                        member
  ****************************************************************************/
 typedef struct forc_struct
 {
@@ -430,11 +567,15 @@ typedef struct forc_struct
 #ifdef _NOAH_
     int             nrad;
     tsdata_struct  *rad;
+    int             nsol;
+    soltbl_struct  *sol;
+    solgeo_struct   solgeo;
 #endif
 #ifdef _BGC_
     tsdata_struct  *co2;
     tsdata_struct  *ndep;
 #endif
+    int             shared;
 } forc_struct;
 
 #ifdef _NOAH_
@@ -20,6 +20,257 @@ typedef struct siteinfo_struct
     double          area;
     double          tavg;
 } siteinfo_struct;
+
+/*****************************************************************************
+ * Uniform grid index of mesh triangles for point location. Each cell lists
+ * the triangles whose bounding boxes overlap it, in ascending order
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * ntri                     int         number of triangles
+ * nx                       int         number of cells in x direction
+ * ny                       int         number of cells in y direction
+ * xmin                     double      x coordinate of lower left corner
+ * ymin                     double      y coordinate of lower left corner
+ * dx                       double      cell size in x direction
+ * dy                       double      cell size in y direction
+ * xv                       double*     x coordinates of triangle vertices
+ *                                        (three per triangle)
+ * yv                       double*     y coordinates of triangle vertices
+ * start                    int*        start of the triangle list of each
+ *                                        cell in tri (nx * ny + 1)
+ * tri                      int*        triangle lists of all cells
+ ****************************************************************************/
+typedef struct trigrid_struct
+{
+    int             ntri;
+    int             nx;
+    int             ny;
+    double          xmin;
+    double          ymin;
+    double          dx;
+    double          dy;
+    double         *xv;
+    double         *yv;
+    int            *start;
+    int            *tri;
+} trigrid_struct;
+
+/*****************************************************************************
+ * Implicit upwind transport of tracers, which is solved after each hydrology
+ * step using water fluxes of the step. Compartments are element surfaces,
+ * element subsurfaces (or saturated zones), river streams, river beds, and
+ * optionally element unsaturated zones. Each path moves tracers
+ * into or out of its owner compartment, and is paired with a path of the
+ * other compartment that uses the same water flux, so that tracers are
+ * conserved. Storage changes that are not explained by paths and sinks
+ * enter without tracers or leave as sinks. Tracers of each compartment are
+ * stored contiguously
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * split                    int         flag that unsaturated and saturated
+ *                                        zones are separate compartments
+ * ncomp                    int         number of compartments
+ * nsp                      int         number of tracer species
+ * npath                    int         number of paths
+ * start                    int*        start of paths of each compartment
+ *                                        (ncomp + 1)
+ * nabr                     int*        compartment on the other side of each
+ *                                        path (-1: outside of domain)
+ * q                        const double**
+ *                                      water flux of each path
+ * qscale                   double*     factor that converts water flux of
+ *                                        each path to m3 s-1 out of owner
+ * mobk                     int*        mobility class of owner of each path
+ *                                        (0: fully mobile, 1: mobile
+ *                                        fraction)
+ * mobm                     int*        mobility class of neighbor of each
+ *                                        path
+ * cin                      double*     inflow coefficient of each path [m2]
+ * ncolor                   int         number of colors of compartment
+ *                                        groups (elements and the river
+ *                                        network)
+ * cstart                   int*        start of groups of each color
+ *                                        (ncolor + 1)
+ * gstart                   int*        start of compartments of each group
+ *                                        in corder, with groups ordered by
+ *                                        color
+ * corder                   int*        compartments ordered by group
+ * area                     double*     area of each compartment [m2]
+ * strg                     double*     water storage of each compartment [m]
+ * strg0                    double*     water storage of each compartment at
+ *                                        the beginning of the step [m]
+ * dsat                     double*     saturated thickness of each element
+ *                                        [m]
+ * dsat0                    double*     saturated thickness of each element at
+ *                                        the beginning of the step [m]
+ * wtex                     double*     residual water exchanged between
+ *                                        unsaturated and saturated zones by
+ *                                        water table changes [m s-1]
+ * mob                      double*     mobile fraction of each species of
+ *                                        both mobility classes (2 * nsp)
+ * x                        double*     tracers of each compartment [kg m-2]
+ * src                      double*     sources of each compartment
+ *                                        [kg m-2 s-1]
+ * sink                     double*     water that leaves each compartment
+ *                                        with tracers without paths [m s-1]
+ * evap                     double*     water that leaves each compartment
+ *                                        without tracers [m s-1]
+ * dout                     double*     coefficients of sinks [m2]
+ * rhs                      double*     right hand side [kg]
+ * diag                     double*     diagonal coefficients [m2]
+ * work                     double*     work array of solver (nsp of each
+ *                                        thread)
+ * mass                     double*     tracers in the domain (nsp) [kg]
+ * gain                     double*     tracers added by sources (nsp) [kg]
+ * loss                     double*     tracers removed by sinks and outflows
+ *                                        (nsp) [kg]
+ * nsweep                   int         number of sweeps of last step
+ * time                     double      time transported [s]
+ * errmax                   double      maximum relative tracer balance error
+ *                                        of a step
+ ****************************************************************************/
+typedef struct tracer_struct
+{
+    int             split;
+    int             ncomp;
+    int             nsp;
+    int             npath;
+    int            *start;
+    int            *nabr;
+    const double  **q;
+    double         *qscale;
+    int            *mobk;
+    int            *mobm;
+    double         *cin;
+    int             ncolor;
+    int            *cstart;
+    int            *gstart;
+    int            *corder;
+    double         *area;
+    double         *strg;
+    double         *strg0;
+    double         *dsat;
+    double         *dsat0;
+    double         *wtex;
+    double         *mob;
+    double         *x;
+    double         *src;
+    double         *sink;
+    double         *evap;
+    double         *dout;
+    double         *rhs;
+    double         *diag;
+    double         *work;
+    double         *mass;
+    double         *gain;
+    double         *loss;
+    int             nsweep;
+    double          time;
+    double          errmax;
+} tracer_struct;
+
+#ifdef _NOAH_
+/*****************************************************************************
+ * Tri-diagonal soil heat or soil moisture equations of a block of elements.
+ * Coefficients are stored layer by layer so that the equations of all
+ * elements in the block are solved together
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * nlane                    int         number of elements in block
+ * nsoil                    int[]       number of soil layers of each element
+ *                                        (0: no equation to be solved)
+ * a                        double[][]  sub-diagonal coefficients
+ * b                        double[][]  diagonal coefficients
+ * c                        double[][]  super-diagonal coefficients
+ * d                        double[][]  right hand side
+ * p                        double[][]  solution
+ * delta                    double[][]  work array of solver
+ * nopac                    int[]       flag that no snowpack exists
+ * yy                       double[]    soil column top temperature
+ * zz1                      double[]    skin temperature factor
+ * df1                      double[]    top soil layer thermal conductivity
+ * t2v                      double[]    virtual air temperature
+ ****************************************************************************/
+typedef struct lsmblk_struct
+{
+    int             nlane;
+    int             nsoil[NOAH_BLOCK];
+    double          a[MAXLYR][NOAH_BLOCK];
+    double          b[MAXLYR][NOAH_BLOCK];
+    double          c[MAXLYR][NOAH_BLOCK];
+    double          d[MAXLYR][NOAH_BLOCK];
+    double          p[MAXLYR][NOAH_BLOCK];
+    double          delta[MAXLYR][NOAH_BLOCK];
+    int             nopac[NOAH_BLOCK];
+    double          yy[NOAH_BLOCK];
+    double          zz1[NOAH_BLOCK];
+    double          df1[NOAH_BLOCK];
+    double          t2v[NOAH_BLOCK];
+} lsmblk_struct;
+
+/*****************************************************************************
+ * Land surface steps of Noah element blocks. With adaptive steps, each block
+ * chooses its own step, and residuals of held fluxes are compared
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * nblk                     int         number of element blocks
+ * dt                       int*        current land surface step of each
+ *                                        block [s]
+ * next                     int*        time of next land surface step of
+ *                                        each block
+ * due                      int*        flag that a block takes a step at the
+ *                                        current model time
+ * next_min                 int         time of next land surface step of any
+ *                                        block
+ * nstep                    long int    number of block steps taken
+ * meteo                    double*     station forcing at look-ahead times
+ * pred                     double*     predicted energy balance residual of
+ *                                        the current step of each element
+ *                                        [W m-2]
+ * pred_next                double*     predicted residual of the step that
+ *                                        starts at the current model time
+ *                                        [W m-2]
+ * real                     double*     realized residual of the step that
+ *                                        ends at the current model time
+ *                                        [W m-2]
+ * held                     double*     net shortwave, downward longwave,
+ *                                        sensible heat and latent heat fluxes
+ *                                        held over the current step of each
+ *                                        element [W m-2]
+ * nres                     long int    number of element steps with
+ *                                        predicted and realized residuals
+ * nexceed                  long int    number of element steps with realized
+ *                                        residuals above the tolerance
+ * pred_sum                 double      sum of predicted residuals [W m-2]
+ * pred_max                 double      maximum predicted residual [W m-2]
+ * real_sum                 double      sum of realized residuals [W m-2]
+ * real_max                 double      maximum realized residual [W m-2]
+ ****************************************************************************/
+typedef struct lsmstep_struct
+{
+    int             nblk;
+    int            *dt;
+    int            *next;
+    int            *due;
+    int             next_min;
+    long int        nstep;
+    double         *meteo;
+    double         *pred;
+    double         *pred_next;
+    double         *real;
+    double         *held;
+    long int        nres;
+    long int        nexceed;
+    double          pred_sum;
+    double          pred_max;
+    double          real_sum;
+    double          real_max;
+} lsmstep_struct;
+#endif
 #ifdef _BGC_
 /*****************************************************************************
  * A structure to hold information on the annual co2 concentration
@@ -97,6 +348,43 @@ typedef struct cninit_struct
     double          litr1n;
     double          sminn;
 } cninit_struct;
+
+/*****************************************************************************
+ * A block of elements in daily BGC. Photosynthesis and decomposition rate
+ * scalars of all elements in a block are calculated together. Sunlit and
+ * shaded canopy fractions are separate photosynthesis lanes
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * nlane                    int         number of elements in block
+ * elem                     int[]       element indices
+ * skip                     int[]       flag that element is retired from
+ *                                        spinup
+ * annual_alloc             int[]       flag of annual allocation day
+ * psn_on                   int[]       flag that photosynthesis is calculated
+ * npsn                     int         number of photosynthesis lanes
+ * psn                      psn_struct*[]
+ *                                      photosynthesis structure of each lane
+ * ndcmp                    int         number of decomposition lanes
+ * epv                      epvar_struct*[]
+ *                                      ecophysiological variables of each
+ *                                        decomposition lane
+ * tsoil                    double[]    top soil layer temperature of each
+ *                                        decomposition lane [degree C]
+ ****************************************************************************/
+typedef struct bgcblk_struct
+{
+    int             nlane;
+    int             elem[NOAH_BLOCK];
+    int             skip[NOAH_BLOCK];
+    int             annual_alloc[NOAH_BLOCK];
+    int             psn_on[NOAH_BLOCK];
+    int             npsn;
+    psn_struct     *psn[2 * NOAH_BLOCK];
+    int             ndcmp;
+    epvar_struct   *epv[NOAH_BLOCK];
+    double          tsoil[NOAH_BLOCK];
+} bgcblk_struct;
 #endif
 
 /*****************************************************************************
@@ -203,6 +491,48 @@ typedef struct calib_struct
 #endif
 } calib_struct;
 
+#ifdef _OPENMP
+/*****************************************************************************
+ * OpenMP schedule of an element or river loop
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * schedule                 omp_sched_t loop schedule
+ * chunk                    int         chunk size (0 for default)
+ * nthreads                 int         number of threads
+ * fixed                    int         flag that schedule is set in .para
+ *                                        file and is not tuned
+ * trial                    int         candidate schedule being timed (-1
+ *                                        when tuned)
+ * best                     int         fastest candidate schedule
+ * ncall                    int         number of calls timed with current
+ *                                        schedule
+ * start                    double      start time of current call [s]
+ * time                     double      time spent with current schedule [s]
+ * best_time                double      time per call of fastest candidate
+ *                                        [s]
+ * static_time              double      time per call of default static
+ *                                        schedule [s]
+ * report                   int         flag that a new schedule has been
+ *                                        chosen and is not yet reported
+ ****************************************************************************/
+typedef struct kernel_struct
+{
+    omp_sched_t     schedule;
+    int             chunk;
+    int             nthreads;
+    int             fixed;
+    int             trial;
+    int             best;
+    int             ncall;
+    double          start;
+    double          time;
+    double          best_time;
+    double          static_time;
+    int             report;
+} kernel_struct;
+#endif
+
 /*****************************************************************************
  * Model control parameters
  * ---------------------------------------------------------------------------
@@ -246,18 +576,61 @@ typedef struct calib_struct
  * decr-                    double      decrease factor
  * incr                     double      increase factor
  * ---------------------------------------------------------------------------
+ * Variables below used to control lookup tables of soil hydraulic functions
+ * ---------------------------------------------------------------------------
+ * soil_tbl                 int         flag to use lookup tables
+ * soil_tbl_tol             double      tolerance of relative error [-]
+ * soil_tbl_verify          int         flag to verify lookup tables against
+ *                                        analytic functions
+ * ---------------------------------------------------------------------------
+ * Variables below used to control water age tracking
+ * ---------------------------------------------------------------------------
+ * water_age                int         flag to track mean water ages
+ * age_nbin                 int         number of age bins of water age
+ *                                        distributions (0: none)
+ * age_binw                 double      width of age bins [day]
+ * age_cputime              double      time spent on water ages [s]
+ * age_excess               double      maximum mean age in excess of elapsed
+ *                                        time [day]
+ * ---------------------------------------------------------------------------
  * Variables below only used in Flux-PIHM
  * ---------------------------------------------------------------------------
  * nsoil                    int         number of standard soil layers
  * sldpth                   double[]    thickness of soil layer [m]
  * rad_mode                 int         radiation forcing mode:
  *                                        0=uniform, 1=topographic
+ * anchor_res               double      size of solar position anchor cells
+ *                                        [degree]
+ * sol_validate             int         flag to validate solar positions
+ *                                        against SPA
+ * lsm_adapt                int         flag to use adaptive land surface
+ *                                        steps
+ * lsm_step_min             int         minimum land surface step [s]
+ * lsm_step_max             int         maximum land surface step [s]
+ * lsm_tol                  double      tolerance of energy balance residual
+ *                                        of land surface steps [W m-2]
+ * lsm                      lsmstep_struct
+ *                                      land surface steps of element blocks
  * ---------------------------------------------------------------------------
  * Variables below only used in Flux-PIHM-BGC
  * ---------------------------------------------------------------------------
  * maxspinyears             int         maximum number of years for spinup run
+ * spinup_replay            int         flag to replay cached daily drivers in
+ *                                        spinup cycles after the first one
+ * spinup_coupled           int         flag to run a final fully coupled
+ *                                        cycle after driver replay spinup
  * read_bgc_restart         int         flag to read BGC restart file
  * write_bgc_restart        int         flag to write BGC restart file
+ * ---------------------------------------------------------------------------
+ * Variables below only used with OpenMP
+ * ---------------------------------------------------------------------------
+ * omp_tune                 int         flag to tune OpenMP loop schedules
+ * kernel                   kernel_struct[]
+ *                                      schedules of element and river loops
+ * first_touch              int         flag to initialize element and river
+ *                                        arrays in parallel
+ * bind                     int         thread binding: 0=none, 1=close,
+ *                                        2=spread
  ****************************************************************************/
 typedef struct ctrl_struct
 {
@@ -290,13 +663,30 @@ typedef struct ctrl_struct
     double          decr;
     double          incr; 
     double          stmin;
+    int             soil_tbl;
+    double          soil_tbl_tol;
+    int             soil_tbl_verify;
+    int             water_age;
+    int             age_nbin;
+    double          age_binw;
+    double          age_cputime;
+    double          age_excess;
 #ifdef _NOAH_
     int             nsoil;
     double          sldpth[MAXLYR];
     int             rad_mode;
+    double          anchor_res;
+    int             sol_validate;
+    int             lsm_adapt;
+    int             lsm_step_min;
+    int             lsm_step_max;
+    double          lsm_tol;
+    lsmstep_struct  lsm;
 #endif
 #ifdef _BGC_
     int             maxspinyears;
+    int             spinup_replay;
+    int             spinup_coupled;
     int             read_bgc_restart;
     int             write_bgc_restart;
 #endif
@@ -304,6 +694,12 @@ typedef struct ctrl_struct
     int             read_cycles_restart;
     int             write_cycles_restart;
 #endif
+#ifdef _OPENMP
+    int             omp_tune;
+    kernel_struct   kernel[NUM_KERNEL];
+    int             first_touch;
+    int             bind;
+#endif
 } ctrl_struct;
 
 /*****************************************************************************
@@ -364,6 +760,223 @@ typedef struct prtctrlT_struct
 	FILE           *datfile;
 } prtctrlT_struct;
 
+/*****************************************************************************
+ * Restart file section
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * id                       int         module of section (RST_*_SEC)
+ * elem_stride              int         size of element records [byte]
+ * riv_stride               int         size of river segment records [byte]
+ * reserved                 int         padding
+ * offset                   long long   offset of first element record from
+ *                                        beginning of file [byte]
+ ****************************************************************************/
+typedef struct rstsec_struct
+{
+    int             id;
+    int             elem_stride;
+    int             riv_stride;
+    int             reserved;
+    long long       offset;
+} rstsec_struct;
+
+/*****************************************************************************
+ * Restart file header
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * magic                    char[]      file signature (RST_MAGIC)
+ * version                  int         restart format version
+ * nsection                 int         number of module sections
+ * nelem                    int         number of element records
+ * nriver                   int         number of river segment records
+ * sec                      rstsec_struct[]
+ *                                      module sections. Each section holds
+ *                                        nelem element records followed by
+ *                                        nriver river segment records, and
+ *                                        starts at a multiple of RST_ALIGN
+ ****************************************************************************/
+typedef struct rsthdr_struct
+{
+    char            magic[8];
+    int             version;
+    int             nsection;
+    int             nelem;
+    int             nriver;
+    rstsec_struct   sec[RST_MAXSEC];
+} rsthdr_struct;
+
+#ifdef _MPI_
+/*****************************************************************************
+ * Sort key used in domain partitioning
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * key                      double      element centroid coordinate
+ * ind                      int         element index
+ ****************************************************************************/
+typedef struct sortkey_struct
+{
+    double          key;
+    int             ind;
+} sortkey_struct;
+
+/*****************************************************************************
+ * Halo exchange structure (one per neighboring rank)
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * rank                     int         neighboring rank
+ * nsend_elem               int         number of owned elements sent
+ * nsend_riv                int         number of owned river segments sent
+ * nrecv_elem               int         number of halo elements received
+ * nrecv_riv                int         number of halo river segments received
+ * send_elem                int*        local indices of elements sent
+ * send_riv                 int*        local indices of river segments sent
+ * recv_elem                int*        local indices of elements received
+ * recv_riv                 int*        local indices of river segments
+ *                                        received
+ * sendbuf                  double*     send buffer
+ * recvbuf                  double*     receive buffer
+ * lag                      int         number of model steps by which
+ *                                        received states lag behind in
+ *                                        subcatchment mode
+ * send_req                 MPI_Request[]
+ *                                      pending sends in subcatchment mode
+ ****************************************************************************/
+typedef struct halo_struct
+{
+    int             rank;
+    int             nsend_elem;
+    int             nsend_riv;
+    int             nrecv_elem;
+    int             nrecv_riv;
+    int            *send_elem;
+    int            *send_riv;
+    int            *recv_elem;
+    int            *recv_riv;
+    double         *sendbuf;
+    double         *recvbuf;
+    int             lag;
+    MPI_Request     send_req[NUM_EXCHANGE_SLOT];
+} halo_struct;
+
+/*****************************************************************************
+ * Domain decomposition structure
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * nelem_global             int         number of elements in model domain
+ * nriver_global            int         number of river segments in model
+ *                                        domain
+ * elem_gid                 int*        global indices of local elements
+ *                                        (owned elements first)
+ * riv_gid                  int*        global indices of local river
+ *                                        segments (owned segments first)
+ * nhalo                    int         number of neighboring ranks
+ * halo                     halo_struct*
+ *                                      halo exchange with neighboring ranks
+ * requests                 MPI_Request*
+ *                                      non-blocking communication requests
+ ****************************************************************************/
+typedef struct decomp_struct
+{
+    int             nelem_global;
+    int             nriver_global;
+    int            *elem_gid;
+    int            *riv_gid;
+    int             nhalo;
+    halo_struct    *halo;
+    MPI_Request    *requests;
+} decomp_struct;
+#endif
+
+#ifdef _DAILY_
+/*****************************************************************************
+ * Daily accumulators of a block of elements. Each variable is stored lane by
+ * lane, so that all accumulators of the block are in one contiguous block of
+ * memory. Sums are averaged into the daily structures of elements at the end
+ * of each day
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * daylight_counter         int[]       number of accumulated daytime steps
+ * sfctmp                   double[]    sum of air temperature [K]
+ * tmax                     double[]    maximum air temperature [K]
+ * tmin                     double[]    minimum air temperature [K]
+ * tday                     double[]    sum of daytime air temperature [K]
+ * tnight                   double[]    sum of nighttime air temperature [K]
+ * sfcspd                   double[]    sum of wind speed [m s-1]
+ * surf                     double[]    sum of surface water level [m]
+ * unsat                    double[]    sum of unsaturated water storage [m]
+ * gw                       double[]    sum of groundwater level [m]
+ * q2d                      double[]    sum of daytime mixing ratio deficit
+ *                                        [kg kg-1]
+ * ch                       double[]    sum of daytime surface exchange
+ *                                        coefficient [m s-1]
+ * rc                       double[]    sum of daytime stomatal resistance
+ *                                        [s m-1]
+ * sfcprs                   double[]    sum of daytime air pressure [Pa]
+ * albedo                   double[]    sum of daytime surface albedo [-]
+ * soldn                    double[]    sum of daytime downward solar
+ *                                        radiation [W m-2]
+ * solar_total              double[]    daily total solar radiation [J m-2]
+ * sncovr                   double[]    sum of snow cover fraction [-]
+ * stc                      double[][]  sum of soil temperature [K]
+ * sh2o                     double[][]  sum of unfrozen soil moisture content
+ *                                        [m3 m-3]
+ * smc                      double[][]  sum of total soil moisture content
+ *                                        [m3 m-3]
+ * smflxv                   double[][]  sum of vertical soil moisture flux
+ *                                        [m s-1]
+ * et                       double[][]  sum of evapotranspiration [m s-1]
+ ****************************************************************************/
+typedef struct dailyblk_struct
+{
+    int             daylight_counter[NOAH_BLOCK];
+    double          sfctmp[NOAH_BLOCK];
+    double          tmax[NOAH_BLOCK];
+    double          tmin[NOAH_BLOCK];
+    double          tday[NOAH_BLOCK];
+    double          tnight[NOAH_BLOCK];
+    double          sfcspd[NOAH_BLOCK];
+    double          surf[NOAH_BLOCK];
+    double          unsat[NOAH_BLOCK];
+    double          gw[NOAH_BLOCK];
+    double          q2d[NOAH_BLOCK];
+    double          ch[NOAH_BLOCK];
+    double          rc[NOAH_BLOCK];
+    double          sfcprs[NOAH_BLOCK];
+    double          albedo[NOAH_BLOCK];
+    double          soldn[NOAH_BLOCK];
+    double          solar_total[NOAH_BLOCK];
+    double          sncovr[NOAH_BLOCK];
+    double          stc[MAXLYR][NOAH_BLOCK];
+    double          sh2o[MAXLYR][NOAH_BLOCK];
+    double          smc[MAXLYR][NOAH_BLOCK];
+    double          smflxv[MAXLYR][NOAH_BLOCK];
+    double          et[MAXLYR][NOAH_BLOCK];
+} dailyblk_struct;
+
+/*****************************************************************************
+ * Daily accumulators of model domain
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * counter                  int         number of accumulated steps
+ * nblk                     int         number of element blocks
+ * blk                      dailyblk_struct*
+ *                                      accumulators of element blocks
+ ****************************************************************************/
+typedef struct dailyacc_struct
+{
+    int             counter;
+    int             nblk;
+    dailyblk_struct *blk;
+} dailyacc_struct;
+#endif
+
 /*****************************************************************************
  * Print control structure
  * ---------------------------------------------------------------------------
@@ -398,13 +1011,73 @@ typedef struct pihm_struct
     ndepcontrol_struct ndepctrl;
     epctbl_struct   epctbl;
     cninit_struct   cninit;
+    int            *bgc_order;
+    tracer_struct   ntrans;
 #endif
     forc_struct     forc;
+    vgtbl_struct   *vgtbl;
+    tracer_struct   age;
+#ifdef _DAILY_
+    dailyacc_struct dacc;
+#endif
     elem_struct    *elem;
     river_struct   *riv;
     calib_struct    cal;
     ctrl_struct     ctrl;
     prtctrl_struct  prtctrl[MAXPRINT];
 	prtctrlT_struct prtctrlT[MAXPRINT];
+#ifdef _MPI_
+    decomp_struct   decomp;
+#endif
+#ifdef _RT_
+    Chem_Data       chData;
+#endif
 } *pihm_struct;
+
+/*****************************************************************************
+ * Ensemble member structure
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * name                     char[]      member name (name of calibration
+ *                                        file)
+ * outputdir                char[]      member output directory
+ * pihm                     pihm_struct member model data structure. Input
+ *                                        tables and forcing are shared with
+ *                                        the other members
+ * CV_Y                     N_Vector    member CVODE state variables
+ * cvode_mem                void*       member CVODE memory
+ * watbal                   FILE*       member water balance file
+ * maxstep                  double      current CVODE maximum step [s]
+ * ncfn                     long int    number of nonlinear convergence
+ *                                        failures
+ * nni                      long int    number of nonlinear iterations
+ ****************************************************************************/
+typedef struct member_struct
+{
+    char            name[MAXSTRING];
+    char            outputdir[MAXSTRING];
+    pihm_struct     pihm;
+    N_Vector        CV_Y;
+    void           *cvode_mem;
+    FILE           *watbal;
+    double          maxstep;
+    long int        ncfn;
+    long int        nni;
+} member_struct;
+
+/*****************************************************************************
+ * Ensemble structure
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * nmember                  int         number of ensemble members
+ * member                   member_struct*
+ *                                      ensemble members
+ ****************************************************************************/
+typedef struct ens_struct
+{
+    int             nmember;
+    member_struct  *member;
+} ens_struct;
 #endif
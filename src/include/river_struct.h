@@ -67,6 +67,27 @@ typedef struct river_wflux_struct
     double          rivflow[NUM_RIVFLX];
 } river_wflux_struct;
 
+/*****************************************************************************
+ * River water ages
+ * ---------------------------------------------------------------------------
+ * Variables                Type        Description
+ * ==========               ==========  ====================
+ * stage                    double      mean age of stream water [day]
+ * gw                       double      mean age of river bed groundwater
+ *                                        [day]
+ * stage_ttd                double[]    fraction of stream water in each age
+ *                                        bin [-]
+ * gw_ttd                   double[]    fraction of river bed groundwater in
+ *                                        each age bin [-]
+ ****************************************************************************/
+typedef struct river_age_struct
+{
+    double          stage;
+    double          gw;
+    double          stage_ttd[MAXAGEBIN];
+    double          gw_ttd[MAXAGEBIN];
+} river_age_struct;
+
 /*****************************************************************************
  * River shape parameters
  * ---------------------------------------------------------------------------
@@ -243,6 +264,7 @@ typedef struct river_struct
     river_wstate_struct ws;
     river_wstate_struct ws0;
     river_wflux_struct wf;
+    river_age_struct age;
     river_ic_struct ic;
     river_bc_struct bc;
 #ifdef _CYCLES_
@@ -7,6 +7,15 @@
  * Developer of PIHM RT 1.0: Chen Bao (baochen.d.s@gmail.com)
  * Date        : June 2013
  *****************************************************************************/
+#ifndef RT_HEADER
+#define RT_HEADER
+
+#ifndef MAX
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
 
 typedef struct Debye_Huckel_structure
 {
@@ -145,6 +154,73 @@ typedef struct Pump_Data_structure
 } Pump;
 
 
+typedef struct React_Work_structure
+{
+  /* Work arrays of React, allocated once for each thread so that cells can be
+     reacted in parallel without allocation */
+  double *residue;       /* residue of total concentrations */
+  double *tmpconc;       /* log10 concentrations of all species */
+  double *totconc;       /* total concentrations */
+  double *area;          /* mineral surface areas */
+  double *error;         /* relative errors of total concentrations */
+  double *gamma;         /* log10 activity coefficients */
+  double *Keq;           /* Keq s of the secondary species */
+  double *Rate_pre;      /* rates of kinetic reactions */
+  double *IAP;           /* ion activity products of kinetic reactions */
+  double *dependency;    /* dependencies of kinetic reactions */
+  double *Rate_spe;      /* rates of species at the start of step */
+  double *Rate_spet;     /* rates of species at the end of step */
+  double *conc;          /* concentrations of all species */
+  int *ind;              /* species of Jacobian rows and columns */
+  long int *p;           /* pivots of LU decomposition */
+  realtype *x_;          /* Newton update */
+  realtype **jcb;        /* LU factorization of Jacobian matrix */
+  long int nnewton;      /* number of Newton iterations */
+  long int nfactor;      /* number of Jacobian factorizations */
+  double *t_pre;         /* total concentrations before reaction */
+  long int nsolve;       /* number of reaction solves */
+  long int nskip;        /* number of skipped reaction solves */
+  double skip_est;       /* maximum change estimate of skipped solves */
+  double *skip_save;     /* state of a skipped cell while it is also solved (debug mode) */
+  double *skip_solved;   /* concentrations of the full solve of a skipped cell (debug mode) */
+  double skip_terr;      /* maximum relative error of total concentrations of skipped solves (debug mode) */
+  double skip_cerr;      /* maximum log10 error of species concentrations of skipped solves (debug mode) */
+  double *fd_conc;       /* perturbed log10 concentrations of Jacobian checks */
+  double *fd_tot;        /* perturbed total concentrations of Jacobian checks */
+  double jcb_err;        /* maximum error of the analytic Jacobian (debug mode) */
+} React_Work;
+
+typedef struct React_Cache_structure
+{
+  /* State of a cell at the end of its last reaction solve. Reaction of the
+     cell is skipped if its state and the reaction change of the last solve
+     are within the tolerance, and the reaction change of the last solve is
+     applied again instead */
+  int valid;             /* whether the cached state can be used */
+  int nskip;             /* number of solves skipped since the last solve */
+  double sat;            /* saturation */
+  double temperature;    /* temperature */
+  double dreact;         /* maximum relative change of total concentrations in the last solve */
+  double *t_conc;        /* total concentrations */
+  double *dt_conc;       /* change of total concentrations in the last solve */
+} React_Cache;
+
+typedef struct Trans_Work_structure
+{
+  /* Persistent arrays of OS3D. Concentrations of all grid blocks are stored in
+     one block, species by species within each grid block, and faces are
+     grouped by their upstream grid blocks so that face fluxes can be computed
+     in parallel and gathered without conflicts */
+  double *conc;          /* total concentrations of all grid blocks, t_conc of grid blocks point into it */
+  double *fconc;         /* mass fluxes of species across each face */
+  double *dconc;         /* mass changes of species of each grid block */
+  double *tmpconc;       /* new concentrations of each grid block */
+  double *diff_coe;      /* diffusion coefficients of species */
+  double *disp_coe;      /* dispersion coefficients of species */
+  int *fstart;           /* start of the faces of each grid block in face */
+  int *face;             /* faces grouped by upstream grid blocks, in ascending order */
+} Trans_Work;
+
 typedef struct Chem_Data_structure
 {
   int NumVol;            /* Number of total volume in the rt simulator */
@@ -181,6 +257,7 @@ typedef struct Chem_Data_structure
   int NumPUMP;           /* Number of pumps  */
   int SUFEFF;            /* surface effect */
   int NumBTC;            /* Number of breakthrough points */
+  int Outlet;            /* Index of the grid block beneath the outlet river segment */
   int *  BTC_loc;        /* Array of locations of breakthrough points */
   int *  prepconcindex;  /* index of prep concentration specifieid in .prep file */
   double TimMax;         /* Maximum time step the simulator can use, important if no convergence type error encountered */
@@ -207,8 +284,13 @@ typedef struct Chem_Data_structure
   Kinetic_Reaction *kinetics;         // kinetics constants and dependencies.
   Debye_Huckel      DH;
   Pump             *pumps;            // injection/ groundwater contribution
-  struct TSD_type  *TSD_prepconc;     // Time series data of concentration in precipitation.
+  tsdata_struct     TSD_prepconc;     // Time series data of concentration in precipitation.
+  int               NumPrep;          // Number of species in the time series of precipitation
+  int               PrepCtr;          // Current record of the time series of precipitation
+  int               NumWork;          // Number of React workspaces, one for each thread
+  React_Work       *Work;             // React workspaces
+  Trans_Work        Trans;            // OS3D persistent arrays
+  double            RxnTol;           // tolerance of reaction skipping, 0 for no skipping
+  React_Cache      *Cache;            // cached states of cells for reaction skipping
 } *Chem_Data;
-
-
-
+#endif
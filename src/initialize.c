@@ -8,12 +8,32 @@
 void Initialize (pihm_struct pihm, N_Vector CV_Y)
 {
     int             i, j;
+#ifdef _BGC_
+    double          mobile;
+#endif
 
     PIHMprintf (VL_VERBOSE, "\n\nInitialize data structure\n");
 
+#ifdef _MPI_
+    /* Halo elements and river segments are initialized together with owned
+     * ones. Counts are restored to owned ones before state variables are
+     * initialized */
+    nelem += nelem_halo;
+    nriver += nriver_halo;
+#endif
+
     pihm->elem = (elem_struct *)malloc (nelem * sizeof (elem_struct));
     pihm->riv = (river_struct *)malloc (nriver * sizeof (river_struct));
 
+#ifdef _OPENMP
+    /* Place element and river data near the threads that update them */
+    if (pihm->ctrl.first_touch)
+    {
+        FirstTouch (pihm->elem, nelem, sizeof (elem_struct));
+        FirstTouch (pihm->riv, nriver, sizeof (river_struct));
+    }
+#endif
+
     for (i = 0; i < nelem; i++)
     {
         pihm->elem[i].attrib.soil_type = pihm->atttbl.soil[i];
@@ -36,8 +56,9 @@ void Initialize (pihm_struct pihm, N_Vector CV_Y)
     InitTopo (pihm->elem, &pihm->meshtbl);
 
 #ifdef _NOAH_
-    /* Calculate average elevation of model domain */
-    pihm->elevation = AvgElev (pihm->elem);
+    /* Calculate average elevation and total area of model domain */
+    pihm->siteinfo.elevation = AvgElev (pihm->elem);
+    pihm->siteinfo.area = TotalArea (pihm->elem);
 #endif
 
     InitSoil (pihm->elem, &pihm->soiltbl,
@@ -46,6 +67,19 @@ void Initialize (pihm_struct pihm, N_Vector CV_Y)
 #endif
         &pihm->cal);
 
+    /* Build lookup tables of soil hydraulic functions */
+    if (pihm->ctrl.soil_tbl)
+    {
+        pihm->vgtbl = (vgtbl_struct *)malloc (pihm->soiltbl.number *
+            sizeof (vgtbl_struct));
+        InitVgTbl (pihm->elem, &pihm->soiltbl, &pihm->cal, &pihm->ctrl,
+            pihm->vgtbl);
+    }
+    else
+    {
+        pihm->vgtbl = NULL;
+    }
+
     InitLC (pihm->elem, &pihm->lctbl, &pihm->cal);
 
     InitForcing (pihm->elem, &pihm->forc, &pihm->cal
@@ -54,6 +88,12 @@ void Initialize (pihm_struct pihm, N_Vector CV_Y)
 #endif
         );
 
+#ifdef _NOAH_
+    InitLsmStep (&pihm->ctrl, pihm->forc.nmeteo);
+
+    InitSolar (&pihm->forc, &pihm->atttbl, &pihm->siteinfo, &pihm->ctrl);
+#endif
+
     InitRiver (pihm->riv, pihm->elem, &pihm->rivtbl,
         &pihm->shptbl, &pihm->matltbl, &pihm->meshtbl, &pihm->cal);
 
@@ -81,6 +121,9 @@ void Initialize (pihm_struct pihm, N_Vector CV_Y)
 
 #ifdef _BGC_
     InitBgc (pihm->elem, &pihm->epctbl);
+
+    pihm->bgc_order = (int *)malloc (nelem * sizeof (int));
+    InitBgcOrder (pihm->elem, pihm->bgc_order);
 #endif
 
     /*
@@ -90,16 +133,24 @@ void Initialize (pihm_struct pihm, N_Vector CV_Y)
     {
 #ifdef _NOAH_
         ApplyForcing (&pihm->forc, pihm->elem, pihm->ctrl.starttime,
-            &pihm->ctrl, pihm->latitude, pihm->longitude, pihm->elevation,
-            pihm->noahtbl.tbot);
+            &pihm->ctrl);
 #endif
         SaturationIC (pihm->elem, pihm->riv);
     }
     else if (pihm->ctrl.init_type == RST_FILE)
     {
+#ifdef _MPI_
+        ReadICPar (pihm->filename.ic, pihm->elem, pihm->riv, &pihm->decomp);
+#else
         ReadIC (pihm->filename.ic, pihm->elem, pihm->riv);
+#endif
     }
 
+#ifdef _MPI_
+    nelem -= nelem_halo;
+    nriver -= nriver_halo;
+#endif
+
     InitVar (pihm->elem, pihm->riv, CV_Y);
 
 #ifdef _BGC_
@@ -115,12 +166,22 @@ void Initialize (pihm_struct pihm, N_Vector CV_Y)
         FirstDay (pihm->elem, pihm->riv, &pihm->cninit);
     }
 
-    InitBgcVar (pihm->elem, pihm->riv, CV_Y);
+    InitBgcVar (pihm->elem, pihm->riv);
+
+    mobile = MOBILEN_PROPORTION;
+    InitTracer (pihm->elem, pihm->riv, 1, &mobile, 0, &pihm->ntrans);
 #endif
 
+    if (pihm->ctrl.water_age)
+    {
+        InitWaterAge (pihm->elem, pihm->riv, &pihm->ctrl, &pihm->age);
+    }
+
     CalcModelStep (&pihm->ctrl);
 
 #ifdef _DAILY_
+    InitDailyAcc (&pihm->dacc);
+
     InitDailyStruct (pihm);
 #endif
 }
@@ -212,6 +273,7 @@ void InitSoil (elem_struct *elem, const soiltbl_struct *soiltbl,
         }
         elem[i].soil.alpha = cal->alpha * soiltbl->alpha[soil_ind];
         elem[i].soil.beta = cal->beta * soiltbl->beta[soil_ind];
+        elem[i].soil.vgtbl = NULL;
 
 
         /* Calculate field capacity and wilting point following Chan and
@@ -394,73 +456,85 @@ void InitForcing (elem_struct *elem, forc_struct *forc,
 {
     int             i, j;
 
-    /* Apply scenarios */
-    for (i = 0; i < forc->nmeteo; i++)
+    /* Forcing series shared by ensemble members are only initialized once */
+    if (!forc->shared)
     {
-        for (j = 0; j < forc->meteo[i].length; j++)
+        /* Apply scenarios */
+        for (i = 0; i < forc->nmeteo; i++)
         {
-            forc->meteo[i].data[j][PRCP_TS] *= cal->prcp;
-            forc->meteo[i].data[j][SFCTMP_TS] += cal->sfctmp;
+            for (j = 0; j < forc->meteo[i].length; j++)
+            {
+                forc->meteo[i].data[j][PRCP_TS] *= cal->prcp;
+                forc->meteo[i].data[j][SFCTMP_TS] += cal->sfctmp;
+            }
         }
-    }
 
-    if (forc->nbc > 0)
-    {
-        for (i = 0; i < forc->nbc; i++)
+        if (forc->nbc > 0)
         {
-            forc->bc[i].value = (double *)malloc (sizeof (double));
+            for (i = 0; i < forc->nbc; i++)
+            {
+                forc->bc[i].value = (double *)malloc (sizeof (double));
+                forc->bc[i].t_intrpl = BADVAL;
+            }
         }
-    }
-    if (forc->nmeteo > 0)
-    {
-        for (i = 0; i < forc->nmeteo; i++)
+        if (forc->nmeteo > 0)
         {
-            forc->meteo[i].value =
-                (double *)malloc (NUM_METEO_VAR * sizeof (double));
+            for (i = 0; i < forc->nmeteo; i++)
+            {
+                forc->meteo[i].value =
+                    (double *)malloc (NUM_METEO_VAR * sizeof (double));
+                forc->meteo[i].t_intrpl = BADVAL;
+            }
         }
-    }
-    if (forc->nlai > 0)
-    {
-        for (i = 0; i < forc->nlai; i++)
+        if (forc->nlai > 0)
         {
-            forc->lai[i].value = (double *)malloc (sizeof (double));
+            for (i = 0; i < forc->nlai; i++)
+            {
+                forc->lai[i].value = (double *)malloc (sizeof (double));
+                forc->lai[i].t_intrpl = BADVAL;
+            }
         }
-    }
-    if (forc->nriverbc > 0)
-    {
-        for (i = 0; i < forc->nriverbc; i++)
+        if (forc->nriverbc > 0)
         {
-            forc->riverbc[i].value = (double *)malloc (sizeof (double));
+            for (i = 0; i < forc->nriverbc; i++)
+            {
+                forc->riverbc[i].value = (double *)malloc (sizeof (double));
+                forc->riverbc[i].t_intrpl = BADVAL;
+            }
         }
-    }
-    if (forc->nsource > 0)
-    {
-        for (i = 0; i < forc->nsource; i++)
+        if (forc->nsource > 0)
         {
-            forc->source[i].value = (double *)malloc (sizeof (double));
+            for (i = 0; i < forc->nsource; i++)
+            {
+                forc->source[i].value = (double *)malloc (sizeof (double));
+                forc->source[i].t_intrpl = BADVAL;
+            }
         }
-    }
 #ifdef _NOAH_
-    if (forc->nrad > 0)
-    {
-        for (i = 0; i < forc->nrad; i++)
+        if (forc->nrad > 0)
         {
-            forc->rad[i].value = (double *)malloc (2 * sizeof (double));
+            for (i = 0; i < forc->nrad; i++)
+            {
+                forc->rad[i].value = (double *)malloc (2 * sizeof (double));
+                forc->rad[i].t_intrpl = BADVAL;
+            }
         }
-    }
 #endif
 
 #ifdef _BGC_
-    if (!spinup_mode && varco2)
-    {
-        forc->co2[0].value = (double *)malloc (sizeof (double));
-    }
+        if (!spinup_mode && varco2)
+        {
+            forc->co2[0].value = (double *)malloc (sizeof (double));
+            forc->co2[0].t_intrpl = BADVAL;
+        }
 
-    if (!spinup_mode && varndep)
-    {
-        forc->ndep[0].value = (double *)malloc (sizeof (double));
-    }
+        if (!spinup_mode && varndep)
+        {
+            forc->ndep[0].value = (double *)malloc (sizeof (double));
+            forc->ndep[0].t_intrpl = BADVAL;
+        }
 #endif
+    }
 
     for (i = 0; i < nelem; i++)
     {
@@ -772,15 +846,9 @@ void InitVar (elem_struct *elem, river_struct *riv, N_Vector CV_Y)
         elem[i].ws.unsat = elem[i].ic.unsat;
         elem[i].ws.gw = elem[i].ic.gw;
 
-#ifdef _OPENMP
-		NV_Ith_OMP(CV_Y, SURF(i)) = elem[i].ic.surf;
-		NV_Ith_OMP(CV_Y, UNSAT(i)) = elem[i].ic.unsat;
-		NV_Ith_OMP(CV_Y, GW(i)) = elem[i].ic.gw;
-#else
-		NV_Ith_S(CV_Y, SURF(i)) = elem[i].ic.surf;
-		NV_Ith_S(CV_Y, UNSAT(i)) = elem[i].ic.unsat;
-		NV_Ith_S(CV_Y, GW(i)) = elem[i].ic.gw;
-#endif
+        NV_Ith (CV_Y, SURF(i)) = elem[i].ic.surf;
+        NV_Ith (CV_Y, UNSAT(i)) = elem[i].ic.unsat;
+        NV_Ith (CV_Y, GW(i)) = elem[i].ic.gw;
 
 #ifdef _NOAH_
         elem[i].es.t1 = elem[i].ic.t1;
@@ -802,18 +870,13 @@ void InitVar (elem_struct *elem, river_struct *riv, N_Vector CV_Y)
         riv[i].ws.stage = riv[i].ic.stage;
         riv[i].ws.gw = riv[i].ic.gw;
 
-#ifdef _OPENMP
-		NV_Ith_OMP(CV_Y, RIVSTG(i)) = riv[i].ic.stage;
-		NV_Ith_OMP(CV_Y, RIVGW(i)) = riv[i].ic.gw;
-#else
-		NV_Ith_S (CV_Y, RIVSTG(i)) = riv[i].ic.stage;
-        NV_Ith_S (CV_Y, RIVGW(i)) = riv[i].ic.gw;
-#endif
+        NV_Ith (CV_Y, RIVSTG(i)) = riv[i].ic.stage;
+        NV_Ith (CV_Y, RIVGW(i)) = riv[i].ic.gw;
         riv[i].ws0 = riv[i].ws;
     }
 
     /* Other variables */
-    for (i = 0; i < nelem; i++)
+    for (i = 0; i < NLOCALELEM; i++)
     {
         InitWFlux (&elem[i].wf);
 
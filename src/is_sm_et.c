@@ -8,7 +8,9 @@ void IntcpSnowET (int t, double stepsize, pihm_struct pihm)
     const double    T0 = 0.0;
 
 #ifdef _OPENMP
-#pragma omp parallel for
+    KernelStart (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[ET_KERNEL]);
+#pragma omp parallel for schedule(runtime) \
+    num_threads(pihm->ctrl.kernel[ET_KERNEL].nthreads)
 #endif
     for (i = 0; i < nelem; i++)
     {
@@ -231,4 +233,7 @@ void IntcpSnowET (int t, double stepsize, pihm_struct pihm)
             (1.0 - elem->lc.shdfac) * (1.0 - frac_snow) * elem->wf.prcp +
             elem->wf.drip + melt_rate;
     }
+#ifdef _OPENMP
+    KernelEnd (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[ET_KERNEL]);
+#endif
 }
@@ -6,13 +6,15 @@ void LateralFlow (pihm_struct pihm)
     double         *dhbydx;
     double         *dhbydy;
 
-    dhbydx = (double *)malloc (nelem * sizeof (double));
-    dhbydy = (double *)malloc (nelem * sizeof (double));
+    dhbydx = (double *)malloc (NLOCALELEM * sizeof (double));
+    dhbydy = (double *)malloc (NLOCALELEM * sizeof (double));
 
     FrictSlope (pihm->elem, pihm->riv, pihm->ctrl.surf_mode, dhbydx, dhbydy);
 
 #ifdef _OPENMP
-#pragma omp parallel for
+    KernelStart (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[LATFLOW_KERNEL]);
+#pragma omp parallel for schedule(runtime) \
+    num_threads(pihm->ctrl.kernel[LATFLOW_KERNEL].nthreads)
 #endif
     for (i = 0; i < nelem; i++)
     {
@@ -61,6 +63,9 @@ void LateralFlow (pihm_struct pihm)
                 /* Groundwater flow modeled by Darcy's Law */
                 elem->wf.subsurf[j] =
                     avg_ksat * grad_y_sub * avg_y_sub * elem->topo.edge[j];
+#ifdef _RT_
+                elem->topo.areasub[j] = avg_y_sub * elem->topo.edge[j];
+#endif
 
                 /*
                  * Surface lateral flux calculation between triangular
@@ -145,6 +150,9 @@ void LateralFlow (pihm_struct pihm)
             }                   /* End of specified boundary condition */
         }                       /* End of neighbor loop */
     }                           /* End of element loop */
+#ifdef _OPENMP
+    KernelEnd (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[LATFLOW_KERNEL]);
+#endif
 
     free (dhbydx);
     free (dhbydy);
@@ -154,10 +162,11 @@ void FrictSlope (elem_struct *elem, river_struct *riv, int surf_mode,
     double *dhbydx, double *dhbydy)
 {
     int             i;
+    /* Slopes of halo elements are needed by their owned neighbors */
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-    for (i = 0; i < nelem; i++)
+    for (i = 0; i < NLOCALELEM; i++)
     {
     int             j;
     double          surfh[NUM_EDGE];
@@ -4,6 +4,7 @@ int             verbose_mode;
 int             debug_mode;
 int             corr_mode;
 int             spinup_mode;
+int             ensemble_mode;
 char            project[MAXSTRING];
 int             nelem;
 int             nriver;
@@ -12,9 +13,9 @@ realtype        cputime, cputime_dt;/* Time cpu duration */
 static double   dtime = 0;
 long int        nst, nfe, nfeLS, nni, ncfn, netf, ncfni = 0, nnii = 10; /*Variables for monitoring performance */
 int             flag;
-char            WBname[100];
-char            Perfname[50];
-char            Convname[50];
+char            WBname[MAXSTRING];
+char            Perfname[MAXSTRING];
+char            Convname[MAXSTRING];
 double          maxstep;
 FILE            *WaterBalance; /* Water balance file */
 FILE            *Perf; /* Performance file */
@@ -31,6 +32,13 @@ int             nthreads=1;  /* default value */
 #if defined(_BGC_) || defined (_CYCLES_)
 int             first_balance;
 #endif
+#ifdef _MPI_
+int             mpi_rank;
+int             mpi_size;
+int             nelem_halo;
+int             nriver_halo;
+int             subcat_mode;
+#endif
 
 int main (int argc, char *argv[])
 {
@@ -42,6 +50,12 @@ int main (int argc, char *argv[])
 
 	memset(outputdir, 0, MAXSTRING);
 
+#ifdef _MPI_
+    MPI_Init (&argc, &argv);
+    MPI_Comm_rank (MPI_COMM_WORLD, &mpi_rank);
+    MPI_Comm_size (MPI_COMM_WORLD, &mpi_size);
+#endif
+
 	/* Set the number of threads to use */
 #ifdef _OPENMP
     nthreads = omp_get_max_threads();
@@ -50,11 +64,30 @@ int main (int argc, char *argv[])
     /* Read command line arguments */
     ParseCmdLineParam (argc, argv, outputdir);
 
+#ifdef _MPI_
+    if (ensemble_mode || corr_mode)
+    {
+        PIHMprintf (VL_ERROR, "Error: Ensemble mode and surface elevation "
+            "correction mode are not supported in MPI runs.\n");
+        PIHMexit (EXIT_FAILURE);
+    }
+#endif
+
     /* Print AscII art */
     AsciiArt ();
 
     /* Create output directory */
+#ifdef _MPI_
+    /* Default output directory name is time stamped, so it is created by
+     * rank 0 and broadcast */
+    if (0 == mpi_rank)
+    {
+        CreateOutputDir (outputdir);
+    }
+    MPI_Bcast (outputdir, MAXSTRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+#else
     CreateOutputDir (outputdir);
+#endif
 
     /* Allocate memory for model data structure */
     pihm = (pihm_struct)malloc (sizeof *pihm);
@@ -62,24 +95,61 @@ int main (int argc, char *argv[])
     /* Read PIHM input files */
     ReadAlloc (project, pihm);
 
-/* Initialize CVode state variables */
+#ifdef _MPI_
+    /* Partition model domain and localize input tables */
+    Decompose (pihm, outputdir);
+
+    /* Each rank writes output of its owned elements and river segments to
+     * its own directory */
+    {
+        char            rankdir[MAXSTRING];
+
+        CheckStrLen (snprintf (rankdir, MAXSTRING, "%srank%d/", outputdir,
+            mpi_rank), rankdir);
+        strcpy (outputdir, rankdir);
+        CreateOutputDir (outputdir);
+    }
+#endif
+
 #ifdef _OPENMP
-	CV_Y = N_VNew_OpenMP(NSV, nthreads);
-	abstol = N_VNew_OpenMP(NSV, nthreads);
-#else
-	CV_Y = N_VNew_Serial(NSV);
-	abstol = N_VNew_Serial(NSV);
+    /* Bind threads before element data are first touched */
+    BindThreads (pihm->ctrl.bind);
+#endif
+
+    if (ensemble_mode)
+    {
+        /* Run calibration ensemble sharing mesh and forcing */
+        RunEnsemble (pihm, outputdir);
+
+        FreeData (pihm);
+        free (pihm);
+        PIHMprintf (VL_NORMAL, "\nSimulation completed.\n");
+
+        return (EXIT_SUCCESS);
+    }
+
+    /* Initialize CVode state variables */
+    CV_Y = N_VNew (NSV);
+    abstol = N_VNew (NSV);
+#ifdef _OPENMP
+    if (pihm->ctrl.first_touch)
+    {
+        FirstTouchVector (CV_Y);
+        FirstTouchVector (abstol);
+    }
 #endif
 
     /* Initialize PIHM structure */
     Initialize (pihm, CV_Y);
+#ifdef _MPI_
+    if (subcat_mode)
+    {
+        InitBoundaryState (pihm);
+    }
+#endif
 	/* Set the vector absolute tolerance */
 	for (i = 0; i < NSV; i++) {
-#ifdef _OPENMP
-		NV_Ith_OMP(abstol, i) = pihm->ctrl.abstol;
-#else
-		NV_Ith_S(abstol, i) = pihm->ctrl.abstol;
-#endif
+		NV_Ith (abstol, i) = pihm->ctrl.abstol;
 	}
     /* Allocate memory for solver */
     cvode_mem = CVodeCreate (CV_BDF, CV_NEWTON);
@@ -93,7 +163,12 @@ int main (int argc, char *argv[])
     MapOutput (project, pihm, outputdir);
 
     /* Backup input files */
-#if !defined(_MSC_VER)
+#if defined(_MPI_)
+    if (0 == mpi_rank)
+    {
+        BKInput (project, outputdir);
+    }
+#elif !defined(_MSC_VER)
     BKInput (project, outputdir);
 #endif
 
@@ -102,23 +177,35 @@ int main (int argc, char *argv[])
 
 	if (pihm->ctrl.waterB)
 	{
-		sprintf(WBname, "%s%s_WaterBalance.plt", outputdir, project);
+		CheckStrLen(snprintf(WBname, MAXSTRING, "%s%s_WaterBalance.plt",
+			outputdir, project), WBname);
 		WaterBalance = fopen(WBname, "w");
 		CheckFile(WaterBalance, WBname);
 	}
 	if (pihm->ctrl.cvode_perf) {
-		sprintf(Perfname, "%s%s_Performance.txt", outputdir, project);
+		CheckStrLen(snprintf(Perfname, MAXSTRING, "%s%s_Performance.txt",
+			outputdir, project), Perfname);
 		Perf = fopen(Perfname, "w");
 		CheckFile(Perf, Perfname);
 		dtime = dtime + cputime_dt;
 		fprintf(Perf, " Time step, cpu_dt, cpu_time, solver_step\n");
-		sprintf(Convname, "%s%s_CVODE.log", outputdir, project);
+		CheckStrLen(snprintf(Convname, MAXSTRING, "%s%s_CVODE.log",
+			outputdir, project), Convname);
 		Conv = fopen(Convname, "w");
 		CheckFile(Conv, Convname);
        }
 
     InitOutputFile (pihm->prtctrl, pihm->ctrl.nprint, pihm->ctrl.ascii, pihm->prtctrlT, pihm->ctrl.nprintT, pihm->ctrl.tecplot);
 
+#ifdef _RT_
+    /* Initialize reactive transport grid blocks and chemistry */
+    pihm->chData = (Chem_Data)malloc (sizeof (*pihm->chData));
+    chem_alloc (project, pihm, pihm->chData,
+        (realtype)pihm->ctrl.starttime / 60.0);
+    InitialChemFile (outputdir, project, pihm->chData->NumBTC,
+        pihm->chData->BTC_loc);
+#endif
+
     PIHMprintf (VL_VERBOSE, "\n\nSolving ODE system ... \n\n");
 
     /* Set solver parameters */
@@ -134,7 +221,7 @@ int main (int argc, char *argv[])
 #ifdef _BGC_
     if (spinup_mode)
     {
-        BgcSpinup (pihm, CV_Y, cvode_mem);
+        BgcSpinup (pihm, CV_Y, cvode_mem, outputdir, WaterBalance);
     }
     else
     {
@@ -161,8 +248,22 @@ int main (int argc, char *argv[])
 #endif
 		ncfni = ncfn;
 		nnii = nni;
+#ifdef _MPI_
+        /* Subcatchments advance as soon as states of their neighbors are
+         * available */
+        if (subcat_mode)
+        {
+            RecvBoundaryState (pihm, i);
+        }
+#endif
      	PIHM(pihm, cvode_mem, CV_Y, pihm->ctrl.tout[i],
 				  pihm->ctrl.tout[i + 1], outputdir, project, cputime, WaterBalance);
+#ifdef _MPI_
+        if (subcat_mode)
+        {
+            SendBoundaryState (pihm, i);
+        }
+#endif
 
 		if (pihm->ctrl.cvode_perf) {
 			dtime = dtime + cputime_dt;
@@ -173,6 +274,10 @@ int main (int argc, char *argv[])
 			}
 				/* Print CVODE statistics */
 				PrintStats(cvode_mem, Conv);
+#ifdef _OPENMP
+            /* Print newly tuned OpenMP loop schedules */
+            PrtKernel (Perf, &pihm->ctrl, pihm->ctrl.tout[i]);
+#endif
 		}
 		flag = CVodeGetNumNonlinSolvConvFails(cvode_mem, &ncfn);
 		flag = CVodeGetNumNonlinSolvIters(cvode_mem, &nni);
@@ -194,9 +299,20 @@ int main (int argc, char *argv[])
         */
         if (pihm->ctrl.write_ic && (pihm->ctrl.tout[i] - pihm->ctrl.starttime) % pihm->ctrl.prtvrbl[IC_CTRL] == 0)
         {
+#ifdef _MPI_
+            PrtInitPar (pihm->elem, pihm->riv, project, pihm->ctrl.tout[i],
+                &pihm->decomp);
+#else
             PrtInit(pihm->elem, pihm->riv, project, pihm->ctrl.tout[i]);
+#endif
         }
     }
+#ifdef _MPI_
+    if (subcat_mode)
+    {
+        FinishBoundaryExchange (pihm, pihm->ctrl.nstep);
+    }
+#endif
 #ifdef _BGC_
     }
 #endif
@@ -221,20 +337,23 @@ int main (int argc, char *argv[])
 	flag = CVodeGetNumRhsEvals(cvode_mem, &nfe);
 	flag = CVodeGetNumErrTestFails(cvode_mem, &netf);
 
-	printf("nst = %-6ld nfe  = %-6ld \n",
+	PIHMprintf(VL_NORMAL, "nst = %-6ld nfe  = %-6ld \n",
 		nst, nfe);
-	printf("nni = %-6ld ncfn = %-6ld netf = %-6ld\n \n",
+	PIHMprintf(VL_NORMAL, "nni = %-6ld ncfn = %-6ld netf = %-6ld\n \n",
 		nni, ncfn, netf);
+#ifdef _NOAH_
+    PrtFrzStats (pihm->elem);
+    PrtLsmStats (&pihm->ctrl);
+#endif
+    PrtAgeStats (&pihm->ctrl, &pihm->age, cputime);
+#ifdef _BGC_
+    PrtNTransStats (&pihm->ntrans);
+#endif
 
 
     /* Free memory */
-#ifdef _OPENMP
-	N_VDestroy_OpenMP(CV_Y);
-	N_VDestroy_OpenMP(abstol);
-#else
-	N_VDestroy_Serial(CV_Y);
-	N_VDestroy_Serial(abstol);
-#endif
+    N_VDestroy (CV_Y);
+    N_VDestroy (abstol);
     /* Free integrator memory */
     CVodeFree (&cvode_mem);
 	if (pihm->ctrl.waterB)
@@ -245,9 +364,19 @@ int main (int argc, char *argv[])
 		fclose(Perf);
 		fclose(Conv);
 	}
+#ifdef _MPI_
+    /* Input tables hold owned and halo entries */
+    nelem += nelem_halo;
+    nriver += nriver_halo;
+    FreeDecomp (&pihm->decomp);
+#endif
     FreeData (pihm);
     free (pihm);
     PIHMprintf (VL_NORMAL, "\nSimulation completed.\n");
 
+#ifdef _MPI_
+    MPI_Finalize ();
+#endif
+
     return (EXIT_SUCCESS);
  }
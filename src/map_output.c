@@ -410,6 +410,176 @@ void MapOutput (char *simulation, pihm_struct pihm, char *outputdir)
                         n++;
                     }
                     break;
+                case AGE_SURF_CTRL:
+                    sprintf (pihm->prtctrl[n].name, "%s%s.surfage", outputdir,
+                        simulation);
+                    pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                    pihm->prtctrl[n].upd_intvl = HYDROL_STEP;
+                    pihm->prtctrl[n].nvar = nelem;
+                    pihm->prtctrl[n].var =
+                        (double **)malloc (pihm->prtctrl[n].nvar *
+                        sizeof (double *));
+                    for (j = 0; j < nelem; j++)
+                    {
+                        pihm->prtctrl[n].var[j] = &pihm->elem[j].age.surf;
+                    }
+                    n++;
+                    break;
+                case AGE_UNSAT_CTRL:
+                    sprintf (pihm->prtctrl[n].name, "%s%s.unsatage", outputdir,
+                        simulation);
+                    pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                    pihm->prtctrl[n].upd_intvl = HYDROL_STEP;
+                    pihm->prtctrl[n].nvar = nelem;
+                    pihm->prtctrl[n].var =
+                        (double **)malloc (pihm->prtctrl[n].nvar *
+                        sizeof (double *));
+                    for (j = 0; j < nelem; j++)
+                    {
+                        pihm->prtctrl[n].var[j] = &pihm->elem[j].age.unsat;
+                    }
+                    n++;
+                    break;
+                case AGE_GW_CTRL:
+                    sprintf (pihm->prtctrl[n].name, "%s%s.gwage", outputdir,
+                        simulation);
+                    pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                    pihm->prtctrl[n].upd_intvl = HYDROL_STEP;
+                    pihm->prtctrl[n].nvar = nelem;
+                    pihm->prtctrl[n].var =
+                        (double **)malloc (pihm->prtctrl[n].nvar *
+                        sizeof (double *));
+                    for (j = 0; j < nelem; j++)
+                    {
+                        pihm->prtctrl[n].var[j] = &pihm->elem[j].age.gw;
+                    }
+                    n++;
+                    break;
+                case AGE_RIVSTG_CTRL:
+                    sprintf (pihm->prtctrl[n].name, "%s%s.stageage", outputdir,
+                        simulation);
+                    pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                    pihm->prtctrl[n].upd_intvl = HYDROL_STEP;
+                    pihm->prtctrl[n].nvar = nriver;
+                    pihm->prtctrl[n].var =
+                        (double **)malloc (pihm->prtctrl[n].nvar *
+                        sizeof (double *));
+                    for (j = 0; j < nriver; j++)
+                    {
+                        pihm->prtctrl[n].var[j] = &pihm->riv[j].age.stage;
+                    }
+                    n++;
+                    break;
+                case AGE_RIVGW_CTRL:
+                    sprintf (pihm->prtctrl[n].name, "%s%s.rivgwage", outputdir,
+                        simulation);
+                    pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                    pihm->prtctrl[n].upd_intvl = HYDROL_STEP;
+                    pihm->prtctrl[n].nvar = nriver;
+                    pihm->prtctrl[n].var =
+                        (double **)malloc (pihm->prtctrl[n].nvar *
+                        sizeof (double *));
+                    for (j = 0; j < nriver; j++)
+                    {
+                        pihm->prtctrl[n].var[j] = &pihm->riv[j].age.gw;
+                    }
+                    n++;
+                    break;
+                case TTD_SURF_CTRL:
+                    for (k = 0; k < pihm->ctrl.age_nbin; k++)
+                    {
+                        sprintf (pihm->prtctrl[n].name, "%s%s.surfttd%d",
+                            outputdir, simulation, k);
+                        pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                        pihm->prtctrl[n].upd_intvl = HYDROL_STEP;
+                        pihm->prtctrl[n].nvar = nelem;
+                        pihm->prtctrl[n].var =
+                            (double **)malloc (pihm->prtctrl[n].nvar *
+                            sizeof (double *));
+                        for (j = 0; j < nelem; j++)
+                        {
+                            pihm->prtctrl[n].var[j] =
+                                &pihm->elem[j].age.surf_ttd[k];
+                        }
+                        n++;
+                    }
+                    break;
+                case TTD_UNSAT_CTRL:
+                    for (k = 0; k < pihm->ctrl.age_nbin; k++)
+                    {
+                        sprintf (pihm->prtctrl[n].name, "%s%s.unsatttd%d",
+                            outputdir, simulation, k);
+                        pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                        pihm->prtctrl[n].upd_intvl = HYDROL_STEP;
+                        pihm->prtctrl[n].nvar = nelem;
+                        pihm->prtctrl[n].var =
+                            (double **)malloc (pihm->prtctrl[n].nvar *
+                            sizeof (double *));
+                        for (j = 0; j < nelem; j++)
+                        {
+                            pihm->prtctrl[n].var[j] =
+                                &pihm->elem[j].age.unsat_ttd[k];
+                        }
+                        n++;
+                    }
+                    break;
+                case TTD_GW_CTRL:
+                    for (k = 0; k < pihm->ctrl.age_nbin; k++)
+                    {
+                        sprintf (pihm->prtctrl[n].name, "%s%s.gwttd%d",
+                            outputdir, simulation, k);
+                        pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                        pihm->prtctrl[n].upd_intvl = HYDROL_STEP;
+                        pihm->prtctrl[n].nvar = nelem;
+                        pihm->prtctrl[n].var =
+                            (double **)malloc (pihm->prtctrl[n].nvar *
+                            sizeof (double *));
+                        for (j = 0; j < nelem; j++)
+                        {
+                            pihm->prtctrl[n].var[j] =
+                                &pihm->elem[j].age.gw_ttd[k];
+                        }
+                        n++;
+                    }
+                    break;
+                case TTD_RIVSTG_CTRL:
+                    for (k = 0; k < pihm->ctrl.age_nbin; k++)
+                    {
+                        sprintf (pihm->prtctrl[n].name, "%s%s.stagettd%d",
+                            outputdir, simulation, k);
+                        pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                        pihm->prtctrl[n].upd_intvl = HYDROL_STEP;
+                        pihm->prtctrl[n].nvar = nriver;
+                        pihm->prtctrl[n].var =
+                            (double **)malloc (pihm->prtctrl[n].nvar *
+                            sizeof (double *));
+                        for (j = 0; j < nriver; j++)
+                        {
+                            pihm->prtctrl[n].var[j] =
+                                &pihm->riv[j].age.stage_ttd[k];
+                        }
+                        n++;
+                    }
+                    break;
+                case TTD_RIVGW_CTRL:
+                    for (k = 0; k < pihm->ctrl.age_nbin; k++)
+                    {
+                        sprintf (pihm->prtctrl[n].name, "%s%s.rivgwttd%d",
+                            outputdir, simulation, k);
+                        pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                        pihm->prtctrl[n].upd_intvl = HYDROL_STEP;
+                        pihm->prtctrl[n].nvar = nriver;
+                        pihm->prtctrl[n].var =
+                            (double **)malloc (pihm->prtctrl[n].nvar *
+                            sizeof (double *));
+                        for (j = 0; j < nriver; j++)
+                        {
+                            pihm->prtctrl[n].var[j] =
+                                &pihm->riv[j].age.gw_ttd[k];
+                        }
+                        n++;
+                    }
+                    break;
 #ifdef _NOAH_
                 case T1_CTRL:
                     sprintf (pihm->prtctrl[n].name, "%s%s.t1", outputdir,
@@ -682,6 +852,51 @@ void MapOutput (char *simulation, pihm_struct pihm, char *outputdir)
                     }
                     n++;
                     break;
+                case LEAFC_CTRL:
+                    sprintf (pihm->prtctrl[n].name, "%s%s.leafc", outputdir,
+                        simulation);
+                    pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                    pihm->prtctrl[n].upd_intvl = CN_STEP;
+                    pihm->prtctrl[n].nvar = nelem;
+                    pihm->prtctrl[n].var =
+                        (double **)malloc (pihm->prtctrl[n].nvar *
+                        sizeof (double *));
+                    for (j = 0; j < nelem; j++)
+                    {
+                        pihm->prtctrl[n].var[j] = &pihm->elem[j].cs.leafc;
+                    }
+                    n++;
+                    break;
+                case LIVESTEMC_CTRL:
+                    sprintf (pihm->prtctrl[n].name, "%s%s.livestemc", outputdir,
+                        simulation);
+                    pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                    pihm->prtctrl[n].upd_intvl = CN_STEP;
+                    pihm->prtctrl[n].nvar = nelem;
+                    pihm->prtctrl[n].var =
+                        (double **)malloc (pihm->prtctrl[n].nvar *
+                        sizeof (double *));
+                    for (j = 0; j < nelem; j++)
+                    {
+                        pihm->prtctrl[n].var[j] = &pihm->elem[j].cs.livestemc;
+                    }
+                    n++;
+                    break;
+                case DEADSTEMC_CTRL:
+                    sprintf (pihm->prtctrl[n].name, "%s%s.deadstemc", outputdir,
+                        simulation);
+                    pihm->prtctrl[n].intvl = pihm->ctrl.prtvrbl[i];
+                    pihm->prtctrl[n].upd_intvl = CN_STEP;
+                    pihm->prtctrl[n].nvar = nelem;
+                    pihm->prtctrl[n].var =
+                        (double **)malloc (pihm->prtctrl[n].nvar *
+                        sizeof (double *));
+                    for (j = 0; j < nelem; j++)
+                    {
+                        pihm->prtctrl[n].var[j] = &pihm->elem[j].cs.deadstemc;
+                    }
+                    n++;
+                    break;
                 case LITRC_CTRL:
                     sprintf (pihm->prtctrl[n].name, "%s%s.litrc", outputdir,
                         simulation);
@@ -25,7 +25,11 @@ void ParseCmdLineParam (int argc, char *argv[], char *outputdir)
 		{ "elevation_correction", 'c', OPTPARSE_NONE },
 		{ "debug", 'd', OPTPARSE_NONE },
 		{ "verbose", 'v', OPTPARSE_NONE },
+		{ "ensemble", 'e', OPTPARSE_NONE },
         { "print_version", 'V', OPTPARSE_NONE },
+#ifdef _MPI_
+        { "subcatchment", 's', OPTPARSE_NONE },
+#endif
 		{ 0 }
 	};
 
@@ -53,6 +57,18 @@ void ParseCmdLineParam (int argc, char *argv[], char *outputdir)
 	            verbose_mode = 1;
 	            printf ("Verbose mode turned on.\n");
 	            break;
+            case 'e':
+                /* Ensemble mode */
+                ensemble_mode = 1;
+                printf ("Ensemble mode turned on.\n");
+                break;
+#ifdef _MPI_
+            case 's':
+                /* Subcatchment mode */
+                subcat_mode = 1;
+                PIHMprintf (VL_NORMAL, "Subcatchment mode turned on.\n");
+                break;
+#endif
             case 'V':
                 /* Print version number */
                 printf ("\nMM-PIHM Version %s.\n", VERSION);
@@ -72,13 +88,17 @@ void ParseCmdLineParam (int argc, char *argv[], char *outputdir)
     {
         fprintf (stderr, "Error:You must specify the name of project!\n");
         fprintf (stderr,
-            "Usage: ./pihm [-o output_dir] [-c] [-d] [-v] [-V]"
+            "Usage: ./pihm [-o output_dir] [-c] [-d] [-v] [-e] [-V]"
             " <project name>\n");
         fprintf (stderr, "\t-o Specify output directory\n");
         fprintf (stderr, "\t-c Correct surface elevation\n");
         fprintf (stderr, "\t-d Debug mode\n");
         fprintf (stderr, "\t-v Verbose mode\n");
+        fprintf (stderr, "\t-e Ensemble mode\n");
         fprintf (stderr, "\t-V Version number\n");
+#ifdef _MPI_
+        fprintf (stderr, "\t-s Subcatchment mode\n");
+#endif
         PIHMexit (EXIT_FAILURE);
     }
     else
@@ -169,6 +189,13 @@ void _PIHMexit (const char *fn, int lineno, const char *func, int error)
     }
     PIHMprintf (VL_ERROR, "...\n\n");
 
+#ifdef _MPI_
+    if (error != EXIT_SUCCESS)
+    {
+        MPI_Abort (MPI_COMM_WORLD, error);
+    }
+#endif
+
     exit (error);
 }
 
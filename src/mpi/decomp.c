@@ -0,0 +1,855 @@
+#include "pihm.h"
+
+void Decompose (pihm_struct pihm, char *outputdir)
+{
+    decomp_struct  *decomp;
+    int            *elem_part;          /* rank that owns each element */
+    int            *riv_part;           /* rank that owns each river segment */
+    int            *rank_down;          /* rank that receives outflow of each
+                                         * rank in subcatchment mode */
+    int            *elem_loc;           /* local index of each element (1-based,
+                                         * 0 if not local) */
+    int            *riv_loc;            /* local index of each river segment
+                                         * (1-based, 0 if not local) */
+    int             nelem_local, nriver_local;
+    int             nelem_owned, nriver_owned;
+    int             nelem_nabr;
+    int             i, j, k;
+
+    decomp = &pihm->decomp;
+
+    if (nelem < mpi_size)
+    {
+        PIHMprintf (VL_ERROR,
+            "Error: Number of MPI ranks (%d) exceeds number of elements "
+            "(%d).\n", mpi_size, nelem);
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    decomp->nelem_global = nelem;
+    decomp->nriver_global = nriver;
+
+    /*
+     * Partition elements by recursive coordinate bisection. River segments
+     * are owned by the rank that owns their left bank elements. In
+     * subcatchment mode, the river network is cut into subcatchments instead.
+     * All ranks compute the same partition
+     */
+    elem_part = (int *)malloc (nelem * sizeof (int));
+    riv_part = (int *)malloc (nriver * sizeof (int));
+    rank_down = (int *)malloc (mpi_size * sizeof (int));
+
+    if (subcat_mode)
+    {
+        PartitionSubcat (pihm, elem_part, riv_part, rank_down);
+    }
+    else
+    {
+        PartitionMesh (&pihm->meshtbl, elem_part);
+
+        for (i = 0; i < nriver; i++)
+        {
+            riv_part[i] = elem_part[pihm->rivtbl.leftele[i] - 1];
+        }
+    }
+
+    if (0 == mpi_rank)
+    {
+        WritePartition (outputdir, elem_part, riv_part);
+    }
+
+    /*
+     * Select local elements and river segments. Owned ones come first in
+     * ascending global order, followed by halo ones
+     */
+    elem_loc = (int *)calloc (nelem, sizeof (int));
+    riv_loc = (int *)calloc (nriver, sizeof (int));
+    decomp->elem_gid = (int *)malloc (nelem * sizeof (int));
+    decomp->riv_gid = (int *)malloc (nriver * sizeof (int));
+
+    nelem_local = 0;
+    for (i = 0; i < nelem; i++)
+    {
+        if (elem_part[i] == mpi_rank)
+        {
+            AddLocal (i, decomp->elem_gid, elem_loc, &nelem_local);
+        }
+    }
+    nelem_owned = nelem_local;
+
+    nriver_local = 0;
+    for (i = 0; i < nriver; i++)
+    {
+        if (riv_part[i] == mpi_rank)
+        {
+            AddLocal (i, decomp->riv_gid, riv_loc, &nriver_local);
+        }
+    }
+    nriver_owned = nriver_local;
+
+    /* Neighbors of owned elements */
+    for (k = 0; k < nelem_owned; k++)
+    {
+        for (j = 0; j < NUM_EDGE; j++)
+        {
+            if (pihm->meshtbl.nabr[decomp->elem_gid[k]][j] > 0)
+            {
+                AddLocal (pihm->meshtbl.nabr[decomp->elem_gid[k]][j] - 1,
+                    decomp->elem_gid, elem_loc, &nelem_local);
+            }
+        }
+    }
+    nelem_nabr = nelem_local;
+
+    /* River segments that exchange water with owned elements, neighbors of
+     * owned elements, or owned river segments */
+    for (i = 0; i < nriver; i++)
+    {
+        if (elem_loc[pihm->rivtbl.leftele[i] - 1] > 0 ||
+            elem_loc[pihm->rivtbl.rightele[i] - 1] > 0 ||
+            (pihm->rivtbl.down[i] > 0 &&
+            riv_part[pihm->rivtbl.down[i] - 1] == mpi_rank))
+        {
+            AddLocal (i, decomp->riv_gid, riv_loc, &nriver_local);
+        }
+    }
+    for (k = 0; k < nriver_owned; k++)
+    {
+        if (pihm->rivtbl.down[decomp->riv_gid[k]] > 0)
+        {
+            AddLocal (pihm->rivtbl.down[decomp->riv_gid[k]] - 1,
+                decomp->riv_gid, riv_loc, &nriver_local);
+        }
+    }
+
+    /* Elements needed to calculate fluxes of neighbor elements and local
+     * river segments */
+    for (k = nelem_owned; k < nelem_nabr; k++)
+    {
+        for (j = 0; j < NUM_EDGE; j++)
+        {
+            if (pihm->meshtbl.nabr[decomp->elem_gid[k]][j] > 0)
+            {
+                AddLocal (pihm->meshtbl.nabr[decomp->elem_gid[k]][j] - 1,
+                    decomp->elem_gid, elem_loc, &nelem_local);
+            }
+        }
+    }
+    for (k = 0; k < nriver_local; k++)
+    {
+        AddLocal (pihm->rivtbl.leftele[decomp->riv_gid[k]] - 1,
+            decomp->elem_gid, elem_loc, &nelem_local);
+        AddLocal (pihm->rivtbl.rightele[decomp->riv_gid[k]] - 1,
+            decomp->elem_gid, elem_loc, &nelem_local);
+    }
+
+    /* Build send and receive lists for halo exchange */
+    InitHalo (decomp, nelem_owned, nelem_local, elem_part, elem_loc,
+        nriver_owned, nriver_local, riv_part, riv_loc);
+
+    if (subcat_mode)
+    {
+        SetHaloLag (decomp, rank_down);
+    }
+
+    /* Localize input tables */
+    LocalizeTbl (pihm, nelem_local, nriver_local, elem_loc, riv_loc);
+
+    nelem = nelem_owned;
+    nriver = nriver_owned;
+    nelem_halo = nelem_local - nelem_owned;
+    nriver_halo = nriver_local - nriver_owned;
+
+    PIHMprintf (VL_VERBOSE, " Model domain decomposed into %d %s.\n",
+        mpi_size, (subcat_mode) ? "subcatchments" : "subdomains");
+
+    free (elem_part);
+    free (riv_part);
+    free (rank_down);
+    free (elem_loc);
+    free (riv_loc);
+}
+
+void AddLocal (int gid, int *local_gid, int *loc, int *nlocal)
+{
+    if (loc[gid] == 0)
+    {
+        local_gid[*nlocal] = gid;
+        (*nlocal)++;
+        loc[gid] = *nlocal;
+    }
+}
+
+void PartitionMesh (const meshtbl_struct *meshtbl, int *part)
+{
+    sortkey_struct *elem_x;
+    double         *x, *y;
+    int             i, j;
+
+    x = (double *)malloc (nelem * sizeof (double));
+    y = (double *)malloc (nelem * sizeof (double));
+    elem_x = (sortkey_struct *)malloc (nelem * sizeof (sortkey_struct));
+
+    /* Element centroids */
+    for (i = 0; i < nelem; i++)
+    {
+        x[i] = 0.0;
+        y[i] = 0.0;
+        for (j = 0; j < NUM_EDGE; j++)
+        {
+            x[i] += meshtbl->x[meshtbl->node[i][j] - 1] / NUM_EDGE;
+            y[i] += meshtbl->y[meshtbl->node[i][j] - 1] / NUM_EDGE;
+        }
+
+        elem_x[i].ind = i;
+    }
+
+    Bisect (elem_x, nelem, x, y, 0, mpi_size, part);
+
+    free (x);
+    free (y);
+    free (elem_x);
+}
+
+void Bisect (sortkey_struct *elem_x, int n, const double *x, const double *y,
+    int rank0, int nrank, int *part)
+{
+    double          xmin, xmax, ymin, ymax;
+    const double   *coord;
+    int             nrank_left;
+    int             n_left;
+    int             k;
+
+    if (nrank == 1)
+    {
+        for (k = 0; k < n; k++)
+        {
+            part[elem_x[k].ind] = rank0;
+        }
+        return;
+    }
+
+    /* Cut along the longer extent of the subdomain */
+    xmin = xmax = x[elem_x[0].ind];
+    ymin = ymax = y[elem_x[0].ind];
+    for (k = 1; k < n; k++)
+    {
+        xmin = (x[elem_x[k].ind] < xmin) ? x[elem_x[k].ind] : xmin;
+        xmax = (x[elem_x[k].ind] > xmax) ? x[elem_x[k].ind] : xmax;
+        ymin = (y[elem_x[k].ind] < ymin) ? y[elem_x[k].ind] : ymin;
+        ymax = (y[elem_x[k].ind] > ymax) ? y[elem_x[k].ind] : ymax;
+    }
+    coord = (xmax - xmin >= ymax - ymin) ? x : y;
+
+    for (k = 0; k < n; k++)
+    {
+        elem_x[k].key = coord[elem_x[k].ind];
+    }
+    qsort (elem_x, n, sizeof (sortkey_struct), CompareKey);
+
+    /* Split elements in proportion to the number of ranks on each side */
+    nrank_left = nrank / 2;
+    n_left = (int)((long int)n * nrank_left / nrank);
+
+    Bisect (elem_x, n_left, x, y, rank0, nrank_left, part);
+    Bisect (elem_x + n_left, n - n_left, x, y, rank0 + nrank_left,
+        nrank - nrank_left, part);
+}
+
+int CompareKey (const void *a, const void *b)
+{
+    const sortkey_struct *ka = (const sortkey_struct *)a;
+    const sortkey_struct *kb = (const sortkey_struct *)b;
+
+    if (ka->key != kb->key)
+    {
+        return ((ka->key < kb->key) ? -1 : 1);
+    }
+    else
+    {
+        return (ka->ind - kb->ind);
+    }
+}
+
+void WritePartition (char *outputdir, const int *elem_part,
+    const int *riv_part)
+{
+    FILE           *part_file;
+    char            fn[MAXSTRING];
+    int            *nowned;
+    int             i;
+
+    CheckStrLen (snprintf (fn, MAXSTRING, "%s%s.part", outputdir, project),
+        fn);
+    part_file = fopen (fn, "w");
+    CheckFile (part_file, fn);
+
+    nowned = (int *)calloc (mpi_size, sizeof (int));
+
+    /* Global index, owner rank, and local index of each element and river
+     * segment. Local indices identify columns in the output files of each
+     * rank */
+    fprintf (part_file, "NUMELE\t%d\n", nelem);
+    for (i = 0; i < nelem; i++)
+    {
+        nowned[elem_part[i]]++;
+        fprintf (part_file, "%d\t%d\t%d\n", i + 1, elem_part[i],
+            nowned[elem_part[i]]);
+    }
+
+    for (i = 0; i < mpi_size; i++)
+    {
+        nowned[i] = 0;
+    }
+
+    fprintf (part_file, "NUMRIV\t%d\n", nriver);
+    for (i = 0; i < nriver; i++)
+    {
+        nowned[riv_part[i]]++;
+        fprintf (part_file, "%d\t%d\t%d\n", i + 1, riv_part[i],
+            nowned[riv_part[i]]);
+    }
+
+    free (nowned);
+    fclose (part_file);
+}
+
+void InitHalo (decomp_struct *decomp, int nelem_owned, int nelem_local,
+    const int *elem_part, const int *elem_loc, int nriver_owned,
+    int nriver_local, const int *riv_part, const int *riv_loc)
+{
+    int            *nsend_elem, *nrecv_elem;
+    int            *nsend_riv, *nrecv_riv;
+    int           **send_elem, **recv_elem;
+    int           **send_riv, **recv_riv;
+    int             r, k, m;
+
+    nsend_elem = (int *)malloc (mpi_size * sizeof (int));
+    nrecv_elem = (int *)malloc (mpi_size * sizeof (int));
+    nsend_riv = (int *)malloc (mpi_size * sizeof (int));
+    nrecv_riv = (int *)malloc (mpi_size * sizeof (int));
+    send_elem = (int **)malloc (mpi_size * sizeof (int *));
+    recv_elem = (int **)malloc (mpi_size * sizeof (int *));
+    send_riv = (int **)malloc (mpi_size * sizeof (int *));
+    recv_riv = (int **)malloc (mpi_size * sizeof (int *));
+
+    ExchangeRequest (nelem_local - nelem_owned, decomp->elem_gid + nelem_owned,
+        nelem_owned, elem_part, elem_loc, nsend_elem, send_elem, nrecv_elem,
+        recv_elem);
+    ExchangeRequest (nriver_local - nriver_owned, decomp->riv_gid + nriver_owned,
+        nriver_owned, riv_part, riv_loc, nsend_riv, send_riv, nrecv_riv,
+        recv_riv);
+
+    decomp->nhalo = 0;
+    for (r = 0; r < mpi_size; r++)
+    {
+        if (nsend_elem[r] + nrecv_elem[r] + nsend_riv[r] + nrecv_riv[r] > 0)
+        {
+            decomp->nhalo++;
+        }
+    }
+
+    decomp->halo =
+        (halo_struct *)malloc (decomp->nhalo * sizeof (halo_struct));
+    decomp->requests =
+        (MPI_Request *)malloc (2 * decomp->nhalo * sizeof (MPI_Request));
+
+    k = 0;
+    for (r = 0; r < mpi_size; r++)
+    {
+        if (nsend_elem[r] + nrecv_elem[r] + nsend_riv[r] + nrecv_riv[r] > 0)
+        {
+            halo_struct    *halo;
+
+            halo = &decomp->halo[k];
+
+            halo->rank = r;
+            halo->nsend_elem = nsend_elem[r];
+            halo->nsend_riv = nsend_riv[r];
+            halo->nrecv_elem = nrecv_elem[r];
+            halo->nrecv_riv = nrecv_riv[r];
+            halo->send_elem = send_elem[r];
+            halo->send_riv = send_riv[r];
+            halo->recv_elem = recv_elem[r];
+            halo->recv_riv = recv_riv[r];
+
+            /* Subcatchment mode keeps one send buffer per pending send */
+            halo->sendbuf = (double *)malloc (((subcat_mode) ?
+                NUM_EXCHANGE_SLOT : 1) * (NUM_HALO_ELEM_VAR *
+                halo->nsend_elem + NUM_HALO_RIV_VAR * halo->nsend_riv) *
+                sizeof (double));
+            halo->recvbuf = (double *)malloc ((NUM_HALO_ELEM_VAR *
+                halo->nrecv_elem + NUM_HALO_RIV_VAR * halo->nrecv_riv) *
+                sizeof (double));
+
+            halo->lag = 0;
+            for (m = 0; m < NUM_EXCHANGE_SLOT; m++)
+            {
+                halo->send_req[m] = MPI_REQUEST_NULL;
+            }
+
+            k++;
+        }
+        else
+        {
+            free (send_elem[r]);
+            free (recv_elem[r]);
+            free (send_riv[r]);
+            free (recv_riv[r]);
+        }
+    }
+
+    free (nsend_elem);
+    free (nrecv_elem);
+    free (nsend_riv);
+    free (nrecv_riv);
+    free (send_elem);
+    free (recv_elem);
+    free (send_riv);
+    free (recv_riv);
+}
+
+void ExchangeRequest (int nhalo, const int *halo_gid, int nowned,
+    const int *part, const int *loc, int *nsend, int **send, int *nrecv,
+    int **recv)
+{
+    int            *sdispls, *rdispls;
+    int            *req_gid, *send_gid;
+    int            *count;
+    int             nsend_total;
+    int             r, k;
+
+    sdispls = (int *)malloc (mpi_size * sizeof (int));
+    rdispls = (int *)malloc (mpi_size * sizeof (int));
+    count = (int *)calloc (mpi_size, sizeof (int));
+
+    /* Halo entities are requested from their owners */
+    for (r = 0; r < mpi_size; r++)
+    {
+        nrecv[r] = 0;
+    }
+    for (k = 0; k < nhalo; k++)
+    {
+        nrecv[part[halo_gid[k]]]++;
+    }
+
+    MPI_Alltoall (nrecv, 1, MPI_INT, nsend, 1, MPI_INT, MPI_COMM_WORLD);
+
+    rdispls[0] = 0;
+    sdispls[0] = 0;
+    for (r = 1; r < mpi_size; r++)
+    {
+        rdispls[r] = rdispls[r - 1] + nrecv[r - 1];
+        sdispls[r] = sdispls[r - 1] + nsend[r - 1];
+    }
+    nsend_total = sdispls[mpi_size - 1] + nsend[mpi_size - 1];
+
+    req_gid = (int *)malloc ((nhalo > 0 ? nhalo : 1) * sizeof (int));
+    send_gid = (int *)malloc ((nsend_total > 0 ? nsend_total : 1) *
+        sizeof (int));
+
+    for (r = 0; r < mpi_size; r++)
+    {
+        recv[r] = (int *)malloc ((nrecv[r] > 0 ? nrecv[r] : 1) * sizeof (int));
+    }
+    for (k = 0; k < nhalo; k++)
+    {
+        r = part[halo_gid[k]];
+        req_gid[rdispls[r] + count[r]] = halo_gid[k];
+        recv[r][count[r]] = nowned + k;
+        count[r]++;
+    }
+
+    MPI_Alltoallv (req_gid, nrecv, rdispls, MPI_INT, send_gid, nsend, sdispls,
+        MPI_INT, MPI_COMM_WORLD);
+
+    /* Requested entities are owned, so their local indices are in the owned
+     * range */
+    for (r = 0; r < mpi_size; r++)
+    {
+        send[r] = (int *)malloc ((nsend[r] > 0 ? nsend[r] : 1) * sizeof (int));
+        for (k = 0; k < nsend[r]; k++)
+        {
+            send[r][k] = loc[send_gid[sdispls[r] + k]] - 1;
+        }
+    }
+
+    free (sdispls);
+    free (rdispls);
+    free (count);
+    free (req_gid);
+    free (send_gid);
+}
+
+void LocalizeTbl (pihm_struct pihm, int nelem_local, int nriver_local,
+    const int *elem_loc, const int *riv_loc)
+{
+    decomp_struct  *decomp;
+    meshtbl_struct  meshtbl;
+    atttbl_struct   atttbl;
+    rivtbl_struct   rivtbl;
+    int             i, j, k;
+
+    decomp = &pihm->decomp;
+
+    meshtbl = pihm->meshtbl;
+    atttbl = pihm->atttbl;
+    rivtbl = pihm->rivtbl;
+
+    /* Node coordinates are not localized */
+    pihm->meshtbl.node = (int **)malloc (nelem_local * sizeof (int *));
+    pihm->meshtbl.nabr = (int **)malloc (nelem_local * sizeof (int *));
+    pihm->atttbl.soil = (int *)malloc (nelem_local * sizeof (int));
+    pihm->atttbl.geol = (int *)malloc (nelem_local * sizeof (int));
+    pihm->atttbl.lc = (int *)malloc (nelem_local * sizeof (int));
+    pihm->atttbl.bc = (int **)malloc (nelem_local * sizeof (int *));
+    pihm->atttbl.meteo = (int *)malloc (nelem_local * sizeof (int));
+    pihm->atttbl.lai = (int *)malloc (nelem_local * sizeof (int));
+    pihm->atttbl.source = (int *)malloc (nelem_local * sizeof (int));
+
+    for (k = 0; k < nelem_local; k++)
+    {
+        i = decomp->elem_gid[k];
+
+        pihm->meshtbl.node[k] = meshtbl.node[i];
+        pihm->meshtbl.nabr[k] = meshtbl.nabr[i];
+        meshtbl.node[i] = NULL;
+        meshtbl.nabr[i] = NULL;
+
+        /* Neighbors that are not local are treated as boundaries. Fluxes
+         * across those edges are only calculated for outermost halo
+         * elements, and are discarded */
+        for (j = 0; j < NUM_EDGE; j++)
+        {
+            if (pihm->meshtbl.nabr[k][j] > 0)
+            {
+                pihm->meshtbl.nabr[k][j] =
+                    elem_loc[pihm->meshtbl.nabr[k][j] - 1];
+            }
+        }
+
+        pihm->atttbl.soil[k] = atttbl.soil[i];
+        pihm->atttbl.geol[k] = atttbl.geol[i];
+        pihm->atttbl.lc[k] = atttbl.lc[i];
+        pihm->atttbl.bc[k] = atttbl.bc[i];
+        atttbl.bc[i] = NULL;
+        pihm->atttbl.meteo[k] = atttbl.meteo[i];
+        pihm->atttbl.lai[k] = atttbl.lai[i];
+        pihm->atttbl.source[k] = atttbl.source[i];
+    }
+
+    for (i = 0; i < nelem; i++)
+    {
+        free (meshtbl.node[i]);
+        free (meshtbl.nabr[i]);
+        free (atttbl.bc[i]);
+    }
+    free (meshtbl.node);
+    free (meshtbl.nabr);
+    free (atttbl.soil);
+    free (atttbl.geol);
+    free (atttbl.lc);
+    free (atttbl.bc);
+    free (atttbl.meteo);
+    free (atttbl.lai);
+    free (atttbl.source);
+
+    pihm->rivtbl.fromnode = (int *)malloc (nriver_local * sizeof (int));
+    pihm->rivtbl.tonode = (int *)malloc (nriver_local * sizeof (int));
+    pihm->rivtbl.down = (int *)malloc (nriver_local * sizeof (int));
+    pihm->rivtbl.leftele = (int *)malloc (nriver_local * sizeof (int));
+    pihm->rivtbl.rightele = (int *)malloc (nriver_local * sizeof (int));
+    pihm->rivtbl.shp = (int *)malloc (nriver_local * sizeof (int));
+    pihm->rivtbl.matl = (int *)malloc (nriver_local * sizeof (int));
+    pihm->rivtbl.bc = (int *)malloc (nriver_local * sizeof (int));
+    pihm->rivtbl.rsvr = (int *)malloc (nriver_local * sizeof (int));
+
+    for (k = 0; k < nriver_local; k++)
+    {
+        i = decomp->riv_gid[k];
+
+        pihm->rivtbl.fromnode[k] = rivtbl.fromnode[i];
+        pihm->rivtbl.tonode[k] = rivtbl.tonode[i];
+        /* Outlets of halo river segments whose downstream segments are not
+         * local are replaced by critical depth boundaries. Their fluxes are
+         * discarded */
+        pihm->rivtbl.down[k] = (rivtbl.down[i] > 0) ?
+            ((riv_loc[rivtbl.down[i] - 1] > 0) ?
+            riv_loc[rivtbl.down[i] - 1] : -4) : rivtbl.down[i];
+        pihm->rivtbl.leftele[k] = elem_loc[rivtbl.leftele[i] - 1];
+        pihm->rivtbl.rightele[k] = elem_loc[rivtbl.rightele[i] - 1];
+        pihm->rivtbl.shp[k] = rivtbl.shp[i];
+        pihm->rivtbl.matl[k] = rivtbl.matl[i];
+        pihm->rivtbl.bc[k] = rivtbl.bc[i];
+        pihm->rivtbl.rsvr[k] = rivtbl.rsvr[i];
+    }
+
+    free (rivtbl.fromnode);
+    free (rivtbl.tonode);
+    free (rivtbl.down);
+    free (rivtbl.leftele);
+    free (rivtbl.rightele);
+    free (rivtbl.shp);
+    free (rivtbl.matl);
+    free (rivtbl.bc);
+    free (rivtbl.rsvr);
+}
+
+MPI_Comm SolverComm (void)
+{
+    /* In subcatchment mode, each rank integrates its own subcatchments with
+     * an independent solver */
+    return ((subcat_mode) ? MPI_COMM_SELF : MPI_COMM_WORLD);
+}
+
+long int GlobalLength (long int nlocal)
+{
+    long int        nglobal;
+
+    MPI_Allreduce (&nlocal, &nglobal, 1, MPI_LONG, MPI_SUM, SolverComm ());
+
+    return (nglobal);
+}
+
+int HaloComm (long int nlocal, realtype t, N_Vector CV_Y, void *pihm_data)
+{
+    pihm_struct     pihm;
+    decomp_struct  *decomp;
+    double         *y;
+    int             nreq = 0;
+    int             i, k, m, n;
+
+    pihm = (pihm_struct)pihm_data;
+    decomp = &pihm->decomp;
+    y = NV_DATA (CV_Y);
+
+    /* Halo states do not depend on time, which CVBBDPRE passes for
+     * time-dependent communication */
+    (void)t;
+
+    if (nlocal != NV_LOCLENGTH_P (CV_Y))
+    {
+        PIHMprintf (VL_ERROR, "Error: Local vector length %ld does not match "
+            "the %ld local states of rank %d.\n",
+            (long int)NV_LOCLENGTH_P (CV_Y), nlocal, mpi_rank);
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    for (k = 0; k < decomp->nhalo; k++)
+    {
+        halo_struct    *halo;
+
+        halo = &decomp->halo[k];
+
+        MPI_Irecv (halo->recvbuf, NUM_HALO_ELEM_VAR * halo->nrecv_elem +
+            NUM_HALO_RIV_VAR * halo->nrecv_riv, MPI_DOUBLE, halo->rank, 0,
+            MPI_COMM_WORLD, &decomp->requests[nreq++]);
+    }
+
+    for (k = 0; k < decomp->nhalo; k++)
+    {
+        halo_struct    *halo;
+
+        halo = &decomp->halo[k];
+
+        /* Negative states are truncated in the same way as in LocalODE */
+        n = 0;
+        for (m = 0; m < halo->nsend_elem; m++)
+        {
+            i = halo->send_elem[m];
+            halo->sendbuf[n++] = (y[SURF(i)] >= 0.0) ? y[SURF(i)] : 0.0;
+            halo->sendbuf[n++] = (y[UNSAT(i)] >= 0.0) ? y[UNSAT(i)] : 0.0;
+            halo->sendbuf[n++] = (y[GW(i)] >= 0.0) ? y[GW(i)] : 0.0;
+        }
+        for (m = 0; m < halo->nsend_riv; m++)
+        {
+            i = halo->send_riv[m];
+            halo->sendbuf[n++] = (y[RIVSTG(i)] >= 0.0) ? y[RIVSTG(i)] : 0.0;
+            halo->sendbuf[n++] = (y[RIVGW(i)] >= 0.0) ? y[RIVGW(i)] : 0.0;
+        }
+
+        MPI_Isend (halo->sendbuf, n, MPI_DOUBLE, halo->rank, 0,
+            MPI_COMM_WORLD, &decomp->requests[nreq++]);
+    }
+
+    MPI_Waitall (nreq, decomp->requests, MPI_STATUSES_IGNORE);
+
+    for (k = 0; k < decomp->nhalo; k++)
+    {
+        UnpackHalo (&decomp->halo[k], pihm->elem, pihm->riv);
+    }
+
+    return (0);
+}
+
+void UnpackHalo (const halo_struct *halo, elem_struct *elem,
+    river_struct *riv)
+{
+    int             i, m, n;
+
+    n = 0;
+    for (m = 0; m < halo->nrecv_elem; m++)
+    {
+        i = halo->recv_elem[m];
+
+        elem[i].ws.surf = halo->recvbuf[n++];
+        elem[i].ws.unsat = halo->recvbuf[n++];
+        elem[i].ws.gw = halo->recvbuf[n++];
+        elem[i].ws.surfh = SurfH (elem[i].ws.surf);
+    }
+    for (m = 0; m < halo->nrecv_riv; m++)
+    {
+        i = halo->recv_riv[m];
+
+        riv[i].ws.stage = halo->recvbuf[n++];
+        riv[i].ws.gw = halo->recvbuf[n++];
+    }
+}
+
+int BBDLocalODE (long int nlocal, realtype t, N_Vector CV_Y,
+    N_Vector CV_Ydot, void *pihm_data)
+{
+    /* The local approximation is the full right-hand side of local states,
+     * which HaloComm has checked against nlocal */
+    (void)nlocal;
+
+    return (LocalODE (t, CV_Y, CV_Ydot, pihm_data));
+}
+
+void ReadICPar (char *filename, elem_struct *elem, river_struct *riv,
+    const decomp_struct *decomp)
+{
+    FILE           *ic_file;
+    int             i;
+    long int        size;
+
+    ic_file = fopen (filename, "rb");
+    CheckFile (ic_file, filename);
+    PIHMprintf (VL_VERBOSE, " Reading %s\n", filename);
+
+    fseek (ic_file, 0L, SEEK_END);
+    size = ftell (ic_file);
+
+    if (size != (long int)(sizeof (ic_struct) * decomp->nelem_global +
+        sizeof (river_ic_struct) * decomp->nriver_global))
+    {
+        PIHMprintf (VL_ERROR,
+            "Error in initial condion file %s.\n"
+            "The file size does not match requirement.\n", filename);
+        PIHMprintf (VL_ERROR,
+            "Please use a correct initial condition file.\n");
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    /* Initial conditions of local elements and river segments are read from
+     * their global positions */
+    for (i = 0; i < nelem; i++)
+    {
+        fseek (ic_file, (long int)(sizeof (ic_struct) * decomp->elem_gid[i]),
+            SEEK_SET);
+        fread (&elem[i].ic, sizeof (ic_struct), 1, ic_file);
+    }
+
+    for (i = 0; i < nriver; i++)
+    {
+        fseek (ic_file, (long int)(sizeof (ic_struct) * decomp->nelem_global +
+            sizeof (river_ic_struct) * decomp->riv_gid[i]), SEEK_SET);
+        fread (&riv[i].ic, sizeof (river_ic_struct), 1, ic_file);
+    }
+
+    fclose (ic_file);
+}
+
+void PrtInitPar (elem_struct *elem, river_struct *riv, char *simulation,
+    int t, const decomp_struct *decomp)
+{
+    MPI_File        init_file;
+    MPI_Offset      offset;
+    char            fn[MAXSTRING];
+    char            name[20];
+    int             i;
+#ifdef _NOAH_
+    int             j;
+#endif
+    pihm_t_struct   pihm_time;
+
+    pihm_time = PIHMTime (t);
+    strcpy (name, pihm_time.str);
+    name[13] = 0;
+
+    CheckStrLen (snprintf (fn, MAXSTRING, "input/%s/ic/%s %s.ic", project,
+        simulation, name), fn);
+
+    if (MPI_File_open (MPI_COMM_WORLD, fn, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+        MPI_INFO_NULL, &init_file) != MPI_SUCCESS)
+    {
+        PIHMprintf (VL_ERROR, "Error opening %s.\n", fn);
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    MPI_File_set_size (init_file,
+        (MPI_Offset)(sizeof (ic_struct) * decomp->nelem_global +
+        sizeof (river_ic_struct) * decomp->nriver_global));
+
+    /* Each rank writes its owned elements and river segments at their
+     * global positions, using the same layout as PrtInit */
+    for (i = 0; i < nelem; i++)
+    {
+        ic_struct       ic;
+
+        ic.cmc = elem[i].ws.cmc;
+        ic.sneqv = elem[i].ws.sneqv;
+        ic.surf = elem[i].ws.surf;
+        ic.unsat = elem[i].ws.unsat;
+        ic.gw = elem[i].ws.gw;
+#ifdef _NOAH_
+        ic.t1 = elem[i].es.t1;
+        ic.snowh = elem[i].ps.snowh;
+        for (j = 0; j < MAXLYR; j++)
+        {
+            ic.stc[j] = elem[i].es.stc[j];
+            ic.smc[j] = elem[i].ws.smc[j];
+            ic.sh2o[j] = elem[i].ws.sh2o[j];
+        }
+#endif
+
+        offset = (MPI_Offset)(sizeof (ic_struct) * decomp->elem_gid[i]);
+        MPI_File_write_at (init_file, offset, &ic, sizeof (ic_struct),
+            MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+
+    for (i = 0; i < nriver; i++)
+    {
+        river_ic_struct ic;
+
+        ic.stage = riv[i].ws.stage;
+        ic.gw = riv[i].ws.gw;
+
+        offset = (MPI_Offset)(sizeof (ic_struct) * decomp->nelem_global +
+            sizeof (river_ic_struct) * decomp->riv_gid[i]);
+        MPI_File_write_at (init_file, offset, &ic, sizeof (river_ic_struct),
+            MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+
+    MPI_File_close (&init_file);
+}
+
+void FreeDecomp (decomp_struct *decomp)
+{
+    int             k;
+
+    for (k = 0; k < decomp->nhalo; k++)
+    {
+        free (decomp->halo[k].send_elem);
+        free (decomp->halo[k].send_riv);
+        free (decomp->halo[k].recv_elem);
+        free (decomp->halo[k].recv_riv);
+        free (decomp->halo[k].sendbuf);
+        free (decomp->halo[k].recvbuf);
+    }
+
+    free (decomp->halo);
+    free (decomp->requests);
+    free (decomp->elem_gid);
+    free (decomp->riv_gid);
+}
@@ -0,0 +1,443 @@
+#include "pihm.h"
+
+void PartitionSubcat (pihm_struct pihm, int *elem_part, int *riv_part,
+    int *rank_down)
+{
+    const meshtbl_struct *meshtbl;
+    const rivtbl_struct *rivtbl;
+    int            *elem_riv;           /* river segment each element drains
+                                         * to */
+    int            *queue;
+    int            *order;              /* river segments from upstream to
+                                         * downstream */
+    int            *nup;
+    int            *weight;
+    int            *piece;              /* subcatchment of each river segment */
+    int            *piece_down;         /* subcatchment receiving outflow of
+                                         * each subcatchment */
+    int            *piece_weight;
+    int            *piece_rank;
+    int            *nowned;
+    int             nqueue, norder;
+    int             npiece;
+    int             i, j, k, p, q;
+
+    meshtbl = &pihm->meshtbl;
+    rivtbl = &pihm->rivtbl;
+
+    if (nriver < mpi_size)
+    {
+        PIHMprintf (VL_ERROR,
+            "Error: Number of MPI ranks (%d) exceeds number of river segments "
+            "(%d) in subcatchment mode.\n", mpi_size, nriver);
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    elem_riv = (int *)malloc (nelem * sizeof (int));
+    queue = (int *)malloc (nelem * sizeof (int));
+    order = (int *)malloc (nriver * sizeof (int));
+    nup = (int *)calloc (nriver, sizeof (int));
+    weight = (int *)malloc (nriver * sizeof (int));
+    piece = (int *)malloc (nriver * sizeof (int));
+    piece_down = (int *)malloc (nriver * sizeof (int));
+    piece_weight = (int *)malloc (nriver * sizeof (int));
+    piece_rank = (int *)malloc (nriver * sizeof (int));
+
+    /*
+     * Each element drains to the river segment of the nearest bank element,
+     * found by a breadth-first search over the mesh starting from bank
+     * elements
+     */
+    for (i = 0; i < nelem; i++)
+    {
+        elem_riv[i] = -1;
+    }
+
+    nqueue = 0;
+    for (i = 0; i < nriver; i++)
+    {
+        if (elem_riv[rivtbl->leftele[i] - 1] < 0)
+        {
+            elem_riv[rivtbl->leftele[i] - 1] = i;
+            queue[nqueue++] = rivtbl->leftele[i] - 1;
+        }
+        if (elem_riv[rivtbl->rightele[i] - 1] < 0)
+        {
+            elem_riv[rivtbl->rightele[i] - 1] = i;
+            queue[nqueue++] = rivtbl->rightele[i] - 1;
+        }
+    }
+
+    for (k = 0; k < nqueue; k++)
+    {
+        for (j = 0; j < NUM_EDGE; j++)
+        {
+            int             nabr;
+
+            nabr = meshtbl->nabr[queue[k]][j];
+            if (nabr > 0 && elem_riv[nabr - 1] < 0)
+            {
+                elem_riv[nabr - 1] = elem_riv[queue[k]];
+                queue[nqueue++] = nabr - 1;
+            }
+        }
+    }
+
+    /* Workload of each river segment is the number of state variables that
+     * drain to it */
+    for (i = 0; i < nriver; i++)
+    {
+        weight[i] = NUM_HALO_RIV_VAR;
+    }
+    for (i = 0; i < nelem; i++)
+    {
+        if (elem_riv[i] >= 0)
+        {
+            weight[elem_riv[i]] += NUM_HALO_ELEM_VAR;
+        }
+    }
+
+    /* Sort river segments from headwaters to outlets */
+    for (i = 0; i < nriver; i++)
+    {
+        if (rivtbl->down[i] > 0)
+        {
+            nup[rivtbl->down[i] - 1]++;
+        }
+    }
+
+    norder = 0;
+    for (i = 0; i < nriver; i++)
+    {
+        if (nup[i] == 0)
+        {
+            order[norder++] = i;
+        }
+    }
+    for (k = 0; k < norder; k++)
+    {
+        i = order[k];
+        if (rivtbl->down[i] > 0)
+        {
+            nup[rivtbl->down[i] - 1]--;
+            if (nup[rivtbl->down[i] - 1] == 0)
+            {
+                order[norder++] = rivtbl->down[i] - 1;
+            }
+        }
+    }
+
+    if (norder < nriver)
+    {
+        PIHMprintf (VL_ERROR,
+            "Error: River network contains a loop and cannot be decomposed "
+            "into subcatchments.\n");
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    /*
+     * Starting from one subcatchment per river segment, the pair of adjacent
+     * subcatchments with the smallest combined workload is merged until there
+     * is one subcatchment per rank. Outlet subcatchments are merged with
+     * other outlet subcatchments, so that every rank drains to at most one
+     * rank
+     */
+    for (i = 0; i < nriver; i++)
+    {
+        piece[i] = i;
+        piece_down[i] = (rivtbl->down[i] > 0) ? rivtbl->down[i] - 1 : -1;
+        piece_weight[i] = weight[i];
+    }
+
+    for (npiece = nriver; npiece > mpi_size; npiece--)
+    {
+        int             outlet1 = -1, outlet2 = -1;
+
+        /* Two smallest outlet subcatchments */
+        for (k = 0; k < nriver; k++)
+        {
+            if (piece_weight[k] > 0 && piece_down[k] < 0)
+            {
+                if (outlet1 < 0 || piece_weight[k] < piece_weight[outlet1])
+                {
+                    outlet2 = outlet1;
+                    outlet1 = k;
+                }
+                else if (outlet2 < 0 ||
+                    piece_weight[k] < piece_weight[outlet2])
+                {
+                    outlet2 = k;
+                }
+            }
+        }
+
+        p = -1;
+        q = -1;
+        for (k = 0; k < nriver; k++)
+        {
+            int             dest;
+
+            if (piece_weight[k] == 0)
+            {
+                continue;
+            }
+
+            dest = (piece_down[k] >= 0) ?
+                piece_down[k] : ((k == outlet1) ? outlet2 : outlet1);
+
+            if (dest >= 0 && (p < 0 || piece_weight[k] + piece_weight[dest] <
+                piece_weight[p] + piece_weight[q]))
+            {
+                p = k;
+                q = dest;
+            }
+        }
+
+        for (k = 0; k < nriver; k++)
+        {
+            piece[k] = (piece[k] == p) ? q : piece[k];
+            piece_down[k] = (piece_down[k] == p) ? q : piece_down[k];
+        }
+        piece_weight[q] += piece_weight[p];
+        piece_weight[p] = 0;
+    }
+
+    /* Ranks are numbered in the order subcatchments are found from the
+     * outlets */
+    for (p = 0; p < nriver; p++)
+    {
+        piece_rank[p] = -1;
+    }
+    k = 0;
+    for (j = nriver - 1; j >= 0; j--)
+    {
+        if (piece_rank[piece[order[j]]] < 0)
+        {
+            piece_rank[piece[order[j]]] = k++;
+        }
+    }
+
+    for (i = 0; i < nriver; i++)
+    {
+        riv_part[i] = piece_rank[piece[i]];
+    }
+
+    /* Elements that are not connected to any river segment are assigned to
+     * the first rank */
+    for (i = 0; i < nelem; i++)
+    {
+        elem_part[i] = (elem_riv[i] >= 0) ? riv_part[elem_riv[i]] : 0;
+    }
+
+    for (p = 0; p < nriver; p++)
+    {
+        if (piece_rank[p] >= 0)
+        {
+            rank_down[piece_rank[p]] = (piece_down[p] >= 0) ?
+                piece_rank[piece_down[p]] : -1;
+        }
+    }
+
+    /* Every rank must own elements */
+    nowned = (int *)calloc (mpi_size, sizeof (int));
+    for (i = 0; i < nelem; i++)
+    {
+        nowned[elem_part[i]]++;
+    }
+    for (k = 0; k < mpi_size; k++)
+    {
+        if (nowned[k] == 0)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error: River network cannot be decomposed into %d "
+                "subcatchments.\n", mpi_size);
+            PIHMexit (EXIT_FAILURE);
+        }
+    }
+
+    free (elem_riv);
+    free (queue);
+    free (order);
+    free (nup);
+    free (weight);
+    free (piece);
+    free (piece_down);
+    free (piece_weight);
+    free (piece_rank);
+    free (nowned);
+}
+
+int UpstreamRank (int rank, int rank_dest, const int *rank_down)
+{
+    /* Whether outflow of rank reaches rank_dest */
+    while (rank >= 0)
+    {
+        rank = rank_down[rank];
+        if (rank == rank_dest)
+        {
+            return (1);
+        }
+    }
+
+    return (0);
+}
+
+void SetHaloLag (decomp_struct *decomp, const int *rank_down)
+{
+    int             k;
+
+    /*
+     * States from upstream subcatchments are received as soon as they finish
+     * a model step, so downstream subcatchments follow them in a pipeline.
+     * States from other subcatchments lag behind by one model step, and
+     * states from downstream subcatchments by two model steps, so that
+     * upstream subcatchments can run ahead of downstream ones
+     */
+    for (k = 0; k < decomp->nhalo; k++)
+    {
+        halo_struct    *halo;
+
+        halo = &decomp->halo[k];
+
+        if (UpstreamRank (halo->rank, mpi_rank, rank_down))
+        {
+            halo->lag = 0;
+        }
+        else if (UpstreamRank (mpi_rank, halo->rank, rank_down))
+        {
+            halo->lag = 2;
+        }
+        else
+        {
+            halo->lag = 1;
+        }
+    }
+}
+
+void InitBoundaryState (pihm_struct pihm)
+{
+    int             i;
+
+    /* Halo states are held fixed at their initial conditions until the
+     * first exchange */
+    for (i = nelem; i < NLOCALELEM; i++)
+    {
+        pihm->elem[i].ws.surf = pihm->elem[i].ic.surf;
+        pihm->elem[i].ws.unsat = pihm->elem[i].ic.unsat;
+        pihm->elem[i].ws.gw = pihm->elem[i].ic.gw;
+        pihm->elem[i].ws.surfh = SurfH (pihm->elem[i].ws.surf);
+    }
+
+    for (i = nriver; i < NLOCALRIV; i++)
+    {
+        pihm->riv[i].ws.stage = pihm->riv[i].ic.stage;
+        pihm->riv[i].ws.gw = pihm->riv[i].ic.gw;
+    }
+}
+
+void RecvBoundaryState (pihm_struct pihm, int step)
+{
+    decomp_struct  *decomp;
+    int             k;
+
+    decomp = &pihm->decomp;
+
+    for (k = 0; k < decomp->nhalo; k++)
+    {
+        halo_struct    *halo;
+
+        halo = &decomp->halo[k];
+
+        if (halo->nrecv_elem + halo->nrecv_riv > 0 && step - halo->lag >= 0)
+        {
+            MPI_Recv (halo->recvbuf, NUM_HALO_ELEM_VAR * halo->nrecv_elem +
+                NUM_HALO_RIV_VAR * halo->nrecv_riv, MPI_DOUBLE, halo->rank, 0,
+                MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+            UnpackHalo (halo, pihm->elem, pihm->riv);
+        }
+    }
+}
+
+void SendBoundaryState (pihm_struct pihm, int step)
+{
+    decomp_struct  *decomp;
+    int             i, k, m, n;
+
+    decomp = &pihm->decomp;
+
+    for (k = 0; k < decomp->nhalo; k++)
+    {
+        halo_struct    *halo;
+        double         *sendbuf;
+        int             slot;
+
+        halo = &decomp->halo[k];
+
+        if (halo->nsend_elem + halo->nsend_riv == 0)
+        {
+            continue;
+        }
+
+        /* The buffer of this slot is reused once the neighboring rank has
+         * received the states sent NUM_EXCHANGE_SLOT steps earlier */
+        slot = step % NUM_EXCHANGE_SLOT;
+        MPI_Wait (&halo->send_req[slot], MPI_STATUS_IGNORE);
+
+        sendbuf = halo->sendbuf + slot * (NUM_HALO_ELEM_VAR *
+            halo->nsend_elem + NUM_HALO_RIV_VAR * halo->nsend_riv);
+
+        n = 0;
+        for (m = 0; m < halo->nsend_elem; m++)
+        {
+            i = halo->send_elem[m];
+            sendbuf[n++] = pihm->elem[i].ws.surf;
+            sendbuf[n++] = pihm->elem[i].ws.unsat;
+            sendbuf[n++] = pihm->elem[i].ws.gw;
+        }
+        for (m = 0; m < halo->nsend_riv; m++)
+        {
+            i = halo->send_riv[m];
+            sendbuf[n++] = pihm->riv[i].ws.stage;
+            sendbuf[n++] = pihm->riv[i].ws.gw;
+        }
+
+        MPI_Isend (sendbuf, n, MPI_DOUBLE, halo->rank, 0, MPI_COMM_WORLD,
+            &halo->send_req[slot]);
+    }
+}
+
+void FinishBoundaryExchange (pihm_struct pihm, int nstep)
+{
+    decomp_struct  *decomp;
+    int             k, m;
+
+    decomp = &pihm->decomp;
+
+    /* States of the last model steps are not used by lagging neighbors, but
+     * must be received to complete the sends */
+    for (k = 0; k < decomp->nhalo; k++)
+    {
+        halo_struct    *halo;
+
+        halo = &decomp->halo[k];
+
+        if (halo->nrecv_elem + halo->nrecv_riv == 0)
+        {
+            continue;
+        }
+
+        for (m = (nstep > halo->lag) ? nstep - halo->lag : 0; m < nstep; m++)
+        {
+            MPI_Recv (halo->recvbuf, NUM_HALO_ELEM_VAR * halo->nrecv_elem +
+                NUM_HALO_RIV_VAR * halo->nrecv_riv, MPI_DOUBLE, halo->rank, 0,
+                MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+    }
+
+    for (k = 0; k < decomp->nhalo; k++)
+    {
+        MPI_Waitall (NUM_EXCHANGE_SLOT, decomp->halo[k].send_req,
+            MPI_STATUSES_IGNORE);
+    }
+}
@@ -2,72 +2,90 @@
 
 void DailyVar (int t, int start_time, pihm_struct pihm)
 {
+    int             b;
     int             i;
+    dailyacc_struct *acc;
+
+    acc = &pihm->dacc;
 
     /*
-     * Cumulates daily variables
+     * Cumulates daily variables. Elements are processed in the same blocks
+     * as the Noah LSM, and the accumulators of each block are contiguous
      */
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-    for (i = 0; i < nelem; i++)
+    for (b = 0; b < acc->nblk; b++)
     {
-        int         k;
-        elem_struct *elem;
+        int         nlane;
+        int         k, l;
+        dailyblk_struct *blk;
 
-        elem = &pihm->elem[i];
+        blk = &acc->blk[b];
+        nlane = ((b + 1) * NOAH_BLOCK <= nelem) ?
+            NOAH_BLOCK : nelem - b * NOAH_BLOCK;
 
-        /* Air temperature */
-        elem->daily.avg_sfctmp += elem->es.sfctmp;
-        elem->daily.tmax = (elem->daily.tmax > elem->es.sfctmp) ?
-            elem->daily.tmax : elem->es.sfctmp;
-        elem->daily.tmin = (elem->daily.tmin < elem->es.sfctmp) ?
-            elem->daily.tmin : elem->es.sfctmp;
+        for (l = 0; l < nlane; l++)
+        {
+            double      sfctmp;
+            double      soldn;
+            const elem_struct *elem;
 
-        /* Wind speed */
-        elem->daily.avg_sfcspd += elem->ps.sfcspd;
+            elem = &pihm->elem[b * NOAH_BLOCK + l];
 
-        /* Soil moisture, temperature, and ET */
-        for (k = 0; k < elem->ps.nsoil; k++)
-        {
-            elem->daily.avg_stc[k] += elem->es.stc[k];
-            elem->daily.avg_sh2o[k] += elem->ws.sh2o[k];
-            elem->daily.avg_smc[k] += elem->ws.smc[k];
-            elem->daily.avg_smflxv[k] += elem->wf.smflxv[k];
+            sfctmp = elem->es.sfctmp;
+            soldn = elem->ef.soldn;
+
+            /* Air temperature */
+            blk->sfctmp[l] += sfctmp;
+            blk->tmax[l] = (blk->tmax[l] > sfctmp) ? blk->tmax[l] : sfctmp;
+            blk->tmin[l] = (blk->tmin[l] < sfctmp) ? blk->tmin[l] : sfctmp;
+
+            /* Wind speed */
+            blk->sfcspd[l] += elem->ps.sfcspd;
+
+            /* Soil moisture, temperature, and ET */
+            for (k = 0; k < elem->ps.nsoil; k++)
+            {
+                blk->stc[k][l] += elem->es.stc[k];
+                blk->sh2o[k][l] += elem->ws.sh2o[k];
+                blk->smc[k][l] += elem->ws.smc[k];
+                blk->smflxv[k][l] += elem->wf.smflxv[k];
 #ifdef _CYCLES_
-            elem->daily.avg_et[k] += elem->wf.et[k];
+                blk->et[k][l] += elem->wf.et[k];
 #endif
-        }
+            }
 
 #ifdef _CYCLES_
-        elem->daily.avg_sncovr += elem->ps.sncovr;
+            blk->sncovr[l] += elem->ps.sncovr;
 #endif
 
-        /* Water storage terms */
-        elem->daily.avg_surf += elem->ws.surf;
-        elem->daily.avg_unsat += elem->ws.unsat;
-        elem->daily.avg_gw += elem->ws.gw;
+            /* Water storage terms */
+            blk->surf[l] += elem->ws.surf;
+            blk->unsat[l] += elem->ws.unsat;
+            blk->gw[l] += elem->ws.gw;
 
-        if (elem->ef.soldn > 0.0)
-        {
-            elem->daily.tday += elem->es.sfctmp;
-            elem->daily.avg_q2d += elem->ps.q2sat - elem->ps.q2;
-            elem->daily.avg_ch += elem->ps.ch;
-            elem->daily.avg_rc += elem->ps.rc;
-            elem->daily.avg_sfcprs += elem->ps.sfcprs;
-            elem->daily.avg_albedo += elem->ps.albedo;
-            elem->daily.avg_soldn += elem->ef.soldn;
-            elem->daily.solar_total += elem->ef.soldn * pihm->ctrl.stepsize;
-            (elem->daily.daylight_counter)++;
-        }
-        else
-        {
-            elem->daily.tnight += elem->es.sfctmp;
+            if (soldn > 0.0)
+            {
+                blk->tday[l] += sfctmp;
+                blk->q2d[l] += elem->ps.q2sat - elem->ps.q2;
+                blk->ch[l] += elem->ps.ch;
+                blk->rc[l] += elem->ps.rc;
+                blk->sfcprs[l] += elem->ps.sfcprs;
+                blk->albedo[l] += elem->ps.albedo;
+                blk->soldn[l] += soldn;
+                blk->solar_total[l] += soldn * pihm->ctrl.stepsize;
+                (blk->daylight_counter[l])++;
+            }
+            else
+            {
+                blk->tnight[l] += sfctmp;
+            }
         }
-
-        (elem->daily.counter)++;
     }
 
+    (acc->counter)++;
+
 #ifdef _CYCLES_
     /* River segments */
 #ifdef _OPENMP
@@ -102,44 +120,51 @@ void DailyVar (int t, int start_time, pihm_struct pihm)
 #endif
         for (i = 0; i < nelem; i++)
         {
-            int     k;
-            elem_struct *elem;
+            int     k, l;
+            double  counter;
+            double  daylight_counter;
+            const dailyblk_struct *blk;
+            daily_struct *daily;
 
-            elem = &pihm->elem[i];
+            blk = &acc->blk[i / NOAH_BLOCK];
+            l = i % NOAH_BLOCK;
+            daily = &pihm->elem[i].daily;
 
-            elem->daily.avg_sfctmp /= (double)elem->daily.counter;
+            counter = (double)acc->counter;
+            daylight_counter = (double)blk->daylight_counter[l];
 
-            elem->daily.avg_sfcspd /= (double)elem->daily.counter;
+            daily->avg_sfctmp = blk->sfctmp[l] / counter;
+            daily->tmax = blk->tmax[l];
+            daily->tmin = blk->tmin[l];
 
-            for (k = 0; k < pihm->elem[i].ps.nsoil; k++)
+            daily->avg_sfcspd = blk->sfcspd[l] / counter;
+
+            /* Sums of layers below the bottom layer are zero */
+            for (k = 0; k < MAXLYR; k++)
             {
-                elem->daily.avg_stc[k] /= (double)elem->daily.counter;
-                elem->daily.avg_sh2o[k] /= (double)elem->daily.counter;
-                elem->daily.avg_smc[k] /= (double)elem->daily.counter;
-                elem->daily.avg_smflxv[k] /= (double)elem->daily.counter;
-#ifdef _CYCLES_
-                elem->daily.avg_et[k] /= (double)elem->daily.counter;
-#endif
+                daily->avg_stc[k] = blk->stc[k][l] / counter;
+                daily->avg_sh2o[k] = blk->sh2o[k][l] / counter;
+                daily->avg_smc[k] = blk->smc[k][l] / counter;
+                daily->avg_smflxv[k] = blk->smflxv[k][l] / counter;
+                daily->avg_et[k] = blk->et[k][l] / counter;
             }
 
-#ifdef _CYCLES_
-            elem->daily.avg_sncovr /= (double)elem->daily.counter;
-#endif
+            daily->avg_sncovr = blk->sncovr[l] / counter;
 
-            elem->daily.avg_surf /= (double)elem->daily.counter;
-            elem->daily.avg_unsat /= (double)elem->daily.counter;
-            elem->daily.avg_gw /= (double)elem->daily.counter;
+            daily->avg_surf = blk->surf[l] / counter;
+            daily->avg_unsat = blk->unsat[l] / counter;
+            daily->avg_gw = blk->gw[l] / counter;
 
-            elem->daily.tday /= (double)elem->daily.daylight_counter;
-            elem->daily.avg_q2d /= (double)elem->daily.daylight_counter;
-            elem->daily.avg_ch /= (double)elem->daily.daylight_counter;
-            elem->daily.avg_rc /= (double)elem->daily.daylight_counter;
-            elem->daily.avg_sfcprs /= (double)elem->daily.daylight_counter;
-            elem->daily.avg_albedo /= (double)elem->daily.daylight_counter;
-            elem->daily.avg_soldn /= (double)elem->daily.daylight_counter;
+            daily->tday = blk->tday[l] / daylight_counter;
+            daily->avg_q2d = blk->q2d[l] / daylight_counter;
+            daily->avg_ch = blk->ch[l] / daylight_counter;
+            daily->avg_rc = blk->rc[l] / daylight_counter;
+            daily->avg_sfcprs = blk->sfcprs[l] / daylight_counter;
+            daily->avg_albedo = blk->albedo[l] / daylight_counter;
+            daily->avg_soldn = blk->soldn[l] / daylight_counter;
+            daily->solar_total = blk->solar_total[l];
 
-            elem->daily.tnight /= (double)(elem->daily.counter -
-                elem->daily.daylight_counter);
+            daily->tnight = blk->tnight[l] / (counter - daylight_counter);
         }
 
 #ifdef _CYCLES_
@@ -165,50 +190,71 @@ void DailyVar (int t, int start_time, pihm_struct pihm)
     }
 }
 
+void InitDailyAcc (dailyacc_struct *acc)
+{
+    acc->nblk = (nelem + NOAH_BLOCK - 1) / NOAH_BLOCK;
+    acc->blk = (dailyblk_struct *)malloc (acc->nblk *
+        sizeof (dailyblk_struct));
+}
+
+void FreeDailyAcc (dailyacc_struct *acc)
+{
+    free (acc->blk);
+}
+
 void InitDailyStruct (pihm_struct pihm)
 {
+    int             b;
+#ifdef _CYCLES_
     int             i;
+#endif
+    dailyacc_struct *acc;
+
+    acc = &pihm->dacc;
+
+    acc->counter = 0;
 
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-    for (i = 0; i < nelem; i++)
+    for (b = 0; b < acc->nblk; b++)
     {
-        int         k;
-        elem_struct *elem;
-
-        elem = &pihm->elem[i];
+        int         k, l;
+        dailyblk_struct *blk;
 
-        elem->daily.counter = 0;
-        elem->daily.daylight_counter = 0;
+        blk = &acc->blk[b];
 
-        elem->daily.avg_surf = 0.0;
-        elem->daily.avg_unsat = 0.0;
-        elem->daily.avg_gw = 0.0;
-        for (k = 0; k < MAXLYR; k++)
+        for (l = 0; l < NOAH_BLOCK; l++)
         {
-            elem->daily.avg_sh2o[k] = 0.0;
-            elem->daily.avg_smc[k] = 0.0;
-            elem->daily.avg_et[k] = 0.0;
-            elem->daily.avg_smflxv[k] = 0.0;
-            elem->daily.avg_stc[k] = 0.0;
+            blk->daylight_counter[l] = 0;
+
+            blk->sfctmp[l] = 0.0;
+            blk->tmax[l] = -999.0;
+            blk->tmin[l] = 999.0;
+            blk->tday[l] = 0.0;
+            blk->tnight[l] = 0.0;
+            blk->sfcspd[l] = 0.0;
+            blk->surf[l] = 0.0;
+            blk->unsat[l] = 0.0;
+            blk->gw[l] = 0.0;
+            blk->q2d[l] = 0.0;
+            blk->ch[l] = 0.0;
+            blk->rc[l] = 0.0;
+            blk->sfcprs[l] = 0.0;
+            blk->albedo[l] = 0.0;
+            blk->soldn[l] = 0.0;
+            blk->solar_total[l] = 0.0;
+            blk->sncovr[l] = 0.0;
+
+            for (k = 0; k < MAXLYR; k++)
+            {
+                blk->stc[k][l] = 0.0;
+                blk->sh2o[k][l] = 0.0;
+                blk->smc[k][l] = 0.0;
+                blk->smflxv[k][l] = 0.0;
+                blk->et[k][l] = 0.0;
+            }
         }
-
-        elem->daily.avg_q2d = 0.0;
-        elem->daily.avg_sfcprs = 0.0;
-        elem->daily.avg_ch = 0.0;
-        elem->daily.avg_rc = 0.0;
-        elem->daily.avg_albedo = 0.0;
-        elem->daily.avg_sfcspd = 0.0;
-
-        elem->daily.tmax = -999.0;
-        elem->daily.tmin = 999.0;
-        elem->daily.avg_sfctmp = 0.0;
-        elem->daily.tday = 0.0;
-        elem->daily.tnight = 0.0;
-
-        elem->daily.avg_soldn = 0.0;
-        elem->daily.solar_total = 0.0;
     }
 
 #ifdef _CYCLES_
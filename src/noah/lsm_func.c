@@ -444,7 +444,7 @@ void RootDist (const double *sldpth, int nsoil, int nroot, double *rtdis)
 }
 
 void SunPos (int t, double latitude, double longitude, double elevation,
-    double tmp, spa_data *spa)
+    double tmp, int function, spa_data *spa)
 {
     int             spa_result;
     pihm_t_struct   pihm_time;
@@ -472,7 +472,7 @@ void SunPos (int t, double latitude, double longitude, double elevation,
         1013.25 * pow ((293.0 - 0.0065 * spa->elevation) / 293.0, 5.26);
     spa->temperature = tmp;
 
-    spa->function = SPA_ZA_RTS;
+    spa->function = function;
     spa_result = spa_calculate (spa);
 
     if (spa_result != 0)
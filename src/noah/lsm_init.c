@@ -34,6 +34,9 @@ void InitLsm (elem_struct *elem, const ctrl_struct *ctrl,
         elem[i].ps.zbot = noahtbl->zbot;
         elem[i].ps.tbot = noahtbl->tbot;
 
+        elem[i].ps.nfrz = 0;
+        elem[i].ps.nfrz_fallback = 0;
+
         /* To adjust frzk parameter to actual soil type */
         frzfact =
             (elem[i].soil.smcmax / elem[i].soil.smcref) * (0.412 / 0.468);
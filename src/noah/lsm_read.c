@@ -141,6 +141,78 @@ void ReadLsm (char *filename, siteinfo_struct *siteinfo, ctrl_struct *ctrl,
     NextLine (lsm_file, cmdstr, &lno);
     ctrl->prtvrbl[CH_CTRL] = ReadPrtCtrl (cmdstr, "CH", filename, lno);
 
+    /* Optional solar position and land surface step controls. Land surface
+     * steps of 0 are set from LSM_STEP by InitLsmStep */
+    ctrl->anchor_res = SOL_ANCHOR_RES;
+    ctrl->sol_validate = 0;
+    ctrl->lsm_adapt = 0;
+    ctrl->lsm_step_min = 0;
+    ctrl->lsm_step_max = 0;
+    ctrl->lsm_tol = LSM_TOL;
+
+    NextLine (lsm_file, cmdstr, &lno);
+    while (strcasecmp (cmdstr, "EOF") != 0)
+    {
+        char            optstr[MAXSTRING];
+
+        sscanf (cmdstr, "%s", optstr);
+
+        if (strcasecmp (optstr, "SOL_ANCHOR_RES") == 0)
+        {
+            ReadKeyword (cmdstr, "SOL_ANCHOR_RES", &ctrl->anchor_res, 'd',
+                filename, lno);
+            if (ctrl->anchor_res <= 0.0)
+            {
+                PIHMprintf (VL_ERROR,
+                    "Error: SOL_ANCHOR_RES should be positive.\n");
+                PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n",
+                    filename, lno);
+                PIHMexit (EXIT_FAILURE);
+            }
+        }
+        else if (strcasecmp (optstr, "SOL_VALIDATE") == 0)
+        {
+            ReadKeyword (cmdstr, "SOL_VALIDATE", &ctrl->sol_validate, 'i',
+                filename, lno);
+        }
+        else if (strcasecmp (optstr, "LSM_ADAPT") == 0)
+        {
+            ReadKeyword (cmdstr, "LSM_ADAPT", &ctrl->lsm_adapt, 'i',
+                filename, lno);
+        }
+        else if (strcasecmp (optstr, "LSM_STEP_MIN") == 0)
+        {
+            ReadKeyword (cmdstr, "LSM_STEP_MIN", &ctrl->lsm_step_min, 'i',
+                filename, lno);
+        }
+        else if (strcasecmp (optstr, "LSM_STEP_MAX") == 0)
+        {
+            ReadKeyword (cmdstr, "LSM_STEP_MAX", &ctrl->lsm_step_max, 'i',
+                filename, lno);
+        }
+        else if (strcasecmp (optstr, "LSM_TOL") == 0)
+        {
+            ReadKeyword (cmdstr, "LSM_TOL", &ctrl->lsm_tol, 'd', filename,
+                lno);
+            if (ctrl->lsm_tol <= 0.0)
+            {
+                PIHMprintf (VL_ERROR, "Error: LSM_TOL should be positive.\n");
+                PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n",
+                    filename, lno);
+                PIHMexit (EXIT_FAILURE);
+            }
+        }
+        else
+        {
+            PIHMprintf (VL_ERROR, "Error: Unknown keyword \"%s\".\n", optstr);
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename,
+                lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+
+        NextLine (lsm_file, cmdstr, &lno);
+    }
+
     fclose (lsm_file);
 }
 
@@ -218,3 +290,48 @@ void ReadRad (char *filename, forc_struct *forc)
 
     fclose (rad_file);
 }
+
+void ReadLatLon (char *filename, atttbl_struct *atttbl)
+{
+    int             i;
+    FILE           *latlon_file;
+    char            cmdstr[MAXSTRING];
+    int             match;
+    int             index;
+    int             lno = 0;
+
+    /* Element latitude and longitude are optional. Without them, solar
+     * positions of all elements are calculated at the domain latitude and
+     * longitude */
+    latlon_file = fopen (filename, "r");
+    if (NULL == latlon_file)
+    {
+        atttbl->lat = NULL;
+        atttbl->lon = NULL;
+        return;
+    }
+    PIHMprintf (VL_VERBOSE, " Reading %s\n", filename);
+
+    atttbl->lat = (double *)malloc (nelem * sizeof (double));
+    atttbl->lon = (double *)malloc (nelem * sizeof (double));
+
+    /* Skip header line */
+    NextLine (latlon_file, cmdstr, &lno);
+    for (i = 0; i < nelem; i++)
+    {
+        NextLine (latlon_file, cmdstr, &lno);
+        match = sscanf (cmdstr, "%d %lf %lf", &index, &atttbl->lat[i],
+            &atttbl->lon[i]);
+        if (match != 3 || i != index - 1)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error reading latitude and longitude of the %dth element.\n",
+                i + 1);
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n",
+                filename, lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+    }
+
+    fclose (latlon_file);
+}
@@ -0,0 +1,352 @@
+#include "pihm.h"
+
+void InitLsmStep (ctrl_struct *ctrl, int nmeteo)
+{
+    lsmstep_struct *lsm;
+    int             b, i;
+
+    if (!ctrl->lsm_adapt)
+    {
+        ctrl->lsm_step_min = ctrl->etstep;
+        ctrl->lsm_step_max = ctrl->etstep;
+    }
+    else
+    {
+        ctrl->lsm_step_min = (ctrl->lsm_step_min > 0) ?
+            ctrl->lsm_step_min : ctrl->etstep;
+        ctrl->lsm_step_max = (ctrl->lsm_step_max > 0) ?
+            ctrl->lsm_step_max : LSM_MAXFACT * ctrl->etstep;
+
+        if (ctrl->lsm_step_min % ctrl->stepsize > 0 ||
+            ctrl->lsm_step_min > ctrl->etstep)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error: LSM_STEP_MIN should be an integral multiple of model "
+                "step size, and should not be greater than LSM_STEP.\n");
+            PIHMexit (EXIT_FAILURE);
+        }
+
+        if (ctrl->lsm_step_max % ctrl->lsm_step_min > 0 ||
+            ctrl->lsm_step_max < ctrl->etstep)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error: LSM_STEP_MAX should be an integral multiple of "
+                "LSM_STEP_MIN, and should not be less than LSM_STEP.\n");
+            PIHMexit (EXIT_FAILURE);
+        }
+
+        PIHMprintf (VL_VERBOSE, " Adaptive land surface steps from %d s to "
+            "%d s, energy balance residual tolerance %.1f W m-2.\n",
+            ctrl->lsm_step_min, ctrl->lsm_step_max, ctrl->lsm_tol);
+    }
+
+    /* Steps are chosen for the element blocks of Noah. Ensemble members call
+     * InitLsmStep for their own copies of the control structure, so arrays
+     * are not shared */
+    lsm = &ctrl->lsm;
+
+    lsm->nblk = (nelem + NOAH_BLOCK - 1) / NOAH_BLOCK;
+    lsm->dt = (int *)malloc (lsm->nblk * sizeof (int));
+    lsm->next = (int *)malloc (lsm->nblk * sizeof (int));
+    lsm->due = (int *)malloc (lsm->nblk * sizeof (int));
+    for (b = 0; b < lsm->nblk; b++)
+    {
+        lsm->dt[b] = ctrl->etstep;
+        lsm->next[b] = ctrl->starttime;
+        lsm->due[b] = 1;
+    }
+    lsm->next_min = ctrl->starttime;
+    lsm->nstep = 0;
+
+    lsm->meteo = NULL;
+    lsm->pred = NULL;
+    lsm->pred_next = NULL;
+    lsm->real = NULL;
+    lsm->held = NULL;
+    if (ctrl->lsm_adapt)
+    {
+        lsm->meteo = (double *)malloc ((ctrl->lsm_step_max /
+            ctrl->lsm_step_min + 1) * nmeteo * NUM_METEO_VAR *
+            sizeof (double));
+        lsm->pred = (double *)malloc (nelem * sizeof (double));
+        lsm->pred_next = (double *)malloc (nelem * sizeof (double));
+        lsm->real = (double *)malloc (nelem * sizeof (double));
+        lsm->held = (double *)malloc (NUM_HELD_FLUX * nelem * sizeof (double));
+        for (i = 0; i < nelem; i++)
+        {
+            lsm->pred[i] = BADVAL;
+            lsm->real[i] = 0.0;
+        }
+        for (i = 0; i < NUM_HELD_FLUX * nelem; i++)
+        {
+            lsm->held[i] = 0.0;
+        }
+    }
+
+    lsm->nres = 0;
+    lsm->nexceed = 0;
+    lsm->pred_sum = 0.0;
+    lsm->pred_max = 0.0;
+    lsm->real_sum = 0.0;
+    lsm->real_max = 0.0;
+}
+
+void FreeLsmStep (lsmstep_struct *lsm)
+{
+    free (lsm->dt);
+    free (lsm->next);
+    free (lsm->due);
+    free (lsm->meteo);
+    free (lsm->pred);
+    free (lsm->pred_next);
+    free (lsm->real);
+    free (lsm->held);
+}
+
+int LsmStepDue (const ctrl_struct *ctrl, int t)
+{
+    if (!ctrl->lsm_adapt)
+    {
+        return ((t - ctrl->starttime) % ctrl->etstep == 0);
+    }
+
+    /* Model time goes back to the start time in spinup runs */
+    return (t == ctrl->starttime || t >= ctrl->lsm.next_min);
+}
+
+static double HeldResid (const elem_struct *elem, const double *f0,
+    const double *f)
+{
+    double          rhocp;
+
+    rhocp = f0[PRES_TS] / RD / f0[SFCTMP_TS] * CP;
+
+    /* Energy balance residual of fluxes held from forcing f0 under forcing
+     * f, estimated from changes in downward radiation, sensible heat
+     * exchange with the air, and the latent heat of precipitation */
+    return ((1.0 - elem->ps.albedo) * fabs (f[SOLAR_TS] - f0[SOLAR_TS]) +
+        elem->ps.emissi * fabs (f[LONGWAVE_TS] - f0[LONGWAVE_TS]) +
+        rhocp * elem->ps.ch * fabs (f[SFCTMP_TS] - f0[SFCTMP_TS]) +
+        LVH2O * fabs (f[PRCP_TS] - f0[PRCP_TS]));
+}
+
+void LsmStep (const forc_struct *forc, const elem_struct *elem,
+    ctrl_struct *ctrl, int t)
+{
+    lsmstep_struct *lsm = &ctrl->lsm;
+    const double   *meteo = lsm->meteo;
+    int             b, k, n;
+    int             nmax;
+
+    if (!ctrl->lsm_adapt)
+    {
+        /* All blocks take LSM_STEP */
+        lsm->nstep += lsm->nblk;
+        lsm->next_min = t + ctrl->etstep;
+
+        return;
+    }
+
+    /* Number of look-ahead times, which are limited by the end of
+     * simulation and the end of forcing */
+    nmax = ctrl->lsm_step_max / ctrl->lsm_step_min;
+    for (k = 0; k < forc->nmeteo; k++)
+    {
+        while (nmax > 1 && t + nmax * ctrl->lsm_step_min >
+            forc->meteo[k].ftime[forc->meteo[k].length - 1])
+        {
+            nmax--;
+        }
+    }
+    while (nmax > 1 && t + nmax * ctrl->lsm_step_min > ctrl->endtime)
+    {
+        nmax--;
+    }
+
+    /* Station forcing at look-ahead times. Forcing at model time is already
+     * interpolated by ApplyForcing */
+    for (k = 0; k < forc->nmeteo; k++)
+    {
+        for (n = 0; n <= nmax; n++)
+        {
+            IntrplValue (&forc->meteo[k], t + n * ctrl->lsm_step_min,
+                NUM_METEO_VAR,
+                &lsm->meteo[(n * forc->nmeteo + k) * NUM_METEO_VAR]);
+        }
+    }
+
+    /* Each block whose step ends at model time chooses its next step. Fluxes
+     * of an element are held over the step, which ends before the estimated
+     * residual of any element of the block exceeds the tolerance */
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (b = 0; b < lsm->nblk; b++)
+    {
+        int             i, l, nl;
+        int             nstep;
+
+        lsm->due[b] = (t == ctrl->starttime || lsm->next[b] <= t);
+        if (!lsm->due[b])
+        {
+            continue;
+        }
+
+        nl = ((b + 1) * NOAH_BLOCK <= nelem) ?
+            NOAH_BLOCK : nelem - b * NOAH_BLOCK;
+
+        nstep = nmax;
+        for (l = 0; l < nl; l++)
+        {
+            int             m;
+            const double   *f0;
+
+            i = b * NOAH_BLOCK + l;
+            m = elem[i].attrib.meteo_type - 1;
+            f0 = &meteo[m * NUM_METEO_VAR];
+
+            for (n = 1; n <= nstep; n++)
+            {
+                const double   *f;
+
+                f = &meteo[(n * forc->nmeteo + m) * NUM_METEO_VAR];
+
+                /* Steps also end before air temperature crosses the freezing
+                 * point over snow, for snowmelt onset */
+                if (HeldResid (&elem[i], f0, f) > ctrl->lsm_tol ||
+                    (elem[i].ws.sneqv > 0.0 &&
+                    (f[SFCTMP_TS] - TFREEZ) * (f0[SFCTMP_TS] - TFREEZ) < 0.0))
+                {
+                    nstep = n - 1;
+                    break;
+                }
+            }
+        }
+        nstep = (nstep > 1) ? nstep : 1;
+
+        /* Predicted residuals of the chosen step */
+        for (l = 0; l < nl; l++)
+        {
+            int             m;
+            const double   *f0;
+
+            i = b * NOAH_BLOCK + l;
+            m = elem[i].attrib.meteo_type - 1;
+            f0 = &meteo[m * NUM_METEO_VAR];
+
+            lsm->pred_next[i] = 0.0;
+            for (n = 1; n <= nstep; n++)
+            {
+                double          resid;
+
+                resid = HeldResid (&elem[i], f0,
+                    &meteo[(n * forc->nmeteo + m) * NUM_METEO_VAR]);
+                lsm->pred_next[i] = (resid > lsm->pred_next[i]) ?
+                    resid : lsm->pred_next[i];
+            }
+
+            /* No residual is realized across the restart of spinup cycles */
+            if (t == ctrl->starttime)
+            {
+                lsm->pred[i] = BADVAL;
+            }
+        }
+
+        lsm->dt[b] = nstep * ctrl->lsm_step_min;
+        lsm->next[b] = t + lsm->dt[b];
+    }
+
+    lsm->next_min = lsm->next[0];
+    for (b = 0; b < lsm->nblk; b++)
+    {
+        lsm->nstep += lsm->due[b];
+        lsm->next_min = (lsm->next[b] < lsm->next_min) ?
+            lsm->next[b] : lsm->next_min;
+    }
+}
+
+void LsmHeld (lsmstep_struct *lsm, const eflux_struct *ef, int i)
+{
+    double         *held = &lsm->held[NUM_HELD_FLUX * i];
+    double          flux[NUM_HELD_FLUX];
+    int             k;
+
+    flux[0] = ef->solnet;
+    flux[1] = ef->lwdn;
+    flux[2] = ef->sheat;
+    flux[3] = ef->eta;
+
+    /* The realized residual of a step is the change of net shortwave,
+     * downward longwave, sensible heat, and latent heat fluxes from the Noah
+     * solve at its start to the Noah solve at its end, i.e., the energy
+     * balance error of holding the fluxes of the start at the end */
+    lsm->real[i] = 0.0;
+    for (k = 0; k < NUM_HELD_FLUX; k++)
+    {
+        lsm->real[i] += fabs (flux[k] - held[k]);
+        held[k] = flux[k];
+    }
+}
+
+void LsmStats (ctrl_struct *ctrl)
+{
+    lsmstep_struct *lsm = &ctrl->lsm;
+    int             b, i, l, nl;
+
+    /* Predicted and realized residuals of the steps that end at model time
+     * are compared */
+    for (b = 0; b < lsm->nblk; b++)
+    {
+        if (!lsm->due[b])
+        {
+            continue;
+        }
+
+        nl = ((b + 1) * NOAH_BLOCK <= nelem) ?
+            NOAH_BLOCK : nelem - b * NOAH_BLOCK;
+
+        for (l = 0; l < nl; l++)
+        {
+            i = b * NOAH_BLOCK + l;
+
+            if (lsm->pred[i] != BADVAL)
+            {
+                lsm->nres++;
+                lsm->pred_sum += lsm->pred[i];
+                lsm->real_sum += lsm->real[i];
+                lsm->pred_max = (lsm->pred[i] > lsm->pred_max) ?
+                    lsm->pred[i] : lsm->pred_max;
+                lsm->real_max = (lsm->real[i] > lsm->real_max) ?
+                    lsm->real[i] : lsm->real_max;
+                lsm->nexceed += (lsm->real[i] > ctrl->lsm_tol);
+            }
+
+            lsm->pred[i] = lsm->pred_next[i];
+        }
+    }
+}
+
+void PrtLsmStats (const ctrl_struct *ctrl)
+{
+    const lsmstep_struct *lsm = &ctrl->lsm;
+
+    if (ctrl->lsm_adapt && lsm->nstep > 0)
+    {
+        PIHMprintf (VL_NORMAL, "Land surface steps: %ld steps of %d element "
+            "blocks, average step %.0f s (LSM_STEP %d s)\n", lsm->nstep,
+            lsm->nblk, (double)(ctrl->endtime - ctrl->starttime) *
+            (double)lsm->nblk / (double)lsm->nstep, ctrl->etstep);
+
+        if (lsm->nres > 0)
+        {
+            PIHMprintf (VL_NORMAL, "Energy balance residuals of held fluxes "
+                "in %ld element steps (W m-2):\n"
+                "  predicted mean %.1f, max %.1f; realized mean %.1f, "
+                "max %.1f\n"
+                "  realized residuals exceed LSM_TOL in %.1f%% of steps\n",
+                lsm->nres, lsm->pred_sum / (double)lsm->nres, lsm->pred_max,
+                lsm->real_sum / (double)lsm->nres, lsm->real_max,
+                100.0 * (double)lsm->nexceed / (double)lsm->nres);
+        }
+    }
+}
@@ -2,103 +2,196 @@
 
 void Noah (pihm_struct pihm)
 {
-    int             i, j;
+    int             nblk;
+    int             b;
+
+    /* Elements are processed in blocks, so that the soil heat equations of
+     * all elements in a block are solved together */
+    nblk = (nelem + NOAH_BLOCK - 1) / NOAH_BLOCK;
 
 #ifdef _OPENMP
-#pragma omp parallel for private(j)
+    KernelStart (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[NOAH_KERNEL]);
+#pragma omp parallel for schedule(runtime) \
+    num_threads(pihm->ctrl.kernel[NOAH_KERNEL].nthreads)
 #endif
-    for (i = 0; i < nelem; i++)
+    for (b = 0; b < nblk; b++)
     {
-        CalHum (&pihm->elem[i].ps, &pihm->elem[i].es);
-
-        pihm->elem[i].ps.ffrozp =
-            FrozRain (pihm->elem[i].wf.prcp, pihm->elem[i].es.sfctmp);
-
-        pihm->elem[i].ps.alb = BADVAL;
-
-        pihm->elem[i].ws.cmcmax = pihm->elem[i].lc.shdfac *
-            pihm->elem[i].lc.cmcfactr * pihm->elem[i].ps.proj_lai;
+        lsmblk_struct   blk;
+        int             i, j, l;
 
-        if (pihm->elem[i].ps.q1 == BADVAL)
+        /* Blocks whose land surface steps have not ended hold their fluxes */
+        if (!pihm->ctrl.lsm.due[b])
         {
-            pihm->elem[i].ps.q1 = pihm->elem[i].ps.q2;
+            continue;
         }
 
-        pihm->elem[i].ef.solnet =
-            pihm->elem[i].ef.soldn * (1.0 - pihm->elem[i].ps.albedo);
-        pihm->elem[i].ef.lwdn =
-            pihm->elem[i].ef.longwave * pihm->elem[i].ps.emissi;
+        InitLsmBlk (&blk, (b + 1) * NOAH_BLOCK <= nelem ?
+            NOAH_BLOCK : nelem - b * NOAH_BLOCK);
 
-        for (j = 0; j < pihm->elem[i].ps.nsoil; j++)
+        for (l = 0; l < blk.nlane; l++)
         {
-            pihm->elem[i].ws.smc[j] =
-                (pihm->elem[i].ws.smc[j] > pihm->elem[i].soil.smcmin + 0.02) ?
-                pihm->elem[i].ws.smc[j] : pihm->elem[i].soil.smcmin + 0.02;
-            pihm->elem[i].ws.smc[j] =
-                (pihm->elem[i].ws.smc[j] < pihm->elem[i].soil.smcmax) ?
-                pihm->elem[i].ws.smc[j] : pihm->elem[i].soil.smcmax;
-            pihm->elem[i].ws.sh2o[j] =
-                (pihm->elem[i].ws.sh2o[j] < pihm->elem[i].ws.smc[j]) ?
-                pihm->elem[i].ws.sh2o[j] : pihm->elem[i].ws.smc[j];
+            i = b * NOAH_BLOCK + l;
+
+            CalHum (&pihm->elem[i].ps, &pihm->elem[i].es);
+
+            pihm->elem[i].ps.ffrozp =
+                FrozRain (pihm->elem[i].wf.prcp, pihm->elem[i].es.sfctmp);
+
+            pihm->elem[i].ps.alb = BADVAL;
+
+            pihm->elem[i].ws.cmcmax = pihm->elem[i].lc.shdfac *
+                pihm->elem[i].lc.cmcfactr * pihm->elem[i].ps.proj_lai;
+
+            if (pihm->elem[i].ps.q1 == BADVAL)
+            {
+                pihm->elem[i].ps.q1 = pihm->elem[i].ps.q2;
+            }
+
+            pihm->elem[i].ef.solnet =
+                pihm->elem[i].ef.soldn * (1.0 - pihm->elem[i].ps.albedo);
+            pihm->elem[i].ef.lwdn =
+                pihm->elem[i].ef.longwave * pihm->elem[i].ps.emissi;
+
+            for (j = 0; j < pihm->elem[i].ps.nsoil; j++)
+            {
+                pihm->elem[i].ws.smc[j] =
+                    (pihm->elem[i].ws.smc[j] >
+                    pihm->elem[i].soil.smcmin + 0.02) ?
+                    pihm->elem[i].ws.smc[j] :
+                    pihm->elem[i].soil.smcmin + 0.02;
+                pihm->elem[i].ws.smc[j] =
+                    (pihm->elem[i].ws.smc[j] < pihm->elem[i].soil.smcmax) ?
+                    pihm->elem[i].ws.smc[j] : pihm->elem[i].soil.smcmax;
+                pihm->elem[i].ws.sh2o[j] =
+                    (pihm->elem[i].ws.sh2o[j] < pihm->elem[i].ws.smc[j]) ?
+                    pihm->elem[i].ws.sh2o[j] : pihm->elem[i].ws.smc[j];
 #ifdef _CYCLES_
-            pihm->elem[i].soil.waterContent[j] = pihm->elem[i].ws.sh2o[j];
+                pihm->elem[i].soil.waterContent[j] = pihm->elem[i].ws.sh2o[j];
 #endif
-        }
+            }
 
-        /*
-         * Run Noah LSM
-         */
-        SFlx (&pihm->elem[i].ws, &pihm->elem[i].wf, &pihm->elem[i].es,
-            &pihm->elem[i].ef, &pihm->elem[i].ps, &pihm->elem[i].lc,
-            &pihm->elem[i].epc, &pihm->elem[i].soil,
+            /*
+             * Run Noah LSM up to the soil heat equation
+             */
+            SFlx (&pihm->elem[i].ws, &pihm->elem[i].wf, &pihm->elem[i].es,
+                &pihm->elem[i].ef, &pihm->elem[i].ps, &pihm->elem[i].lc,
+                &pihm->elem[i].epc, &pihm->elem[i].soil,
 #ifdef _CYCLES_
-            &pihm->elem[i].comm, &pihm->elem[i].residue,
+                &pihm->elem[i].comm, &pihm->elem[i].residue,
 #endif
-            pihm->ctrl.etstep);
+                pihm->ctrl.lsm.dt[b], &blk, l);
+        }
+
+        /* Solve soil heat equations of the block */
+        Rosr12 (&blk);
+
+        for (l = 0; l < blk.nlane; l++)
+        {
+            i = b * NOAH_BLOCK + l;
 
-        /* ET: convert from W m-2 to m s-1 */
-        pihm->elem[i].wf.ec = pihm->elem[i].ef.ec / LVH2O / 1000.0;
-        pihm->elem[i].wf.ett = pihm->elem[i].ef.ett / LVH2O / 1000.0;
-        pihm->elem[i].wf.edir = pihm->elem[i].ef.edir / LVH2O / 1000.0;
+            SFlxEnd (&pihm->elem[i].wf, &pihm->elem[i].es, &pihm->elem[i].ef,
+                &pihm->elem[i].ps, &blk, l);
+
+            /* ET: convert from W m-2 to m s-1 */
+            pihm->elem[i].wf.ec = pihm->elem[i].ef.ec / LVH2O / 1000.0;
+            pihm->elem[i].wf.ett = pihm->elem[i].ef.ett / LVH2O / 1000.0;
+            pihm->elem[i].wf.edir = pihm->elem[i].ef.edir / LVH2O / 1000.0;
+
+            if (pihm->ctrl.lsm_adapt)
+            {
+                LsmHeld (&pihm->ctrl.lsm, &pihm->elem[i].ef, i);
+            }
+        }
+    }
+#ifdef _OPENMP
+    KernelEnd (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[NOAH_KERNEL]);
+#endif
+
+    if (pihm->ctrl.lsm_adapt)
+    {
+        LsmStats (&pihm->ctrl);
     }
 }
 
 void NoahHydrol (elem_struct *elem, double dt)
 {
-    int             i, j;
+    int             nblk;
+    int             b;
+
+    nblk = (nelem + NOAH_BLOCK - 1) / NOAH_BLOCK;
 
 #ifdef _OPENMP
-#pragma omp parallel for private(j)
+#pragma omp parallel for
 #endif
-    for (i = 0; i < nelem; i++)
-    {
-        /* Find water table position */
-        elem[i].ps.nwtbl = FindWT (elem[i].ps.sldpth,
-            elem[i].ps.nsoil, elem[i].ws.gw,
-            elem[i].ps.satdpth);
-
-        for (j = 0; j < elem[i].ps.nsoil; j++)
-        {
-            elem[i].ws.smc[j] =
-                (elem[i].ws.smc[j] > elem[i].soil.smcmin + 0.02) ?
-                elem[i].ws.smc[j] : elem[i].soil.smcmin + 0.02;
-            elem[i].ws.smc[j] =
-                (elem[i].ws.smc[j] < elem[i].soil.smcmax) ?
-                elem[i].ws.smc[j] : elem[i].soil.smcmax;
-            elem[i].ws.sh2o[j] =
-                (elem[i].ws.sh2o[j] < elem[i].ws.smc[j]) ?
-                elem[i].ws.sh2o[j] : elem[i].ws.smc[j];
+    for (b = 0; b < nblk; b++)
+    {
+        lsmblk_struct   blk;
+        int             i, j, l;
+
+        InitLsmBlk (&blk, (b + 1) * NOAH_BLOCK <= nelem ?
+            NOAH_BLOCK : nelem - b * NOAH_BLOCK);
+
+        for (l = 0; l < blk.nlane; l++)
+        {
+            i = b * NOAH_BLOCK + l;
+
+            /* Find water table position */
+            elem[i].ps.nwtbl = FindWT (elem[i].ps.sldpth,
+                elem[i].ps.nsoil, elem[i].ws.gw,
+                elem[i].ps.satdpth);
+
+            for (j = 0; j < elem[i].ps.nsoil; j++)
+            {
+                elem[i].ws.smc[j] =
+                    (elem[i].ws.smc[j] > elem[i].soil.smcmin + 0.02) ?
+                    elem[i].ws.smc[j] : elem[i].soil.smcmin + 0.02;
+                elem[i].ws.smc[j] =
+                    (elem[i].ws.smc[j] < elem[i].soil.smcmax) ?
+                    elem[i].ws.smc[j] : elem[i].soil.smcmax;
+                elem[i].ws.sh2o[j] =
+                    (elem[i].ws.sh2o[j] < elem[i].ws.smc[j]) ?
+                    elem[i].ws.sh2o[j] : elem[i].ws.smc[j];
 #ifdef _CYCLES_
-            elem[i].soil.waterContent[j] = elem[i].ws.sh2o[j];
+                elem[i].soil.waterContent[j] = elem[i].ws.sh2o[j];
 #endif
-        }
+            }
 
-        SmFlx (&elem[i].ws, &elem[i].wf, &elem[i].ps,
-            &elem[i].soil,
+            SmFlx (&elem[i].ws, &elem[i].wf, &elem[i].ps,
+                &elem[i].soil,
 #ifdef _CYCLES_
-            &elem[i].residue,
+                &elem[i].residue,
 #endif
-            dt);
+                dt, &blk, l);
+        }
+
+        /* Solve soil moisture equations of the block */
+        Rosr12 (&blk);
+
+        for (l = 0; l < blk.nlane; l++)
+        {
+            i = b * NOAH_BLOCK + l;
+
+            if (blk.nsoil[l] > 0)
+            {
+                SStepEnd (&elem[i].ws, &elem[i].wf, &elem[i].ps,
+                    &elem[i].soil, &blk, l, dt);
+            }
+        }
+    }
+}
+
+void InitLsmBlk (lsmblk_struct *blk, int nlane)
+{
+    int             l;
+
+    blk->nlane = nlane;
+
+    /* Lanes without equations (including unused lanes of the last block)
+     * are solved as identity equations */
+    for (l = 0; l < NOAH_BLOCK; l++)
+    {
+        blk->nsoil[l] = 0;
+        blk->nopac[l] = 0;
     }
 }
 
@@ -108,7 +201,7 @@ void SFlx (wstate_struct *ws, wflux_struct *wf, estate_struct *es,
 #ifdef _CYCLES_
     comm_struct *comm, residue_struct *residue,
 #endif
-    int etstep)
+    int etstep, lsmblk_struct *blk, int lane)
 {
     /*
      * subroutine SFlx - unified noahlsm version 1.0 july 2007
@@ -118,6 +211,11 @@ void SFlx (wstate_struct *ws, wflux_struct *wf, estate_struct *es,
      * soil temperature, skin temperature, snowpack water content, snowdepth,
      * and all terms of the surface energy balance and surface water balance
      * (excluding input atmospheric forcings of downward radiation and precip)
+     *
+     * In Flux-PIHM, the soil heat equation of the element is stored in the
+     * lane of the block, and is solved together with other elements in the
+     * block. Soil temperatures and terms that depend on them are updated in
+     * SFlxEnd
      */
     int             frzgra, snowng;
     const int       IZ0TLND = 0;
@@ -454,13 +552,16 @@ void SFlx (wstate_struct *ws, wflux_struct *wf, estate_struct *es,
      */
     wf->esnow = 0.0;
 
+    blk->nopac[lane] = (ws->sneqv == 0.0);
+    blk->t2v[lane] = t2v;
+
     if (ws->sneqv == 0.0)
     {
         NoPac (ws, wf, es, ef, ps, lc, soil,
 #ifdef _CYCLES_
             comm, residue,
 #endif
-            dt, t24);
+            dt, t24, blk, lane);
         ps->eta_kinematic = wf->eta * 1000.0;
     }
     else
@@ -469,17 +570,13 @@ void SFlx (wstate_struct *ws, wflux_struct *wf, estate_struct *es,
 #ifdef _CYCLES_
             comm, residue,
 #endif
-            snowng, dt, t24, prcpf, df1);
+            snowng, dt, t24, prcpf, df1, blk, lane);
         ps->eta_kinematic = (wf->esnow + wf->etns) * 1000.0;
     }
 
     /* Calculate effective mixing ratio at grnd level (skin) */
     ps->q1 = ps->q2 + ps->eta_kinematic * CP / ps->rch;
 
-    /* Determine sensible heat (H) in energy units (W m-2) */
-    ef->sheat =
-        - (ps->ch * CP * ps->sfcprs) / (RD * t2v) * (es->th2 - es->t1);
-
     /* Convert evap terms from rate (m s-1) to energy units (w m-2) */
     ef->edir = wf->edir * 1000.0 * LVH2O;
     ef->ec = wf->ec * 1000.0 * LVH2O;
@@ -516,11 +613,6 @@ void SFlx (wstate_struct *ws, wflux_struct *wf, estate_struct *es,
         ps->beta = ef->eta / ef->etp;
     }
 
-    /* Convert the sign of soil heat flux so that:
-     *   ssoil>0: warm the surface  (night time)
-     *   ssoil<0: cool the surface  (day time) */
-    ef->ssoil *= -1.0;
-
     ws->soilm = -1.0 * ws->smc[0] * ps->zsoil[0];
     for (k = 1; k < ps->nsoil; k++)
     {
@@ -558,6 +650,46 @@ void SFlx (wstate_struct *ws, wflux_struct *wf, estate_struct *es,
     }
 }
 
+void SFlxEnd (const wflux_struct *wf, estate_struct *es, eflux_struct *ef,
+    const pstate_struct *ps, const lsmblk_struct *blk, int lane)
+{
+    /*
+     * Update soil temperatures using the solution of the soil heat equation,
+     * and the skin temperature and fluxes that depend on them
+     */
+    int             k;
+
+    for (k = 0; k < ps->nsoil; k++)
+    {
+        es->stc[k] += blk->p[k][lane];
+    }
+
+    if (blk->nopac[lane])
+    {
+        /* In the no snowpack case (via routine NoPac branch,) update the
+         * grnd (skin) temperature here in response to the updated soil
+         * temperature profile above. (Note: skin temperature is updated
+         * differently in routine SnoPac) */
+        es->t1 = (blk->yy[lane] + (blk->zz1[lane] - 1.0) * es->stc[0]) /
+            blk->zz1[lane];
+
+        /* Calculate surface soil heat flux */
+        ef->ssoil = blk->df1[lane] * (es->stc[0] - es->t1) /
+            (0.5 * ps->zsoil[0]);
+
+        ef->flx1 = CPH2O * wf->prcp * 1000.0 * (es->t1 - es->sfctmp);
+    }
+
+    /* Determine sensible heat (H) in energy units (W m-2) */
+    ef->sheat = - (ps->ch * CP * ps->sfcprs) / (RD * blk->t2v[lane]) *
+        (es->th2 - es->t1);
+
+    /* Convert the sign of soil heat flux so that:
+     *   ssoil>0: warm the surface  (night time)
+     *   ssoil<0: cool the surface  (day time) */
+    ef->ssoil *= -1.0;
+}
+
 void AlCalc (pstate_struct *ps, double dt, int snowng)
 {
     /*
@@ -862,7 +994,8 @@ void Evapo (wstate_struct *ws, wflux_struct *wf, pstate_struct *ps,
 #endif
 }
 
-double FrH2O (double tkelv, double smc, double sh2o, const soil_struct *soil)
+double FrH2O (double tkelv, double smc, double sh2o, const soil_struct *soil,
+    pstate_struct *ps)
 {
     /*
      * Function FrH2O
@@ -882,6 +1015,11 @@ double FrH2O (double tkelv, double smc, double sh2o, const soil_struct *soil)
      *
      * YS: In Flux-PIHM, van Genuchten parameters are used. See Technical
      * Documentation for details
+     *
+     * When soil lookup tables are used, a few safeguarded Newton iterations
+     * start from the equilibrium liquid water content interpolated from the
+     * inverse table of the soil type. The iterations below are only used if
+     * they do not converge.
      */
     double          denom;
     double          df;
@@ -896,6 +1034,23 @@ double FrH2O (double tkelv, double smc, double sh2o, const soil_struct *soil)
     double          mx;
     double          freew;
 
+    if (soil->vgtbl != NULL && tkelv <= TFREEZ - 1.0e-3)
+    {
+        double          lnsc;
+
+        lnsc = log (-(tkelv - TFREEZ) / tkelv);
+        freew = FrzTblValue (soil->vgtbl, lnsc, smc, soil->smcmin,
+            soil->smcmax);
+
+        ps->nfrz++;
+        if (FrH2ONewton (lnsc, smc, soil->smcmin, soil->smcmax, soil->alpha,
+            soil->beta, FRZ_NITER, &freew))
+        {
+            return (freew);
+        }
+        ps->nfrz_fallback++;
+    }
+
     nlog = 0;
     kcount = 0;
 
@@ -978,6 +1133,107 @@ double FrH2O (double tkelv, double smc, double sh2o, const soil_struct *soil)
     return (freew);
 }
 
+int FrH2ONewton (double lnsc, double smc, double smcmin, double smcmax,
+    double alpha, double beta, int niter, double *freew)
+{
+    /*
+     * Function FrH2ONewton
+     *
+     * Solve Eqn 17 of Koren et al (1999) for the liquid water content, with
+     * Newton iterations starting from freew. The residual decreases
+     * monotonically with liquid water content, so Newton steps leaving the
+     * bracket of the solution are replaced by bisection, and iterations
+     * converge from any initial guess. lnsc is the log of supercooling,
+     * log ((t0 - tkelv) / tkelv). Returns 1 if converged within niter
+     * iterations.
+     */
+    double          lo, hi;
+    double          wmin;
+    double          mx;
+    double          c0;
+    double          w;
+    int             n;
+    const double    CK = 8.0;
+
+    /* Same bounds as the frozen content bounds of FrH2O */
+    wmin = (smcmin > 0.02) ? smcmin : 0.02;
+    lo = wmin;
+    hi = smc;
+
+    if (hi <= lo)
+    {
+        *freew = smc;
+        return (1);
+    }
+
+    mx = beta / (1.0 - beta);
+    c0 = log (GRAV / alpha / LSUBF) - lnsc;
+
+    /* The residual is infinite at zero saturation ratio */
+    w = *freew;
+    w = (w > hi) ? hi : w;
+    w = (w <= lo) ? ((lo == smcmin) ? 0.5 * (lo + hi) : lo) : w;
+
+    for (n = 0; n < niter; n++)
+    {
+        double          satn;
+        double          swl;
+        double          pw;
+        double          f, df;
+        double          wk;
+
+        satn = (w - smcmin) / (smcmax - smcmin);
+        swl = smc - w;
+        pw = pow (satn, mx);
+
+        f = c0 + log (pw - 1.0) / beta + 2.0 * log (1.0 + CK * swl);
+        df = pw / satn / (pw - 1.0) / (1.0 - beta) / (smcmax - smcmin) -
+            2.0 * CK / (1.0 + CK * swl);
+
+        if (f > 0.0)
+        {
+            lo = w;
+        }
+        else
+        {
+            hi = w;
+        }
+
+        wk = w - f / df;
+        /* Steps beyond the bounds try the bounds first, which are the
+         * solution when the soil is not frozen, or when liquid water reaches
+         * its lower bound. Other steps leaving the bracket are replaced by
+         * bisection. Negated comparison also catches NaN at saturation */
+        if (!(wk > lo && wk < hi))
+        {
+            if (wk >= hi && hi == smc && w != smc)
+            {
+                wk = smc;
+            }
+            else if (wk <= lo && lo == wmin && w != wmin && wmin > smcmin)
+            {
+                wk = wmin;
+            }
+            else
+            {
+                wk = 0.5 * (lo + hi);
+            }
+        }
+
+        if (fabs (wk - w) <= FRZ_TOL)
+        {
+            *freew = wk;
+            return (1);
+        }
+
+        w = wk;
+    }
+
+    *freew = w;
+
+    return (0);
+}
+
 void HRT (wstate_struct *ws, estate_struct *es, eflux_struct *ef,
     pstate_struct *ps, const lc_struct *lc, const soil_struct *soil,
     double *rhsts, double yy, double zz1, double dt,
@@ -1074,8 +1330,8 @@ void HRT (wstate_struct *ws, estate_struct *es, eflux_struct *ef,
             (tsurf < TFREEZ) || (tbk < TFREEZ))
         {
             tavg = TmpAvg (tsurf, es->stc[0], tbk, ps->zsoil, 0);
-            SnkSrc (&tsnsr, tavg, ws->smc[0], &ws->sh2o[0], soil, ps->zsoil,
-                dt, 0, qtot);
+            SnkSrc (&tsnsr, tavg, ws->smc[0], &ws->sh2o[0], soil, ps, dt, 0,
+                qtot);
             rhsts[0] -= tsnsr / denom;
         }
     }
@@ -1084,7 +1340,7 @@ void HRT (wstate_struct *ws, estate_struct *es, eflux_struct *ef,
         if ((sice > 0.0) || (es->stc[0] < TFREEZ))
         {
             SnkSrc (&tsnsr, es->stc[0], ws->smc[0], &ws->sh2o[0], soil,
-                ps->zsoil, dt, 0, qtot);
+                ps, dt, 0, qtot);
             rhsts[0] -= tsnsr / denom;
         }
         /* This ends section for top soil layer. */
@@ -1177,7 +1433,7 @@ void HRT (wstate_struct *ws, estate_struct *es, eflux_struct *ef,
                 (tbk < TFREEZ) || (tbk1 < TFREEZ))
             {
                 SnkSrc (&tsnsr, tavg, ws->smc[k], &ws->sh2o[k], soil,
-                    ps->zsoil, dt, k, qtot);
+                    ps, dt, k, qtot);
                 rhsts[k] = rhsts[k] - tsnsr / denom;
             }
         }
@@ -1186,7 +1442,7 @@ void HRT (wstate_struct *ws, estate_struct *es, eflux_struct *ef,
             if ((sice > 0.0) || (es->stc[k] < TFREEZ))
             {
                 SnkSrc (&tsnsr, es->stc[k], ws->smc[k], &ws->sh2o[k], soil,
-                    ps->zsoil, dt, k, qtot);
+                    ps, dt, k, qtot);
                 rhsts[k] = rhsts[k] - tsnsr / denom;
             }
         }
@@ -1204,45 +1460,26 @@ void HRT (wstate_struct *ws, estate_struct *es, eflux_struct *ef,
     }
 }
 
-void HStep (estate_struct *es, double *rhsts, double dt, int nsoil,
-    double *ai, double *bi, double *ci)
+void HStep (double *rhsts, double dt, int nsoil, double *ai, double *bi,
+    double *ci, lsmblk_struct *blk, int lane)
 {
     /*
      * Subroutine HStep
      *
-     * Calculate/update the soil temperature field.
+     * Create the soil temperature equation in the lane of the block.
      */
     int             k;
-    double          rhstsin[MAXLYR];
-    double          ciin[MAXLYR];
 
     /* Create finite difference values for use in Rosr12 routine */
     for (k = 0; k < nsoil; k++)
     {
-        rhsts[k] *= dt;
-        ai[k] *= dt;
-        bi[k] = 1.0 + bi[k] * dt;
-        ci[k] *= dt;
+        blk->d[k][lane] = rhsts[k] * dt;
+        blk->a[k][lane] = ai[k] * dt;
+        blk->b[k][lane] = 1.0 + bi[k] * dt;
+        blk->c[k][lane] = ci[k] * dt;
     }
 
-    /* Copy values for input variables before call to Rosr12 */
-    for (k = 0; k < nsoil; k++)
-    {
-        rhstsin[k] = rhsts[k];
-    }
-    for (k = 0; k < nsoil; k++)
-    {
-        ciin[k] = ci[k];
-    }
-
-    /* Solve the tri-diagonal matrix equation */
-    Rosr12 (ci, ai, bi, ciin, rhstsin, rhsts, nsoil);
-
-    /* Calc/update the soil temps using matrix solution */
-    for (k = 0; k < nsoil; k++)
-    {
-        es->stc[k] += ci[k];
-    }
+    blk->nsoil[lane] = nsoil;
 }
 
 void NoPac (wstate_struct *ws, wflux_struct *wf, estate_struct *es,
@@ -1250,7 +1487,7 @@ void NoPac (wstate_struct *ws, wflux_struct *wf, estate_struct *es,
 #ifdef _CYCLES_
     comm_struct *comm, residue_struct *residue,
 #endif
-    double dt, double t24)
+    double dt, double t24, lsmblk_struct *blk, int lane)
 {
     /*
      * Function NoPac
@@ -1345,12 +1582,12 @@ void NoPac (wstate_struct *ws, wflux_struct *wf, estate_struct *es,
 
     zz1 = df1 / (-0.5 * ps->zsoil[0] * ps->rch * ps->rr) + 1.0;
 
-    ShFlx (ws, es, ef, ps, lc, soil, dt, yy, zz1, df1);
+    ShFlx (ws, es, ef, ps, lc, soil, dt, yy, zz1, df1, blk, lane);
 
     /* Set flx1 and flx3 (snopack phase change heat fluxes) to zero since
      * they are not used here in SnoPac. flx2 (freezing rain heat flux) was
-     * similarly initialized in the Penman routine. */
-    ef->flx1 = CPH2O * wf->prcp * 1000.0 * (es->t1 - es->sfctmp);
+     * similarly initialized in the Penman routine. flx1 depends on the
+     * updated skin temperature, and is calculated in SFlxEnd */
     ef->flx3 = 0.0;
 }
 
@@ -1472,8 +1709,7 @@ void Penman (wflux_struct *wf, estate_struct *es, eflux_struct *ef,
     wf->etp = ps->epsca * ps->rch / lvs / 1000.0;
 }
 
-void Rosr12 (double *p, double *a, double *b, double *c, double *d,
-    double *delta, int nsoil)
+void Rosr12 (lsmblk_struct *blk)
 {
     /*
      * Function Rosr12
@@ -1492,39 +1728,85 @@ void Rosr12 (double *p, double *a, double *b, double *c, double *d,
      * # 0  , . . . , 0 ,   0   , a[m-1], b[m-1], c[m-1]# #p(m-1)#   #d[m-1]#
      * # 0  , . . . , 0 ,   0   ,   0   ,  a(m) ,  b[m] # # p(m) #   # d[m] #
      * ###                                            ### ###  ###   ###  ###
+     *
+     * for all lanes of the block. Each soil layer is solved for all lanes at
+     * once. Layers below the lowest soil layer of a lane are identity
+     * equations, which do not change the solution of the lane.
      */
-
     int             k, kk;
+    int             l;
+    int             nsoil = 0;
+
+    for (l = 0; l < NOAH_BLOCK; l++)
+    {
+        nsoil = (blk->nsoil[l] > nsoil) ? blk->nsoil[l] : nsoil;
+    }
+
+    if (nsoil == 0)
+    {
+        return;
+    }
 
-    /* Initialize eqn coef c for the lowest soil layer */
-    c[nsoil - 1] = 0.0;
-    p[0] = -c[0] / b[0];
+    for (l = 0; l < NOAH_BLOCK; l++)
+    {
+        /* Initialize eqn coef c for the lowest soil layer */
+        if (blk->nsoil[l] > 0)
+        {
+            blk->c[blk->nsoil[l] - 1][l] = 0.0;
+        }
+
+        for (k = blk->nsoil[l]; k < nsoil; k++)
+        {
+            blk->a[k][l] = 0.0;
+            blk->b[k][l] = 1.0;
+            blk->c[k][l] = 0.0;
+            blk->d[k][l] = 0.0;
+        }
+    }
 
     /* Solve the coefs for the 1st soil layer */
-    delta[0] = d[0] / b[0];
+    for (l = 0; l < NOAH_BLOCK; l++)
+    {
+        blk->p[0][l] = -blk->c[0][l] / blk->b[0][l];
+        blk->delta[0][l] = blk->d[0][l] / blk->b[0][l];
+    }
 
     /* Solve the coefs for soil layers 2 thru nsoil */
     for (k = 1; k < nsoil; k++)
     {
-        p[k] = -c[k] * (1.0 / (b[k] + a[k] * p[k - 1]));
-        delta[k] =
-            (d[k] - a[k] * delta[k - 1]) * (1.0 / (b[k] + a[k] * p[k - 1]));
+        for (l = 0; l < NOAH_BLOCK; l++)
+        {
+            double          rdenom;
+
+            rdenom = 1.0 / (blk->b[k][l] + blk->a[k][l] * blk->p[k - 1][l]);
+            blk->p[k][l] = -blk->c[k][l] * rdenom;
+            blk->delta[k][l] =
+                (blk->d[k][l] - blk->a[k][l] * blk->delta[k - 1][l]) * rdenom;
+        }
     }
 
     /* Set p to delta for lowest soil layer */
-    p[nsoil - 1] = delta[nsoil - 1];
+    for (l = 0; l < NOAH_BLOCK; l++)
+    {
+        blk->p[nsoil - 1][l] = blk->delta[nsoil - 1][l];
+    }
 
     /* Adjust p for soil layers 2 thru nsoil */
     for (k = 1; k < nsoil; k++)
     {
         kk = nsoil - k - 1;
-        p[kk] = p[kk] * p[kk + 1] + delta[kk];
+        for (l = 0; l < NOAH_BLOCK; l++)
+        {
+            blk->p[kk][l] = blk->p[kk][l] * blk->p[kk + 1][l] +
+                blk->delta[kk][l];
+        }
     }
 }
 
 void ShFlx (wstate_struct *ws, estate_struct *es, eflux_struct *ef,
     pstate_struct *ps, const lc_struct *lc, const soil_struct *soil,
-    double dt, double yy, double zz1, double df1)
+    double dt, double yy, double zz1, double df1, lsmblk_struct *blk,
+    int lane)
 {
     /*
      * Function ShFlx
@@ -1532,6 +1814,10 @@ void ShFlx (wstate_struct *ws, estate_struct *es, eflux_struct *ef,
      * Update the temperature state of the soil column based on the thermal
      * diffusion equation and update the frozen soil moisture content based
      * on the temperature.
+     *
+     * The soil temperature equation is stored in the lane of the block.
+     * Soil temperatures are updated in SFlxEnd after the equations of the
+     * block are solved.
      */
     double          ai[MAXLYR], bi[MAXLYR], ci[MAXLYR];
     double          rhsts[MAXLYR];
@@ -1541,17 +1827,13 @@ void ShFlx (wstate_struct *ws, estate_struct *es, eflux_struct *ef,
     HRT (ws, es, ef, ps, lc, soil, rhsts, yy, zz1, dt, df1, ai, bi,
         ci);
 
-    HStep (es, rhsts, dt, ps->nsoil, ai, bi, ci);
-
-    /* In the no snowpack case (via routine NoPac branch,) update the grnd
-     * (skin) temperature here in response to the updated soil temperature
-     * profile above.  (note: inspection of routine SnoPac shows that t1
-     * below is a dummy variable only, as skin temperature is updated
-     * differently in routine SnoPac) */
-    es->t1 = (yy + (zz1 - 1.0) * es->stc[0]) / zz1;
+    HStep (rhsts, dt, ps->nsoil, ai, bi, ci, blk, lane);
 
-    /* Calculate surface soil heat flux */
-    ef->ssoil = df1 * (es->stc[0] - es->t1) / (0.5 * ps->zsoil[0]);
+    /* Terms to update the grnd (skin) temperature and surface soil heat flux
+     * in response to the updated soil temperature profile */
+    blk->yy[lane] = yy;
+    blk->zz1[lane] = zz1;
+    blk->df1[lane] = df1;
 }
 
 
@@ -1560,7 +1842,7 @@ void SmFlx (wstate_struct *ws, wflux_struct *wf, pstate_struct *ps,
 #ifdef _CYCLES_
     residue_struct *residue,
 #endif
-    double dt)
+    double dt, lsmblk_struct *blk, int lane)
 {
     /*
      * Function SmFlx
@@ -1570,6 +1852,10 @@ void SmFlx (wstate_struct *ws, wflux_struct *wf, pstate_struct *ps,
      * prognostic eqns.
      * Frozen ground version: new states added: sh2o, and frozen ground
      * correction factor, frzfact and parameter slope.
+     *
+     * The soil moisture equation is stored in the lane of the block. Soil
+     * moisture is updated in SStepEnd after the equations of the block are
+     * solved.
      */
     int             i;
     double          ai[MAXLYR], bi[MAXLYR], ci[MAXLYR];
@@ -1610,7 +1896,7 @@ void SmFlx (wstate_struct *ws, wflux_struct *wf, pstate_struct *ps,
             residue, dt,
 #endif
             rhstt, sice, ai, bi, ci);
-        SStep (ws, wf, ps, soil, rhstt, sice, ai, bi, ci, dt);
+        SStep (wf, ps, rhstt, ai, bi, ci, dt, blk, lane);
     }
 }
 
@@ -1648,7 +1934,7 @@ double SnFrac (double sneqv, double snup, double salp, double snowh)
 }
 
 void SnkSrc (double *tsnsr, double tavg, double smc, double *sh2o,
-    const soil_struct *soil, const double *zsoil, double dt, int k,
+    const soil_struct *soil, pstate_struct *ps, double dt, int k,
     double qtot)
 {
     /*
@@ -1665,11 +1951,11 @@ void SnkSrc (double *tsnsr, double tavg, double smc, double *sh2o,
 
     if (0 == k)
     {
-        dz = -zsoil[0];
+        dz = -ps->zsoil[0];
     }
     else
     {
-        dz = zsoil[k - 1] - zsoil[k];
+        dz = ps->zsoil[k - 1] - ps->zsoil[k];
     }
 
     /* Via function FrH2O, compute potential or 'equilibrium' unfrozen
@@ -1677,7 +1963,7 @@ void SnkSrc (double *tsnsr, double tavg, double smc, double *sh2o,
      * Function FrH2O invokes Eqn (17) from V. Koren et al (1999, JGR, Vol.
      * 104, Pg 19573). (Aside: latter eqn in journal in centigrade units.
      * routine FrH2O use form of eqn in kelvin units.) */
-    freew = FrH2O (tavg, smc, *sh2o, soil);
+    freew = FrH2O (tavg, smc, *sh2o, soil, ps);
 
     /* In next block of code, invoke Eqn 18 of V. Koren et al (1999, JGR,
      * Vol. 104, Pg 19573.) that is, first estimate the new amountof liquid
@@ -1719,7 +2005,8 @@ void SnoPac (wstate_struct *ws, wflux_struct *wf, estate_struct *es,
 #ifdef _CYCLES_
     comm_struct *comm, residue_struct *residue,
 #endif
-    int snowng, double dt, double t24, double prcpf, double df1)
+    int snowng, double dt, double t24, double prcpf, double df1,
+    lsmblk_struct *blk, int lane)
 {
     /*
      * Function SnoPac
@@ -1972,7 +2259,7 @@ void SnoPac (wstate_struct *ws, wflux_struct *wf, estate_struct *es,
      * used  in any subsequent calculations. Rather, they are dummy variables
      * here in the SnoPac case, since the skin temp and sub-sfc heat flux are
      * updated instead near the beginning of the call to SnoPac. */
-    ShFlx (ws, es, ef, ps, lc, soil, dt, yy, zz1, df1);
+    ShFlx (ws, es, ef, ps, lc, soil, dt, yy, zz1, df1, blk, lane);
 
     es->t1 = t11;
     ef->ssoil = ssoil1;
@@ -2333,48 +2620,55 @@ void SRT (wstate_struct *ws, wflux_struct *wf, pstate_struct *ps,
     }
 }
 
-void SStep (wstate_struct *ws, wflux_struct *wf, pstate_struct *ps,
-    const soil_struct *soil, double *rhstt, double *sice, double *ai,
-    double *bi, double *ci, double dt)
+void SStep (wflux_struct *wf, const pstate_struct *ps, const double *rhstt,
+    const double *ai, const double *bi, const double *ci, double dt,
+    lsmblk_struct *blk, int lane)
 {
     /*
      * Function SStep
      *
-     * Calculate/update soil moisture content values and canopy moisture
-     * content values.
+     * Create the soil moisture equation in the lane of the block.
      */
     int             k;
-    double          rhsttin[MAXLYR];
-    double          ciin[MAXLYR];
-    double          sh2o0[MAXLYR];
-    double          sh2omid[MAXLYR];
-    double          ddz;
-    double          stot;
-    double          wplus;
-    double          stotmin;
 
     /* Create 'amount' values of variables to be input to the tri-diagonal
      * matrix routine. */
     for (k = 0; k < ps->nsoil; k++)
     {
-        rhstt[k] *= dt;
-        ai[k] *= dt;
-        bi[k] = 1.0 + bi[k] * dt;
-        ci[k] *= dt;
-        sh2o0[k] = ws->sh2o[k];
+        blk->d[k][lane] = rhstt[k] * dt;
+        blk->a[k][lane] = ai[k] * dt;
+        blk->b[k][lane] = 1.0 + bi[k] * dt;
+        blk->c[k][lane] = ci[k] * dt;
         wf->smflxv[k] = 0.0;
     }
 
-    /* Copy values for input variables before call to Rosr12 */
+    blk->nsoil[lane] = ps->nsoil;
+}
+
+void SStepEnd (wstate_struct *ws, wflux_struct *wf, const pstate_struct *ps,
+    const soil_struct *soil, const lsmblk_struct *blk, int lane, double dt)
+{
+    /*
+     * Function SStepEnd
+     *
+     * Calculate/update soil moisture content values using the solution of
+     * the soil moisture equation.
+     */
+    int             k;
+    double          sice[MAXLYR];
+    double          sh2o0[MAXLYR];
+    double          sh2omid[MAXLYR];
+    double          ddz;
+    double          stot;
+    double          wplus;
+    double          stotmin;
+
     for (k = 0; k < ps->nsoil; k++)
     {
-        rhsttin[k] = rhstt[k];
-        ciin[k] = ci[k];
+        sice[k] = ws->smc[k] - ws->sh2o[k];
+        sh2o0[k] = ws->sh2o[k];
     }
 
-    /* Call Rosr12 to solve the tri-diagonal matrix */
-    Rosr12 (ci, ai, bi, ciin, rhsttin, rhstt, ps->nsoil);
-
     /* Runoff3: runoff within soil layers */
     wplus = 0.0;
     wf->runoff3 = 0.0;
@@ -2397,7 +2691,7 @@ void SStep (wstate_struct *ws, wflux_struct *wf, pstate_struct *ps,
             ddz = -ps->zsoil[0];
         }
 
-        sh2omid[k] = ws->sh2o[k] + ci[k] + wplus / ddz;
+        sh2omid[k] = ws->sh2o[k] + blk->p[k][lane] + wplus / ddz;
         stot = sh2omid[k] + sice[k];
 
         if (stot > soil->smcmax)
@@ -2808,7 +3102,6 @@ void WDfCnd (double *wdf, double *wcnd, double smc, double sicemax,
      * Calculate soil water diffusivity and soil hydraulic conductivity.
      * Flux-PIHM: using van Genuchten parameters
      */
-    double          expon;
     double          factr1;
     double          factr2;
     double          vkwgt;
@@ -2824,13 +3117,9 @@ void WDfCnd (double *wdf, double *wcnd, double smc, double sicemax,
     factr2 = (factr2 < 0.0 + 5.0e-4) ? 5.0e-4 : factr2;
 
     factr1 = (factr1 < factr2) ? factr1 : factr2;
-    expon = 1.0 - 1.0 / soil->beta;
 
-    satkfunc = KrFunc (soil->alpha, soil->beta, factr2);
-    dpsidsm =
-        (1.0 - expon) / soil->alpha / expon / (soil->smcmax - soil->smcmin) *
-        pow (pow (factr2, -1.0 / expon) - 1.0, -expon) *
-        pow (factr2, -(1.0 / expon + 1.0));
+    satkfunc = KrFuncSoil (soil, factr2);
+    dpsidsm = DPsiDSmc (soil, factr2);
 
     if (macpore && ps->macpore_status > MTX_CTRL)
     {
@@ -2848,12 +3137,8 @@ void WDfCnd (double *wdf, double *wcnd, double smc, double sicemax,
     if (sicemax > 0.0)
     {
         vkwgt = 1.0 / (1.0 + pow (500.0 * sicemax, 3.0));
-        satkfunc = KrFunc (soil->alpha, soil->beta, factr1);
-        dpsidsm =
-            (1.0 - expon) / soil->alpha / expon
-            / (soil->smcmax - soil->smcmin) *
-            pow (pow (factr1, -1.0 / expon) - 1.0, -expon) *
-            pow (factr1, -(1.0 / expon + 1.0));
+        satkfunc = KrFuncSoil (soil, factr1);
+        dpsidsm = DPsiDSmc (soil, factr1);
         if (macpore == 1 && ps->macpore_status > MTX_CTRL)
         {
             *wdf =
@@ -0,0 +1,618 @@
+#include "pihm.h"
+
+void InitSolar (forc_struct *forc, const atttbl_struct *atttbl,
+    const siteinfo_struct *siteinfo, const ctrl_struct *ctrl)
+{
+    int             i, k;
+    int             step;
+    solgeo_struct  *solgeo;
+
+    solgeo = &forc->solgeo;
+
+    /* Solar positions of elements at the current forcing step, which are
+     * used by topographic radiation. Ensemble members are advanced in
+     * parallel, so each member has its own */
+    if (ctrl->rad_mode > 0)
+    {
+        solgeo->zenith = (double *)malloc (nelem * sizeof (double));
+        solgeo->azimuth = (double *)malloc (nelem * sizeof (double));
+    }
+    else
+    {
+        solgeo->zenith = NULL;
+        solgeo->azimuth = NULL;
+    }
+
+    /* Tables and element geometry are shared by ensemble members */
+    if (forc->shared)
+    {
+        return;
+    }
+
+    solgeo->anchor = (int *)malloc (nelem * sizeof (int));
+    solgeo->sinlat = (double *)malloc (nelem * sizeof (double));
+    solgeo->coslat = (double *)malloc (nelem * sizeof (double));
+    solgeo->dlon = (double *)malloc (nelem * sizeof (double));
+
+    if (NULL == atttbl->lat)
+    {
+        /* All elements use solar positions at the domain latitude and
+         * longitude */
+        forc->nsol = 1;
+        forc->sol = (soltbl_struct *)malloc (sizeof (soltbl_struct));
+        forc->sol[0].latitude = siteinfo->latitude;
+        forc->sol[0].longitude = siteinfo->longitude;
+
+        for (i = 0; i < nelem; i++)
+        {
+            solgeo->anchor[i] = 0;
+            solgeo->sinlat[i] = sin (siteinfo->latitude * PI / 180.0);
+            solgeo->coslat[i] = cos (siteinfo->latitude * PI / 180.0);
+            solgeo->dlon[i] = 0.0;
+        }
+
+        solgeo->corr = 0;
+    }
+    else
+    {
+        InitAnchor (forc, atttbl, ctrl->anchor_res);
+
+        solgeo->corr = 1;
+    }
+
+    /* Nodes are at land surface steps if possible, so that solar positions
+     * at land surface steps are not interpolated */
+    step = (ctrl->lsm_step_min >= SOLTBL_MINSTEP &&
+        DAYINSEC % ctrl->lsm_step_min == 0) ?
+        ctrl->lsm_step_min : SOLTBL_MINSTEP;
+
+    for (k = 0; k < forc->nsol; k++)
+    {
+        forc->sol[k].elevation = siteinfo->elevation;
+        forc->sol[k].tavg = siteinfo->tavg;
+        forc->sol[k].step = step;
+        forc->sol[k].t0 = 0;
+        forc->sol[k].nday = 0;
+        forc->sol[k].nnode = 0;
+    }
+
+    /* Solar positions are only used by topographic radiation and daylength
+     * calculation. Without a table, they are calculated when needed */
+#if !defined(_BGC_)
+    if (ctrl->rad_mode == 0)
+    {
+        return;
+    }
+#endif
+
+    PIHMprintf (VL_VERBOSE, " Building %d solar position table(s).\n",
+        forc->nsol);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (k = 0; k < forc->nsol; k++)
+    {
+        InitSolTbl (&forc->sol[k], ctrl->starttime, ctrl->endtime);
+    }
+
+    if (ctrl->sol_validate)
+    {
+        ValidateSolar (forc, atttbl, siteinfo);
+    }
+}
+
+void InitAnchor (forc_struct *forc, const atttbl_struct *atttbl, double res)
+{
+    int             i, k;
+    int             nsol = 0;
+    int            *cellx, *celly;
+    int            *count;
+    int            *nearest;
+    double         *clat, *clon;
+    double         *dist;
+    double          latmin, lonmin;
+    solgeo_struct  *solgeo;
+
+    solgeo = &forc->solgeo;
+
+    latmin = atttbl->lat[0];
+    lonmin = atttbl->lon[0];
+    for (i = 1; i < nelem; i++)
+    {
+        latmin = (atttbl->lat[i] < latmin) ? atttbl->lat[i] : latmin;
+        lonmin = (atttbl->lon[i] < lonmin) ? atttbl->lon[i] : lonmin;
+    }
+
+    cellx = (int *)malloc (nelem * sizeof (int));
+    celly = (int *)malloc (nelem * sizeof (int));
+    count = (int *)calloc (nelem, sizeof (int));
+    nearest = (int *)malloc (nelem * sizeof (int));
+    clat = (double *)calloc (nelem, sizeof (double));
+    clon = (double *)calloc (nelem, sizeof (double));
+    dist = (double *)malloc (nelem * sizeof (double));
+
+    /* Elements are grouped into cells of res by res degrees. Each cell with
+     * elements has one anchor */
+    for (i = 0; i < nelem; i++)
+    {
+        int             ix, iy;
+
+        ix = (int)floor ((atttbl->lon[i] - lonmin) / res);
+        iy = (int)floor ((atttbl->lat[i] - latmin) / res);
+
+        for (k = 0; k < nsol; k++)
+        {
+            if (cellx[k] == ix && celly[k] == iy)
+            {
+                break;
+            }
+        }
+
+        if (k == nsol)
+        {
+            cellx[k] = ix;
+            celly[k] = iy;
+            nsol++;
+        }
+
+        solgeo->anchor[i] = k;
+        clat[k] += atttbl->lat[i];
+        clon[k] += atttbl->lon[i];
+        count[k]++;
+    }
+
+    /* The anchor of a cell is the element closest to the center of the
+     * elements in the cell, so that solar positions of elements at the
+     * anchor are not corrected */
+    for (k = 0; k < nsol; k++)
+    {
+        clat[k] /= (double)count[k];
+        clon[k] /= (double)count[k];
+        dist[k] = BADVAL;
+        nearest[k] = -1;
+    }
+
+    for (i = 0; i < nelem; i++)
+    {
+        double          d;
+
+        k = solgeo->anchor[i];
+
+        d = (atttbl->lat[i] - clat[k]) * (atttbl->lat[i] - clat[k]) +
+            (atttbl->lon[i] - clon[k]) * (atttbl->lon[i] - clon[k]);
+
+        if (nearest[k] < 0 || d < dist[k])
+        {
+            dist[k] = d;
+            nearest[k] = i;
+        }
+    }
+
+    forc->nsol = nsol;
+    forc->sol = (soltbl_struct *)malloc (nsol * sizeof (soltbl_struct));
+
+    for (k = 0; k < nsol; k++)
+    {
+        forc->sol[k].latitude = atttbl->lat[nearest[k]];
+        forc->sol[k].longitude = atttbl->lon[nearest[k]];
+    }
+
+    for (i = 0; i < nelem; i++)
+    {
+        solgeo->sinlat[i] = sin (atttbl->lat[i] * PI / 180.0);
+        solgeo->coslat[i] = cos (atttbl->lat[i] * PI / 180.0);
+        solgeo->dlon[i] = atttbl->lon[i] -
+            forc->sol[solgeo->anchor[i]].longitude;
+    }
+
+    PIHMprintf (VL_VERBOSE, " %d solar position anchor(s) at %.3f degree "
+        "resolution.\n", nsol, res);
+
+    free (cellx);
+    free (celly);
+    free (count);
+    free (nearest);
+    free (clat);
+    free (clon);
+    free (dist);
+}
+
+void InitSolTbl (soltbl_struct *sol, int starttime, int endtime)
+{
+    int             j;
+    int             step;
+    spa_data        spa;
+
+    step = sol->step;
+
+    /* The table starts at 00:00 UTC of the day before model start time, as
+     * daylengths of previous days are used by BGC */
+    sol->t0 = starttime - DAYINSEC;
+    sol->t0 -= sol->t0 % DAYINSEC;
+    sol->nday = (endtime - sol->t0) / DAYINSEC + 1;
+    sol->nnode = sol->nday * (DAYINSEC / step) + 1;
+
+    sol->zenith = (double *)malloc (sol->nnode * sizeof (double));
+    sol->azimuth = (double *)malloc (sol->nnode * sizeof (double));
+    sol->ha = (double *)malloc (sol->nnode * sizeof (double));
+    sol->decl = (double *)malloc (sol->nnode * sizeof (double));
+    sol->sunrise = (double *)malloc (sol->nday * sizeof (double));
+    sol->sunset = (double *)malloc (sol->nday * sizeof (double));
+    sol->decl_day = (double *)malloc (sol->nday * sizeof (double));
+
+    for (j = 0; j < sol->nday; j++)
+    {
+        SunPos (sol->t0 + j * DAYINSEC, sol->latitude, sol->longitude,
+            sol->elevation, sol->tavg, SPA_ZA_RTS, &spa);
+
+        sol->sunrise[j] = spa.sunrise;
+        sol->sunset[j] = spa.sunset;
+        sol->decl_day[j] = spa.delta;
+    }
+
+    for (j = 0; j < sol->nnode; j++)
+    {
+        SunPos (sol->t0 + j * step, sol->latitude, sol->longitude,
+            sol->elevation, sol->tavg, SPA_ZA, &spa);
+
+        sol->zenith[j] = spa.zenith;
+        sol->azimuth[j] = spa.azimuth180;
+        sol->ha[j] = spa.h;
+        sol->decl[j] = spa.delta;
+    }
+}
+
+void SolarPos (const soltbl_struct *sol, int t, double *zenith,
+    double *azimuth, double *ha, double *decl)
+{
+    int             j;
+    double          frac;
+
+    if (t < sol->t0 || t >= sol->t0 + (sol->nnode - 1) * sol->step)
+    {
+        spa_data        spa;
+
+        /* Outside of the table */
+        SunPos (t, sol->latitude, sol->longitude, sol->elevation, sol->tavg,
+            SPA_ZA, &spa);
+
+        *zenith = spa.zenith;
+        *azimuth = spa.azimuth180;
+        *ha = spa.h;
+        *decl = spa.delta;
+
+        return;
+    }
+
+    j = (t - sol->t0) / sol->step;
+
+    if ((t - sol->t0) % sol->step == 0)
+    {
+        *zenith = sol->zenith[j];
+        *azimuth = sol->azimuth[j];
+        *ha = sol->ha[j];
+        *decl = sol->decl[j];
+    }
+    else
+    {
+        double          dang;
+
+        frac = (double)((t - sol->t0) % sol->step) / (double)sol->step;
+
+        *zenith = (1.0 - frac) * sol->zenith[j] + frac * sol->zenith[j + 1];
+        *decl = (1.0 - frac) * sol->decl[j] + frac * sol->decl[j + 1];
+
+        /* Azimuth is interpolated along the shorter arc, as it jumps between
+         * -180 and 180 degrees when the sun passes north */
+        dang = WrapAngle (sol->azimuth[j + 1] - sol->azimuth[j]);
+        *azimuth = WrapAngle (sol->azimuth[j] + frac * dang);
+
+        /* Hour angle wraps at 360 degrees */
+        dang = WrapAngle (sol->ha[j + 1] - sol->ha[j]);
+        *ha = sol->ha[j] + frac * dang;
+    }
+}
+
+void ElemSolarPos (const forc_struct *forc, int t, double *zenith,
+    double *azimuth)
+{
+    int             i, k;
+    double         *za, *aa;
+    double         *zs, *as;
+    double         *ha, *sind, *cosd;
+    const solgeo_struct *solgeo;
+
+    solgeo = &forc->solgeo;
+
+    za = (double *)malloc (7 * forc->nsol * sizeof (double));
+    aa = za + forc->nsol;
+    zs = aa + forc->nsol;
+    as = zs + forc->nsol;
+    ha = as + forc->nsol;
+    sind = ha + forc->nsol;
+    cosd = sind + forc->nsol;
+
+    /* Exact solar positions at anchors */
+    for (k = 0; k < forc->nsol; k++)
+    {
+        double          decl;
+
+        SolarPos (&forc->sol[k], t, &za[k], &aa[k], &ha[k], &decl);
+
+        sind[k] = sin (decl * PI / 180.0);
+        cosd[k] = cos (decl * PI / 180.0);
+
+        LocalSunPos (sin (forc->sol[k].latitude * PI / 180.0),
+            cos (forc->sol[k].latitude * PI / 180.0), ha[k], sind[k], cosd[k],
+            &zs[k], &as[k]);
+    }
+
+    if (!solgeo->corr)
+    {
+        for (i = 0; i < nelem; i++)
+        {
+            zenith[i] = za[solgeo->anchor[i]];
+            azimuth[i] = aa[solgeo->anchor[i]];
+        }
+    }
+    else
+    {
+        /* Solar positions of elements are corrected from anchor solar
+         * positions using differences in the low-cost solar model, which
+         * accounts for local hour angles and latitudes. Refraction and
+         * parallax are taken from the anchor */
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (i = 0; i < nelem; i++)
+        {
+            int             ka;
+            double          zl, al;
+
+            ka = solgeo->anchor[i];
+
+            LocalSunPos (solgeo->sinlat[i], solgeo->coslat[i],
+                ha[ka] + solgeo->dlon[i], sind[ka], cosd[ka], &zl, &al);
+
+            zenith[i] = za[ka] + (zl - zs[ka]);
+            azimuth[i] = WrapAngle (aa[ka] + WrapAngle (al - as[ka]));
+        }
+    }
+
+    free (za);
+}
+
+void LocalSunPos (double sinlat, double coslat, double ha, double sind,
+    double cosd, double *zenith, double *azimuth)
+{
+    double          cosz;
+    double          h;
+
+    h = ha * PI / 180.0;
+
+    cosz = sinlat * sind + coslat * cosd * cos (h);
+    cosz = (cosz > 1.0) ? 1.0 : cosz;
+    cosz = (cosz < -1.0) ? -1.0 : cosz;
+
+    *zenith = acos (cosz) * 180.0 / PI;
+    *azimuth = atan2 (sin (h), cos (h) * sinlat - sind / cosd * coslat) *
+        180.0 / PI;
+}
+
+double LocalDayLength (double sinlat, double coslat, double sind, double cosd)
+{
+    double          cosh0;
+
+    /* Hour angle of sunrise and sunset, when the sun's center is 0.8333
+     * degree below the horizon */
+    cosh0 = (sin (-0.8333 * PI / 180.0) - sinlat * sind) / (coslat * cosd);
+    cosh0 = (cosh0 > 1.0) ? 1.0 : cosh0;
+    cosh0 = (cosh0 < -1.0) ? -1.0 : cosh0;
+
+    return (acos (cosh0) / PI * (double)DAYINSEC);
+}
+
+double WrapAngle (double angle)
+{
+    angle = (angle > 180.0) ? angle - 360.0 : angle;
+    angle = (angle < -180.0) ? angle + 360.0 : angle;
+
+    return (angle);
+}
+
+double DayLength (const forc_struct *forc, int i, int t)
+{
+    double          sunrise, sunset;
+    double          decl;
+    double          dayl;
+    const soltbl_struct *sol;
+
+    sol = &forc->sol[forc->solgeo.anchor[i]];
+
+    if (t < sol->t0 || t >= sol->t0 + sol->nday * DAYINSEC)
+    {
+        spa_data        spa;
+
+        /* Outside of the table */
+        SunPos (t, sol->latitude, sol->longitude, sol->elevation, sol->tavg,
+            SPA_ZA_RTS, &spa);
+
+        sunrise = spa.sunrise;
+        sunset = spa.sunset;
+        decl = spa.delta;
+    }
+    else
+    {
+        sunrise = sol->sunrise[(t - sol->t0) / DAYINSEC];
+        sunset = sol->sunset[(t - sol->t0) / DAYINSEC];
+        decl = sol->decl_day[(t - sol->t0) / DAYINSEC];
+    }
+
+    dayl = (sunset - sunrise) * 3600.0;
+    dayl = (dayl < 0.0) ? dayl + 24.0 * 3600.0 : dayl;
+
+    if (forc->solgeo.corr)
+    {
+        double          sind, cosd;
+
+        sind = sin (decl * PI / 180.0);
+        cosd = cos (decl * PI / 180.0);
+
+        dayl += LocalDayLength (forc->solgeo.sinlat[i],
+            forc->solgeo.coslat[i], sind, cosd) -
+            LocalDayLength (sin (sol->latitude * PI / 180.0),
+            cos (sol->latitude * PI / 180.0), sind, cosd);
+
+        dayl = (dayl < 0.0) ? 0.0 : dayl;
+        dayl = (dayl > (double)DAYINSEC) ? (double)DAYINSEC : dayl;
+    }
+
+    return (dayl);
+}
+
+void ValidateSolar (const forc_struct *forc, const atttbl_struct *atttbl,
+    const siteinfo_struct *siteinfo)
+{
+    int             i, j, m;
+    int             nsample = 0;
+    int             imax = 0;
+    double         *zenith, *azimuth;
+    double         *zerr, *aerr, *derr, *sqerr;
+    int            *count;
+    double          zmax = 0.0, amax = 0.0, dmax = 0.0;
+    double          sqsum = 0.0;
+    int             ntot = 0;
+    const soltbl_struct *sol;
+
+    sol = &forc->sol[0];
+
+    zenith = (double *)malloc (nelem * sizeof (double));
+    azimuth = (double *)malloc (nelem * sizeof (double));
+    zerr = (double *)calloc (nelem, sizeof (double));
+    aerr = (double *)calloc (nelem, sizeof (double));
+    derr = (double *)calloc (nelem, sizeof (double));
+    sqerr = (double *)calloc (nelem, sizeof (double));
+    count = (int *)calloc (nelem, sizeof (int));
+
+    /* Solar positions of all elements are compared with SPA calculations
+     * every SOLVAL_STEP on every SOLVAL_DAYS days. Times between table nodes
+     * are included when SOLVAL_STEP is shorter than the table interval */
+    for (j = 0; j < sol->nday; j += SOLVAL_DAYS)
+    {
+        for (m = 0; m < DAYINSEC / SOLVAL_STEP; m++)
+        {
+            int             t;
+
+            t = sol->t0 + j * DAYINSEC + m * SOLVAL_STEP;
+
+            ElemSolarPos (forc, t, zenith, azimuth);
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+            for (i = 0; i < nelem; i++)
+            {
+                spa_data        spa;
+                double          err;
+
+                SunPos (t,
+                    (NULL == atttbl->lat) ? siteinfo->latitude : atttbl->lat[i],
+                    (NULL == atttbl->lon) ?
+                    siteinfo->longitude : atttbl->lon[i],
+                    siteinfo->elevation, siteinfo->tavg,
+                    (m == 0) ? SPA_ZA_RTS : SPA_ZA, &spa);
+
+                if (m == 0)
+                {
+                    double          dayl;
+
+                    dayl = (spa.sunset - spa.sunrise) * 3600.0;
+                    dayl = (dayl < 0.0) ? dayl + 24.0 * 3600.0 : dayl;
+
+                    err = fabs (DayLength (forc, i, t) - dayl);
+                    derr[i] = (err > derr[i]) ? err : derr[i];
+                }
+
+                /* Only daytime solar positions are used by topographic
+                 * radiation */
+                if (spa.zenith < 90.0)
+                {
+                    err = fabs (zenith[i] - spa.zenith);
+                    zerr[i] = (err > zerr[i]) ? err : zerr[i];
+                    sqerr[i] += err * err;
+                    count[i]++;
+
+                    err = fabs (WrapAngle (azimuth[i] - spa.azimuth180));
+                    aerr[i] = (err > aerr[i]) ? err : aerr[i];
+                }
+            }
+
+            nsample++;
+        }
+    }
+
+    for (i = 0; i < nelem; i++)
+    {
+        if (zerr[i] > zmax)
+        {
+            zmax = zerr[i];
+            imax = i;
+        }
+        amax = (aerr[i] > amax) ? aerr[i] : amax;
+        dmax = (derr[i] > dmax) ? derr[i] : dmax;
+        sqsum += sqerr[i];
+        ntot += count[i];
+    }
+
+    PIHMprintf (VL_NORMAL,
+        " Solar positions of %d elements validated against SPA at %d times:\n",
+        nelem, nsample);
+    PIHMprintf (VL_NORMAL,
+        "  Zenith angle error: max %.4f degree (element %d), RMS %.4f "
+        "degree\n", zmax, imax + 1, (ntot > 0) ? sqrt (sqsum / ntot) : 0.0);
+    PIHMprintf (VL_NORMAL, "  Azimuth angle error: max %.4f degree\n", amax);
+    PIHMprintf (VL_NORMAL, "  Daylength error: max %.1f s\n", dmax);
+
+    if (zmax > SOLVAL_TOL)
+    {
+        PIHMprintf (VL_NORMAL, "Warning: Solar zenith angle error exceeds "
+            "%.2f degree. Consider a smaller SOL_ANCHOR_RES.\n", SOLVAL_TOL);
+    }
+
+    free (zenith);
+    free (azimuth);
+    free (zerr);
+    free (aerr);
+    free (derr);
+    free (sqerr);
+    free (count);
+}
+
+void FreeSolar (forc_struct *forc)
+{
+    int             k;
+
+    for (k = 0; k < forc->nsol; k++)
+    {
+        if (forc->sol[k].nnode > 0)
+        {
+            free (forc->sol[k].zenith);
+            free (forc->sol[k].azimuth);
+            free (forc->sol[k].ha);
+            free (forc->sol[k].decl);
+            free (forc->sol[k].sunrise);
+            free (forc->sol[k].sunset);
+            free (forc->sol[k].decl_day);
+        }
+    }
+
+    free (forc->sol);
+
+    free (forc->solgeo.anchor);
+    free (forc->solgeo.sinlat);
+    free (forc->solgeo.coslat);
+    free (forc->solgeo.dlon);
+    free (forc->solgeo.zenith);
+    free (forc->solgeo.azimuth);
+}
@@ -1,6 +1,21 @@
 #include "pihm.h"
 
 int ODE (realtype t, N_Vector CV_Y, N_Vector CV_Ydot, void *pihm_data)
+{
+#ifdef _MPI_
+    /* Update states of halo elements and river segments before fluxes are
+     * calculated. In subcatchment mode, they are only updated between model
+     * steps */
+    if (!subcat_mode)
+    {
+        HaloComm (NV_LOCLENGTH_P (CV_Y), t, CV_Y, pihm_data);
+    }
+#endif
+
+    return (LocalODE (t, CV_Y, CV_Ydot, pihm_data));
+}
+
+int LocalODE (realtype t, N_Vector CV_Y, N_Vector CV_Ydot, void *pihm_data)
 {
     int             i;
     double         *y;
@@ -9,13 +24,8 @@ int ODE (realtype t, N_Vector CV_Y, N_Vector CV_Ydot, void *pihm_data)
     pihm_struct     pihm;
 
 
-#ifdef _OPENMP
-		y = NV_DATA_OMP(CV_Y);
-		dy = NV_DATA_OMP(CV_Ydot);
-#else
-		y = NV_DATA_S(CV_Y);
-		dy = NV_DATA_S(CV_Ydot);
-#endif
+    y = NV_DATA (CV_Y);
+    dy = NV_DATA (CV_Ydot);
     pihm = (pihm_struct)pihm_data;
 
     dt = (double)pihm->ctrl.stepsize;
@@ -39,10 +49,6 @@ int ODE (realtype t, N_Vector CV_Y, N_Vector CV_Ydot, void *pihm_data)
         elem->ws.surf = (y[SURF(i)] >= 0.0) ? y[SURF(i)] : 0.0;
         elem->ws.unsat = (y[UNSAT(i)] >= 0.0) ? y[UNSAT(i)] : 0.0;
         elem->ws.gw = (y[GW(i)] >= 0.0) ? y[GW(i)] : 0.0;
-
-#ifdef _BGC_
-        elem->ns.sminn = (y[SMINN(i)] >= 0.0) ? y[SMINN(i)] : 0.0;
-#endif
     }
 
 #ifdef _OPENMP
@@ -56,23 +62,25 @@ int ODE (realtype t, N_Vector CV_Y, N_Vector CV_Ydot, void *pihm_data)
         riv->ws.stage = (y[RIVSTG (i)] >= 0.0) ? y[RIVSTG (i)] : 0.0;
         riv->ws.gw = (y[RIVGW (i)] >= 0.0) ? y[RIVGW (i)] : 0.0;
 
-#ifdef _BGC_
-        riv->ns.rivern = (y[RIVERN(i)] >= 0.0) ? y[RIVERN(i)] : 0.0;
-#endif
-
         riv->wf.rivflow[UP_CHANL2CHANL] = 0.0;
         riv->wf.rivflow[UP_AQUIF2AQUIF] = 0.0;
     }
 
+#ifdef _MPI_
+    /* In-flows of halo river segments are accumulated from local upstream
+     * segments, and are discarded */
+    for (i = nriver; i < NLOCALRIV; i++)
+    {
+        pihm->riv[i].wf.rivflow[UP_CHANL2CHANL] = 0.0;
+        pihm->riv[i].wf.rivflow[UP_AQUIF2AQUIF] = 0.0;
+    }
+#endif
+
     /*
      * PIHM Hydrology
      */
     Hydrol (pihm);
 
-#ifdef _BGC_
-    NTransport (pihm);
-#endif
-
     /*
      * Build RHS of ODEs
      */
@@ -121,25 +129,6 @@ int ODE (realtype t, N_Vector CV_Y, N_Vector CV_Ydot, void *pihm_data)
                 i + 1, t);
             PIHMexit (EXIT_FAILURE);
         }
-
-#ifdef _BGC_
-        dy[SMINN(i)] +=
-            (elem->nf.ndep_to_sminn + elem->nf.nfix_to_sminn) / DAYINSEC +
-            elem->nsol.snksrc;
-
-        for (j = 0; j < NUM_EDGE; j++)
-        {
-            dy[SMINN(i)] -= elem->nsol.flux[j] / elem->topo.area;
-        }
-
-        if (isnan (dy[SMINN(i)]))
-        {
-            PIHMprintf (VL_ERROR,
-                "Error: NAN error for Element %d (soil mineral N) at %lf\n",
-                i + 1, t);
-            PIHMexit (EXIT_FAILURE);
-        }
-#endif
     }
 
 #ifdef _OPENMP
@@ -182,21 +171,6 @@ int ODE (realtype t, N_Vector CV_Y, N_Vector CV_Ydot, void *pihm_data)
                 "%lf\n", i + 1, t);
             PIHMexit (EXIT_FAILURE);
         }
-
-#ifdef _BGC_
-        dy[RIVERN (i)] -= riv->nsol.flux[UP] + riv->nsol.flux[DOWN] +
-            riv->nsol.flux[LEFT] + riv->nsol.flux[RIGHT];
-
-        dy[RIVERN (i)] /= riv->topo.area;
-
-        if (isnan (dy[RIVERN(i)]))
-        {
-            PIHMprintf (VL_ERROR,
-                "Error: NAN error for River Segment %d (mineral N) at %lf\n",
-                i + 1, t);
-            PIHMexit (EXIT_FAILURE);
-        }
-#endif
     }
 
     return (0);
@@ -213,7 +187,22 @@ void SetCVodeParam (pihm_struct pihm, void *cvode_mem, N_Vector CV_Y)
     flag = CVodeSetInitStep (cvode_mem, (realtype) pihm->ctrl.initstep);
     flag = CVodeSetStabLimDet (cvode_mem, TRUE);
     flag = CVodeSetMaxStep (cvode_mem, (realtype) pihm->ctrl.maxstep);
+#if defined(_MPI_) && defined(_BBD_)
+    /* Each rank preconditions with a banded approximation of its local
+     * Jacobian block */
+    if (!subcat_mode)
+    {
+        flag = CVSpgmr (cvode_mem, PREC_LEFT, 0);
+        flag = CVBBDPrecInit (cvode_mem, NSV, BBD_BANDWIDTH, BBD_BANDWIDTH,
+            BBD_BANDWIDTH, BBD_BANDWIDTH, 0.0, BBDLocalODE, HaloComm);
+    }
+    else
+    {
+        flag = CVSpgmr (cvode_mem, PREC_NONE, 0);
+    }
+#else
     flag = CVSpgmr (cvode_mem, PREC_NONE, 0);
+#endif
 }
 
 void SolveCVode (int starttime, int *t, int nextptr, int stepsize, double cputime,
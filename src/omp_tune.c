@@ -0,0 +1,326 @@
+#include "pihm.h"
+
+#ifdef _OPENMP
+/* Candidate schedules. Each one is also timed with half of the threads */
+#define NUM_CAND_SCHED  6
+
+const omp_sched_t cand_sched[NUM_CAND_SCHED] = {omp_sched_static,
+    omp_sched_static, omp_sched_dynamic, omp_sched_dynamic,
+    omp_sched_dynamic, omp_sched_guided};
+const int       cand_chunk[NUM_CAND_SCHED] = {0, 16, 1, 8, 32, 1};
+
+const char     *kernel_name[NUM_KERNEL] = {"VERTFLOW", "LATFLOW", "RIVFLOW",
+    "ET", "NOAH", "BGC"};
+
+void InitKernel (ctrl_struct *ctrl)
+{
+    int             k;
+
+    ctrl->omp_tune = 1;
+    ctrl->first_touch = 0;
+    ctrl->bind = BIND_NONE;
+
+    /* Default schedule is the static schedule with all threads, which is
+     * also the first candidate */
+    for (k = 0; k < NUM_KERNEL; k++)
+    {
+        SetTrial (&ctrl->kernel[k], 0);
+        ctrl->kernel[k].fixed = 0;
+        ctrl->kernel[k].trial = -1;
+        ctrl->kernel[k].best = -1;
+        ctrl->kernel[k].report = 0;
+    }
+}
+
+void SetTrial (kernel_struct *kernel, int trial)
+{
+    kernel->trial = trial;
+    kernel->ncall = 0;
+    kernel->time = 0.0;
+
+    kernel->schedule = cand_sched[trial % NUM_CAND_SCHED];
+    kernel->chunk = cand_chunk[trial % NUM_CAND_SCHED];
+    kernel->nthreads = (trial < NUM_CAND_SCHED) ? nthreads : nthreads / 2;
+}
+
+void PinKernel (ctrl_struct *ctrl)
+{
+    int             k;
+
+    /* First touch places pages with the static schedule of all threads.
+     * Element loops keep that schedule, so that each element is updated by
+     * the thread that placed it. Tuning and OMP_SCHEDULE are turned off */
+    if (ctrl->omp_tune)
+    {
+        PIHMprintf (VL_VERBOSE, " OpenMP schedule tuning is turned off by "
+            "first touch.\n");
+        ctrl->omp_tune = 0;
+    }
+
+    for (k = 0; k < NUM_KERNEL; k++)
+    {
+        if (ctrl->kernel[k].fixed &&
+            (ctrl->kernel[k].schedule != omp_sched_static ||
+            ctrl->kernel[k].chunk != 0 ||
+            ctrl->kernel[k].nthreads != nthreads))
+        {
+            PIHMprintf (VL_NORMAL, "Warning: OMP_SCHEDULE of %s is replaced "
+                "by the static schedule of all threads, which is used by "
+                "first touch.\n", kernel_name[k]);
+        }
+
+        SetTrial (&ctrl->kernel[k], 0);
+        ctrl->kernel[k].trial = -1;
+        ctrl->kernel[k].fixed = 1;
+    }
+}
+
+void KernelStart (int tune, kernel_struct *kernel)
+{
+    /* Loops called inside parallel regions (e.g., ensemble members) run
+     * serially and are not timed */
+    if (tune && !kernel->fixed && nthreads > 1 && !omp_in_parallel ())
+    {
+        /* Kernels are tuned on their first call, and tuned again
+         * periodically as per-element costs change during the run */
+        if (kernel->trial < 0 &&
+            (kernel->best < 0 || kernel->ncall >= RETUNE_INTERVAL))
+        {
+            SetTrial (kernel, 0);
+        }
+
+        kernel->start = omp_get_wtime ();
+    }
+
+    omp_set_schedule (kernel->schedule, kernel->chunk);
+}
+
+void KernelEnd (int tune, kernel_struct *kernel)
+{
+    double          time;
+
+    if (!tune || kernel->fixed || nthreads == 1 || omp_in_parallel ())
+    {
+        return;
+    }
+
+    kernel->ncall++;
+
+    if (kernel->trial < 0)
+    {
+        return;
+    }
+
+    kernel->time += omp_get_wtime () - kernel->start;
+
+    if (kernel->ncall < NUM_TUNE_CALL)
+    {
+        return;
+    }
+
+    time = kernel->time / (double)NUM_TUNE_CALL;
+
+    if (kernel->trial == 0)
+    {
+        kernel->static_time = time;
+    }
+    if (kernel->trial == 0 || time < kernel->best_time)
+    {
+        kernel->best_time = time;
+        kernel->best = kernel->trial;
+    }
+
+    if (kernel->trial + 1 < 2 * NUM_CAND_SCHED)
+    {
+        SetTrial (kernel, kernel->trial + 1);
+    }
+    else
+    {
+        /* Use the fastest candidate until the next tuning */
+        SetTrial (kernel, kernel->best);
+        kernel->trial = -1;
+        kernel->report = 1;
+    }
+}
+
+void PrtKernel (FILE *perf_file, ctrl_struct *ctrl, int t)
+{
+    int             k;
+
+    for (k = 0; k < NUM_KERNEL; k++)
+    {
+        kernel_struct  *kernel;
+
+        kernel = &ctrl->kernel[k];
+
+        if (kernel->report)
+        {
+            /* Ratio of static to chosen time per call measures the load
+             * imbalance of the static schedule */
+            fprintf (perf_file, "# %d kernel %s schedule %s,%d threads %d "
+                "time %e static %e\n", t - ctrl->starttime, kernel_name[k],
+                ScheduleName (kernel->schedule), kernel->chunk,
+                kernel->nthreads, kernel->best_time, kernel->static_time);
+
+            PIHMprintf (VL_VERBOSE, " Kernel %s tuned: schedule %s,%d, "
+                "%d threads (%.2f times faster than static).\n",
+                kernel_name[k], ScheduleName (kernel->schedule),
+                kernel->chunk, kernel->nthreads,
+                kernel->static_time / kernel->best_time);
+
+            kernel->report = 0;
+        }
+    }
+}
+
+const char *ScheduleName (omp_sched_t schedule)
+{
+    switch (schedule)
+    {
+        case omp_sched_static:
+            return ("static");
+        case omp_sched_dynamic:
+            return ("dynamic");
+        case omp_sched_guided:
+            return ("guided");
+        default:
+            return ("auto");
+    }
+}
+#endif
+
+void ReadOmpCtrl (char *cmdstr, ctrl_struct *ctrl, char *filename,
+    int lno)
+{
+    char            optstr[MAXSTRING];
+
+    sscanf (cmdstr, "%s", optstr);
+
+    if (strcasecmp (optstr, "OMP_TUNE") == 0)
+    {
+#ifdef _OPENMP
+        ReadKeyword (cmdstr, "OMP_TUNE", &ctrl->omp_tune, 'i', filename, lno);
+#endif
+    }
+    else if (strcasecmp (optstr, "OMP_FIRST_TOUCH") == 0)
+    {
+#ifdef _OPENMP
+        ReadKeyword (cmdstr, "OMP_FIRST_TOUCH", &ctrl->first_touch, 'i',
+            filename, lno);
+#endif
+    }
+    else if (strcasecmp (optstr, "OMP_BIND") == 0)
+    {
+#ifdef _OPENMP
+        char            bindstr[MAXSTRING];
+
+        if (sscanf (cmdstr, "%*s %s", bindstr) != 1)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error: OMP_BIND should be followed by none, close, or "
+                "spread.\n");
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename,
+                lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+
+        if (strcasecmp (bindstr, "none") == 0)
+        {
+            ctrl->bind = BIND_NONE;
+        }
+        else if (strcasecmp (bindstr, "close") == 0)
+        {
+            ctrl->bind = BIND_CLOSE;
+        }
+        else if (strcasecmp (bindstr, "spread") == 0)
+        {
+            ctrl->bind = BIND_SPREAD;
+        }
+        else
+        {
+            PIHMprintf (VL_ERROR, "Error: Unknown thread binding %s.\n",
+                bindstr);
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename,
+                lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+#endif
+    }
+    else if (strcasecmp (optstr, "OMP_SCHEDULE") == 0)
+    {
+#ifdef _OPENMP
+        char            name[MAXSTRING];
+        char            schedstr[MAXSTRING];
+        int             chunk;
+        int             nthr;
+        int             k;
+
+        if (sscanf (cmdstr, "%*s %s %s %d %d", name, schedstr, &chunk,
+            &nthr) != 4)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error: OMP_SCHEDULE should be followed by kernel name, "
+                "schedule, chunk size, and number of threads.\n");
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename,
+                lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+
+        for (k = 0; k < NUM_KERNEL; k++)
+        {
+            if (strcasecmp (name, kernel_name[k]) == 0)
+            {
+                break;
+            }
+        }
+        if (k == NUM_KERNEL)
+        {
+            PIHMprintf (VL_ERROR, "Error: Unknown kernel %s.\n", name);
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename,
+                lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+
+        if (strcasecmp (schedstr, "static") == 0)
+        {
+            ctrl->kernel[k].schedule = omp_sched_static;
+        }
+        else if (strcasecmp (schedstr, "dynamic") == 0)
+        {
+            ctrl->kernel[k].schedule = omp_sched_dynamic;
+        }
+        else if (strcasecmp (schedstr, "guided") == 0)
+        {
+            ctrl->kernel[k].schedule = omp_sched_guided;
+        }
+        else if (strcasecmp (schedstr, "auto") == 0)
+        {
+            ctrl->kernel[k].schedule = omp_sched_auto;
+        }
+        else
+        {
+            PIHMprintf (VL_ERROR, "Error: Unknown OpenMP schedule %s.\n",
+                schedstr);
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename,
+                lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+
+        /* Zero number of threads uses all threads */
+        ctrl->kernel[k].chunk = (chunk > 0) ? chunk : 0;
+        ctrl->kernel[k].nthreads =
+            (nthr > 0 && nthr < nthreads) ? nthr : nthreads;
+        ctrl->kernel[k].fixed = 1;
+
+        PIHMprintf (VL_VERBOSE, " Kernel %s: schedule %s,%d, %d threads.\n",
+            kernel_name[k], ScheduleName (ctrl->kernel[k].schedule),
+            ctrl->kernel[k].chunk, ctrl->kernel[k].nthreads);
+#endif
+    }
+    else
+    {
+        PIHMprintf (VL_ERROR, "Error: Unknown keyword \"%s\".\n", optstr);
+        PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename, lno);
+        PIHMexit (EXIT_FAILURE);
+    }
+}
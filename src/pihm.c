@@ -10,25 +10,38 @@ void PIHM (pihm_struct pihm, void *cvode_mem, N_Vector CV_Y, int t,
     ApplyBC (&pihm->forc, pihm->elem, pihm->riv, t);
 
     /* Determine if land surface simulation is needed */
+#ifdef _NOAH_
+    if (LsmStepDue (&pihm->ctrl, t))
+#else
     if ((t - pihm->ctrl.starttime) % pihm->ctrl.etstep == 0)
+#endif
     {
         /* Apply forcing */
         ApplyForcing (&pihm->forc, pihm->elem, t
     #ifdef _NOAH_
-            , &pihm->ctrl, &pihm->siteinfo
+            , &pihm->ctrl
     #endif
             );
 
 #ifdef _NOAH_
+        /* Choose the length of land surface step */
+        LsmStep (&pihm->forc, pihm->elem, &pihm->ctrl, t);
+
         /* Calculate surface energy balance */
         Noah (pihm);
 #else
         /* Calculate Interception storage and ET */
         IntcpSnowET (t, (double)pihm->ctrl.etstep, pihm);
 #endif
-        /*
-         * Update print variables for land surface step variables
-         */
+    }
+
+    /*
+     * Update print variables for land surface step variables. Land surface
+     * steps may be longer or shorter than LSM_STEP, but variables are sampled
+     * every LSM_STEP so that averages are weighted by time
+     */
+    if ((t - pihm->ctrl.starttime) % pihm->ctrl.etstep == 0)
+    {
         UpdPrintVar (pihm->prtctrl, pihm->ctrl.nprint, LS_STEP);
     }
 
@@ -50,10 +63,39 @@ void PIHM (pihm_struct pihm, void *cvode_mem, N_Vector CV_Y, int t,
     NoahHydrol (pihm->elem, (double)pihm->ctrl.stepsize);
 #endif
 
+#ifdef _RT_
+    /* Reactive transport, in minutes as in RT-PIHM */
+    fluxtrans ((realtype)t / 60.0, (realtype)pihm->ctrl.stepsize / 60.0,
+        pihm, pihm->chData);
+#endif
+
+#ifdef _BGC_
+    NTransport (pihm->elem, pihm->riv, &pihm->ntrans,
+        (double)pihm->ctrl.stepsize);
+#endif
+
 #ifdef _CYCLES_
     SoluteTransport (pihm->elem, pihm->riv, (double)pihm->ctrl.stepsize);
 #endif
 
+    if (pihm->ctrl.water_age)
+    {
+#ifdef _OPENMP
+        double          age_start = omp_get_wtime ();
+#else
+        clock_t         age_start = clock ();
+#endif
+
+        WaterAge (pihm->elem, pihm->riv, &pihm->ctrl, &pihm->age);
+
+#ifdef _OPENMP
+        pihm->ctrl.age_cputime += omp_get_wtime () - age_start;
+#else
+        pihm->ctrl.age_cputime +=
+            (double)(clock () - age_start) / CLOCKS_PER_SEC;
+#endif
+    }
+
     /*
      * Update print variables for hydrology step variables
      */
@@ -119,4 +161,8 @@ void PIHM (pihm_struct pihm, void *cvode_mem, N_Vector CV_Y, int t,
 				t - pihm->ctrl.starttime);
 		}
 
+#ifdef _RT_
+    PrintChem (outputdir, simulation, pihm->chData, (realtype)t / 60.0);
+#endif
+
 }
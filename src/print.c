@@ -49,7 +49,11 @@ void _PIHMprintf (const char *fn, int lineno, const char *func, int verbosity,
         }
         fflush (stderr);
     }
+#ifdef _MPI_
+    else if (verbosity <= verbose_mode && 0 == mpi_rank)
+#else
     else if (verbosity <= verbose_mode)
+#endif
     {
         vfprintf (stdout, fmt, va);
         if (debug_mode)
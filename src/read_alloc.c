@@ -21,6 +21,7 @@ void ReadAlloc (char *simulation, pihm_struct pihm)
 #ifdef _NOAH_
     sprintf (pihm->filename.lsm, "input/%s/%s.lsm", project, project);
     sprintf (pihm->filename.rad, "input/%s/%s.rad", project, project);
+    sprintf (pihm->filename.latlon, "input/%s/%s.latlon", project, project);
 #endif
 #ifdef _CYCLES_
     sprintf (pihm->filename.cycles, "input/%s/%s.cycles", project, project);
@@ -55,6 +56,7 @@ void ReadAlloc (char *simulation, pihm_struct pihm)
     ReadLC (pihm->filename.lc, &pihm->lctbl);
 
     /* Read meteorological forcing input file */
+    pihm->forc.shared = 0;
     ReadForc (pihm->filename.meteo, &pihm->forc);
 
     /* Read LAI input file */
@@ -87,6 +89,9 @@ void ReadAlloc (char *simulation, pihm_struct pihm)
         /* Read radiation input file */
         ReadRad (pihm->filename.rad, &pihm->forc);
     }
+
+    /* Read optional element latitude and longitude file */
+    ReadLatLon (pihm->filename.latlon, &pihm->atttbl);
 #endif
 
 #ifdef _CYCLES_
@@ -944,6 +949,19 @@ void ReadPara (char *filename, ctrl_struct *ctrl)
         ctrl->prtvrbl[i] = 0;
     }
 
+#ifdef _OPENMP
+    InitKernel (ctrl);
+#endif
+
+    ctrl->soil_tbl = 0;
+    ctrl->soil_tbl_tol = VGTBL_TOL;
+    ctrl->soil_tbl_verify = 0;
+    ctrl->water_age = 0;
+    ctrl->age_nbin = 0;
+    ctrl->age_binw = AGE_BINW;
+    ctrl->age_cputime = 0.0;
+    ctrl->age_excess = 0.0;
+
     para_file = fopen (filename, "r");
     CheckFile (para_file, filename);
     PIHMprintf (VL_VERBOSE, " Reading %s\n", filename);
@@ -1122,8 +1140,58 @@ void ReadPara (char *filename, ctrl_struct *ctrl)
 	ctrl->prtvrbl[IC_CTRL] = ReadPrtCtrl(cmdstr, "IC", filename,
 		lno);
 
+    /* Optional OpenMP, water age, and soil lookup table controls */
+    NextLine (para_file, cmdstr, &lno);
+    while (strcasecmp (cmdstr, "EOF") != 0)
+    {
+        if (strncasecmp (cmdstr, "OMP_", 4) == 0)
+        {
+            ReadOmpCtrl (cmdstr, ctrl, filename, lno);
+        }
+        else if (strncasecmp (cmdstr, "AGE_", 4) == 0 ||
+            strncasecmp (cmdstr, "TTD_", 4) == 0 ||
+            strncasecmp (cmdstr, "WATER_AGE", 9) == 0)
+        {
+            ReadAgeCtrl (cmdstr, ctrl, filename, lno);
+        }
+        else
+        {
+            ReadSoilTblCtrl (cmdstr, ctrl, filename, lno);
+        }
+        NextLine (para_file, cmdstr, &lno);
+    }
+
 	fclose (para_file);
 
+#ifdef _OPENMP
+    if (ctrl->first_touch)
+    {
+        PinKernel (ctrl);
+    }
+#endif
+
+    for (i = AGE_SURF_CTRL; i <= AGE_RIVGW_CTRL; i++)
+    {
+        if (ctrl->prtvrbl[i] != 0 && !ctrl->water_age)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error: Water age output requires WATER_AGE to be on.\n");
+            PIHMprintf (VL_ERROR, "Error in %s.\n", filename);
+            PIHMexit (EXIT_FAILURE);
+        }
+    }
+
+    for (i = TTD_SURF_CTRL; i <= TTD_RIVGW_CTRL; i++)
+    {
+        if (ctrl->prtvrbl[i] != 0 && (!ctrl->water_age || ctrl->age_nbin == 0))
+        {
+            PIHMprintf (VL_ERROR, "Error: Water age distribution output "
+                "requires WATER_AGE to be on and AGE_NBIN to be set.\n");
+            PIHMprintf (VL_ERROR, "Error in %s.\n", filename);
+            PIHMexit (EXIT_FAILURE);
+        }
+    }
+
     if (ctrl->etstep < ctrl->stepsize || ctrl->etstep % ctrl->stepsize > 0)
     {
         PIHMprintf (VL_ERROR,
@@ -1257,11 +1325,20 @@ void ReadCalib (char *filename, calib_struct *cal)
 #ifdef _RT_
     FindLine (global_calib, "RT_CALIBRATION", &lno, filename);
 
-    CS->Cal.PCO2 = 1.0;
-    CS->Cal.Keq = 1.0;
-    CS->Cal.Site_den = 1.0;
-    CS->Cal.SSA = 1.0;
-    CS->Cal.Prep_conc = 1.0;
+    NextLine (global_calib, cmdstr, &lno);
+    ReadKeyword (cmdstr, "PCO2", &cal->pco2, 'd', filename, lno);
+
+    NextLine (global_calib, cmdstr, &lno);
+    ReadKeyword (cmdstr, "KEQ", &cal->keq, 'd', filename, lno);
+
+    NextLine (global_calib, cmdstr, &lno);
+    ReadKeyword (cmdstr, "SSA", &cal->ssa, 'd', filename, lno);
+
+    NextLine (global_calib, cmdstr, &lno);
+    ReadKeyword (cmdstr, "SITE_DEN", &cal->site_den, 'd', filename, lno);
+
+    NextLine (global_calib, cmdstr, &lno);
+    ReadKeyword (cmdstr, "PREP_CONC", &cal->prep_conc, 'd', filename, lno);
 #endif
 
     /*
@@ -1403,8 +1480,16 @@ void FreeData (pihm_struct pihm)
     free (pihm->atttbl.meteo);
     free (pihm->atttbl.lai);
     free (pihm->atttbl.source);
+#ifdef _NOAH_
+    free (pihm->atttbl.lat);
+    free (pihm->atttbl.lon);
+#endif
 
     /* Free soil input structure */
+    if (pihm->vgtbl != NULL)
+    {
+        FreeVgTbl (pihm->vgtbl, pihm->soiltbl.number);
+    }
     free (pihm->soiltbl.silt);
     free (pihm->soiltbl.clay);
     free (pihm->soiltbl.om);
@@ -1511,6 +1596,9 @@ void FreeData (pihm_struct pihm)
         }
         free (pihm->forc.rad);
     }
+
+    FreeSolar (&pihm->forc);
+    FreeLsmStep (&pihm->ctrl.lsm);
 #endif
 
     free (pihm->ctrl.tout);
@@ -1531,6 +1619,17 @@ void FreeData (pihm_struct pihm)
 			fclose(pihm->prtctrlT[i].datfile);
 		}
 	}
+#ifdef _DAILY_
+    FreeDailyAcc (&pihm->dacc);
+#endif
+#ifdef _BGC_
+    free (pihm->bgc_order);
+    FreeTracer (&pihm->ntrans);
+#endif
+    if (pihm->ctrl.water_age)
+    {
+        FreeTracer (&pihm->age);
+    }
     free (pihm->elem);
     free (pihm->riv);
 }
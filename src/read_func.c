@@ -164,6 +164,17 @@ void CheckFile (FILE *fid, char *fn)
     }
 }
 
+void CheckStrLen (int len, const char *str)
+{
+    /* len is the return value of snprintf into a MAXSTRING buffer */
+    if (len < 0 || len >= MAXSTRING)
+    {
+        PIHMprintf (VL_ERROR, "Error: %s... is longer than %d characters.\n",
+            str, MAXSTRING - 1);
+        PIHMexit (EXIT_FAILURE);
+    }
+}
+
 int ReadTS (char *cmdstr, int *ftime, double *data, int nvrbl)
 {
     int             match;
@@ -0,0 +1,221 @@
+/* 64-bit file offsets on 32-bit POSIX systems */
+#define _FILE_OFFSET_BITS   64
+
+#include "pihm.h"
+
+#if defined(_MSC_VER)
+typedef __int64 rst_off_t;
+#define rst_fseek           _fseeki64
+#else
+typedef off_t   rst_off_t;
+#define rst_fseek           fseeko
+#endif
+
+/*
+ * Restart files start with a header that lists module sections. Each section
+ * starts at a multiple of RST_ALIGN, and holds fixed-size element records
+ * followed by fixed-size river segment records, so that the record of any
+ * element can be read or written in place, or the file can be memory mapped.
+ * Records are written in native byte order, as other binary input files
+ */
+static rst_off_t RestartOffset (const rsthdr_struct *hdr, int sec, int type,
+    int ind)
+{
+    const rstsec_struct *rstsec = &hdr->sec[sec];
+
+    return (rst_off_t)((type == RST_ELEM) ?
+        rstsec->offset + (long long)rstsec->elem_stride * ind :
+        rstsec->offset + (long long)rstsec->elem_stride * hdr->nelem +
+        (long long)rstsec->riv_stride * ind);
+}
+
+static int FindRestartSec (char *fn, const rsthdr_struct *hdr, int id,
+    int elem_stride, int riv_stride)
+{
+    int             k;
+
+    for (k = 0; k < hdr->nsection; k++)
+    {
+        if (hdr->sec[k].id == id)
+        {
+            if (hdr->sec[k].elem_stride != elem_stride ||
+                hdr->sec[k].riv_stride != riv_stride)
+            {
+                PIHMprintf (VL_ERROR,
+                    "Error in restart file %s.\n"
+                    "Record sizes of section %d do not match this model.\n",
+                    fn, id);
+                PIHMexit (EXIT_FAILURE);
+            }
+
+            return (k);
+        }
+    }
+
+    return (-1);
+}
+
+static FILE *ReadRestartHdr (char *fn, const char *mode,
+    rsthdr_struct *hdr)
+{
+    FILE           *fp;
+
+    fp = fopen (fn, mode);
+    if (NULL == fp)
+    {
+        return (NULL);
+    }
+
+    if (fread (hdr, sizeof (rsthdr_struct), 1, fp) != 1 ||
+        strncmp (hdr->magic, RST_MAGIC, sizeof (hdr->magic)) != 0)
+    {
+        /* Not a restart file, e.g., written by earlier versions */
+        fclose (fp);
+        return (NULL);
+    }
+
+    if (hdr->version > RST_VERSION || hdr->nsection > RST_MAXSEC)
+    {
+        PIHMprintf (VL_ERROR,
+            "Error in restart file %s.\n"
+            "Restart format version %d is not supported.\n",
+            fn, hdr->version);
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    return (fp);
+}
+
+FILE *OpenRestartRd (char *fn, int id, int elem_stride, int riv_stride,
+    rsthdr_struct *hdr, int *sec)
+{
+    FILE           *fp;
+
+    fp = ReadRestartHdr (fn, "rb", hdr);
+    if (NULL == fp)
+    {
+        *sec = -1;
+        return (NULL);
+    }
+
+    if (hdr->nelem != nelem || hdr->nriver != nriver)
+    {
+        PIHMprintf (VL_ERROR,
+            "Error in restart file %s.\n"
+            "The numbers of elements and river segments (%d, %d) "
+            "do not match the model domain.\n",
+            fn, hdr->nelem, hdr->nriver);
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    *sec = FindRestartSec (fn, hdr, id, elem_stride, riv_stride);
+    if (*sec < 0)
+    {
+        PIHMprintf (VL_ERROR,
+            "Error in restart file %s.\n"
+            "Section %d is not found.\n", fn, id);
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    return (fp);
+}
+
+FILE *OpenRestartWr (char *fn, int id, int elem_stride, int riv_stride,
+    rsthdr_struct *hdr, int *sec)
+{
+    FILE           *fp;
+    long long       end;
+    long long       sec_end;
+    int             k;
+
+    /* Sections of other modules in an existing restart file of the same
+     * domain are kept, and records of an existing section are overwritten in
+     * place */
+    fp = ReadRestartHdr (fn, "r+b", hdr);
+    if (NULL != fp && (hdr->nelem != nelem || hdr->nriver != nriver))
+    {
+        fclose (fp);
+        fp = NULL;
+    }
+
+    if (NULL == fp)
+    {
+        fp = fopen (fn, "wb");
+        CheckFile (fp, fn);
+
+        memset (hdr, 0, sizeof (rsthdr_struct));
+        strcpy (hdr->magic, RST_MAGIC);
+        hdr->nsection = 0;
+        hdr->nelem = nelem;
+        hdr->nriver = nriver;
+    }
+    hdr->version = RST_VERSION;
+
+    *sec = FindRestartSec (fn, hdr, id, elem_stride, riv_stride);
+    if (*sec < 0)
+    {
+        if (hdr->nsection >= RST_MAXSEC)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error writing restart file %s.\n"
+                "Too many sections.\n", fn);
+            PIHMexit (EXIT_FAILURE);
+        }
+
+        end = sizeof (rsthdr_struct);
+        for (k = 0; k < hdr->nsection; k++)
+        {
+            sec_end = hdr->sec[k].offset +
+                (long long)hdr->sec[k].elem_stride * hdr->nelem +
+                (long long)hdr->sec[k].riv_stride * hdr->nriver;
+            end = (sec_end > end) ? sec_end : end;
+        }
+
+        *sec = hdr->nsection;
+        hdr->sec[*sec].id = id;
+        hdr->sec[*sec].elem_stride = elem_stride;
+        hdr->sec[*sec].riv_stride = riv_stride;
+        hdr->sec[*sec].reserved = 0;
+        hdr->sec[*sec].offset = (end + RST_ALIGN - 1) / RST_ALIGN * RST_ALIGN;
+        hdr->nsection++;
+    }
+
+    fseek (fp, 0L, SEEK_SET);
+    fwrite (hdr, sizeof (rsthdr_struct), 1, fp);
+
+    return (fp);
+}
+
+void ReadRestartRec (FILE *fp, const rsthdr_struct *hdr, int sec, int type,
+    int ind, void *rec)
+{
+    int             stride;
+
+    stride = (type == RST_ELEM) ?
+        hdr->sec[sec].elem_stride : hdr->sec[sec].riv_stride;
+
+    if (rst_fseek (fp, RestartOffset (hdr, sec, type, ind), SEEK_SET) != 0 ||
+        fread (rec, stride, 1, fp) != 1)
+    {
+        PIHMprintf (VL_ERROR,
+            "Error reading restart file.\n"
+            "The file is truncated.\n");
+        PIHMexit (EXIT_FAILURE);
+    }
+}
+
+void WriteRestartRec (FILE *fp, const rsthdr_struct *hdr, int sec, int type,
+    int ind, const void *rec)
+{
+    int             stride;
+
+    stride = (type == RST_ELEM) ?
+        hdr->sec[sec].elem_stride : hdr->sec[sec].riv_stride;
+
+    if (rst_fseek (fp, RestartOffset (hdr, sec, type, ind), SEEK_SET) != 0 ||
+        fwrite (rec, stride, 1, fp) != 1)
+    {
+        PIHMprintf (VL_ERROR, "Error writing restart file.\n");
+        PIHMexit (EXIT_FAILURE);
+    }
+}
@@ -11,10 +11,14 @@ void RiverFlow (pihm_struct pihm)
      * Lateral flux calculation between river-river and river-triangular
      * elements
      */
+    /* Halo river segments are included so that in-flows from upstream
+     * segments owned by other ranks are accumulated */
 #ifdef _OPENMP
-#pragma omp parallel for
+    KernelStart (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[RIVFLOW_KERNEL]);
+#pragma omp parallel for schedule(runtime) \
+    num_threads(pihm->ctrl.kernel[RIVFLOW_KERNEL].nthreads)
 #endif
-    for (i = 0; i < nriver; i++)
+    for (i = 0; i < NLOCALRIV; i++)
     {
         river_struct *riv;
         river_struct *down;
@@ -71,7 +75,12 @@ void RiverFlow (pihm_struct pihm)
             avg_y = (avg_perim == 0.0) ? 0.0 : (avg_crossa / avg_perim);
             riv->wf.rivflow[DOWN_CHANL2CHANL] =
                 OverlandFlow (avg_y, grad_y, avg_sf, crossa, avg_rough);
-            /* Accumulate to get in-flow for down segments */
+            /* Accumulate to get in-flow for down segments. Segments
+             * upstream of a confluence may be processed by different
+             * threads */
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
             down->wf.rivflow[UP_CHANL2CHANL] -=
                 riv->wf.rivflow[DOWN_CHANL2CHANL];
 
@@ -107,6 +116,9 @@ void RiverFlow (pihm_struct pihm)
             riv->wf.rivflow[DOWN_AQUIF2AQUIF] =
                 avg_ksat * grad_y_sub * avg_y_sub * avg_wid;
             /* Accumulate to get in-flow for down segments */
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
             down->wf.rivflow[UP_AQUIF2AQUIF] -=
                 riv->wf.rivflow[DOWN_AQUIF2AQUIF];
         }
@@ -203,6 +215,9 @@ void RiverFlow (pihm_struct pihm)
         riv->wf.rivflow[CHANL_LKG] =
             riv->matl.ksatv * riv->shp.width * riv->shp.length * grad_y;
     }
+#ifdef _OPENMP
+    KernelEnd (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[RIVFLOW_KERNEL]);
+#endif
 }
 
 void RiverToEle (river_struct *riv, elem_struct *elem, elem_struct *oppbank,
@@ -293,6 +308,9 @@ void RiverToEle (river_struct *riv, elem_struct *elem, elem_struct *oppbank,
         {
             elem->wf.ovlflow[j] = -(*fluxsurf);
             elem->wf.subsurf[j] = -(*fluxriv + *fluxsub);
+#ifdef _RT_
+            elem->topo.areasub[j] = elem->ws.gw * elem->topo.edge[j];
+#endif
             break;
         }
     }
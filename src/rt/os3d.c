@@ -20,516 +20,366 @@
 #include <assert.h>
 
 /* SUNDIAL Header Files */
-#include "../pihm.h"
-#include "rt.h"                 /* Data Model and Variable Declarations for chemical processes */
+#include "pihm.h"
+
 
 #define EPSILON 1.0E-20
 
-void OS3D (realtype t, realtype stepsize, Chem_Data CD)
+void            OS3DAlloc (Chem_Data);
+// allocate persistent arrays and group faces by upstream grid blocks
+static void     FaceFlux (const Chem_Data, int, double *);
+// mass fluxes of all species across a face
+static void     UpdateCell (realtype, realtype, Chem_Data, int);
+// update concentrations of a grid block from mass changes
+void            OS3D (realtype, realtype, Chem_Data);
+// one transport step
+void            ReportError (vol_conc, Chem_Data);
+
+void OS3DAlloc (Chem_Data CD)
 {
+    Trans_Work     *w = &CD->Trans;
+    int             i, j, k, *next;
+
+    // conc is allocated with the grid blocks in chem_alloc
+    w->fconc = (double *)malloc (CD->NumFac * CD->NumSpc * sizeof (double));
+    w->dconc = (double *)malloc (CD->NumVol * CD->NumSpc * sizeof (double));
+    w->tmpconc =
+        (double *)malloc (CD->NumVol * CD->NumSpc * sizeof (double));
+    w->diff_coe = (double *)malloc (CD->NumSpc * sizeof (double));
+    w->disp_coe = (double *)malloc (CD->NumSpc * sizeof (double));
+    for (j = 0; j < CD->NumSpc; j++)
+    {
+        w->diff_coe[j] = CD->chemtype[j].DiffCoe;
+        w->disp_coe[j] = CD->chemtype[j].DispCoe;
+    }
 
-    // input t and stepsize in the unit of minute
-
-    double        **dconc =
-        (double **)malloc (CD->NumOsv * sizeof (double *));
-    int             i, j, k, jj, node_1, node_2, node_3, node_4, abnormalflg,
-        nr_tmp;
-    double          flux_t, diff_flux, disp_flux, distance, temp_dconc,
-        velocity, temp_conc, inv_dist, diff_conc, unit_c, area, r_, beta_,
-        var_height, total_prep_mass, timelps, invavg, adpstep;
-    double         *tmpconc = (double *)malloc (CD->NumSpc * sizeof (double));
+    // faces of each grid block are stored in ascending order, so that mass
+    // changes are summed in the same order as a loop over faces
+    w->fstart = (int *)calloc (CD->NumVol + 1, sizeof (int));
+    w->face = (int *)malloc (CD->NumFac * sizeof (int));
+    next = (int *)malloc (CD->NumVol * sizeof (int));
+
+    for (k = 0; k < CD->NumFac; k++)
+        w->fstart[CD->Flux[k].nodeup]++;
+    for (i = 0; i < CD->NumVol; i++)
+        w->fstart[i + 1] += w->fstart[i];
+    for (i = 0; i < CD->NumVol; i++)
+        next[i] = w->fstart[i];
+    for (k = 0; k < CD->NumFac; k++)
+        w->face[next[CD->Flux[k].nodeup - 1]++] = k;
+
+    free (next);
+}
 
-    abnormalflg = 0;
+static void FaceFlux (const Chem_Data CD, int k, double *fq)
+{
+    /* fq stores the mass changes of the upstream grid block from the face.
+     * Branches on flow direction and boundary type are taken once for each
+     * face, so that loops over species can be vectorized */
+    const face     *f = &CD->Flux[k];
+    const Trans_Work *w = &CD->Trans;
+    const double   *c1, *c2, *cu, *cd, *cuu;
+    int             j, node_1, node_2, node_3, node_4, nspc, tvd;
+    double          flux_t, velocity, area, inv_dist, unit_c, pw, dv, r_,
+        beta_, diff_flux, disp_flux, diff_conc;
+
+    nspc = CD->NumSpc;
     unit_c = 1.0 / 1440;
-    total_prep_mass = 0.0;
 
-    // Initalize the allocated array
+    node_1 = f->nodeup - 1;
+    node_2 = f->nodelo - 1;
+    node_3 = f->nodeuu - 1;
+    node_4 = f->nodell - 1;
+    flux_t = -f->flux;
+    velocity = -f->velocity;
+    area = f->s_area;
+    inv_dist = 1.0 / f->distance;
 
-    for (i = 0; i < CD->NumOsv; i++)
+    c1 = CD->Vcele[node_1].t_conc;
+    c2 = CD->Vcele[node_2].t_conc;
+
+    // upwind (cu), downwind (cd) and second upwind (cuu) grid blocks
+    if (flux_t > 0)
     {
-        dconc[i] = (double *)malloc (CD->NumSpc * sizeof (double));
-        for (j = 0; j < CD->NumSpc; j++)
-            dconc[i][j] = 0.0;
+        cu = c2;
+        cd = c1;
+        tvd = (CD->TVDFlg == 1) && (node_4 > 0);
+        cuu = (tvd) ? CD->Vcele[node_4].t_conc : cu;
+    }
+    else
+    {
+        cu = c1;
+        cd = c2;
+        tvd = (CD->TVDFlg == 1) && (node_3 > 0);
+        cuu = (tvd) ? CD->Vcele[node_3].t_conc : cu;
     }
 
-
-    for (i = 0; i < CD->NumFac; i++)
+    /* uses fq to store the concentration at the surfaces first */
+    if (tvd)
     {
-        CD->Flux[i].q = 0.0;
-        node_1 = CD->Flux[i].nodeup - 1;
-        node_2 = CD->Flux[i].nodelo - 1;
-        node_3 = CD->Flux[i].nodeuu - 1;
-        node_4 = CD->Flux[i].nodell - 1;
-        flux_t = -CD->Flux[i].flux;
-        distance = CD->Flux[i].distance;
-        velocity = -CD->Flux[i].velocity;
-        area = CD->Flux[i].s_area;
-        inv_dist = 1.0 / distance;
-
-        for (j = 0; j < CD->NumSpc; j++)
+        for (j = 0; j < nspc; j++)
         {
+            r_ = (cu[j] - cuu[j] + EPSILON) / (cd[j] - cu[j] + EPSILON);
+            beta_ = MAX (0, MIN (MIN (2, 2 * r_), (2 + r_) / 3));
+            fq[j] = cu[j] + beta_ * (cd[j] - cu[j]) * 0.5;
+        }
+    }
+    else
+    {
+        for (j = 0; j < nspc; j++)
+            fq[j] = cu[j];
+    }
 
-            diff_conc = CD->Vcele[node_2].t_conc[j] - CD->Vcele[node_1].t_conc[j];      /* difference in concentration, in M/kg w */
-            diff_flux = 0.0;
-            disp_flux = 0.0;
-            if (CD->Flux[i].BC == 0)
-            {
-                diff_flux =
-                    CD->chemtype[j].DiffCoe * pow (CD->Vcele[node_1].porosity,
-                    CD->Cementation);
-                /* diffusion flux, effective diffusion coefficient  */
-                if (velocity < 0.0)
-                    disp_flux = velocity * CD->chemtype[j].DispCoe;
-                else
-                    disp_flux = -velocity * CD->chemtype[j].DispCoe;
-                /* longitudinal dispersion */
-                diff_flux = -diff_flux * inv_dist * diff_conc * area;
-                /* diffusion is in the opposite direction of conc gradient */
-                disp_flux = disp_flux * inv_dist * diff_conc * area;
-
-            }
-
-
-            temp_dconc = 0.0;
-            temp_conc = 0.0;
-
-            /* uses temp_conc to store the concentration at the surfaces */
-            /* uses temp_dconc to store the concentration changes at the cell */
-
-            if (CD->TVDFlg == 0)
-            {
-                if (flux_t > 0)
-                {
-                    temp_conc = CD->Vcele[node_2].t_conc[j];
-                }
-                else
-                {
-                    temp_conc = CD->Vcele[node_1].t_conc[j];
-                }
-            }
-            if (CD->TVDFlg == 1)
-            {
-                if (flux_t > 0)
-                {
-                    if (node_4 > 0)
-                    {
-                        r_ = (CD->Vcele[node_2].t_conc[j] -
-                            CD->Vcele[node_4].t_conc[j] +
-                            EPSILON) / (CD->Vcele[node_1].t_conc[j] -
-                            CD->Vcele[node_2].t_conc[j] + EPSILON);
-                        beta_ = MAX (0, MIN (MIN (2, 2 * r_), (2 + r_) / 3));
-                        temp_conc =
-                            CD->Vcele[node_2].t_conc[j] +
-                            beta_ * (CD->Vcele[node_1].t_conc[j] -
-                            CD->Vcele[node_2].t_conc[j]) * 0.5;
-                    }
-                    else
-                        temp_conc = CD->Vcele[node_2].t_conc[j];
-                }
-                else
-                {
-                    if (node_3 > 0)
-                    {
-                        r_ = (CD->Vcele[node_1].t_conc[j] -
-                            CD->Vcele[node_3].t_conc[j] +
-                            EPSILON) / (CD->Vcele[node_2].t_conc[j] -
-                            CD->Vcele[node_1].t_conc[j] + EPSILON);
-                        beta_ = MAX (0, MIN (MIN (2, 2 * r_), (2 + r_) / 3));
-                        temp_conc =
-                            CD->Vcele[node_1].t_conc[j] +
-                            beta_ * (CD->Vcele[node_2].t_conc[j] -
-                            CD->Vcele[node_1].t_conc[j]) * 0.5;
-                    }
-                    else
-                        temp_conc = CD->Vcele[node_1].t_conc[j];
-                }
-            }
-
-            else
-            {
-                if (flux_t > 0)
-                    temp_conc = CD->Vcele[node_2].t_conc[j];
-                else
-                    temp_conc = CD->Vcele[node_1].t_conc[j];
+    // Flux[k].BC = 0 normal cell face
+    //            = 1 flux boundary
+    //            = 2 noflow boundary
 
-            }
+    if (f->BC != 2)
+    {
+        for (j = 0; j < nspc; j++)
+            fq[j] = fq[j] * flux_t;
+    }
+    else
+    {
+        for (j = 0; j < nspc; j++)
+            fq[j] = 0.0;
+    }
 
-            // Flux[i].BC = 0 normal cell face
-            //            = 1 flux boundary
-            //            = 2 noflow boundary
-
-            if (CD->Flux[i].BC != 2)
-                temp_dconc += temp_conc * flux_t;
-            if (CD->Flux[i].BC == 0)
-                temp_dconc -= diff_flux + disp_flux;
-            temp_dconc *= unit_c;
-            CD->Flux[i].q = temp_dconc;
-            dconc[node_1][j] += temp_dconc;
-            /*
-             * if (( CD->Flux[i].nodeup == 1109) && (j == 2) && ((int)t % 1440 == 0)){
-             * fprintf(stderr, "%s fromid %d, toid %d, flux: %f, velo: %f, dist: %f, vol:%f, conc: %f, sconc: %f, nconc: %f, adv_trans: %g, diff_trans: %g, s_area: %f\n",CD->chemtype[j].ChemName, CD->Flux[i].nodeup, CD->Flux[i].nodelo,  CD->Flux[i].flux, CD->Flux[i].velocity, CD->Flux[i].distance, CD->Vcele[CD->Flux[i].nodeup-1].vol, CD->Vcele[CD->Flux[i].nodeup-1].t_conc[j],temp_conc, CD->Vcele[CD->Flux[i].nodelo-1].t_conc[j], temp_conc * flux_t, - diff_flux  - disp_flux, CD->Flux[i].s_area);
-             * }
-             * if (( CD->Flux[i].nodeup == 58) && (j == 2) && ((int)t % 1440 == 0)){
-             * fprintf(stderr, "%s fromid %d, toid %d, flux: %f, velo: %f, dist: %f, vol:%f, conc: %f, sconc: %f, nconc: %f, adv_trans: %g, diff_trans: %g, s_area: %f\n",CD->chemtype[j].ChemName, CD->Flux[i].nodeup, CD->Flux[i].nodelo,  CD->Flux[i].flux, CD->Flux[i].velocity, CD->Flux[i].distance, CD->Vcele[CD->Flux[i].nodeup-1].vol, CD->Vcele[CD->Flux[i].nodeup-1].t_conc[j],temp_conc, CD->Vcele[CD->Flux[i].nodelo-1].t_conc[j], temp_conc * flux_t, - diff_flux  - disp_flux, CD->Flux[i].s_area);
-             * }
-             * if (( CD->Flux[i].nodeup == 59) && (j == 2) && ((int)t % 1440 == 0)){
-             * fprintf(stderr, "%s fromid %d, toid %d, flux: %f, velo: %f, dist: %f, vol:%f, conc: %f, sconc: %f, nconc: %f, adv_trans: %g, diff_trans: %g, s_area: %f\n",CD->chemtype[j].ChemName, CD->Flux[i].nodeup, CD->Flux[i].nodelo,  CD->Flux[i].flux, CD->Flux[i].velocity, CD->Flux[i].distance, CD->Vcele[CD->Flux[i].nodeup-1].vol, CD->Vcele[CD->Flux[i].nodeup-1].t_conc[j],temp_conc, CD->Vcele[CD->Flux[i].nodelo-1].t_conc[j], temp_conc * flux_t, - diff_flux  - disp_flux, CD->Flux[i].s_area);
-             * } */
+    if (f->BC == 0)
+    {
+        /* diffusion flux, effective diffusion coefficient, and longitudinal
+         * dispersion. diffusion is in the opposite direction of conc
+         * gradient */
+        pw = pow (CD->Vcele[node_1].porosity, CD->Cementation);
+        dv = (velocity < 0.0) ? velocity : -velocity;
+        for (j = 0; j < nspc; j++)
+        {
+            diff_conc = c2[j] - c1[j];
+            diff_flux = -(w->diff_coe[j] * pw) * inv_dist * diff_conc * area;
+            disp_flux = dv * w->disp_coe[j] * inv_dist * diff_conc * area;
+            fq[j] -= diff_flux + disp_flux;
         }
     }
 
+    for (j = 0; j < nspc; j++)
+        fq[j] *= unit_c;
+}
+
+static void UpdateCell (realtype t, realtype stepsize, Chem_Data CD, int i)
+{
+    Trans_Work     *w = &CD->Trans;
+    vol_conc       *cell = &CD->Vcele[i];
+    double         *dconc, *tmpconc;
+    double          diff_conc, unit_c, timelps, adpstep;
+    int             j, n, nspc;
+
+    nspc = CD->NumSpc;
+    unit_c = 1.0 / 1440;
+    dconc = &w->dconc[i * nspc];
+    tmpconc = &w->tmpconc[i * nspc];
 
     //Local time step part
 
-    for (i = 0; i < CD->NumOsv; i++)
+    if (CD->CptFlg == 1)
     {
-        if (CD->CptFlg == 1)
+        if ((cell->rt_step < stepsize) && (cell->height_t > 1.0E-3)
+            && (cell->height_o > 1.0E-3))
         {
-            if ((CD->Vcele[i].rt_step < stepsize)
-                && (CD->Vcele[i].height_t > 1.0E-3)
-                && (CD->Vcele[i].height_o > 1.0E-3))
+            // use its intrinsic smaller step for small cells/ fast flowing cells ~= slow cells (in term of time marching).
+            if (i < 2 * CD->NumEle + CD->NumRiv - CD->RivOff)
             {
-                // use its intrinsic smaller step for small cells/ fast flowing cells ~= slow cells (in term of time marching).
-                if (i < 2 * CD->NumEle + CD->NumRiv - CD->RivOff)
-                {
-                    timelps = t;
-                    invavg = 1.0 / stepsize;
-                    adpstep = CD->Vcele[i].rt_step;
-                    //      fprintf(stderr, " Local time step at cell %d is %f\n", CD->Vcele[i].index, CD->Vcele[i].rt_step);
+                timelps = t;
+                adpstep = cell->rt_step;
 
-                    //      fprintf(stderr, " %d cell is flowing at AdptTime\n",i+1);
-                    while (timelps < t + stepsize)
+                while (timelps < t + stepsize)
+                {
+                    if (adpstep > t + stepsize - timelps)
+                    {
+                        adpstep = t + stepsize - timelps;
+                    }
+                    diff_conc = 0.0;
+                    for (j = 0; j < nspc; j++)
                     {
-                        if (adpstep > t + stepsize - timelps)
+                        tmpconc[j] =
+                            dconc[j] * adpstep +
+                            cell->t_conc[j] * (cell->porosity * 0.5 *
+                            (cell->vol_o + cell->vol));
+                        if (CD->PrpFlg)
                         {
-                            adpstep = t + stepsize - timelps;
+                            if (cell->q > 0.0)
+                                tmpconc[j] +=
+                                    CD->Precipitation.t_conc[j] * cell->q *
+                                    adpstep * unit_c * CD->Condensation;
+                            // n_0 design for negative q
                         }
-                        diff_conc = 0.0;
-                        for (j = 0; j < CD->NumSpc; j++)
+                        if ((tmpconc[j] < 0.0)
+                            && (strcmp (CD->chemtype[j].ChemName, "'H+'")))
                         {
-                            tmpconc[j] =
-                                dconc[i][j] * adpstep +
-                                CD->Vcele[i].t_conc[j] *
-                                (CD->Vcele[i].porosity * 0.5 *
-                                (CD->Vcele[i].vol_o + CD->Vcele[i].vol));
-                            if (CD->PrpFlg)
-                            {
-                                if (CD->Vcele[i].q > 0.0)
-                                    tmpconc[j] +=
-                                        CD->Precipitation.t_conc[j] *
-                                        CD->Vcele[i].q * adpstep * unit_c *
-                                        CD->Condensation;
-                                if (CD->Vcele[i].q < 0.0)
-                                {
-                                    tmpconc[j] += 0.0;  // n_0 design
-                                }
-                            }
-                            if ((tmpconc[j] < 0.0)
-                                && (strcmp (CD->chemtype[j].ChemName,
-                                        "'H+'")))
-                            {
-                                fprintf (stderr,
-                                    "Local time stepping check\n");
-                                fprintf (stderr,
-                                    "negative concentration change at species %s !\n",
-                                    CD->chemtype[j].ChemName);
-                                fprintf (stderr,
-                                    "Change from fluxes: %8.4g\n",
-                                    dconc[i][j] * adpstep);
-                                fprintf (stderr,
-                                    "Change from precipitation: %8.4g\n",
-                                    CD->Precipitation.t_conc[j] *
-                                    CD->Vcele[i].q * adpstep * unit_c *
-                                    CD->Condensation);
-                                fprintf (stderr, "Original mass: %8.4g\n",
-                                    CD->Vcele[i].t_conc[j] *
-                                    (CD->Vcele[i].porosity * 0.5 *
-                                        (CD->Vcele[i].vol_o +
-                                            CD->Vcele[i].vol)));
-                                fprintf (stderr,
-                                    "Old Conc: %8.4g\t New Conc: %8.4g\n",
-                                    CD->Vcele[i].t_conc[j], tmpconc[j]);
-                                ReportError (CD->Vcele[i], CD);
-                                abnormalflg = 1;
-                                CD->Vcele[i].illness++;
-                            }
-                            tmpconc[j] =
-                                tmpconc[j] / (CD->Vcele[i].porosity * 0.5 *
-                                (CD->Vcele[i].vol + CD->Vcele[i].vol_o));
-                            if (CD->Vcele[i].illness < 20)
-                            {
-                                diff_conc =
-                                    MAX (fabs
-                                    (CD->Vcele[i].t_conc[j] - tmpconc[j]),
-                                    diff_conc);
-                                CD->Vcele[i].t_conc[j] = tmpconc[j];
-                            }
+                            fprintf (stderr, "Local time stepping check\n");
+                            fprintf (stderr,
+                                "negative concentration change at species %s !\n",
+                                CD->chemtype[j].ChemName);
+                            fprintf (stderr, "Change from fluxes: %8.4g\n",
+                                dconc[j] * adpstep);
+                            fprintf (stderr,
+                                "Change from precipitation: %8.4g\n",
+                                CD->Precipitation.t_conc[j] * cell->q *
+                                adpstep * unit_c * CD->Condensation);
+                            fprintf (stderr, "Original mass: %8.4g\n",
+                                cell->t_conc[j] * (cell->porosity * 0.5 *
+                                    (cell->vol_o + cell->vol)));
+                            fprintf (stderr,
+                                "Old Conc: %8.4g\t New Conc: %8.4g\n",
+                                cell->t_conc[j], tmpconc[j]);
+                            ReportError (*cell, CD);
+                            cell->illness++;
                         }
-                        if (diff_conc > 1.0E-6) // which lead to the change in the flux of mass between cells
+                        tmpconc[j] =
+                            tmpconc[j] / (cell->porosity * 0.5 *
+                            (cell->vol + cell->vol_o));
+                        if (cell->illness < 20)
                         {
-                            for (j = 0; j < CD->NumSpc; j++)
-                                tmpconc[j] = 0.0;
-
-                            for (k = 0; k < CD->NumFac; k++)
-                            {
-                                if (CD->Flux[k].nodeup == CD->Vcele[i].index)
-                                {
-
-                                    node_1 = CD->Flux[k].nodeup - 1;
-                                    node_2 = CD->Flux[k].nodelo - 1;
-                                    node_3 = CD->Flux[k].nodeuu - 1;
-                                    node_4 = CD->Flux[k].nodell - 1;
-                                    flux_t = -CD->Flux[k].flux;
-                                    distance = CD->Flux[k].distance;
-                                    velocity = -CD->Flux[k].velocity;
-                                    area = CD->Flux[k].s_area;
-                                    inv_dist = 1.0 / distance;
-
-                                    for (j = 0; j < CD->NumSpc; j++)
-                                    {
-                                        diff_conc =
-                                            CD->Vcele[node_2].t_conc[j] -
-                                            CD->Vcele[node_1].t_conc[j];
-                                        diff_flux = 0.0;
-                                        disp_flux = 0.0;
-                                        if (CD->Flux[k].BC == 0)
-                                        {
-                                            diff_flux =
-                                                CD->chemtype[j].DiffCoe *
-                                                pow (CD->Vcele[node_1].
-                                                porosity, CD->Cementation);
-
-                                            if (velocity < 0.0)
-                                                disp_flux =
-                                                    velocity *
-                                                    CD->chemtype[j].DispCoe;
-                                            else
-                                                disp_flux =
-                                                    -velocity *
-                                                    CD->chemtype[j].DispCoe;
-
-                                            diff_flux =
-                                                -diff_flux * inv_dist *
-                                                diff_conc * area;
-
-                                            disp_flux =
-                                                disp_flux * inv_dist *
-                                                diff_conc * area;
-                                        }
-
-                                        temp_dconc = 0.0;
-                                        temp_conc = 0.0;
-
-                                        if (CD->TVDFlg == 0)
-                                        {
-                                            if (flux_t > 0)
-                                            {
-                                                temp_conc =
-                                                    CD->Vcele[node_2].
-                                                    t_conc[j];
-                                            }
-                                            else
-                                            {
-                                                temp_conc =
-                                                    CD->Vcele[node_1].
-                                                    t_conc[j];
-                                            }
-                                        }
-                                        if (CD->TVDFlg == 1)
-                                        {
-                                            if (flux_t > 0)
-                                            {
-                                                if (node_4 > 0)
-                                                {
-                                                    r_ = (CD->
-                                                        Vcele[node_2].t_conc
-                                                        [j] -
-                                                        CD->
-                                                        Vcele[node_4].t_conc
-                                                        [j] +
-                                                        EPSILON) /
-                                                        (CD->
-                                                        Vcele[node_1].t_conc
-                                                        [j] -
-                                                        CD->
-                                                        Vcele[node_2].t_conc
-                                                        [j] + EPSILON);
-                                                    beta_ =
-                                                        MAX (0, MIN (MIN (2,
-                                                                2 * r_),
-                                                            (2 + r_) / 3));
-                                                    temp_conc =
-                                                        CD->
-                                                        Vcele[node_2].t_conc
-                                                        [j] +
-                                                        beta_ *
-                                                        (CD->
-                                                        Vcele[node_1].t_conc
-                                                        [j] -
-                                                        CD->
-                                                        Vcele[node_2].t_conc
-                                                        [j]) * 0.5;
-                                                }
-                                                else
-                                                    temp_conc =
-                                                        CD->Vcele[node_2].
-                                                        t_conc[j];
-                                            }
-                                            else
-                                            {
-                                                if (node_3 > 0)
-                                                {
-                                                    r_ = (CD->
-                                                        Vcele[node_1].t_conc
-                                                        [j] -
-                                                        CD->
-                                                        Vcele[node_3].t_conc
-                                                        [j] +
-                                                        EPSILON) /
-                                                        (CD->
-                                                        Vcele[node_2].t_conc
-                                                        [j] -
-                                                        CD->
-                                                        Vcele[node_1].t_conc
-                                                        [j] + EPSILON);
-                                                    beta_ =
-                                                        MAX (0, MIN (MIN (2,
-                                                                2 * r_),
-                                                            (2 + r_) / 3));
-                                                    temp_conc =
-                                                        CD->
-                                                        Vcele[node_1].t_conc
-                                                        [j] +
-                                                        beta_ *
-                                                        (CD->
-                                                        Vcele[node_2].t_conc
-                                                        [j] -
-                                                        CD->
-                                                        Vcele[node_1].t_conc
-                                                        [j]) * 0.5;
-                                                }
-                                                else
-                                                    temp_conc =
-                                                        CD->Vcele[node_1].
-                                                        t_conc[j];
-                                            }
-                                        }
-
-                                        else
-                                        {
-                                            if (flux_t > 0)
-                                                temp_conc =
-                                                    CD->Vcele[node_2].
-                                                    t_conc[j];
-                                            else
-                                                temp_conc =
-                                                    CD->Vcele[node_1].
-                                                    t_conc[j];
-
-                                        }
-
-                                        if (CD->Flux[k].BC != 2)
-                                            temp_dconc += temp_conc * flux_t;
-                                        if (CD->Flux[k].BC == 0)
-                                            temp_dconc -=
-                                                diff_flux + disp_flux;
-
-                                        temp_dconc *= unit_c;
-
-                                        tmpconc[j] += temp_dconc;
-                                    }
-
-                                }
-                            }
-
-                            for (j = 0; j < CD->NumSpc; j++)
-                            {
-                                dconc[i][j] = tmpconc[j];
-                            }
+                            diff_conc =
+                                MAX (fabs (cell->t_conc[j] - tmpconc[j]),
+                                diff_conc);
+                            cell->t_conc[j] = tmpconc[j];
                         }
+                    }
+                    if (diff_conc > 1.0E-6) // which lead to the change in the flux of mass between cells
+                    {
+                        for (j = 0; j < nspc; j++)
+                            dconc[j] = 0.0;
+
+                        // only faces of this grid block are updated
+                        for (n = w->fstart[i]; n < w->fstart[i + 1]; n++)
+                        {
+                            double         *fq =
+                                &w->fconc[w->face[n] * nspc];
 
-                        timelps += adpstep;
-                        if (timelps >= t + stepsize)
-                            break;
+                            FaceFlux (CD, w->face[n], fq);
+                            for (j = 0; j < nspc; j++)
+                                dconc[j] += fq[j];
+                        }
                     }
+
+                    timelps += adpstep;
+                    if (timelps >= t + stepsize)
+                        break;
                 }
             }
         }
+    }
 
-        if ((CD->Vcele[i].height_t > 1.0E-3)
-            && (CD->Vcele[i].height_o > 1.0E-3))
-        {
+    if ((cell->height_t > 1.0E-3) && (cell->height_o > 1.0E-3))
+    {
 
-            if (CD->CptFlg)
+        if (CD->CptFlg)
+        {
+            if (cell->rt_step < stepsize)
+                return;         // treated in the above section
+            if ((i >= 2 * CD->NumEle) && (i < 2 * CD->NumEle + CD->NumRiv))
+                return;         // treated in the above section
+        }
+        // For blocks with very small content, we just skip it.
+        if (cell->BC != 2)
+        {
+            for (j = 0; j < nspc; j++)
             {
-                if (CD->Vcele[i].rt_step < stepsize)
-                    continue;   // treated in the above section
-                if ((i >= 2 * CD->NumEle) &&
-                    (i < 2 * CD->NumEle + CD->NumRiv))
-                    continue;   // treated in the above section
+                tmpconc[j] =
+                    dconc[j] * stepsize +
+                    cell->t_conc[j] * (cell->porosity * cell->vol_o);
+                // need consider the change of concentration at the unsat zone from precipitation.
+                if (CD->PrpFlg)
+                {
+                    if (cell->q > 0.0)
+                        tmpconc[j] +=
+                            CD->Precipitation.t_conc[j] * cell->q *
+                            stepsize * unit_c * CD->Condensation;
+                    // n_0 design for negative q
+                }
+                tmpconc[j] = tmpconc[j] / (cell->porosity * cell->vol);
             }
-            // For blocks with very small content, we just skip it.
-            if (CD->Vcele[i].BC != 2)
-            {
-                for (j = 0; j < CD->NumSpc; j++)
+            if (cell->illness < 20)
+                for (j = 0; j < nspc; j++)
                 {
-                    tmpconc[j] =
-                        dconc[i][j] * stepsize +
-                        CD->Vcele[i].t_conc[j] * (CD->Vcele[i].porosity *
-                        CD->Vcele[i].vol_o);
-                    // need consider the change of concentration at the unsat zone from precipitation.
-                    if (CD->PrpFlg)
+
+                    if ((tmpconc[j] < 0.0)
+                        && (strcmp (CD->chemtype[j].ChemName, "'H+'"))
+                        && (i < CD->NumEle * 2))
                     {
-                        if (CD->Vcele[i].q > 0.0)
-                            tmpconc[j] +=
-                                CD->Precipitation.t_conc[j] * CD->Vcele[i].q *
-                                stepsize * unit_c * CD->Condensation;
-                        if (CD->Vcele[i].q < 0.0)
-                        {
-                            tmpconc[j] += 0.0;  // n_0 design
-                        }
+                        fprintf (stderr,
+                            "negative concentration change at species %s !\n",
+                            CD->chemtype[j].ChemName);
+                        fprintf (stderr, "Change from fluxes: %8.4g\t",
+                            dconc[j] * stepsize);
+                        fprintf (stderr, "Original mass: %8.4g\n",
+                            cell->t_conc[j] * (cell->porosity *
+                                cell->vol_o));
+                        fprintf (stderr,
+                            "New mass: %8.4g\t New Volume: %8.4g\t Old Conc: %8.4g\t New Conc: %8.4g\t Timestep: %8.4g\n",
+                            dconc[j] * stepsize +
+                            cell->t_conc[j] * (cell->porosity * cell->vol_o),
+                            cell->porosity * cell->height_t * cell->area,
+                            cell->t_conc[j], tmpconc[j], cell->rt_step);
+                        ReportError (*cell, CD);
+                        cell->illness++;
                     }
-                    tmpconc[j] =
-                        tmpconc[j] / (CD->Vcele[i].porosity *
-                        CD->Vcele[i].vol);
+                    cell->t_conc[j] = tmpconc[j];
                 }
-                if (CD->Vcele[i].illness < 20)
-                    for (j = 0; j < CD->NumSpc; j++)
-                    {
-
-                        if ((tmpconc[j] < 0.0)
-                            && (strcmp (CD->chemtype[j].ChemName, "'H+'"))
-                            && (i < CD->NumEle * 2))
-                        {
-                            fprintf (stderr,
-                                "negative concentration change at species %s !\n",
-                                CD->chemtype[j].ChemName);
-                            fprintf (stderr, "Change from fluxes: %8.4g\t",
-                                dconc[i][j] * stepsize);
-                            fprintf (stderr, "Original mass: %8.4g\n",
-                                CD->Vcele[i].t_conc[j] *
-                                (CD->Vcele[i].porosity * CD->Vcele[i].vol_o));
-                            fprintf (stderr,
-                                "New mass: %8.4g\t New Volume: %8.4g\t Old Conc: %8.4g\t New Conc: %8.4g\t Timestep: %8.4g\n",
-                                dconc[i][j] * stepsize +
-                                CD->Vcele[i].t_conc[j] *
-                                (CD->Vcele[i].porosity * CD->Vcele[i].vol_o),
-                                CD->Vcele[i].porosity *
-                                CD->Vcele[i].height_t * CD->Vcele[i].area,
-                                CD->Vcele[i].t_conc[j], tmpconc[j],
-                                CD->Vcele[i].rt_step);
-                            ReportError (CD->Vcele[i], CD);
-                            CD->Vcele[i].illness++;
-                            abnormalflg = 1;
-                        }
-                        CD->Vcele[i].t_conc[j] = tmpconc[j];
-                    }
-            }
         }
     }
+}
+
+void OS3D (realtype t, realtype stepsize, Chem_Data CD)
+{
+
+    // input t and stepsize in the unit of minute
+
+    Trans_Work     *w = &CD->Trans;
+    int             i, nspc;
+
+    nspc = CD->NumSpc;
+
+    // Fluxes of all faces are computed first, each face independently
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < CD->NumFac; i++)
+    {
+        FaceFlux (CD, i, &w->fconc[i * nspc]);
+        CD->Flux[i].q = (nspc > 0) ? w->fconc[i * nspc + nspc - 1] : 0.0;
+    }
+
+    // then gathered by upstream grid blocks, so no two threads write the
+    // same grid block
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
     for (i = 0; i < CD->NumOsv; i++)
-        free (dconc[i]);
+    {
+        int             j, n;
+        double         *dconc = &w->dconc[i * nspc];
 
-    free (dconc);
-    free (tmpconc);
+        for (j = 0; j < nspc; j++)
+            dconc[j] = 0.0;
+        for (n = w->fstart[i]; n < w->fstart[i + 1]; n++)
+        {
+            const double   *fq = &w->fconc[w->face[n] * nspc];
+
+            for (j = 0; j < nspc; j++)
+                dconc[j] += fq[j];
+        }
+    }
+
+    // Grid blocks with local time steps use updated concentrations of the
+    // grid blocks before them, so they are only updated in parallel without
+    // local time stepping
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 64) if (CD->CptFlg != 1)
+#endif
+    for (i = 0; i < CD->NumOsv; i++)
+        UpdateCell (t, stepsize, CD, i);
 }
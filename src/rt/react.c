@@ -20,8 +20,7 @@
 #include <assert.h>
 
 /* SUNDIAL Header Files */
-#include "../pihm.h"
-#include "rt.h"                 /* Data Model and Variable Declarations for chemical processes */
+#include "pihm.h"
 
 #define UNIT_C     1440
 #define ZERO       1E-20
@@ -31,20 +30,28 @@
 #define EPSILON    1E-3
 #define TOL        1E-7
 #define TIGHT      10
-#define SKIP_JACOB 1
+#define JACOB_RATIO 0.25
+#define LN10       2.302585092994046
+#define FD_STEP    1E-6
+#define JACOB_TOL  1E-5
 #define ACT_ENERGY 10
 #define sqr(a)  (a)*(a)
 
 // default activation energy in case of 0 activation energy specified.
 
 int             keymatch (char *, char *, double *, char **);
-int             React (realtype, realtype, Chem_Data, int, int *);
+int             React (realtype, Chem_Data, int, int *, React_Work *);
+void            ReactWorkAlloc (Chem_Data);
+int             ReactSkip (Chem_Data, int, realtype, React_Work *);
+void            ReactCache (Chem_Data, int, React_Work *, int);
+void            TotConcJacob (Chem_Data, const double *, const int *, int,
+    realtype **);
 void            wrap (char *);
 void            ReportError (vol_conc, Chem_Data);
 int             SpeciationType (FILE *, char *);
 void            Lookup (FILE *, Chem_Data, int);
 int             Speciation (Chem_Data, int);
-int             React (realtype, realtype, Chem_Data, int, int *);
+int             React (realtype, Chem_Data, int, int *, React_Work *);
 
 void wrap (char *str)
 {
@@ -221,6 +228,7 @@ void Lookup (FILE * database, Chem_Data CD, int lookupflg)
         fgets (line, LINE_WIDTH, database);
     }
     total_temp_points = tmpval[0];
+    keq_position = 0;
     for (i = 0; i < tmpval[0]; i++)
     {
         if (tmpval[i + 1] == CD->Temperature)
@@ -231,6 +239,13 @@ void Lookup (FILE * database, Chem_Data CD, int lookupflg)
             keq_position = i + 1;
         }
     }
+    if (keq_position == 0)
+    {
+        PIHMprintf (VL_ERROR,
+            "Error: temperature point %6.4f C is not found in the database.\n",
+            CD->Temperature);
+        PIHMexit (EXIT_FAILURE);
+    }
     while (keymatch (line, "'Debye-Huckel adh'", tmpval, tmpstr) != 1)
     {
         fgets (line, LINE_WIDTH, database);
@@ -614,13 +629,14 @@ int Speciation (Chem_Data CD, int cell)
     /* if speciation flg = 1, pH is defined
      * if speciation flg = 0, all defined value is total concentration */
 
-    int             i, j, k, control, speciation_flg = CD->SPCFlg, num_spe =
+    int             i, j, control, speciation_flg = CD->SPCFlg, num_spe =
         CD->NumStc + CD->NumSsc;
-    double          residue[CD->NumStc], residue_t[CD->NumStc],
+    double          residue[CD->NumStc],
         tmpconc[CD->NumStc + CD->NumSsc], totconc[CD->NumStc];
-    double          tmpval, tmpprb = 1E-2, I, Iroot;
+    double          tmpval, I, Iroot;
     double          error[CD->NumStc], gamma[num_spe], Keq[CD->NumSsc],
-        current_totconc[CD->NumStc], adh, bdh, bdt;
+        adh, bdh, bdt, conc[num_spe];
+    int             ind[CD->NumStc];
     realtype      **jcb;
 
 
@@ -661,17 +677,11 @@ int Speciation (Chem_Data CD, int cell)
     for (i = 0; i < num_spe; i++)
         gamma[i] = 0;
 
-    for (i = 0; i < CD->NumStc; i++)
-    {
-        //    fprintf(stderr, " Sum%s:%12.10f\t %s:%12.10f\n",CD->chemtype[i].ChemName, log10(CD->Vcele[cell].t_conc[i]), CD->chemtype[i].ChemName,log10( CD->Vcele[cell].p_conc[i]));
-        current_totconc[i] = CD->Vcele[cell].t_conc[i];
-    }
-
     if (speciation_flg == 1)
     {
         /* pH is defined, total concentration is calculated from the activity of H */
         /* Dependency is the same but the total concentration for H need not be solved */
-        jcb = denalloc (CD->NumStc - 1);
+        jcb = newDenseMat (CD->NumStc - 1, CD->NumStc - 1);
         long int        p[CD->NumStc - 1];
         realtype        x_[CD->NumStc - 1];
         double          maxerror = 1;
@@ -722,67 +732,28 @@ int Speciation (Chem_Data CD, int cell)
                 tmpconc[i + CD->NumStc] = tmpval;
                 //      fprintf(stderr, " UPDATE %s %6.4f\n", CD->chemtype[i+CD->NumSpc].ChemName, tmpconc[i+CD->NumSpc]);
             }
+            for (j = 0; j < num_spe; j++)
+                conc[j] = pow (10, tmpconc[j]);
             for (i = 0; i < CD->NumStc; i++)
             {
                 tmpval = 0.0;
                 for (j = 0; j < num_spe; j++)
                 {
-                    tmpval += CD->Totalconc[i][j] * pow (10, tmpconc[j]);
-                    //fprintf(stderr, " %s %6.4f\t %6.4f\n", CD->chemtype[j].ChemName,CD->Totalconc[i][j], tmpconc[j]);
+                    tmpval += CD->Totalconc[i][j] * conc[j];
                 }
                 totconc[i] = tmpval;
                 if (strcmp (CD->chemtype[i].ChemName, "'H+'") == 0)
                     CD->Vcele[cell].t_conc[i] = totconc[i];
                 residue[i] = tmpval - CD->Vcele[cell].t_conc[i];
                 /* update the total concentration of H+ for later stage RT at initialization */
-                // fprintf(stderr, " Residue: Sum%s %6.4g\n", CD->chemtype[i].ChemName, residue[i]);
-            }
-            int             row, col;
-            col = 0;
-            for (k = 0; k < CD->NumStc; k++)
-            {
-                if (strcmp (CD->chemtype[k].ChemName, "'H+'") != 0)
-                {
-                    tmpconc[k] += tmpprb;
-                    for (i = 0; i < CD->NumSsc; i++)
-                    {
-                        tmpval = 0.0;
-                        for (j = 0; j < CD->NumSdc; j++)
-                            tmpval +=
-                                (tmpconc[j] +
-                                gamma[j]) * CD->Dependency[i][j];
-                        tmpval -= Keq[i] + gamma[i + CD->NumStc];
-                        tmpconc[i + CD->NumStc] = tmpval;
-                        //  fprintf(stderr, " CALC_SEC %s %6.4f\t %6.4f\n", CD->chemtype[i+CD->NumStc].ChemName, tmpval, pow(10,tmpconc[i+CD->NumStc]));
-                    }
-                    row = 0;
-                    for (i = 0; i < CD->NumStc; i++)
-                    {
-                        if (strcmp (CD->chemtype[i].ChemName, "'H+'") != 0)
-                        {
-                            tmpval = 0.0;
-                            for (j = 0; j < CD->NumStc + CD->NumSsc; j++)
-                            {
-                                tmpval +=
-                                    CD->Totalconc[i][j] * pow (10,
-                                    tmpconc[j]);
-                                //      fprintf(stderr, " CALC_TOT %s %6.4f\t %6.4f\n",CD->chemtype[j].ChemName, CD->Totalconc[i][j], pow(10,tmpconc[j]));
-                            }
-                            //totconc[i] = tmpval;
-                            //              fprintf(stderr, " CALC_TOT Sum%s %6.4f\t %12.10f\n", CD->chemtype[i].ChemName, log10(totconc[i]), totconc[i]);
-                            residue_t[i] = tmpval - CD->Vcele[cell].t_conc[i];
-                            //fprintf(stderr, " %d %d\n",col,row);
-                            jcb[col][row] =
-                                (residue_t[i] - residue[i]) / (tmpprb);
-                            //    fprintf(stderr, "%g\n", jcb[k][i]);
-                            //  fprintf(stderr, " Sum%s %6.4f\t %6.4f\n", CD->chemtype[i].ChemName, tmpval, residue_t[i]);
-                            row++;
-                        }
-                    }
-                    tmpconc[k] -= tmpprb;
-                    col++;
-                }
             }
+            /* H+ is not solved for */
+            int             row;
+            row = 0;
+            for (i = 0; i < CD->NumStc; i++)
+                if (strcmp (CD->chemtype[i].ChemName, "'H+'") != 0)
+                    ind[row++] = i;
+            TotConcJacob (CD, conc, ind, CD->NumStc - 1, jcb);
             row = 0;
             for (i = 0; i < CD->NumStc; i++)
                 if (strcmp (CD->chemtype[i].ChemName, "'H+'") != 0)
@@ -790,14 +761,14 @@ int Speciation (Chem_Data CD, int cell)
             //fprintf(stderr, " Jacobian Matrix!\n");
             //denprint(jcb, CD->NumSpc-1);
             //      fprintf(stderr, " LU flag %ld\n",gefa(jcb,CD->NumStc-1,p));
-            if (gefa (jcb, CD->NumStc - 1, p) != 0)
+            if (denseGETRF (jcb, CD->NumStc - 1, CD->NumStc - 1, p) != 0)
             {
 
                 ReportError (CD->Vcele[cell], CD);
                 return (1);
                 //  assert(gefa(jcb, CD->NumStc-1, p) == 0 );
             }
-            gesl (jcb, CD->NumStc - 1, p, x_);
+            denseGETRS (jcb, CD->NumStc - 1, p, x_);
             //   gauss(jcb, x_, CD->NumStc-1);
             //      assert(gefa(jcb, CD->NumStc-1, p)==0);
 
@@ -816,10 +787,10 @@ int Speciation (Chem_Data CD, int cell)
             control++;
         }
     }
-    if (speciation_flg == 0)
+    else
     {
         // fprintf(stderr, " \n\nTotal H+\n\n");
-        jcb = denalloc (CD->NumStc);
+        jcb = newDenseMat (CD->NumStc, CD->NumStc);
         long int        p[CD->NumStc];
         realtype        x_[CD->NumStc];
         control = 0;
@@ -864,55 +835,26 @@ int Speciation (Chem_Data CD, int cell)
                 tmpconc[i + CD->NumStc] = tmpval;
                 //      fprintf(stderr, " UPDATE %s %6.4f\n", CD->chemtype[i+CD->NumStc].ChemName, tmpconc[i+CD->NumStc]);
             }
+            for (j = 0; j < num_spe; j++)
+                conc[j] = pow (10, tmpconc[j]);
             for (i = 0; i < CD->NumStc; i++)
             {
                 tmpval = 0.0;
                 for (j = 0; j < CD->NumStc + CD->NumSsc; j++)
                 {
-                    tmpval += CD->Totalconc[i][j] * pow (10, tmpconc[j]);
-                    //  fprintf(stderr, " %s %6.4f\t %6.4f\n", CD->chemtype[j].ChemName,CD->Totalconc[i][j], tmpconc[j]);
+                    tmpval += CD->Totalconc[i][j] * conc[j];
                 }
                 totconc[i] = tmpval;
                 residue[i] = tmpval - CD->Vcele[cell].t_conc[i];
-                //      fprintf(stderr, " Residue: Sum%s %6.4f\n", CD->chemtype[i].ChemName, residue[i]);
-            }
-
-            for (k = 0; k < CD->NumStc; k++)
-            {
-                tmpconc[k] += tmpprb;
-                for (i = 0; i < CD->NumSsc; i++)
-                {
-                    tmpval = 0.0;
-                    for (j = 0; j < CD->NumSdc; j++)
-                        tmpval +=
-                            (tmpconc[j] + gamma[j]) * CD->Dependency[i][j];
-                    tmpval -= Keq[i] + gamma[i + CD->NumStc];
-                    tmpconc[i + CD->NumStc] = tmpval;
-                    // fprintf(stderr, " CALC_SEC %s %6.4f\t %6.4f\n", CD->chemtype[i+CD->NumSpc].ChemName, tmpval, pow(10,tmpconc[i+CD->NumSpc]));
-                }
-                for (i = 0; i < CD->NumStc; i++)
-                {
-                    tmpval = 0.0;
-                    for (j = 0; j < CD->NumStc + CD->NumSsc; j++)
-                    {
-                        tmpval += CD->Totalconc[i][j] * pow (10, tmpconc[j]);
-                        // fprintf(stderr, " CALC_TOT %s %6.4f\t %6.4f\n",CD->chemtype[j].ChemName, CD->Totalconc[i][j], pow(10,tmpconc[j]));
-                    }
-                    //    totconc[i] = tmpval;
-                    //fprintf(stderr, " CALC_TOT Sum%s %6.4f\t %12.10f\n", CD->chemtype[i].ChemName, log10(totconc[i]), totconc[i]);
-                    residue_t[i] = tmpval - CD->Vcele[cell].t_conc[i];
-                    jcb[k][i] = (residue_t[i] - residue[i]) / (tmpprb);
-
-                    //    fprintf(stderr, "%g\n", jcb[k][i]);
-                    //    fprintf(stderr, " Sum%s %6.4f\t %6.4f\n", CD->chemtype[i].ChemName, tmpval, residue_t[i]);
-                }
-                tmpconc[k] -= tmpprb;
             }
+            for (i = 0; i < CD->NumStc; i++)
+                ind[i] = i;
+            TotConcJacob (CD, conc, ind, CD->NumStc, jcb);
             for (i = 0; i < CD->NumStc; i++)
                 x_[i] = -residue[i];
             //      fprintf(stderr, " Jacobian Matrix!\n");
             //      denprint(jcb, CD->NumSpc);
-            if (gefa (jcb, CD->NumStc, p) != 0)
+            if (denseGETRF (jcb, CD->NumStc, CD->NumStc, p) != 0)
             {
 
                 ReportError (CD->Vcele[cell], CD);
@@ -920,11 +862,13 @@ int Speciation (Chem_Data CD, int cell)
                 //      assert(gefa(jcb, CD->NumStc, p) == 0 );
             }
             //   fprintf(stderr, " LU %ld\n",gefa(jcb,CD->NumStc,p));
-            gesl (jcb, CD->NumStc, p, x_);
+            denseGETRS (jcb, CD->NumStc, p, x_);
             //  gauss(jcb, x_, CD->NumStc);
             for (i = 0; i < CD->NumStc; i++)
             {
-                tmpconc[i] += x_[i];
+                /* Newton updates are bounded as in React, so that blocks
+                 * with trace amounts of some species do not overflow */
+                tmpconc[i] += MAX (MIN (x_[i], 0.3), -0.3);
                 //      fprintf(stderr, " %s  TMPCON %6.4f\t IMPROVE %g", CD->chemtype[i].ChemName, tmpconc[i], x_[i]);
                 error[i] = residue[i] / totconc[i];
                 //      fprintf(stderr, "  RESI %6.4g\t TOT_CONC %6.4g\t ERROR %6.4g\n", residue[i], totconc[i], error[i] );
@@ -987,53 +931,358 @@ int Speciation (Chem_Data CD, int cell)
     //  for ( i = 0; i < CD->NumStc; i ++){
     //   fprintf(stderr, " Sum%s: log10(TOTCONC_NR) %4.3f\t log10(TOTCONC_B) %4.3f\t TOTCONC_NR %4.3g\t RESIDUE %2.1g\t RELATIVE ERROR %2.1g\n", CD->chemtype[i].ChemName,log10(totconc[i]),log10(CD->Vcele[cell].t_conc[i]), totconc[i], fabs(residue[i]), fabs(error[i]*100));
     //  }
-    denfree (jcb);
+    destroyMat (jcb);
     return (0);
 
 }
 
 
+void TotConcJacob (Chem_Data CD, const double *conc, const int *ind, int n,
+    realtype **jcb)
+{
+    /*
+     * Analytic Jacobian of total concentrations with respect to log10
+     * concentrations of the primary species in ind. Secondary species depend
+     * on primary species through mass action, log10 c_s = sum_k nu_sk
+     * log10 c_k - log10 Keq_s (activity coefficients are lagged), so
+     *
+     *   d T_i / d log10 c_k = ln(10) * (U_ik c_k + sum_s U_is c_s nu_sk)
+     *
+     * where U is CD->Totalconc and nu is CD->Dependency. conc stores the
+     * concentrations of all species
+     */
+    int             i, k, s, row, col;
+    double          tmpval;
+
+    for (col = 0; col < n; col++)
+    {
+        k = ind[col];
+        for (row = 0; row < n; row++)
+        {
+            i = ind[row];
+            tmpval = CD->Totalconc[i][k] * conc[k];
+            if (k < CD->NumSdc)
+            {
+                for (s = 0; s < CD->NumSsc; s++)
+                    tmpval += CD->Totalconc[i][s + CD->NumStc] *
+                        conc[s + CD->NumStc] * CD->Dependency[s][k];
+            }
+            jcb[col][row] = LN10 * tmpval;
+        }
+    }
+}
+
+static double TotConcJacobErr (Chem_Data CD, const double *tmpconc,
+    const double *gamma, const double *Keq, const int *ind, int n,
+    realtype **jcb, React_Work *w)
+{
+    /*
+     * Maximum error of the analytic Jacobian against central differences of
+     * total concentrations, with secondary species from mass action and the
+     * same activity coefficients. Errors are relative to the largest entry
+     * of each row, so that small entries of the same total do not dominate
+     */
+    int             i, j, k, s, row, col, sign;
+    int             num_spe = CD->NumStc + CD->NumSsc;
+    double         *conc = w->fd_conc, *tot;
+    double          tmpval, fd, scale, err = 0.0;
+
+    for (col = 0; col < n; col++)
+    {
+        k = ind[col];
+        for (sign = 0; sign < 2; sign++)
+        {
+            tot = w->fd_tot + sign * n;
+
+            for (j = 0; j < num_spe; j++)
+                conc[j] = tmpconc[j];
+            conc[k] += (sign == 0) ? FD_STEP : -FD_STEP;
+
+            for (s = 0; s < CD->NumSsc; s++)
+            {
+                tmpval = 0.0;
+                for (j = 0; j < CD->NumSdc; j++)
+                    tmpval += (conc[j] + gamma[j]) * CD->Dependency[s][j];
+                conc[s + CD->NumStc] = tmpval - Keq[s] - gamma[s + CD->NumStc];
+            }
+
+            for (row = 0; row < n; row++)
+            {
+                i = ind[row];
+                tot[row] = 0.0;
+                for (j = 0; j < num_spe; j++)
+                    tot[row] += CD->Totalconc[i][j] * pow (10, conc[j]);
+            }
+        }
+
+        for (row = 0; row < n; row++)
+        {
+            scale = 0.0;
+            for (j = 0; j < n; j++)
+                scale = MAX (scale, fabs (jcb[j][row]));
+
+            fd = (w->fd_tot[row] - w->fd_tot[n + row]) / (2.0 * FD_STEP);
+            if (scale > 0.0)
+                err = MAX (err, fabs (jcb[col][row] - fd) / scale);
+        }
+    }
+
+    return (err);
+}
+
+void ReactWorkAlloc (Chem_Data CD)
+{
+    /* One workspace for each thread, so that React allocates nothing and
+     * cells can be reacted in parallel */
+    int             i, j;
+    int             stc = CD->NumStc, ssc = CD->NumSsc, nkr =
+        CD->NumMkr + CD->NumAkr, smc = CD->NumMin, num_spe =
+        CD->NumStc + CD->NumSsc;
+
+#ifdef _OPENMP
+    CD->NumWork = omp_get_max_threads ();
+#else
+    CD->NumWork = 1;
+#endif
+    CD->Work = (React_Work *) malloc (CD->NumWork * sizeof (React_Work));
+
+    for (i = 0; i < CD->NumWork; i++)
+    {
+        React_Work     *w = &CD->Work[i];
+
+        w->residue = (double *)malloc (stc * sizeof (double));
+        w->tmpconc = (double *)malloc (num_spe * sizeof (double));
+        w->totconc = (double *)malloc (stc * sizeof (double));
+        w->area = (double *)malloc (smc * sizeof (double));
+        w->error = (double *)malloc (stc * sizeof (double));
+        w->gamma = (double *)malloc (num_spe * sizeof (double));
+        w->Keq = (double *)malloc (ssc * sizeof (double));
+        w->Rate_pre = (double *)malloc (nkr * sizeof (double));
+        w->IAP = (double *)malloc (nkr * sizeof (double));
+        w->dependency = (double *)malloc (nkr * sizeof (double));
+        w->Rate_spe = (double *)malloc (stc * sizeof (double));
+        w->Rate_spet = (double *)malloc (stc * sizeof (double));
+        w->p = (long int *)malloc ((stc - smc) * sizeof (long int));
+        w->x_ = (realtype *) malloc ((stc - smc) * sizeof (realtype));
+        w->conc = (double *)malloc (num_spe * sizeof (double));
+        w->ind = (int *)malloc ((stc - smc) * sizeof (int));
+        for (j = 0; j < stc - smc; j++)
+            w->ind[j] = j;
+        w->jcb = newDenseMat (stc - smc, stc - smc);
+        w->nnewton = 0;
+        w->nfactor = 0;
+        w->t_pre = (double *)malloc (stc * sizeof (double));
+        w->nsolve = 0;
+        w->nskip = 0;
+        w->skip_est = 0.0;
+        w->skip_save = (double *)malloc ((3 * stc + 2 * ssc) * sizeof (double));
+        w->skip_solved = (double *)malloc ((2 * stc + ssc) * sizeof (double));
+        w->skip_terr = 0.0;
+        w->skip_cerr = 0.0;
+        w->fd_conc = (double *)malloc (num_spe * sizeof (double));
+        w->fd_tot = (double *)malloc (2 * (stc - smc) * sizeof (double));
+        w->jcb_err = 0.0;
+    }
+
+    CD->Cache = NULL;
+    if (CD->RxnTol > 0.0)
+    {
+        CD->Cache =
+            (React_Cache *) malloc (CD->NumVol * sizeof (React_Cache));
+        for (i = 0; i < CD->NumVol; i++)
+        {
+            CD->Cache[i].valid = 0;
+            CD->Cache[i].nskip = 0;
+            CD->Cache[i].t_conc = (double *)malloc (stc * sizeof (double));
+            CD->Cache[i].dt_conc = (double *)malloc (stc * sizeof (double));
+        }
+    }
+}
+
+static double RelChange (double x, double ref)
+{
+    // relative change of x from ref, infinite if ref is zero and x is not
+    if (x == ref)
+        return (0.0);
+    return ((ref != 0.0) ? fabs (x - ref) / fabs (ref) : HUGE_VAL);
+}
+
+static int SolveSkipped (Chem_Data CD, int cell, realtype stepsize,
+    React_Work *w)
+{
+    /* Debug mode: a skipped cell is also solved from the same state, so that
+     * the error of skipping can be measured. Concentrations of the solve are
+     * kept in skip_solved, and the cell state and Newton statistics are
+     * restored. Returns 1 if the solve succeeds */
+    vol_conc       *v = &CD->Vcele[cell];
+    double         *save = w->skip_save, *solved = w->skip_solved;
+    int             stc = CD->NumStc, ssc = CD->NumSsc;
+    int             i, nr, illness, success;
+    long int        nnewton = w->nnewton, nfactor = w->nfactor;
+
+    for (i = 0; i < stc; i++)
+    {
+        save[i] = v->t_conc[i];
+        save[stc + i] = v->p_conc[i];
+        save[2 * stc + i] = v->p_actv[i];
+        w->t_pre[i] = v->t_conc[i];
+    }
+    for (i = 0; i < ssc; i++)
+    {
+        save[3 * stc + i] = v->s_conc[i];
+        save[3 * stc + ssc + i] = v->s_actv[i];
+    }
+    illness = v->illness;
+
+    success = (React (stepsize, CD, cell, &nr, w) == 0);
+
+    for (i = 0; i < stc; i++)
+    {
+        solved[i] = v->t_conc[i];
+        solved[stc + i] = v->p_conc[i];
+        v->t_conc[i] = save[i];
+        v->p_conc[i] = save[stc + i];
+        v->p_actv[i] = save[2 * stc + i];
+    }
+    for (i = 0; i < ssc; i++)
+    {
+        solved[2 * stc + i] = v->s_conc[i];
+        v->s_conc[i] = save[3 * stc + i];
+        v->s_actv[i] = save[3 * stc + ssc + i];
+    }
+    v->illness = illness;
+    w->nnewton = nnewton;
+    w->nfactor = nfactor;
+
+    return (success);
+}
+
+static double Log10Diff (double x, double ref)
+{
+    // difference of log10 concentrations, zero if either is not positive
+    return ((x > 0.0 && ref > 0.0) ? fabs (log10 (x) - log10 (ref)) : 0.0);
+}
+
+int ReactSkip (Chem_Data CD, int cell, realtype stepsize, React_Work *w)
+{
+    /* Returns 1 if the reaction of the cell can be skipped. The change
+     * estimate of a skipped solve is the relative change of total
+     * concentrations, saturation and temperature since the last solve, plus
+     * the reaction change of the last solve times the number of steps it is
+     * lagged. The estimate is not an error bound: kinetic rates of the last
+     * solve are extrapolated, and secondary species are not checked. In
+     * debug mode, skipped cells are also solved, and the differences between
+     * skipped and solved concentrations are measured */
+    React_Cache    *c = &CD->Cache[cell];
+    vol_conc       *v = &CD->Vcele[cell];
+    double          drift, est;
+    int             i, solved = 0;
+
+    if (c->valid)
+    {
+        drift = RelChange (v->sat, c->sat);
+        drift = MAX (drift, RelChange (v->temperature, c->temperature));
+        for (i = 0; i < CD->NumStc && drift < CD->RxnTol; i++)
+            drift = MAX (drift, RelChange (v->t_conc[i], c->t_conc[i]));
+
+        est = drift + (c->nskip + 1) * c->dreact;
+        if (est < CD->RxnTol)
+        {
+            if (debug_mode)
+                solved = SolveSkipped (CD, cell, stepsize, w);
+
+            /* Kinetic reactions continue at the rates of the last solve, so
+             * that mass they transfer is not lost while the cell is
+             * skipped. The cached state moves with them, so that the drift
+             * only measures changes from transport */
+            for (i = 0; i < CD->NumStc; i++)
+            {
+                v->t_conc[i] += c->dt_conc[i];
+                c->t_conc[i] += c->dt_conc[i];
+            }
+            c->nskip++;
+            w->nskip++;
+            w->skip_est = MAX (w->skip_est, est);
+
+            if (solved)
+            {
+                for (i = 0; i < CD->NumStc; i++)
+                {
+                    w->skip_terr = MAX (w->skip_terr,
+                        RelChange (v->t_conc[i], w->skip_solved[i]));
+                    w->skip_cerr = MAX (w->skip_cerr,
+                        Log10Diff (v->p_conc[i],
+                            w->skip_solved[CD->NumStc + i]));
+                }
+                for (i = 0; i < CD->NumSsc; i++)
+                {
+                    w->skip_cerr = MAX (w->skip_cerr,
+                        Log10Diff (v->s_conc[i],
+                            w->skip_solved[2 * CD->NumStc + i]));
+                }
+            }
+            return (1);
+        }
+    }
+
+    // Equilibrium speciation of the last solve (p_conc and s_conc) is the
+    // initial guess of Newton iterations
+    for (i = 0; i < CD->NumStc; i++)
+        w->t_pre[i] = v->t_conc[i];
+    w->nsolve++;
+
+    return (0);
+}
+
+void ReactCache (Chem_Data CD, int cell, React_Work *w, int success)
+{
+    // Save the state of a cell after its reaction solve
+    React_Cache    *c = &CD->Cache[cell];
+    vol_conc       *v = &CD->Vcele[cell];
+    int             i;
+
+    c->valid = success;
+    c->nskip = 0;
+    if (!success)
+        return;
+
+    c->sat = v->sat;
+    c->temperature = v->temperature;
+    c->dreact = 0.0;
+    for (i = 0; i < CD->NumStc; i++)
+    {
+        c->dreact = MAX (c->dreact, RelChange (v->t_conc[i], w->t_pre[i]));
+        c->dt_conc[i] = v->t_conc[i] - w->t_pre[i];
+        c->t_conc[i] = v->t_conc[i];
+    }
+}
+
 int
-React (realtype t, realtype stepsize, Chem_Data CD, int cell, int *NR_times)
+React (realtype stepsize, Chem_Data CD, int cell, int *NR_times,
+    React_Work *w)
 {
 
     if (CD->Vcele[cell].sat < 1.0E-2)
         return (0);             // very dry, no reaction can take place.
-    int             i, j, k, control, speciation_flg = CD->SPCFlg, num_spe =
-        CD->NumStc + CD->NumSsc, min_pos, pivot_flg;
-    int             stc = CD->NumStc, ssc = CD->NumSsc, spc =
-        CD->NumSpc, sdc = CD->NumSdc, nkr = CD->NumMkr + CD->NumAkr, smc =
-        CD->NumMin;
-    double         *residue, *residue_t, *tmpconc, *totconc, *area, *error,
-        *gamma, *Keq, *Rate_pre, *IAP, *dependency, *Rate_spe, *Rate_spe_t,
-        *Rate_spet;
-    residue = (double *)malloc (stc * sizeof (double));
-    residue_t = (double *)malloc (stc * sizeof (double));
-    tmpconc = (double *)malloc (num_spe * sizeof (double));
-    totconc = (double *)malloc (stc * sizeof (double));
-    area = (double *)malloc (smc * sizeof (double));
-    error = (double *)malloc (stc * sizeof (double));
-    gamma = (double *)malloc (num_spe * sizeof (double));
-    Keq = (double *)malloc (ssc * sizeof (double));
-    Rate_pre = (double *)malloc (nkr * sizeof (double));
-    IAP = (double *)malloc (nkr * sizeof (double));
-    dependency = (double *)malloc (nkr * sizeof (double));
-    Rate_spe = (double *)malloc (stc * sizeof (double));
-    Rate_spe_t = (double *)malloc (stc * sizeof (double));
-    Rate_spet = (double *)malloc (stc * sizeof (double));
-    long int       *p =
-        (long int *)malloc ((CD->NumStc - CD->NumMin) * sizeof (long int));
-    realtype       *x_ =
-        (realtype *) malloc ((CD->NumStc - CD->NumMin) * sizeof (realtype));
-    double          tmpval, tmpprb, inv_sat, I, Iroot, tmpKeq, ISupdateflg,
+    int             i, j, k, control, min_pos, pivot_flg;
+    int             num_spe = CD->NumStc + CD->NumSsc;
+    double         *residue = w->residue,
+        *tmpconc = w->tmpconc, *totconc = w->totconc, *area = w->area,
+        *error = w->error, *gamma = w->gamma, *Keq = w->Keq,
+        *Rate_pre = w->Rate_pre, *IAP = w->IAP, *dependency = w->dependency,
+        *Rate_spe = w->Rate_spe, *Rate_spet = w->Rate_spet, *conc = w->conc;
+    int             refactor = 1;
+    double          prev_error;
+    long int       *p = w->p;
+    realtype       *x_ = w->x_;
+    double          tmpval, inv_sat, I, Iroot, tmpKeq,
         adh, bdh, bdt, maxerror =
-        1, surf_ratio, tot_cec, tmpprb_inv, kinetic_multiplier;
-    realtype      **jcb;
+        1, surf_ratio, tot_cec, kinetic_multiplier;
+    realtype      **jcb = w->jcb;
 
     control = 0;
+    prev_error = maxerror;
     kinetic_multiplier = 1.0;
-    tmpprb = 1.0E-2;
-    tmpprb_inv = 1.0 / tmpprb;
     inv_sat = 1.0 / CD->Vcele[cell].sat;
 
     if (CD->TEMcpl)
@@ -1119,7 +1368,6 @@ React (realtype t, realtype stepsize, Chem_Data CD, int cell, int *NR_times)
             Rate_spe[i] = Rate_spe[i] * inv_sat;
 
 
-    jcb = denalloc (CD->NumStc - CD->NumMin);
     /*
      * long int p[CD->NumStc];
      * realtype x_[CD->NumStc];
@@ -1261,74 +1509,51 @@ React (realtype t, realtype stepsize, Chem_Data CD, int cell, int *NR_times)
                 Rate_spet[i] = Rate_spet[i] * inv_sat;
 
 
+        for (j = 0; j < num_spe; j++)
+            conc[j] = pow (10, tmpconc[j]);
         for (i = 0; i < CD->NumStc - CD->NumMin; i++)
         {
             tmpval = 0.0;
             for (j = 0; j < CD->NumStc + CD->NumSsc; j++)
             {
-                tmpval += CD->Totalconc[i][j] * pow (10, tmpconc[j]);
-                //fprintf(stderr, " %s %6.4f\t %6.4f\n", CD->chemtype[j].ChemName,CD->Totalconc[i][j], tmpconc[j]);
+                tmpval += CD->Totalconc[i][j] * conc[j];
             }
             totconc[i] = tmpval;
             residue[i] =
                 tmpval - (CD->Vcele[cell].t_conc[i] +
                 (Rate_spe[i] + Rate_spet[i]) * stepsize * 0.5);
-            //residue[i] = tmpval -( CD->Vcele[cell].t_conc[i] + (Rate_spet[i])*stepsize);
-            //      fprintf(stderr, " %s Residue: %6.4g\t Sum1:%6.4g\tSum2:%6.4g\tRate1%6.4g\tRate2%6.4g\n", CD->chemtype[i].ChemName, residue[i],totconc[i], CD->Vcele[cell].t_conc[i], Rate_spe[i], Rate_spet[i]);
         }
-        if (control % SKIP_JACOB == 0)  // update jacobian every the other iteration
+        if (refactor)
         {
-            for (k = 0; k < CD->NumStc - CD->NumMin; k++)
+            /* Kinetic rates are lagged in the Jacobian */
+            TotConcJacob (CD, conc, w->ind, CD->NumStc - CD->NumMin, jcb);
+            if (debug_mode)
             {
-                tmpconc[k] += tmpprb;
-                for (i = 0; i < CD->NumSsc; i++)
+                tmpval = TotConcJacobErr (CD, tmpconc, gamma, Keq, w->ind,
+                    CD->NumStc - CD->NumMin, jcb, w);
+                w->jcb_err = MAX (w->jcb_err, tmpval);
+                if (tmpval > JACOB_TOL)
                 {
-                    tmpval = 0.0;
-                    for (j = 0; j < CD->NumSdc; j++)
-                        tmpval +=
-                            (tmpconc[j] + gamma[j]) * CD->Dependency[i][j];
-                    tmpval -= Keq[i] + gamma[i + CD->NumStc];
-                    tmpconc[i + CD->NumStc] = tmpval;
-                    // fprintf(stderr, " CALC_SEC %s %6.4f\t %6.4f\n", CD->chemtype[i+CD->NumSpc].ChemName, tmpval, pow(10,tmpconc[i+CD->NumSpc]));
+                    PIHMprintf (VL_ERROR,
+                        "Error: analytic Jacobian of total concentrations in "
+                        "grid block %d\ndiffers from finite differences by "
+                        "%g.\n", cell + 1, tmpval);
+                    PIHMexit (EXIT_FAILURE);
                 }
-                for (i = 0; i < CD->NumStc - CD->NumMin; i++)
-                {
-                    tmpval = 0.0;
-                    for (j = 0; j < CD->NumStc + CD->NumSsc; j++)
-                    {
-                        tmpval += CD->Totalconc[i][j] * pow (10, tmpconc[j]);
-                        // fprintf(stderr, " CALC_TOT %s %6.4f\t %6.4f\n",CD->chemtype[j].ChemName, CD->Totalconc[i][j], pow(10,tmpconc[j]));
-                    }
-                    //    totconc[i] = tmpval;
-                    //fprintf(stderr, " CALC_TOT Sum%s %6.4f\t %12.10f\n", CD->chemtype[i].ChemName, log10(totconc[i]), totconc[i]);
-                    residue_t[i] =
-                        tmpval - (CD->Vcele[cell].t_conc[i] +
-                        (Rate_spe[i] + Rate_spet[i]) * stepsize * 0.5);
-                    jcb[k][i] = (residue_t[i] - residue[i]) * tmpprb_inv;
-
-                    //  fprintf(stderr, "%g\n", jcb[k][i]);
-                    //  fprintf(stderr, " Sum%s %6.4f\t %6.4f\n", CD->chemtype[i].ChemName, tmpval, residue_t[i]);
-                }
-                tmpconc[k] -= tmpprb;
+            }
+            pivot_flg = denseGETRF (jcb, CD->NumStc - CD->NumMin,
+                CD->NumStc - CD->NumMin, p);
+            w->nfactor++;
+            if (pivot_flg != 0)
+            {
+                CD->Vcele[cell].illness++;
+                return (1);
             }
         }
         for (i = 0; i < CD->NumStc - CD->NumMin; i++)
             x_[i] = -residue[i];
-        //      fprintf(stderr, " Jacobian Matrix!\n");
-        //    if (control == 1) denprint(jcb, CD->NumStc);
-        //  fprintf(stderr, " LU %ld\n",gefa(jcb,CD->NumStc,p));
-        pivot_flg = gefa (jcb, CD->NumStc - CD->NumMin, p);
-        if (pivot_flg != 0)
-        {                       /*
-                                 * for ( i = 0 ; i < CD->NumStc; i ++)
-                                 * fprintf(stderr, "%d %s Conp: %6.4g\t, sat: %6.4g\t, height: %6.4g\t, tot_conc: %6.4g\n", cell , CD->chemtype[i].ChemName, CD->Vcele[cell].p_conc[i], CD->Vcele[cell].sat, CD->Vcele[cell].height_o, CD->Vcele[cell].t_conc[i]); */
-            CD->Vcele[cell].illness++;
-            //      denprint(jcb, CD->NumStc);
-            return (1);
-        }
-
         //    assert(pivot_flg ==0);
-        gesl (jcb, CD->NumStc - CD->NumMin, p, x_);
+        denseGETRS (jcb, CD->NumStc - CD->NumMin, p, x_);
 
         //    gauss(jcb, x_, CD->NumStc);
         for (i = 0; i < CD->NumStc - CD->NumMin; i++)
@@ -1351,12 +1576,16 @@ React (realtype t, realtype stepsize, Chem_Data CD, int cell, int *NR_times)
             if (fabs (error[i]) > maxerror)
                 maxerror = fabs (error[i]);
         control++;
+        w->nnewton++;
+        /* The LU factorization is kept (modified Newton) as long as errors
+         * decrease fast enough */
+        refactor = (maxerror > JACOB_RATIO * prev_error);
+        prev_error = maxerror;
         if (control > 10)
             return (1);
     }
 
     *(NR_times) = control;
-    denfree (jcb);
 
     //  fprintf(stderr, " Solution Reached After %d Newton Ralphson Iterations!\n", control);
     for (i = 0; i < CD->NumSsc; i++)
@@ -1428,22 +1657,6 @@ React (realtype t, realtype stepsize, Chem_Data CD, int cell, int *NR_times)
      * fprintf(stderr, " %d React maximum kinetic rate is %10.6g, sat %f, h %f, htot %f, %s is %14.12f!\n",cell, Rate_spe[11],  CD->Vcele[cell].sat, CD->Vcele[cell].height_t,CD->Vcele[cell].height_v, CD->chemtype[11].ChemName, CD->Vcele[cell].p_conc[11]);
      * }
      */
-    free (residue);
-    free (residue_t);
-    free (tmpconc);
-    free (totconc);
-    free (area);
-    free (error);
-    free (gamma);
-    free (Keq);
-    free (Rate_pre);
-    free (IAP);
-    free (dependency);
-    free (Rate_spe);
-    free (Rate_spe_t);
-    free (Rate_spet);
-    free (p);
-    free (x_);
     return (0);
 
 }
@@ -26,10 +26,8 @@
 #include <time.h>
 #include <assert.h>
 #include <sys/time.h>
-#include <omp.h>
 
-#include "../pihm.h"            /* Data Model and Variable Declarations     */
-#include "rt.h"                 /* Data Model and Variable Declarations for chemical processes */
+#include "pihm.h"            /* Data Model and Variable Declarations     */
 
 #define UNIT_C 1440
 #define ZERO   1E-20
@@ -42,16 +40,12 @@
 #define RTdepth 5.0
 
 /* Functions declarations and usage */
-realtype        rivArea (int, realtype, realtype);
-realtype        returnVal (realtype rArea, realtype rPerem, realtype eqWid,
-    realtype ap_Bool);
-realtype        CS_AreaOrPerem (int rivOrder, realtype rivDepth,
-    realtype rivCoeff, realtype a_pBool);
 static double   timer ();
 // timer, system function called to time subroutines
-void            Monitor (realtype, realtype, void *, Chem_Data);
+void            Monitor (realtype, realtype, const pihm_struct, Chem_Data);
 // adjust unphysical PIHM flux outputs by mass balance
-int             upstream (element, element, const void *);
+int             upstream (const elem_struct *, const elem_struct *,
+    const trigrid_struct *);
 // locate upstream nodes for TVD calculation
 int             realcheck (const char *);
 // check real number or real number range
@@ -59,17 +53,17 @@ int             keymatch (const char *, const char *, double *, char **);
 // keyword matching and data reading
 void            ConditionAssign (int, char *, int *);
 // Assign conditions to different cells
-void            chem_alloc (char *, const void *, const Control_Data,
-    Chem_Data, realtype);
-// chemical component initialization
-void            fluxtrans (realtype, realtype, const void *, Chem_Data,
-    N_Vector);
-// translational function to take PIHM outputs to RT calculation
-void            chem_updater (Chem_Data, void *);
+void            chem_updater (Chem_Data, const pihm_struct);
 // unused subroutine to update field properties from chemical reactions
 void            OS3D (realtype, realtype, Chem_Data);
 // operator splitting 3D (finite volume) for transport
-int             React (realtype, realtype, Chem_Data, int, int *);
+void            OS3DAlloc (Chem_Data);
+// persistent arrays of OS3D
+int             React (realtype, Chem_Data, int, int *, React_Work *);
+void            ReactWorkAlloc (Chem_Data);
+int             ReactSkip (Chem_Data, int, realtype, React_Work *);
+void            ReactCache (Chem_Data, int, React_Work *, int);
+// skip reaction of cells that change little, and cache states of reacted cells
 // kinetic reaction component
 void            Lookup (FILE *, Chem_Data, int);
 // database fetching
@@ -91,10 +85,11 @@ static double timer ()
     return ((double)(tp.tv_sec) + 1e-6 * tp.tv_usec);
 }
 
-void Monitor (realtype t, realtype stepsize, void *DS, Chem_Data CD)
+void Monitor (realtype t, realtype stepsize, const pihm_struct pihm,
+    Chem_Data CD)
 {
     /* unit of t and stepsize: min */
-    /* DS: model data              */
+    /* pihm: model data            */
 
     // this is to obtain the infiltration rate that can not be obtained from reading f.c
     // f.c outputs the last trial value, rather the best values of infiltration
@@ -109,8 +104,6 @@ void Monitor (realtype t, realtype stepsize, void *DS, Chem_Data CD)
 
     MF_CONVERT = (realtype) (24 * 60 * 60);
 
-    Model_Data      MD;
-    MD = (Model_Data) DS;
     rawtime = (time_t *) malloc (sizeof (time_t));
     *rawtime = (int)(t * 60);
     timestamp = gmtime (rawtime);
@@ -134,18 +127,18 @@ void Monitor (realtype t, realtype stepsize, void *DS, Chem_Data CD)
 
     for (j = 0; j < CD->NumEle; j++)
     {
-        hu = CD->Vcele[j + MD->NumEle].height_t;
+        hu = CD->Vcele[j + CD->NumEle].height_t;
         hg = CD->Vcele[j].height_t;
         depth = CD->Vcele[j].height_v;
         hn = ((swi + 1.0) * 0.5 * (depth - hg) - hu) * inv_swi;
         ht = depth - hg - hn;
 
-        if ((hg * ht > 0))
-            partratio = ht * 0.30 / hg; // One forth indicate third order relationship between S and Kr, and so on
-        if (hg <= 0)
-            partratio = 1.00E3; // no groundwater and flow essentially
         if (ht <= 0)
             partratio = 1.00E-3;        // no transient zone flow essentially
+        else if (hg <= 0)
+            partratio = 1.00E3; // no groundwater and flow essentially
+        else
+            partratio = ht * 0.30 / hg; // One forth indicate third order relationship between S and Kr, and so on
 
         A = partratio / (1 + partratio);
         tmpflux[j] = A;
@@ -214,7 +207,7 @@ void Monitor (realtype t, realtype stepsize, void *DS, Chem_Data CD)
     for (i = 0; i < CD->NumEle; i++)
     {
         sumflux1 = (CD->Vcele[i].height_t - CD->Vcele[i].height_o)
-            * MD->Ele[i].area * MD->Ele[i].Porosity;
+            * pihm->elem[i].topo.area * pihm->elem[i].soil.porosity;
         sumflux2 = sumflux1 - resflux[i];
         correction = -sumflux2 * UNIT_C / stepsize
             / CD->Flux[CD->Vcele[i].ErrDumper].flux;
@@ -223,9 +216,9 @@ void Monitor (realtype t, realtype stepsize, void *DS, Chem_Data CD)
         CD->Flux[CD->Vcele[i].ErrDumper].velocity =
             CD->Flux[CD->Vcele[i].ErrDumper].flux
             / CD->Flux[CD->Vcele[i].ErrDumper].s_area;
-        CD->Flux[CD->Vcele[i].ErrDumper - MD->NumEle].flux =
+        CD->Flux[CD->Vcele[i].ErrDumper - CD->NumEle].flux =
             -CD->Flux[CD->Vcele[i].ErrDumper].flux;
-        CD->Flux[CD->Vcele[i].ErrDumper - MD->NumEle].velocity =
+        CD->Flux[CD->Vcele[i].ErrDumper - CD->NumEle].velocity =
             -CD->Flux[CD->Vcele[i].ErrDumper].velocity;
         // fprintf(logfile, "%d\t%8.6f\t%8.6f\t%8.6f\t%8.6f\t%8.6f\t%8.6f\t%8.6f\t%8.6f\t%8.6f\t%8.6f\n", i+1, CD->Vcele[i].height_t, CD->Vcele[i].height_o, sumflux1, tmpflux[i], resflux[i], sumflux2, A, sumflux2 * UNIT_C/ stepsize , (sumflux1-resflux[i] + CD->Flux[CD->Vcele[i].ErrDumper].flux * unit_c )/sumflux1 * 100, correction);
     }
@@ -249,15 +242,16 @@ void Monitor (realtype t, realtype stepsize, void *DS, Chem_Data CD)
     for (i = CD->NumEle; i < CD->NumEle * 2; i++)
     {
         sumflux1 = (CD->Vcele[i].height_t - CD->Vcele[i].height_o)
-            * MD->Ele[i - MD->NumEle].area * MD->Ele[i - MD->NumEle].Porosity;
+            * pihm->elem[i - CD->NumEle].topo.area *
+            pihm->elem[i - CD->NumEle].soil.porosity;
         sumflux2 = sumflux1 - resflux[i];
         correction = -sumflux2 * UNIT_C / stepsize / CD->Vcele[i].q;
         A = CD->Flux[CD->Vcele[i].ErrDumper].flux;
         CD->Vcele[i].q = sumflux2 * UNIT_C / stepsize;
         CD->Vcele[i].q = MAX (CD->Vcele[i].q, 0.0);
         // input of rain water chemistry can not be negative;
-        CD->Vcele[i].q += fabs (MD->EleET[i - MD->NumEle][2] * MF_CONVERT)
-            * MD->Ele[i - MD->NumEle].area;
+        CD->Vcele[i].q += fabs (pihm->elem[i - CD->NumEle].wf.edir *
+            MF_CONVERT) * pihm->elem[i - CD->NumEle].topo.area;
         // in addition, the soil evaporation leaves chemicals inside
         // The above code is , ensure the q term, which is the net input of water resulted from precipitation, should be net precipitation plus soil evaporation. Note
         // that soil evaporation itself might not be accurate in flux-PIHM. If flux-PIHM underestimates soil evaporation, RT need overestimate the incoming concentration
@@ -283,57 +277,24 @@ void Monitor (realtype t, realtype stepsize, void *DS, Chem_Data CD)
     free (rawtime);
 }
 
-int upstream (element up, element lo, const void *DS)
+int upstream (const elem_struct *up, const elem_struct *lo,
+    const trigrid_struct *grid)
 {
     /* Locate the upstream grid of up -> lo flow */
     /* Require verification                      */
     /* only determines points in triangular elements */
+    /* point location uses the uniform grid index of mesh triangles,
+     * which returns the same element as a search over all elements */
 
-    double          x_, y_, x_a, x_b, x_c, y_a, y_b, y_c,
-        dot00, dot01, dot02, dot11, dot12, u, v, invDenom;
-
-    int             i, j, upstreamfound = 0;
-    x_ = 2 * up.x - lo.x;
-    y_ = 2 * up.y - lo.y;
-
-    Model_Data      MD;
-    MD = (Model_Data) DS;
-
-    //  fprintf(stderr,"%d\t%d\t%d\t%d\t",MD->NumEle,MD->Ele[up.nabr[0]].index,MD->Ele[up.nabr[1]].index,MD->Ele[up.nabr[2]].index);
-
-    for (i = 0; i < MD->NumEle; i++)
-    {
-        /* find point lies in which triangular element, a very interesting method */
-        if ((i != (up.index - 1)) && (i != (lo.index - 1)))
-        {
-            x_a = MD->Node[MD->Ele[i].node[0] - 1].x;
-            x_b = MD->Node[MD->Ele[i].node[1] - 1].x;
-            x_c = MD->Node[MD->Ele[i].node[2] - 1].x;
-            y_a = MD->Node[MD->Ele[i].node[0] - 1].y;
-            y_b = MD->Node[MD->Ele[i].node[1] - 1].y;
-            y_c = MD->Node[MD->Ele[i].node[2] - 1].y;
-            dot00 = (x_c - x_a) * (x_c - x_a) + (y_c - y_a) * (y_c - y_a);
-            dot01 = (x_c - x_a) * (x_b - x_a) + (y_c - y_a) * (y_b - y_a);
-            dot02 = (x_c - x_a) * (x_ - x_a) + (y_c - y_a) * (y_ - y_a);
-            dot11 = (x_b - x_a) * (x_b - x_a) + (y_b - y_a) * (y_b - y_a);
-            dot12 = (x_b - x_a) * (x_ - x_a) + (y_b - y_a) * (y_ - y_a);
-            invDenom = 1 / (dot00 * dot11 - dot01 * dot01);
-            u = (dot11 * dot02 - dot01 * dot12) * invDenom;
-            v = (dot00 * dot12 - dot01 * dot02) * invDenom;
-            if ((u > 0.0) && (v > 0.0) && (u + v < 1))
-            {
-                upstreamfound = 1;
-                //      fprintf(stderr, "The upstream of %d and %d is %d!\n",up.index, lo.index, MD->Ele[i].index);
-                return (MD->Ele[i].index);
-            }
-        }
-    }
-    if (upstreamfound == 0)
-    {
-        //    fprintf(stderr, "The upstream of %d and %d is beyond boundaries!\n",up.index, lo.index);
-        return (0);
-    }
-    return (0);
+    int             i;
+    double          x, y;
+
+    x = 2 * up->topo.x - lo->topo.x;
+    y = 2 * up->topo.y - lo->topo.y;
+    i = LocateTri (grid, x, y, up->ind - 1, lo->ind - 1);
+
+    // index of the upstream element, or 0 if beyond boundaries
+    return ((i >= 0) ? i + 1 : 0);
 }
 
 int realcheck (const char *words)
@@ -506,8 +467,8 @@ void ConditionAssign (int condition, char *str, int *index)
 
 
 void
-chem_alloc (char *filename, const void *DS, const Control_Data CS,
-    Chem_Data CD, realtype t)
+chem_alloc (char *filename, const pihm_struct pihm, Chem_Data CD,
+    realtype t)
 {
 
     int             i, j, k, num_face =
@@ -518,11 +479,10 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
     double          total_flux = 0.0, total_area = 0.0, tmpval[WORDS_LINE];
     time_t          rawtime;
     struct tm      *timeinfo;
+    const elem_struct *elem = pihm->elem;
+    const river_struct *riv = pihm->riv;
 
-    Model_Data      MD;
-    MD = (Model_Data) DS;
-
-    char            keyword[WORD_WIDTH], line[256], word[WORD_WIDTH];
+    char            line[LINE_WIDTH], word[WORD_WIDTH];
     char          **tmpstr = (char **)malloc (WORDS_LINE * sizeof (char *));
 
     timeinfo = (struct tm *)malloc (sizeof (struct tm));
@@ -551,12 +511,24 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
     /* get rid of the following paragraph after testing real input */
 
 
-    CD->NumVol = 2 * (MD->NumEle + MD->NumRiv) + 2;
+    CD->NumVol = 2 * (nelem + nriver) + 2;
     CD->NumOsv = CD->NumVol - 2;
-    CD->NumEle = MD->NumEle;
-    CD->NumRiv = MD->NumRiv;
+    CD->NumEle = nelem;
+    CD->NumRiv = nriver;
     // sat, unsat gw elements, river elements, ERB elements and their outlets
 
+    /* Grid block beneath the outlet river segment, for breakthrough output.
+     * River flows are routed through the blocks beneath river segments */
+    CD->Outlet = 2 * (nelem + nriver) - 1;
+    for (i = 0; i < nriver; i++)
+    {
+        if (riv[i].down < 0)
+        {
+            CD->Outlet = 2 * nelem + nriver + i;
+            break;
+        }
+    }
+
     CD->StartTime = t;
     CD->TVDFlg = 1;
     CD->OutItv = 1;
@@ -575,6 +547,7 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
     CD->NumBTC = 0;
     CD->NumPUMP = 0;
     CD->SUFEFF = 1;
+    CD->RxnTol = 0.0;
     /* default control variable if not found in input file */
 
 
@@ -703,7 +676,7 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
                 " The concentrations of infiltrating rainfall is set to be %f times of concentrations in precipitation.\n",
                 CD->Condensation);
             // under construction.
-            CD->Condensation *= CS->Cal.Prep_conc;
+            CD->Condensation *= pihm->cal.prep_conc;
             fprintf (stderr,
                 " The concentrations of infiltrating rainfall is set to be %f times of concentrations in precipitation.\n",
                 CD->Condensation);
@@ -730,6 +703,15 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
                 CD->TimRiv);
             // under construction.
         }
+        if (keymatch (line, "react_skip_tol", tmpval, tmpstr) == 1)
+        {
+            CD->RxnTol = tmpval[0];
+            // 0 for no skipping
+            if (CD->RxnTol > 0.0)
+                fprintf (stderr,
+                    " Reaction is skipped for cells that change less than %g since their last solve.\n",
+                    CD->RxnTol);
+        }
     }
 
 
@@ -759,6 +741,8 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
     species         Global_type;
     Global_type.ChemName = (char *)malloc (WORD_WIDTH * sizeof (char));
     strcpy (Global_type.ChemName, "GLOBAL");
+    Global_type.DiffCoe = 0.0;
+    Global_type.DispCoe = 0.0;
 
     rewind (chemfile);
     fgets (line, line_width, chemfile);
@@ -936,7 +920,7 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
         (int *)malloc ((CD->NumVol + 1) * sizeof (int));
     /* when user assign conditions to blocks, they start from 1 */
 
-    for (i = 0; i < CD->NumVol; i++)
+    for (i = 0; i < CD->NumVol + 1; i++)
         condition_index[i] = 0;
 
     vol_conc       *Condition_vcele =
@@ -1021,15 +1005,11 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
         fprintf (stderr,
             " Initializing the initial chemical distribution from file %s\n",
             tmpstr[2]);
-        char            cheminit[30];
-        strcpy (cheminit, "input/");
-        strcat (cheminit, filename);
-        strcat (cheminit, "/");
-        strcat (cheminit, tmpstr[2]);
+        char            cheminit[MAXSTRING];
+        CheckStrLen (snprintf (cheminit, MAXSTRING, "input/%s/%s", filename,
+            tmpstr[2]), cheminit);
         cheminitfile = fopen (cheminit, "r");
-        if (cheminitfile == NULL)
-            fprintf (stderr,
-                " Chemical initial distribution file is missing from input directory!\n");
+        CheckFile (cheminitfile, cheminit);
         initfile = 1;
     }
     fgets (line, line_width, chemfile);
@@ -1051,11 +1031,42 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
     {
         for (i = 0; i < CD->NumVol; i++)
         {
-            fscanf (cheminitfile, "%d %d", &k, condition_index + i + 1);
+            if (fscanf (cheminitfile, "%d %d", &k,
+                    condition_index + i + 1) != 2)
+            {
+                /* Ghost blocks may be left out of the file */
+                if (i < CD->NumOsv)
+                {
+                    PIHMprintf (VL_ERROR,
+                        "Error reading the initial condition of grid block "
+                        "%d.\n", i + 1);
+                    PIHMexit (EXIT_FAILURE);
+                }
+                break;
+            }
             // fprintf(stderr, "%6d %6d %6s\n", i+1, condition_index[i+1], chemcon[condition_index[i+1]-1]);
         }
     }
 
+    /* Ghost blocks take their concentrations from boundaries or
+     * precipitation, and only need a valid condition to start with */
+    for (i = 0; i < CD->NumVol; i++)
+    {
+        if (condition_index[i + 1] < 1 ||
+            condition_index[i + 1] > num_conditions)
+        {
+            if (i < CD->NumOsv)
+            {
+                PIHMprintf (VL_ERROR,
+                    "Error in the initial condition of grid block %d.\n"
+                    "Condition %d is not defined.\n",
+                    i + 1, condition_index[i + 1]);
+                PIHMexit (EXIT_FAILURE);
+            }
+            condition_index[i + 1] = 1;
+        }
+    }
+
     if (cheminitfile != NULL)
         fclose (cheminitfile);
 
@@ -1100,7 +1111,7 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
                     if (strcmp (tmpstr[2], "-ssa") == 0)
                         Condition_vcele[i].p_para[CD->NumSpc + CD->NumAds +
                             CD->NumCex + num_mineral] =
-                            tmpval[1] * CS->Cal.SSA;
+                            tmpval[1] * pihm->cal.ssa;
                     strcpy (con_chem_name[i]
                         [CD->NumSpc + CD->NumAds + CD->NumCex +
                             num_mineral], tmpstr[0]);
@@ -1114,7 +1125,7 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
                 }
                 if ((tmpstr[0][0] == '>') || (specflg == 2))
                 {               // adsorptive sites and species start with >
-                    Condition_vcele[i].t_conc[CD->NumSpc + num_ads] = tmpval[0] * CS->Cal.Site_den;     // this is the site density of the adsorptive species.
+                    Condition_vcele[i].t_conc[CD->NumSpc + num_ads] = tmpval[0] * pihm->cal.site_den;     // this is the site density of the adsorptive species.
                     Condition_vcele[i].p_type[CD->NumSpc + num_ads] = 2;
                     Condition_vcele[i].p_para[CD->NumSpc + num_ads] = 0;
                     // update when fill in the parameters for adsorption.
@@ -1365,15 +1376,12 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
     if (CD->PrpFlg == 2)
     {
 
-        CD->TSD_prepconc = (TSD *) malloc (sizeof (TSD));
+        fscanf (prepconc, "%s %d %d", word, &CD->NumPrep,
+            &CD->TSD_prepconc.length);
 
-        fscanf (prepconc, "%s %d %d", &(CD->TSD_prepconc->name),
-            &(CD->TSD_prepconc->index), &(CD->TSD_prepconc->length));
-
-        CD->prepconcindex =
-            (int *)malloc (CD->TSD_prepconc->index * sizeof (int));
-        // here prepconc.index is used to save the number of primary species. Must be equal to the number of primary species specified before.
-        for (i = 0; i < CD->TSD_prepconc->index; i++)
+        CD->prepconcindex = (int *)malloc (CD->NumPrep * sizeof (int));
+        // here NumPrep is used to save the number of primary species. Must be equal to the number of primary species specified before.
+        for (i = 0; i < CD->NumPrep; i++)
         {
             fscanf (prepconc, "%d", &(CD->prepconcindex[i]));
             if (CD->prepconcindex[i] > 0)
@@ -1386,34 +1394,28 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
         }
 
 
-        CD->TSD_prepconc->TS =
-            (realtype **) malloc ((CD->TSD_prepconc->length) *
-            sizeof (realtype *));
-        for (i = 0; i < CD->TSD_prepconc->length; i++)
+        CD->TSD_prepconc.ftime =
+            (int *)malloc (CD->TSD_prepconc.length * sizeof (int));
+        CD->TSD_prepconc.data =
+            (double **)malloc (CD->TSD_prepconc.length * sizeof (double *));
+        for (i = 0; i < CD->TSD_prepconc.length; i++)
         {
-            CD->TSD_prepconc->TS[i] =
-                (realtype *) malloc ((1 + CD->TSD_prepconc->index) *
-                sizeof (realtype));
+            CD->TSD_prepconc.data[i] =
+                (double *)malloc (CD->NumPrep * sizeof (double));
             fscanf (prepconc, "%d-%d-%d %d:%d:%d", &timeinfo->tm_year,
                 &timeinfo->tm_mon, &timeinfo->tm_mday, &timeinfo->tm_hour,
                 &timeinfo->tm_min, &timeinfo->tm_sec);
             timeinfo->tm_year = timeinfo->tm_year - 1900;
             timeinfo->tm_mon = timeinfo->tm_mon - 1;
             rawtime = timegm (timeinfo);
-            CD->TSD_prepconc->TS[i][0] = (realtype) rawtime;
-            for (j = 0; j < CD->TSD_prepconc->index; j++)
+            CD->TSD_prepconc.ftime[i] = (int)rawtime;
+            for (j = 0; j < CD->NumPrep; j++)
             {
-                fscanf (prepconc, "%lf", &CD->TSD_prepconc->TS[i][j + 1]);      // [i][0] stores the time
+                fscanf (prepconc, "%lf", &CD->TSD_prepconc.data[i][j]);
             }
-            /*
-             * fprintf(stderr, " %8.4f\t", CD->TSD_prepconc->TS[i][0] );
-             * for ( j = 1 ; j <= CD->TSD_prepconc->index; j ++)
-             * fprintf(stderr, " %d %6.4g\t", j , CD->TSD_prepconc->TS[i][j]);
-             * fprintf(stderr, "\n");
-             */
         }
 
-        CD->TSD_prepconc->iCounter = 0;
+        CD->PrepCtr = 0;
     }
 
 
@@ -1490,95 +1492,92 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
 
     /* Initializing volumetrics for groundwater (GW) cells */
 
-    for (i = 0; i < MD->NumEle; i++)
+    for (i = 0; i < nelem; i++)
     {
 
-        CD->Vcele[i].height_v = MD->Ele[i].zmax - MD->Ele[i].zmin;
-        CD->Vcele[i].height_o = MD->DummyY[i + 2 * MD->NumEle];
-        CD->Vcele[i].height_t = MD->DummyY[i + 2 * MD->NumEle];
-        CD->Vcele[i].area = MD->Ele[i].area;
-        CD->Vcele[i].porosity = MD->Ele[i].Porosity;
+        CD->Vcele[i].height_v = elem[i].topo.zmax - elem[i].topo.zmin;
+        CD->Vcele[i].height_o = elem[i].ws.gw;
+        CD->Vcele[i].height_t = elem[i].ws.gw;
+        CD->Vcele[i].area = elem[i].topo.area;
+        CD->Vcele[i].porosity = elem[i].soil.porosity;
         CD->Vcele[i].vol_o = CD->Vcele[i].area * CD->Vcele[i].height_o;
         CD->Vcele[i].vol = CD->Vcele[i].area * CD->Vcele[i].height_t;
         CD->Vcele[i].sat = 1.0;
         CD->Vcele[i].sat_o = 1.0;
-        //      CD->Vcele[i].temperature = (realtype) MD->Ele[i].temp;
+        CD->Vcele[i].temperature = elem[i].es.stc[0];
         CD->Vcele[i].reset_ref = 0;
         for (j = 0; j < 3; j++)
         {
-            if (condition_index[MD->Ele[i].nabr[j]] == condition_index[i + 1])
-                CD->Vcele[i].reset_ref = MD->Ele[i].nabr[j];
+            if (elem[i].nabr[j] > 0 &&
+                condition_index[elem[i].nabr[j]] == condition_index[i + 1])
+                CD->Vcele[i].reset_ref = elem[i].nabr[j];
         }
     }
 
     /* Initializing unsaturated zone (vadoze) */
 
-    for (i = MD->NumEle; i < 2 * MD->NumEle; i++)
+    for (i = nelem; i < 2 * nelem; i++)
     {
-        CD->Vcele[i].height_v = CD->Vcele[i - MD->NumEle].height_v;
-        CD->Vcele[i].height_o = MD->DummyY[i];
-        CD->Vcele[i].height_t = MD->DummyY[i];
-        CD->Vcele[i].area = MD->Ele[i - MD->NumEle].area;
-        CD->Vcele[i].porosity = MD->Ele[i - MD->NumEle].Porosity;
-        //    CD->Vcele[i].sat      = MD->DummyY[i]/ (CD->Vcele[i].height_v-CD->Vcele[i-MD->NumEle].height_o) ;
+        CD->Vcele[i].height_v = CD->Vcele[i - nelem].height_v;
+        CD->Vcele[i].height_o = elem[i - nelem].ws.unsat;
+        CD->Vcele[i].height_t = elem[i - nelem].ws.unsat;
+        CD->Vcele[i].area = elem[i - nelem].topo.area;
+        CD->Vcele[i].porosity = elem[i - nelem].soil.porosity;
         CD->Vcele[i].sat =
-            MD->DummyY[i] / (CD->Vcele[i].height_v -
-            CD->Vcele[i - MD->NumEle].height_o);
+            elem[i - nelem].ws.unsat / (CD->Vcele[i].height_v -
+            CD->Vcele[i - nelem].height_o);
         CD->Vcele[i].sat_o = CD->Vcele[i].sat;
         CD->Vcele[i].vol_o = CD->Vcele[i].area * CD->Vcele[i].height_o;
         CD->Vcele[i].vol = CD->Vcele[i].area * CD->Vcele[i].height_t;
-        //      CD->Vcele[i].temperature = MD->Ele[i - MD->NumEle].temp;
+        CD->Vcele[i].temperature = elem[i - nelem].es.stc[0];
         /* The saturation of unsaturated zone is the Hu divided by height of this cell */
         if (CD->Vcele[i].sat > 1.0)
             fprintf (stderr,
                 "Fatal Error, Unsaturated Zone Initialization For RT Failed!\n");
-        CD->Vcele[i].reset_ref = i - MD->NumEle + 1;
+        CD->Vcele[i].reset_ref = i - nelem + 1;
         // default reset reference of unsaturated cells are the groundwater cells underneath
     }
 
     /* Initializing River cells */
-    for (i = 2 * MD->NumEle; i < 2 * MD->NumEle + MD->NumRiv; i++)
+    for (i = 2 * nelem; i < 2 * nelem + nriver; i++)
     {
-        j = i - 2 * MD->NumEle;
-        CD->Vcele[i].height_v = MD->DummyY[i + MD->NumEle];
+        j = i - 2 * nelem;
+        CD->Vcele[i].height_v = riv[j].ws.stage;
         CD->Vcele[i].height_o = CD->Vcele[i].height_v;
         CD->Vcele[i].height_t = CD->Vcele[i].height_o;
-        CD->Vcele[i].area =
-            MD->Riv[j].Length *
-            CS_AreaOrPerem (MD->Riv_Shape[MD->Riv[j].shape - 1].interpOrd,
-            MD->DummyY[j + 3 * MD->NumEle], MD->Riv[j].coeff, 3);
+        CD->Vcele[i].area = riv[j].shp.length *
+            RivEqWid (riv[j].shp.intrpl_ord, riv[j].ws.stage,
+            riv[j].shp.coeff);
         CD->Vcele[i].porosity = 1.0;
         CD->Vcele[i].sat = 1.0;
         CD->Vcele[i].sat_o = CD->Vcele[i].sat;
         CD->Vcele[i].vol_o = CD->Vcele[i].area * CD->Vcele[i].height_o;
         CD->Vcele[i].vol = CD->Vcele[i].area * CD->Vcele[i].height_t;
-        CD->Vcele[i].reset_ref = i + MD->NumRiv + 1;
+        CD->Vcele[i].reset_ref = i + nriver + 1;
         // default reset reference of river segments are the EBR underneath
     }
 
 
     /* Initializing EBR cells */
-    for (i = 2 * MD->NumEle + MD->NumRiv; i < 2 * MD->NumEle + 2 * MD->NumRiv;
-        i++)
+    for (i = 2 * nelem + nriver; i < 2 * nelem + 2 * nriver; i++)
     {
-        j = i - 2 * MD->NumEle - MD->NumRiv;
-        CD->Vcele[i].height_v = MD->DummyY[i + MD->NumEle];
+        j = i - 2 * nelem - nriver;
+        CD->Vcele[i].height_v = riv[j].ws.gw;
         CD->Vcele[i].height_o = CD->Vcele[i].height_v;
         CD->Vcele[i].height_t = CD->Vcele[i].height_o;
-        CD->Vcele[i].area =
-            MD->Riv[j].Length *
-            CS_AreaOrPerem (MD->Riv_Shape[MD->Riv[j].shape - 1].interpOrd,
-            MD->DummyY[j + 3 * MD->NumEle], MD->Riv[j].coeff, 3);
+        CD->Vcele[i].area = riv[j].shp.length *
+            RivEqWid (riv[j].shp.intrpl_ord, riv[j].ws.stage,
+            riv[j].shp.coeff);
         CD->Vcele[i].porosity = 1.0;
         CD->Vcele[i].sat = 1.0;
         CD->Vcele[i].sat_o = CD->Vcele[i].sat;
         CD->Vcele[i].vol_o = CD->Vcele[i].area * CD->Vcele[i].height_o;
         CD->Vcele[i].vol = CD->Vcele[i].area * CD->Vcele[i].height_t;
         CD->Vcele[i].reset_ref = 0;
-        if (condition_index[MD->Riv[j].LeftEle] == condition_index[i + 1])
-            CD->Vcele[i].reset_ref = MD->Riv[j].LeftEle;
-        if (condition_index[MD->Riv[j].RightEle] == condition_index[i + 1])
-            CD->Vcele[i].reset_ref = MD->Riv[j].RightEle;
+        if (condition_index[riv[j].leftele] == condition_index[i + 1])
+            CD->Vcele[i].reset_ref = riv[j].leftele;
+        if (condition_index[riv[j].rightele] == condition_index[i + 1])
+            CD->Vcele[i].reset_ref = riv[j].rightele;
     }
 
     tmpval[0] = 0.0;
@@ -1600,7 +1599,6 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
 
     for (i = CD->NumOsv; i < CD->NumVol; i++)
     {
-        j = i - 2 * MD->NumEle - MD->NumRiv;
         CD->Vcele[i].height_v = 1.0;
         CD->Vcele[i].height_o = 1.0;
         CD->Vcele[i].height_t = 1.0;
@@ -1610,17 +1608,21 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
         CD->Vcele[i].sat_o = 1.0;
         CD->Vcele[i].vol_o = 1.0;
         CD->Vcele[i].vol = 1.0;
-        CD->Vcele[i].reset_ref = 2 * MD->NumEle + MD->NumRiv + 1;
+        CD->Vcele[i].reset_ref = 2 * nelem + nriver + 1;
     }
 
     /* Initializing concentration distributions */
 
+    // total concentrations of all grid blocks are stored in one block for OS3D
+    CD->Trans.conc =
+        (double *)malloc (CD->NumVol * CD->NumStc * sizeof (double));
+
     for (i = 0; i < CD->NumVol; i++)
     {
         CD->Vcele[i].index = i + 1;
         CD->Vcele[i].NumStc = CD->NumStc;
         CD->Vcele[i].NumSsc = CD->NumSsc;
-        CD->Vcele[i].t_conc = (double *)malloc (CD->NumStc * sizeof (double));
+        CD->Vcele[i].t_conc = &CD->Trans.conc[i * CD->NumStc];
         CD->Vcele[i].t_rate = (double *)malloc (CD->NumStc * sizeof (double));
         CD->Vcele[i].t_tol = (double *)malloc (CD->NumStc * sizeof (double));
         CD->Vcele[i].p_conc = (double *)malloc (CD->NumStc * sizeof (double));
@@ -1684,19 +1686,21 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
         }
     }
 
-    for (i = 0; i < MD->NumEle; i++)
+    /* Elements on both banks of a river segment are not neighbors. Their
+     * shared edge connects each of them to the EBR of the river segment */
+    for (i = 0; i < nelem; i++)
     {
         for (j = 0; j < 3; j++)
-            if (MD->Ele[i].nabr[j] > 0)
+            if (elem[i].nabr[j] != 0)
             {
                 num_face++;
             }
-        total_area += MD->Ele[i].area;
+        total_area += elem[i].topo.area;
     }
     CD->PIHMFac = num_face;
 
     num_face *= 2;
-    num_face += 2 * MD->NumEle + 6 * MD->NumRiv;
+    num_face += 2 * nelem + 6 * nriver;
     // A river + EBR taks 6 faces
 
     fprintf (stderr, " Total area of the watershed is %f m^2\n", total_area);
@@ -1708,221 +1712,114 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
     CD->Flux = (face *) malloc (CD->NumFac * sizeof (face));
     k = 0;
 
-    double          dist1, dist2, para_a, para_b, para_c, x_0, x_1, y_0, y_1;
-    int             index_0, index_1, rivi, control;
+    double          dist1, para_a, para_b, para_c, x_0, x_1, y_0, y_1;
+    int             index_0, index_1, l, nabr, offset;
 
-    for (i = 0; i < MD->NumEle; i++)
-    {
-        for (j = 0; j < 3; j++)
-            if (MD->Ele[i].nabr[j] > 0)
-            {
-                /* node indicates the index of grid blocks, not nodes at corners */
-                CD->Flux[k].nodeup = i + 1;
-                CD->Flux[k].nodelo = MD->Ele[i].nabr[j];
-                CD->Flux[k].nodeuu =
-                    upstream (MD->Ele[i], MD->Ele[MD->Ele[i].nabr[j] - 1],
-                    MD);
-                CD->Flux[k].nodell =
-                    upstream (MD->Ele[MD->Ele[i].nabr[j] - 1], MD->Ele[i],
-                    MD);
-                CD->Flux[k].flux_type = 0;
-                CD->Flux[k].BC = 0;
-                if (CD->Flux[k].nodeuu > 0)
-                    CD->Flux[k].distuu =
-                        sqrt (pow
-                        (MD->Ele[i].x - MD->Ele[CD->Flux[k].nodeuu - 1].x,
-                            2) + pow (MD->Ele[i].y -
-                            MD->Ele[CD->Flux[k].nodeuu - 1].y, 2));
-                else
-                    CD->Flux[k].distuu = 0.0;
-                if (CD->Flux[k].nodell > 0)
-                    CD->Flux[k].distll =
-                        sqrt (pow
-                        (MD->Ele[MD->Ele[i].nabr[j] - 1].x -
-                            MD->Ele[CD->Flux[k].nodell - 1].x,
-                            2) + pow (MD->Ele[MD->Ele[i].nabr[j] - 1].y -
-                            MD->Ele[CD->Flux[k].nodell - 1].y, 2));
-                else
-                    CD->Flux[k].distll = 0.0;
-
-                CD->Flux[k].distance =
-                    sqrt (pow (MD->Ele[i].x - MD->Ele[MD->Ele[i].nabr[j] -
-                            1].x,
-                        2) + pow (MD->Ele[i].y - MD->Ele[MD->Ele[i].nabr[j] -
-                            1].y, 2));
+    // uniform grid index of elements for upstream element location
+    trigrid_struct  tgrid;
+    double         *tri_x, *tri_y;
 
+    tri_x = (double *)malloc (3 * nelem * sizeof (double));
+    tri_y = (double *)malloc (3 * nelem * sizeof (double));
+    for (i = 0; i < nelem; i++)
+        for (j = 0; j < 3; j++)
+        {
+            tri_x[3 * i + j] = pihm->meshtbl.x[elem[i].node[j] - 1];
+            tri_y[3 * i + j] = pihm->meshtbl.y[elem[i].node[j] - 1];
+        }
+    BuildTriGrid (nelem, tri_x, tri_y, &tgrid);
+    free (tri_x);
+    free (tri_y);
 
-                index_0 = MD->Ele[i].node[(j + 1) % 3] - 1;
-                index_1 = MD->Ele[i].node[(j + 2) % 3] - 1;
-
-                x_0 = MD->Node[index_0].x;
-                y_0 = MD->Node[index_0].y;
-                x_1 = MD->Node[index_1].x;
-                y_1 = MD->Node[index_1].y;
+    /* Faces between gw blocks (l = 0), then faces between unsat blocks
+     * (l = 1) */
+    for (l = 0; l < 2; l++)
+    {
+        offset = l * nelem;
 
+        for (i = 0; i < nelem; i++)
+        {
+            for (j = 0; j < 3; j++)
+            {
+                if (elem[i].nabr[j] == 0)
+                    continue;
+
+                nabr = elem[i].nabr[j];
+
+                /* distance from the centroid of the element to the edge */
+                index_0 = elem[i].node[(j + 1) % 3] - 1;
+                index_1 = elem[i].node[(j + 2) % 3] - 1;
+                x_0 = pihm->meshtbl.x[index_0];
+                y_0 = pihm->meshtbl.y[index_0];
+                x_1 = pihm->meshtbl.x[index_1];
+                y_1 = pihm->meshtbl.y[index_1];
                 para_a = y_1 - y_0;
                 para_b = x_0 - x_1;
                 para_c = (x_1 - x_0) * y_0 - (y_1 - y_0) * x_0;
-
-                if ((para_a * MD->Ele[i].x + para_b * MD->Ele[i].y +
-                        para_c) * (para_a * MD->Ele[MD->Ele[i].nabr[j] -
-                            1].x + para_b * MD->Ele[MD->Ele[i].nabr[j] -
-                            1].y + para_c) > 0.0)
-                    fprintf (stderr,
-                        " two points at the same side of edge!\n");
                 dist1 =
-                    fabs (para_a * MD->Ele[i].x + para_b * MD->Ele[i].y +
+                    fabs (para_a * elem[i].topo.x + para_b * elem[i].topo.y +
                     para_c) / sqrt (para_a * para_a + para_b * para_b);
-                dist2 =
-                    fabs (para_a * MD->Ele[MD->Ele[i].nabr[j] - 1].x +
-                    para_b * MD->Ele[MD->Ele[i].nabr[j] - 1].y +
-                    para_c) / sqrt (para_a * para_a + para_b * para_b);
-                if ((CD->Flux[k].distance < dist1) ||
-                    (CD->Flux[k].distance < dist2))
-                {
-                    fprintf (stderr,
-                        "\n Checking the distance calculation wrong, total is %f, from ele to edge is %f, from edge to neighbor is %f\n",
-                        CD->Flux[k].distance, dist1, dist2);
-                    fprintf (stderr,
-                        " Ele coordinates, x: %f, y: %f\n Node_1 coordinates, x: %f, y: %f\n Node_2 coordinates, x: %f, y: %f\n Nabr x:%f, y:%f\n",
-                        MD->Ele[i].x, MD->Ele[i].y, x_0, y_0, x_1, y_1,
-                        MD->Ele[MD->Ele[i].nabr[j] - 1].x,
-                        MD->Ele[MD->Ele[i].nabr[j] - 1].y);
-                    fprintf (stderr,
-                        " node_1 x:%f y:%f\t node_2 x:%f y:%f node_3 x:%f y:%f nabr x:%f y:%f, no:%d\n",
-                        MD->Node[MD->Ele[i].node[0] - 1].x,
-                        MD->Node[MD->Ele[i].node[0] - 1].y,
-                        MD->Node[MD->Ele[i].node[1] - 1].x,
-                        MD->Node[MD->Ele[i].node[1] - 1].y,
-                        MD->Node[MD->Ele[i].node[2] - 1].x,
-                        MD->Node[MD->Ele[i].node[2] - 1].y,
-                        MD->Ele[MD->Ele[i].nabr[j] - 1].x,
-                        MD->Ele[MD->Ele[i].nabr[j] - 1].y, j);
-                }
-                else
-                {
-                    CD->Flux[k].distance = dist1;
-                }
-                for (rivi = 0; rivi < CD->NumRiv; rivi++)
-                {
-                    if ((CD->Flux[k].nodeup == MD->Riv[rivi].LeftEle)
-                        && (CD->Flux[k].nodelo == MD->Riv[rivi].RightEle))
-                    {
-                        CD->Flux[k].nodelo =
-                            2 * CD->NumEle + CD->NumRiv + rivi + 1;
-                        CD->Flux[k].nodeuu = 0;
-                        CD->Flux[k].nodell = 0;
-                        CD->Flux[k].distance = dist1;
-                        //      fprintf(stderr, " Riv - Watershed connection corrected, now from cell %d to cell %d\n", CD->Flux[k].nodeup, CD->Flux[k].nodelo);
-                    }
-                    if ((CD->Flux[k].nodeup == MD->Riv[rivi].RightEle)
-                        && (CD->Flux[k].nodelo == MD->Riv[rivi].LeftEle))
-                    {
-                        CD->Flux[k].nodelo =
-                            2 * CD->NumEle + CD->NumRiv + rivi + 1;
-                        CD->Flux[k].nodeuu = 0;
-                        CD->Flux[k].nodell = 0;
-                        CD->Flux[k].distance = dist1;
-                        //            fprintf(stderr, " Riv - Watershed connection corrected, now from cell %d to cell %d\n", CD->Flux[k].nodeup, CD->Flux[k].nodelo);
-                    }
-                }
-                k++;
-            }
-    }
 
-    for (i = 0; i < MD->NumEle; i++)
-    {
-        for (j = 0; j < 3; j++)
-            if (MD->Ele[i].nabr[j] > 0)
-            {
                 /* node indicates the index of grid blocks, not nodes at corners */
-                CD->Flux[k].nodeup = i + 1 + MD->NumEle;
-                CD->Flux[k].nodelo = MD->Ele[i].nabr[j] + MD->NumEle;
-                CD->Flux[k].nodeuu =
-                    upstream (MD->Ele[i], MD->Ele[MD->Ele[i].nabr[j] - 1],
-                    MD) + MD->NumEle;
-                CD->Flux[k].nodell =
-                    upstream (MD->Ele[MD->Ele[i].nabr[j] - 1], MD->Ele[i],
-                    MD) + MD->NumEle;
+                CD->Flux[k].nodeup = i + 1 + offset;
                 CD->Flux[k].flux_type = 0;
                 CD->Flux[k].BC = 0;
-                if (CD->Flux[k].nodeuu > 0)
-                    CD->Flux[k].distuu =
-                        sqrt (pow
-                        (MD->Ele[i].x - MD->Ele[CD->Flux[k].nodeuu - 1].x,
-                            2) + pow (MD->Ele[i].y -
-                            MD->Ele[CD->Flux[k].nodeuu - 1].y, 2));
-                else
-                    CD->Flux[k].distuu = 0.0;
-                if (CD->Flux[k].nodell > 0)
-                    CD->Flux[k].distll =
-                        sqrt (pow
-                        (MD->Ele[MD->Ele[i].nabr[j] - 1].x -
-                            MD->Ele[CD->Flux[k].nodell - 1].x,
-                            2) + pow (MD->Ele[MD->Ele[i].nabr[j] - 1].y -
-                            MD->Ele[CD->Flux[k].nodell - 1].y, 2));
-                else
-                    CD->Flux[k].distll = 0.0;
-                CD->Flux[k].distance =
-                    sqrt (pow (MD->Ele[i].x - MD->Ele[MD->Ele[i].nabr[j] -
-                            1].x,
-                        2) + pow (MD->Ele[i].y - MD->Ele[MD->Ele[i].nabr[j] -
-                            1].y, 2));
-                index_0 = MD->Ele[i].node[(j + 1) % 3] - 1;
-                index_1 = MD->Ele[i].node[(j + 2) % 3] - 1;
-                x_0 = MD->Node[index_0].x;
-                y_0 = MD->Node[index_0].y;
-                x_1 = MD->Node[index_1].x;
-                y_1 = MD->Node[index_1].y;
-                para_a = y_1 - y_0;
-                para_b = x_0 - x_1;
-                para_c = (x_1 - x_0) * y_0 - (y_1 - y_0) * x_0;
-                dist1 =
-                    fabs (para_a * MD->Ele[i].x + para_b * MD->Ele[i].y +
-                    para_c) / sqrt (para_a * para_a + para_b * para_b);
-                dist2 =
-                    fabs (para_a * MD->Ele[MD->Ele[i].nabr[j] - 1].x +
-                    para_b * MD->Ele[MD->Ele[i].nabr[j] - 1].y +
-                    para_c) / sqrt (para_a * para_a + para_b * para_b);
                 CD->Flux[k].distance = dist1;
-                for (rivi = 0; rivi < CD->NumRiv; rivi++)
+
+                if (nabr < 0)
                 {
-                    if ((CD->Flux[k].nodeup - CD->NumEle ==
-                            MD->Riv[rivi].LeftEle) &&
-                        (CD->Flux[k].nodelo - CD->NumEle ==
-                            MD->Riv[rivi].RightEle))
-                    {
-                        CD->Flux[k].nodelo =
-                            2 * CD->NumEle + CD->NumRiv + rivi + 1;
-                        CD->Flux[k].nodeuu = 0;
-                        CD->Flux[k].nodell = 0;
-                        CD->Flux[k].distance = dist1;
-                    }
-                    if ((CD->Flux[k].nodeup - CD->NumEle ==
-                            MD->Riv[rivi].RightEle)
-                        && (CD->Flux[k].nodelo - CD->NumEle ==
-                            MD->Riv[rivi].LeftEle))
-                    {
-                        CD->Flux[k].nodelo =
-                            2 * CD->NumEle + CD->NumRiv + rivi + 1;
-                        CD->Flux[k].nodeuu = 0;
-                        CD->Flux[k].nodell = 0;
-                        CD->Flux[k].distance = dist1;
-                    }
+                    /* river bank, connected to the EBR cell */
+                    CD->Flux[k].nodelo = 2 * nelem + nriver + (-nabr - 1) + 1;
+                    CD->Flux[k].nodeuu = 0;
+                    CD->Flux[k].nodell = 0;
+                    CD->Flux[k].distuu = 0.0;
+                    CD->Flux[k].distll = 0.0;
+                    k++;
+                    continue;
                 }
+
+                CD->Flux[k].nodelo = nabr + offset;
+                CD->Flux[k].nodeuu =
+                    upstream (&elem[i], &elem[nabr - 1], &tgrid);
+                CD->Flux[k].nodell =
+                    upstream (&elem[nabr - 1], &elem[i], &tgrid);
+                CD->Flux[k].distuu = (CD->Flux[k].nodeuu > 0) ?
+                    sqrt (pow (elem[i].topo.x -
+                        elem[CD->Flux[k].nodeuu - 1].topo.x, 2) +
+                    pow (elem[i].topo.y -
+                        elem[CD->Flux[k].nodeuu - 1].topo.y, 2)) : 0.0;
+                CD->Flux[k].distll = (CD->Flux[k].nodell > 0) ?
+                    sqrt (pow (elem[nabr - 1].topo.x -
+                        elem[CD->Flux[k].nodell - 1].topo.x, 2) +
+                    pow (elem[nabr - 1].topo.y -
+                        elem[CD->Flux[k].nodell - 1].topo.y, 2)) : 0.0;
+                if (CD->Flux[k].nodeuu > 0)
+                    CD->Flux[k].nodeuu += offset;
+                if (CD->Flux[k].nodell > 0)
+                    CD->Flux[k].nodell += offset;
+
+                if (l == 0 && (para_a * elem[i].topo.x +
+                        para_b * elem[i].topo.y + para_c) *
+                    (para_a * elem[nabr - 1].topo.x +
+                        para_b * elem[nabr - 1].topo.y + para_c) > 0.0)
+                    fprintf (stderr,
+                        " two points at the same side of edge!\n");
                 k++;
             }
+        }
     }
 
+    FreeTriGrid (&tgrid);
+
     /* Configure the connectivity of unsat - gw grid blocks follows */
 
     /* centered at unsat blocks */
 
-    for (i = MD->NumEle; i < 2 * MD->NumEle; i++)
+    for (i = nelem; i < 2 * nelem; i++)
     {
         CD->Vcele[i].ErrDumper = k;
         CD->Flux[k].nodeup = i + 1;
-        CD->Flux[k].nodelo = i + 1 - MD->NumEle;
+        CD->Flux[k].nodelo = i + 1 - nelem;
         CD->Flux[k].nodeuu = 0;
         CD->Flux[k].nodell = 0;
         CD->Flux[k].flux_type = 0;
@@ -1933,11 +1830,11 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
 
     /* centered at gw blocks */
 
-    for (i = 0; i < MD->NumEle; i++)
+    for (i = 0; i < nelem; i++)
     {
         CD->Vcele[i].ErrDumper = k;
         CD->Flux[k].nodeup = i + 1;
-        CD->Flux[k].nodelo = i + 1 + MD->NumEle;
+        CD->Flux[k].nodelo = i + 1 + nelem;
         CD->Flux[k].nodeuu = 0;
         CD->Flux[k].nodell = 0;
         CD->Flux[k].flux_type = 1;
@@ -1994,9 +1891,9 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
 
     /* Between River and Left */
     // River to left OFL 2
-    for (i = 0; i < MD->NumRiv; i++)
+    for (i = 0; i < nriver; i++)
     {
-        CD->Flux[k].nodeup = i + 2 * MD->NumEle + 1 + MD->NumRiv;
+        CD->Flux[k].nodeup = i + 2 * nelem + 1 + nriver;
         CD->Flux[k].nodelo = CD->NumVol;
         CD->Flux[k].nodeuu = 0;
         CD->Flux[k].nodell = 0;
@@ -2010,9 +1907,9 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
 
     /* Between River and Right */
     // River to right OFL 3
-    for (i = 0; i < MD->NumRiv; i++)
+    for (i = 0; i < nriver; i++)
     {
-        CD->Flux[k].nodeup = i + 2 * MD->NumEle + 1 + MD->NumRiv;
+        CD->Flux[k].nodeup = i + 2 * nelem + 1 + nriver;
         CD->Flux[k].nodelo = CD->NumVol;
         CD->Flux[k].nodeuu = 0;
         CD->Flux[k].nodell = 0;
@@ -2056,10 +1953,10 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
      */
     /* Between Left and EBR */
     // EBR to left  7
-    for (i = 0; i < MD->NumRiv; i++)
+    for (i = 0; i < nriver; i++)
     {
-        CD->Flux[k].nodeup = i + 2 * MD->NumEle + MD->NumRiv + 1;
-        CD->Flux[k].nodelo = MD->Riv[i].LeftEle;
+        CD->Flux[k].nodeup = i + 2 * nelem + nriver + 1;
+        CD->Flux[k].nodelo = riv[i].leftele;
         CD->Flux[k].nodeuu = 0;
         CD->Flux[k].nodell = 0;
         CD->Flux[k].flux_type = 0;
@@ -2067,17 +1964,17 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
         CD->Flux[k].flux = 0.0;
         CD->Flux[k].distance = 1.0;
         CD->Flux[k].s_area =
-            MD->Riv[i].Length * CD->Vcele[MD->Riv[i].LeftEle - 1].height_v;
+            riv[i].shp.length * CD->Vcele[riv[i].leftele - 1].height_v;
         k++;
     }
 
 
     /* Between Right and EBR */
     // EBR to right 8
-    for (i = 0; i < MD->NumRiv; i++)
+    for (i = 0; i < nriver; i++)
     {
-        CD->Flux[k].nodeup = i + 2 * MD->NumEle + MD->NumRiv + 1;
-        CD->Flux[k].nodelo = MD->Riv[i].RightEle;
+        CD->Flux[k].nodeup = i + 2 * nelem + nriver + 1;
+        CD->Flux[k].nodelo = riv[i].rightele;
         CD->Flux[k].nodeuu = 0;
         CD->Flux[k].nodell = 0;
         CD->Flux[k].flux_type = 0;
@@ -2085,24 +1982,17 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
         CD->Flux[k].flux = 0.0;
         CD->Flux[k].distance = 1.0;
         CD->Flux[k].s_area =
-            MD->Riv[i].Length * CD->Vcele[MD->Riv[i].RightEle - 1].height_v;
+            riv[i].shp.length * CD->Vcele[riv[i].rightele - 1].height_v;
         k++;
     }
 
     /* Between EBR */
     // To downstream EBR 9
-    for (i = 0; i < MD->NumRiv; i++)
+    for (i = 0; i < nriver; i++)
     {
-        if (i == MD->NumRiv - 1)
-        {
-            CD->Flux[k].nodeup = i + 2 * MD->NumEle + MD->NumRiv + 1;
-            CD->Flux[k].nodelo = CD->NumVol;
-        }
-        else
-        {
-            CD->Flux[k].nodeup = i + 2 * MD->NumEle + MD->NumRiv + 1;
-            CD->Flux[k].nodelo = i + 2 * MD->NumEle + MD->NumRiv + 2;
-        }
+        CD->Flux[k].nodeup = i + 2 * nelem + nriver + 1;
+        CD->Flux[k].nodelo = (riv[i].down > 0) ?
+            riv[i].down + 2 * nelem + nriver : CD->NumVol;
         CD->Flux[k].nodeuu = 0;
         CD->Flux[k].nodell = 0;
         CD->Flux[k].flux_type = 0;
@@ -2114,18 +2004,12 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
     }
 
     // From upstream EBR 10
-    for (i = 0; i < MD->NumRiv; i++)
+    // (flows from all upstream segments are lumped at this face)
+    for (i = 0; i < nriver; i++)
     {
-        if (i == 0)
-        {
-            CD->Flux[k].nodelo = CD->NumVol;
-            CD->Flux[k].nodeup = i + 2 * MD->NumEle + MD->NumRiv + 1;
-        }
-        else
-        {
-            CD->Flux[k].nodeup = i + 2 * MD->NumEle + MD->NumRiv + 1;
-            CD->Flux[k].nodelo = i + 2 * MD->NumEle + MD->NumRiv;
-        }
+        CD->Flux[k].nodeup = i + 2 * nelem + nriver + 1;
+        CD->Flux[k].nodelo = (riv[i].up > 0) ?
+            riv[i].up + 2 * nelem + nriver : CD->NumVol;
         CD->Flux[k].nodeuu = 0;
         CD->Flux[k].nodell = 0;
         CD->Flux[k].flux_type = 0;
@@ -2154,11 +2038,11 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
             (CD->chemtype[i + CD->NumSpc + CD->NumAds + CD->NumCex].ChemName,
                 "'CO2(*g)'"))
         {
-            CD->KeqKinect[i] += log10 (CS->Cal.PCO2);
+            CD->KeqKinect[i] += log10 (pihm->cal.pco2);
         }
         else
         {
-            CD->KeqKinect[i] += log10 (CS->Cal.Keq);
+            CD->KeqKinect[i] += log10 (pihm->cal.keq);
         }
     }
 
@@ -2167,7 +2051,7 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
     for (i = 0; i < CD->NumStc; i++)
     {
         fprintf (stderr, " Conc and SSA of each species: %6.4g %6.4g\n",
-            CD->Vcele[200].t_conc[i], CD->Vcele[200].p_para[i]);
+            CD->Vcele[0].t_conc[i], CD->Vcele[0].p_para[i]);
     }
 
     fprintf (stderr, " Kinetic Mass Matrx!\n\t\t");
@@ -2355,6 +2239,8 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
     free (forcfn);
     free (condition_index);
 
+    ReactWorkAlloc (CD);
+    OS3DAlloc (CD);
 
     fclose (chemfile);
     fclose (database);
@@ -2363,20 +2249,21 @@ chem_alloc (char *filename, const void *DS, const Control_Data CS,
 }
 
 void
-fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
-    N_Vector VY)
+fluxtrans (realtype t, realtype stepsize, const pihm_struct pihm,
+    Chem_Data CD)
 {
 
     /* unit of t and stepsize: min */
-    /* DS: model data              */
+    /* pihm: hydrologic states and fluxes of the current model step */
 
     int             i, j, k, NumEle, NumVol;
     struct tm      *timestamp;
     time_t         *rawtime;
     double          timelps, rt_step, temp_rt_step, peclet, tmptime, tmpval,
         invavg, unit_c, tmpconc, timer1, timer2;
-    realtype       *Y;
     realtype        MF_CONVERT;
+    const elem_struct *elem = pihm->elem;
+    const river_struct *riv = pihm->riv;
 
 
     NumEle = CD->NumEle;
@@ -2384,20 +2271,17 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
     k = 0;
     MF_CONVERT = (realtype) (24 * 60 * 60);
     rt_step = stepsize * (double)CD->AvgScl;    // by default, the largest averaging period is per 10 mins. Longer default averaging value will fail
-    Y = NV_DATA_S (VY);
     rawtime = (time_t *) malloc (sizeof (time_t));
     *rawtime = (int)(t * 60);
     timestamp = gmtime (rawtime);
     timelps = (t - CD->StartTime);
-    Model_Data      MD;
-    MD = (Model_Data) DS;
 
 
     for (i = NumEle; i < 2 * NumEle; i++)
     {
         j = i - NumEle;
         CD->Vcele[i].q +=
-            MAX (MD->ElePrep[j], 0.0) * CD->Vcele[i].area * MF_CONVERT;
+            MAX (elem[j].wf.prcp, 0.0) * CD->Vcele[i].area * MF_CONVERT;
     }
 
 
@@ -2414,15 +2298,15 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
 
     for (i = 0; i < NumEle; i++)
     {
-        CD->Vcele[i].height_tl = Y[i + 2 * NumEle];
-        CD->Vcele[i + NumEle].height_tl = Y[i + NumEle];
+        CD->Vcele[i].height_tl = elem[i].ws.gw;
+        CD->Vcele[i + NumEle].height_tl = elem[i].ws.unsat;
 
         for (j = 0; j < 3; j++)
-            if (MD->Ele[i].nabr[j] > 0)
+            if (elem[i].nabr[j] != 0)
             {
                 /* node indicates the index of grid blocks, not nodes at corners */
-                CD->Flux[k].flux += MD->FluxSub[i][j] * MF_CONVERT;
-                CD->Flux[k].s_area += MD->AreaSub[i][j];
+                CD->Flux[k].flux += elem[i].wf.subsurf[j] * MF_CONVERT;
+                CD->Flux[k].s_area += elem[i].topo.areasub[j];
                 CD->Flux[k].velocity += 0;
                 k++;
             }
@@ -2434,7 +2318,7 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
     for (i = 0; i < NumEle; i++)
     {
         for (j = 0; j < 3; j++)
-            if (MD->Ele[i].nabr[j] > 0)
+            if (elem[i].nabr[j] != 0)
             {
                 CD->Flux[k].flux = 0.0;
                 CD->Flux[k].s_area = 1.0;
@@ -2449,17 +2333,17 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
 
     for (i = NumEle; i < 2 * NumEle; i++)
     {
-        CD->Flux[k].velocity += MD->Recharge[i - NumEle] * MF_CONVERT;
+        CD->Flux[k].velocity += elem[i - NumEle].wf.rechg * MF_CONVERT;
         CD->Flux[k].flux +=
-            MD->Recharge[i - NumEle] * MF_CONVERT * CD->Vcele[i].area;
+            elem[i - NumEle].wf.rechg * MF_CONVERT * CD->Vcele[i].area;
         CD->Flux[k].s_area += CD->Vcele[i].area;
         k++;
     }
 
     for (i = 0; i < NumEle; i++)
     {
-        CD->Flux[k].velocity += -MD->Recharge[i] * MF_CONVERT;
-        CD->Flux[k].flux += -MD->Recharge[i] * MF_CONVERT * CD->Vcele[i].area;
+        CD->Flux[k].velocity += -elem[i].wf.rechg * MF_CONVERT;
+        CD->Flux[k].flux += -elem[i].wf.rechg * MF_CONVERT * CD->Vcele[i].area;
         CD->Flux[k].s_area += CD->Vcele[i].area;
         k++;
     }
@@ -2483,38 +2367,38 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
 
     //  fprintf(stderr, " Rivd is %f this day\n", CD->rivd);
 
-    for (i = 0; i < MD->NumRiv; i++)
+    for (i = 0; i < nriver; i++)
     {
-        CD->Flux[k].flux += MD->FluxRiv[i][2] * MF_CONVERT;
+        CD->Flux[k].flux += riv[i].wf.rivflow[LEFT_SURF2CHANL] * MF_CONVERT;
         k++;
     }
-    for (i = 0; i < MD->NumRiv; i++)
+    for (i = 0; i < nriver; i++)
     {
-        CD->Flux[k].flux += MD->FluxRiv[i][3] * MF_CONVERT;
+        CD->Flux[k].flux += riv[i].wf.rivflow[RIGHT_SURF2CHANL] * MF_CONVERT;
         k++;
     }
-    for (i = 0; i < MD->NumRiv; i++)
+    for (i = 0; i < nriver; i++)
     {
-        CD->Flux[k].flux +=
-            (MD->FluxRiv[i][7] + MD->FluxRiv[i][4]) * MF_CONVERT;
+        CD->Flux[k].flux += (riv[i].wf.rivflow[LEFT_AQUIF2AQUIF] +
+            riv[i].wf.rivflow[LEFT_AQUIF2CHANL]) * MF_CONVERT;
         k++;
     }
-    for (i = 0; i < MD->NumRiv; i++)
+    for (i = 0; i < nriver; i++)
     {
-        CD->Flux[k].flux +=
-            (MD->FluxRiv[i][8] + MD->FluxRiv[i][5]) * MF_CONVERT;
+        CD->Flux[k].flux += (riv[i].wf.rivflow[RIGHT_AQUIF2AQUIF] +
+            riv[i].wf.rivflow[RIGHT_AQUIF2CHANL]) * MF_CONVERT;
         k++;
     }
-    for (i = 0; i < MD->NumRiv; i++)
+    for (i = 0; i < nriver; i++)
     {
-        CD->Flux[k].flux +=
-            (MD->FluxRiv[i][9] + MD->FluxRiv[i][1]) * MF_CONVERT;
+        CD->Flux[k].flux += (riv[i].wf.rivflow[DOWN_AQUIF2AQUIF] +
+            riv[i].wf.rivflow[DOWN_CHANL2CHANL]) * MF_CONVERT;
         k++;
     }
-    for (i = 0; i < MD->NumRiv; i++)
+    for (i = 0; i < nriver; i++)
     {
-        CD->Flux[k].flux +=
-            (MD->FluxRiv[i][10] + MD->FluxRiv[i][0]) * MF_CONVERT;
+        CD->Flux[k].flux += (riv[i].wf.rivflow[UP_AQUIF2AQUIF] +
+            riv[i].wf.rivflow[UP_CHANL2CHANL]) * MF_CONVERT;
         k++;
     }
     /* update the cell volumetrics every averaging cycle */
@@ -2525,23 +2409,19 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
         // update the concentration in precipitation here.
         if (CD->PrpFlg == 2)
         {
-            while (CD->TSD_prepconc->TS[CD->TSD_prepconc->iCounter][0] <
-                (realtype) * rawtime)
-                CD->TSD_prepconc->iCounter++;
-            CD->TSD_prepconc->iCounter--;
-            //      fprintf(stderr, " %d %6.4f time %6.4f\n", CD->TSD_prepconc->iCounter, CD->TSD_prepconc->TS[CD->TSD_prepconc->iCounter][0], (realtype) * rawtime);
-            for (i = 0; i < CD->TSD_prepconc->index; i++)
+            while (CD->PrepCtr + 1 < CD->TSD_prepconc.length &&
+                CD->TSD_prepconc.ftime[CD->PrepCtr + 1] <= (int)*rawtime)
+                CD->PrepCtr++;
+            for (i = 0; i < CD->NumPrep; i++)
             {
                 if (CD->prepconcindex[i] > 0)
                 {
                     j = CD->prepconcindex[i] - 1;
                     if (CD->Precipitation.t_conc[j] !=
-                        CD->TSD_prepconc->TS[CD->TSD_prepconc->iCounter][i +
-                            1])
+                        CD->TSD_prepconc.data[CD->PrepCtr][i])
                     {
                         CD->Precipitation.t_conc[j] =
-                            CD->TSD_prepconc->TS[CD->TSD_prepconc->
-                            iCounter][i + 1];
+                            CD->TSD_prepconc.data[CD->PrepCtr][i];
                         fprintf (stderr,
                             " %s in precipitation is changed to %6.4g\n",
                             CD->chemtype[j].ChemName,
@@ -2585,7 +2465,7 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
         for (i = 0; i < NumEle; i++)
         {
             CD->Vcele[i].height_o = CD->Vcele[i].height_t;
-            CD->Vcele[i].height_t = MAX (Y[i + 2 * NumEle], 1.0E-5);
+            CD->Vcele[i].height_t = MAX (elem[i].ws.gw, 1.0E-5);
             CD->Vcele[i].height_int = CD->Vcele[i].height_t;
             CD->Vcele[i].height_sp =
                 (CD->Vcele[i].height_t - CD->Vcele[i].height_o) * invavg;
@@ -2598,7 +2478,7 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
         {
             j = i - NumEle;
             CD->Vcele[i].height_o = CD->Vcele[i].height_t;
-            CD->Vcele[i].height_t = MAX (Y[i], 1.0E-5);
+            CD->Vcele[i].height_t = MAX (elem[j].ws.unsat, 1.0E-5);
             CD->Vcele[i].height_int = CD->Vcele[i].height_t;
             CD->Vcele[i].height_sp =
                 (CD->Vcele[i].height_t - CD->Vcele[i].height_o) * invavg;
@@ -2612,42 +2492,38 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
             CD->Vcele[i].q *= invavg;
         }
         /* update river cells */
-        for (i = 2 * NumEle; i < 2 * NumEle + MD->NumRiv; i++)
+        for (i = 2 * NumEle; i < 2 * NumEle + nriver; i++)
         {
             j = i - 2 * NumEle;
             CD->Vcele[i].height_o = CD->Vcele[i].height_t;
-            CD->Vcele[i].height_t = MAX (Y[i + NumEle], 1.0E-5);
+            CD->Vcele[i].height_t = MAX (riv[j].ws.stage, 1.0E-5);
             CD->Vcele[i].height_int = CD->Vcele[i].height_t;
             CD->Vcele[i].height_sp =
                 (CD->Vcele[i].height_t - CD->Vcele[i].height_o) * invavg;
-            CD->Vcele[i].area =
-                MD->Riv[j].Length *
-                CS_AreaOrPerem (MD->Riv_Shape[MD->Riv[j].shape - 1].interpOrd,
-                Y[j + 3 * NumEle], MD->Riv[j].coeff, 3);
+            CD->Vcele[i].area = riv[j].shp.length *
+                RivEqWid (riv[j].shp.intrpl_ord, riv[j].ws.stage,
+                riv[j].shp.coeff);
             CD->Vcele[i].vol_o = CD->Vcele[i].area * CD->Vcele[i].height_o;
             CD->Vcele[i].vol = CD->Vcele[i].area * CD->Vcele[i].height_t;
         }
         /* update EBR cells */
-        for (i = 2 * NumEle + MD->NumRiv; i < 2 * (NumEle + MD->NumRiv); i++)
+        for (i = 2 * NumEle + nriver; i < 2 * (NumEle + nriver); i++)
         {
-            j = i - 2 * NumEle - MD->NumRiv;
+            j = i - 2 * NumEle - nriver;
             CD->Vcele[i].height_o = CD->Vcele[i].height_t;
-            CD->Vcele[i].height_t =
-                MAX (Y[i + NumEle],
-                1.0E-5) + MAX (Y[i + NumEle - MD->NumRiv],
-                1.0E-5) / CD->Vcele[i].porosity;
+            CD->Vcele[i].height_t = MAX (riv[j].ws.gw, 1.0E-5) +
+                MAX (riv[j].ws.stage, 1.0E-5) / CD->Vcele[i].porosity;
             CD->Vcele[i].height_int = CD->Vcele[i].height_t;
             CD->Vcele[i].height_sp =
                 (CD->Vcele[i].height_t - CD->Vcele[i].height_o) * invavg;
-            CD->Vcele[i].area =
-                MD->Riv[j].Length *
-                CS_AreaOrPerem (MD->Riv_Shape[MD->Riv[j].shape - 1].interpOrd,
-                Y[j + 3 * NumEle], MD->Riv[j].coeff, 3);
+            CD->Vcele[i].area = riv[j].shp.length *
+                RivEqWid (riv[j].shp.intrpl_ord, riv[j].ws.stage,
+                riv[j].shp.coeff);
             CD->Vcele[i].vol_o = CD->Vcele[i].area * CD->Vcele[i].height_o;
             CD->Vcele[i].vol = CD->Vcele[i].area * CD->Vcele[i].height_t;
         }
 
-        Monitor (t, stepsize * (double)CD->AvgScl, MD, CD);
+        Monitor (t, stepsize * (double)CD->AvgScl, pihm, CD);
 
         for (k = 0; k < CD->NumStc; k++)
         {
@@ -2743,7 +2619,7 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
                 tmpconc = 0.0;
                 for (i = 0; i < NumEle; i++)
                 {
-                    tmpval = MD->Ele[i].temp;
+                    tmpval = elem[i].es.stc[0];
                     CD->Vcele[i].temperature = tmpval;
                     CD->Vcele[i + NumEle].temperature = tmpval;
                     tmpconc += tmpval;
@@ -2795,7 +2671,7 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
         }
         /* step control ends */
 
-        chem_updater (CD, MD);  /* update essential chem/physical information for pihm */
+        chem_updater (CD, pihm);  /* update essential chem/physical information for pihm */
         CD->TimLst = timelps;
 
         for (i = NumEle; i < 2 * NumEle; i++)
@@ -2813,7 +2689,7 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
             CD->Flux[k].s_area = 0.0;
         }                       // for gw cells, contact area is needed for dispersion;
 
-        for (k; k < CD->NumFac; k++)
+        for (; k < CD->NumFac; k++)
         {
             CD->Flux[k].flux = 0.0;
             CD->Flux[k].velocity = 0.0;
@@ -2823,28 +2699,34 @@ fluxtrans (realtype t, realtype stepsize, const void *DS, Chem_Data CD,
 
 }
 
-void InitialChemFile (char *filename, int NumBTC, int *BTC_loc)
+void InitialChemFile (char *outputdir, char *filename, int NumBTC,
+    int *BTC_loc)
 {
 
     FILE           *Cfile[10];
     char           *cfn[10];
     int             i;
 
-    cfn[0] = (char *)malloc ((strlen (filename) + 20) * sizeof (char));
-    sprintf (cfn[0], "output/%s.conc", filename);
-    cfn[1] = (char *)malloc ((strlen (filename) + 20) * sizeof (char));
-    sprintf (cfn[1], "output/%s.gwt", filename);
-    cfn[2] = (char *)malloc ((strlen (filename) + 20) * sizeof (char));
-    sprintf (cfn[2], "output/%s.btcv", filename);
+    for (i = 0; i < 3 + NumBTC; i++)
+    {
+        cfn[i] = (char *)malloc (MAXSTRING * sizeof (char));
+    }
+    CheckStrLen (snprintf (cfn[0], MAXSTRING, "%s%s.conc", outputdir,
+        filename), cfn[0]);
+    CheckStrLen (snprintf (cfn[1], MAXSTRING, "%s%s.gwt", outputdir,
+        filename), cfn[1]);
+    CheckStrLen (snprintf (cfn[2], MAXSTRING, "%s%s.btcv", outputdir,
+        filename), cfn[2]);
     for (i = 3; i < 3 + NumBTC; i++)
     {
-        cfn[i] = (char *)malloc ((strlen (filename) + 20) * sizeof (char));
-        sprintf (cfn[i], "output/%s%d.btcv", filename, BTC_loc[i - 3]);
+        CheckStrLen (snprintf (cfn[i], MAXSTRING, "%s%s%d.btcv", outputdir,
+            filename, BTC_loc[i - 3]), cfn[i]);
     }
 
     for (i = 0; i < 3 + NumBTC; i++)
     {
         Cfile[i] = fopen (cfn[i], "w");
+        CheckFile (Cfile[i], cfn[i]);
         free (cfn[i]);
         fclose (Cfile[i]);
     }
@@ -2853,7 +2735,7 @@ void InitialChemFile (char *filename, int NumBTC, int *BTC_loc)
 }
 
 
-void PrintChem (char *filename, Chem_Data CD, realtype t)
+void PrintChem (char *outputdir, char *filename, Chem_Data CD, realtype t)
 {
 
     FILE           *Cfile[10];
@@ -2897,24 +2779,25 @@ void PrintChem (char *filename, Chem_Data CD, realtype t)
     if ((int)timelps % (CD->OutItv * 60) == 0)
     {
 
-        cfn[0] = (char *)malloc ((strlen (filename) + 12) * sizeof (char));
-        sprintf (cfn[0], "output/%s.conc", filename);
-        Cfile[0] = fopen (cfn[0], "a+");
-        cfn[1] = (char *)malloc ((strlen (filename) + 12) * sizeof (char));
-        sprintf (cfn[1], "output/%s.btcv", filename);
-        Cfile[1] = fopen (cfn[1], "a+");
-        cfn[2] = (char *)malloc ((strlen (filename) + 12) * sizeof (char));
-        sprintf (cfn[2], "output/%s.gwt", filename);
-        Cfile[2] = fopen (cfn[2], "a+");
+        for (i = 0; i < 3 + CD->NumBTC; i++)
+        {
+            cfn[i] = (char *)malloc (MAXSTRING * sizeof (char));
+        }
+        CheckStrLen (snprintf (cfn[0], MAXSTRING, "%s%s.conc", outputdir,
+            filename), cfn[0]);
+        CheckStrLen (snprintf (cfn[1], MAXSTRING, "%s%s.btcv", outputdir,
+            filename), cfn[1]);
+        CheckStrLen (snprintf (cfn[2], MAXSTRING, "%s%s.gwt", outputdir,
+            filename), cfn[2]);
         for (i = 3; i < 3 + CD->NumBTC; i++)
         {
-            cfn[i] =
-                (char *)malloc ((strlen (filename) + 20) * sizeof (char));
-            sprintf (cfn[i], "output/%s%d.btcv", filename,
-                CD->BTC_loc[i - 3]);
+            CheckStrLen (snprintf (cfn[i], MAXSTRING, "%s%s%d.btcv",
+                outputdir, filename, CD->BTC_loc[i - 3]), cfn[i]);
+        }
+        for (i = 0; i < 3 + CD->NumBTC; i++)
+        {
             Cfile[i] = fopen (cfn[i], "a+");
-            if (Cfile[i] == NULL)
-                fprintf (stderr, " Output BTC not found \n");
+            CheckFile (Cfile[i], cfn[i]);
         }
 
 
@@ -2973,9 +2856,9 @@ void PrintChem (char *filename, Chem_Data CD, realtype t)
             timestamp->tm_year + 1900, timestamp->tm_mon + 1,
             timestamp->tm_mday, timestamp->tm_hour, timestamp->tm_min);
         for (j = 0; j < CD->NumStc; j++)
-            fprintf (Cfile[1], "%12.8f\t", log10 (CD->Vcele[1109].p_conc[j]));
+            fprintf (Cfile[1], "%12.8f\t", log10 (CD->Vcele[CD->Outlet].p_conc[j]));
         for (j = 0; j < CD->NumSsc; j++)
-            fprintf (Cfile[1], "%12.8f\t", log10 (CD->Vcele[1109].s_conc[j]));
+            fprintf (Cfile[1], "%12.8f\t", log10 (CD->Vcele[CD->Outlet].s_conc[j]));
         fprintf (Cfile[1], "\n");
 
         /*
@@ -3058,9 +2941,9 @@ AdptTime (Chem_Data CD, realtype timelps, double rt_step, double hydro_step,
     double *start_step, int num_blocks)
 {
     double          stepsize, org_time, step_rst, end_time, substep;
-    double          timer1, timer2;
+    double          timer1 = 0.0, timer2 = 0.0;
     int             i, j, k, m, nr_tmp, nr_max, int_flg, tot_nr, NumEle,
-        NumVol;
+        NumVol, success;
 
     NumEle = CD->NumEle;
     NumVol = CD->NumVol;
@@ -3082,7 +2965,6 @@ AdptTime (Chem_Data CD, realtype timelps, double rt_step, double hydro_step,
     {
 
         nr_max = 5;
-        nr_tmp = 1;
 
         if (stepsize > end_time - timelps)
         {
@@ -3189,13 +3071,34 @@ AdptTime (Chem_Data CD, realtype timelps, double rt_step, double hydro_step,
             && ((int)(timelps + stepsize) %
                 (int)(CD->React_delay * stepsize) == 0))
         {
+            /* Cells are reacted in parallel, each thread with its own React
+             * workspace. Newton iteration counts differ among cells, so
+             * cells are scheduled dynamically */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) \
+    private(j, k, nr_tmp, substep, success) reduction(+:tot_nr)
+#endif
             for (i = 0; i < num_blocks; i++)
             {
+                React_Work     *w;
+
+#ifdef _OPENMP
+                w = &CD->Work[omp_get_thread_num ()];
+#else
+                w = &CD->Work[0];
+#endif
+                nr_tmp = 1;
+                success = (CD->Vcele[i].illness < 20);
+
+                if ((CD->RxnTol > 0.0) &&
+                    ReactSkip (CD, i, stepsize * CD->React_delay, w))
+                    continue;
+
                 if (CD->Vcele[i].illness < 20)
-                    if (React
-                        (timelps - (CD->React_delay * stepsize),
-                            stepsize * CD->React_delay, CD, i, &nr_tmp))
+                    if (React (stepsize * CD->React_delay, CD, i, &nr_tmp,
+                            w))
                     {
+                        success = 0;
                         fprintf (stderr,
                             "  ---> React failed at cell %12d.\t",
                             CD->Vcele[i].index);
@@ -3203,7 +3106,7 @@ AdptTime (Chem_Data CD, realtype timelps, double rt_step, double hydro_step,
                         substep = 0.5 * stepsize;
                         k = 2;
 
-                        while (j = React (timelps, substep, CD, i, &nr_tmp))
+                        while ((j = React (substep, CD, i, &nr_tmp, w)))
                         {
                             substep = 0.5 * substep;
                             k = 2 * k;
@@ -3213,36 +3116,21 @@ AdptTime (Chem_Data CD, realtype timelps, double rt_step, double hydro_step,
 
                         if (j == 0)
                         {
+                            success = 1;
                             tot_nr += nr_tmp;
                             fprintf (stderr,
                                 " Reaction passed with step equals to %f (1/%d)\n",
                                 substep, k);
                             for (j = 1; j < k; j++)
                             {
-                                React (timelps + j * substep, substep, CD, i,
-                                    &nr_tmp);
+                                React (substep, CD, i, &nr_tmp, w);
                                 tot_nr += nr_tmp;
                             }
 
                         }
-                        //              else
-                        //        {
-                        //          fprintf(stderr, " Taking smaller step does not work, altering initial guess!\n");
-                        /*
-                         * for ( j = 0; j < CD->NumStc; j ++){
-                         * if (CD->chemtype[j].itype == 4)
-                         * CD->Vcele[i].p_conc[j] = CD->Vcele[i].t_conc[j];
-                         * else
-                         * CD->Vcele[i].p_conc[j] = fabs(CD->Vcele[i].t_conc[j]*0.1);
-                         * }
-                         * //           CD->Vcele[i].illness ++ ;
-                         * for (j = 0; j < k; j ++){
-                         * m = MAX(React(timelps + j * substep, substep, CD, i , &nr_tmp),m);
-                         * }
-                         */
-                        //              if ( m == 1) ReportError(CD->Vcele[i],CD);
-                        //        }
                     }
+                if (CD->RxnTol > 0.0)
+                    ReactCache (CD, i, w, success);
                 tot_nr += nr_tmp;
             }
         }
@@ -3255,14 +3143,57 @@ AdptTime (Chem_Data CD, realtype timelps, double rt_step, double hydro_step,
     if ((!CD->RecFlg)
         && ((int)(timelps) % (int)(CD->React_delay * stepsize) == 0))
     {
+        long int        nnewton = 0, nfactor = 0;
+
+        for (i = 0; i < CD->NumWork; i++)
+        {
+            nnewton += CD->Work[i].nnewton;
+            nfactor += CD->Work[i].nfactor;
+        }
         fprintf (stderr,
             "  React from %f to %f, Temp:%f/%f, Average NR taken: %f, time elapsed %6.4f seconds\n",
             timelps - (CD->React_delay * stepsize), timelps,
             CD->Temperature_avg, CD->Temperature + 273.15,
             (double)tot_nr / (double)NumEle / 2.0, timer2 - timer1);
+        fprintf (stderr,
+            "  Newton iterations: %ld, Jacobian factorizations: %ld\n",
+            nnewton, nfactor);
+        if (debug_mode)
+        {
+            double          jcb_err = 0.0;
+
+            for (i = 0; i < CD->NumWork; i++)
+                jcb_err = MAX (jcb_err, CD->Work[i].jcb_err);
+            fprintf (stderr,
+                "  Maximum relative error of analytic Jacobians: %g\n",
+                jcb_err);
+        }
+        if (CD->RxnTol > 0.0)
+        {
+            long int        nsolve = 0, nskip = 0;
+            double          skip_est = 0.0, skip_terr = 0.0, skip_cerr = 0.0;
+
+            for (i = 0; i < CD->NumWork; i++)
+            {
+                nsolve += CD->Work[i].nsolve;
+                nskip += CD->Work[i].nskip;
+                skip_est = MAX (skip_est, CD->Work[i].skip_est);
+                skip_terr = MAX (skip_terr, CD->Work[i].skip_terr);
+                skip_cerr = MAX (skip_cerr, CD->Work[i].skip_cerr);
+            }
+            fprintf (stderr,
+                "  Reaction skipped in %ld of %ld cell solves (%.1f%%), maximum change estimate %g\n",
+                nskip, nsolve + nskip,
+                100.0 * (double)nskip / (double)MAX (nsolve + nskip, 1),
+                skip_est);
+            if (debug_mode)
+                fprintf (stderr,
+                    "  Maximum errors of skipped solves: %g relative in total concentrations, %g in log10 species concentrations\n",
+                    skip_terr, skip_cerr);
+        }
     }
 }
 
-void chem_updater (Chem_Data CD, void *DS)
+void chem_updater (Chem_Data CD, const pihm_struct pihm)
 {
 }
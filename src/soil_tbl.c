@@ -0,0 +1,484 @@
+#include "pihm.h"
+
+void InitVgTbl (elem_struct *elem, const soiltbl_struct *soiltbl,
+    const calib_struct *cal, const ctrl_struct *ctrl, vgtbl_struct *vgtbl)
+{
+    int             i, k;
+
+    /* Tables are built for each soil type, as van Genuchten parameters of
+     * elements only depend on soil type */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (k = 0; k < soiltbl->number; k++)
+    {
+        BuildVgTbl (&vgtbl[k], cal->alpha * soiltbl->alpha[k],
+            cal->beta * soiltbl->beta[k], ctrl->soil_tbl_tol);
+#ifdef _NOAH_
+        BuildFrzTbl (&vgtbl[k], cal->porosity * soiltbl->smcmin[k],
+            cal->porosity * soiltbl->smcmax[k]);
+#endif
+    }
+
+    for (k = 0; k < soiltbl->number; k++)
+    {
+        PIHMprintf (VL_VERBOSE, " Soil type %d: %d nodes per binade, "
+            "max relative error %.2e (Kr), %.2e (Psi), %.2e (dPsi).\n", k + 1,
+            vgtbl[k].nsub, vgtbl[k].err[KR_FN], vgtbl[k].err[PSI_FN],
+            vgtbl[k].err[DPSI_FN]);
+
+        if (vgtbl[k].err[KR_FN] > ctrl->soil_tbl_tol ||
+            vgtbl[k].err[PSI_FN] > ctrl->soil_tbl_tol ||
+            vgtbl[k].err[DPSI_FN] > ctrl->soil_tbl_tol)
+        {
+            PIHMprintf (VL_NORMAL, "Warning: Lookup tables of soil type %d "
+                "do not reach the tolerance of %.2e with %d nodes per "
+                "binade.\n", k + 1, ctrl->soil_tbl_tol, VGTBL_MAXSUB);
+        }
+    }
+
+    for (i = 0; i < nelem; i++)
+    {
+        elem[i].soil.vgtbl = &vgtbl[elem[i].attrib.soil_type - 1];
+    }
+
+    if (ctrl->soil_tbl_verify)
+    {
+        for (k = 0; k < soiltbl->number; k++)
+        {
+            VerifyVgTbl (&vgtbl[k], k);
+        }
+    }
+}
+
+void BuildVgTbl (vgtbl_struct *vgtbl, double alpha, double beta, double tol)
+{
+    int             fn, side, q;
+
+    vgtbl->alpha = alpha;
+    vgtbl->beta = beta;
+
+    for (fn = 0; fn < NUM_VGFN; fn++)
+    {
+        for (side = 0; side < 2; side++)
+        {
+            vgtbl->value[fn][side] = NULL;
+            vgtbl->slope[fn][side] = NULL;
+        }
+    }
+
+    /* The number of nodes is doubled until interpolation errors between
+     * nodes are within the tolerance */
+    for (vgtbl->nsub = VGTBL_MINSUB; vgtbl->nsub <= VGTBL_MAXSUB;
+        vgtbl->nsub *= 2)
+    {
+        vgtbl->nnode = VGTBL_NBIN * vgtbl->nsub + 1;
+
+        for (fn = 0; fn < NUM_VGFN; fn++)
+        {
+            for (side = 0; side < 2; side++)
+            {
+                double         *x;
+
+                vgtbl->value[fn][side] = (double *)realloc
+                    (vgtbl->value[fn][side], vgtbl->nnode * sizeof (double));
+                vgtbl->slope[fn][side] = (double *)realloc
+                    (vgtbl->slope[fn][side], vgtbl->nnode * sizeof (double));
+
+                x = (double *)malloc (vgtbl->nnode * sizeof (double));
+
+                for (q = 0; q < vgtbl->nnode; q++)
+                {
+                    x[q] = VgTblNode (vgtbl->nsub, q);
+                    vgtbl->value[fn][side][q] = VgFunc (fn,
+                        (side == 0) ? x[q] : 1.0 - x[q], alpha, beta);
+                }
+
+                MonotoneSlope (x, vgtbl->value[fn][side], vgtbl->nnode,
+                    vgtbl->slope[fn][side]);
+
+                free (x);
+            }
+        }
+
+        /* Errors are checked at quarter points of each interval */
+        for (fn = 0; fn < NUM_VGFN; fn++)
+        {
+            vgtbl->err[fn] = 0.0;
+
+            for (side = 0; side < 2; side++)
+            {
+                for (q = 0; q < vgtbl->nnode - 1; q++)
+                {
+                    int             m;
+                    double          x0, x1;
+
+                    x0 = VgTblNode (vgtbl->nsub, q);
+                    x1 = VgTblNode (vgtbl->nsub, q + 1);
+
+                    for (m = 1; m < 4; m++)
+                    {
+                        double          satn;
+                        double          err;
+
+                        satn = x0 + 0.25 * (double)m * (x1 - x0);
+                        satn = (side == 0) ? satn : 1.0 - satn;
+
+                        err = VgRelErr (VgTblValue (vgtbl, fn, satn),
+                            VgFunc (fn, satn, alpha, beta));
+                        vgtbl->err[fn] = (err > vgtbl->err[fn]) ?
+                            err : vgtbl->err[fn];
+                    }
+                }
+            }
+        }
+
+        if ((vgtbl->err[KR_FN] <= tol && vgtbl->err[PSI_FN] <= tol &&
+                vgtbl->err[DPSI_FN] <= tol) || vgtbl->nsub == VGTBL_MAXSUB)
+        {
+            break;
+        }
+    }
+}
+
+double VgTblNode (int nsub, int q)
+{
+    int             b;
+    int             j;
+
+    /* Binade b contains x in [2^(-b-2), 2^(-b-1)). The last node is at
+     * x = 0.5 */
+    b = VGTBL_NBIN - 1 - q / nsub;
+    j = q % nsub;
+
+    return (ldexp (0.5 + 0.5 * (double)j / (double)nsub, -b - 1));
+}
+
+void MonotoneSlope (const double *x, const double *y, int n, double *m)
+{
+    int             q;
+
+    /* Fritsch and Carlson (1980) monotone piecewise cubic slopes, with the
+     * weighted harmonic mean of Fritsch and Butland (1984) for interior
+     * nodes */
+    m[0] = (y[1] - y[0]) / (x[1] - x[0]);
+    m[n - 1] = (y[n - 1] - y[n - 2]) / (x[n - 1] - x[n - 2]);
+
+    for (q = 1; q < n - 1; q++)
+    {
+        double          h0, h1;
+        double          d0, d1;
+
+        h0 = x[q] - x[q - 1];
+        h1 = x[q + 1] - x[q];
+        d0 = (y[q] - y[q - 1]) / h0;
+        d1 = (y[q + 1] - y[q]) / h1;
+
+        if (d0 * d1 <= 0.0)
+        {
+            m[q] = 0.0;
+        }
+        else
+        {
+            double          w0, w1;
+
+            w0 = 2.0 * h1 + h0;
+            w1 = h1 + 2.0 * h0;
+
+            m[q] = (w0 + w1) / (w0 / d0 + w1 / d1);
+        }
+    }
+}
+
+double VgTblValue (const vgtbl_struct *vgtbl, int fn, double satn)
+{
+    int             side;
+    int             e;
+    int             b, j, q;
+    double          x;
+    double          f;
+    double          pos;
+    double          h, t;
+    const double   *v, *m;
+
+    side = (satn < 0.5) ? 0 : 1;
+    x = (side == 0) ? satn : 1.0 - satn;
+
+    if (x >= 0.5)
+    {
+        return (vgtbl->value[fn][side][vgtbl->nnode - 1]);
+    }
+
+    /* x = f * 2^e with f in [0.5, 1) */
+    f = frexp (x, &e);
+    b = -e - 1;
+
+    /* Outside of the table */
+    if (x <= 0.0 || b >= VGTBL_NBIN)
+    {
+        return (VgFunc (fn, satn, vgtbl->alpha, vgtbl->beta));
+    }
+
+    pos = (f - 0.5) * 2.0 * (double)vgtbl->nsub;
+    j = (int)pos;
+    j = (j > vgtbl->nsub - 1) ? vgtbl->nsub - 1 : j;
+    t = pos - (double)j;
+    q = (VGTBL_NBIN - 1 - b) * vgtbl->nsub + j;
+    h = ldexp (0.5 / (double)vgtbl->nsub, e);
+
+    v = vgtbl->value[fn][side];
+    m = vgtbl->slope[fn][side];
+
+    /* Cubic Hermite interpolation */
+    return ((1.0 + 2.0 * t) * (1.0 - t) * (1.0 - t) * v[q] +
+        t * (1.0 - t) * (1.0 - t) * h * m[q] +
+        t * t * (3.0 - 2.0 * t) * v[q + 1] -
+        t * t * (1.0 - t) * h * m[q + 1]);
+}
+
+double VgFunc (int fn, double satn, double alpha, double beta)
+{
+    switch (fn)
+    {
+        case KR_FN:
+            return (KrFunc (alpha, beta, satn));
+        case PSI_FN:
+            return (Psi (satn, alpha, beta));
+        case DPSI_FN:
+            return (DPsi (satn, alpha, beta));
+        default:
+            PIHMprintf (VL_ERROR,
+                "Error: van Genuchten function (%d) is not defined.\n", fn);
+            PIHMexit (EXIT_FAILURE);
+    }
+
+    return (BADVAL);
+}
+
+double VgRelErr (double approx, double exact)
+{
+    /* Relative conductivities of very dry soils are negligible, and their
+     * analytic values suffer from round-off errors. Absolute errors are used
+     * for these values */
+    return (fabs (approx - exact) /
+        ((fabs (exact) > VGTBL_FLOOR) ? fabs (exact) : VGTBL_FLOOR));
+}
+
+void VerifyVgTbl (const vgtbl_struct *vgtbl, int k)
+{
+    int             fn, n;
+    double          err[NUM_VGFN] = {0.0, 0.0, 0.0};
+    double          satn_max[NUM_VGFN] = {0.0, 0.0, 0.0};
+    const char     *fn_name[NUM_VGFN] = {"Kr", "Psi", "dPsi/dSatn"};
+
+    /* Saturation ratios are sampled evenly in the logarithm of saturation
+     * ratio and one minus saturation ratio, over the whole table range. The
+     * irrational step places samples away from nodes and quarter points */
+    for (n = 0; n < VGTBL_NVERIFY; n++)
+    {
+        double          x;
+        double          satn;
+
+        x = 0.5 * pow (2.0, -(double)VGTBL_NBIN * fmod (n * M_SQRT2, 1.0));
+        satn = (n % 2 == 0) ? x : 1.0 - x;
+
+        for (fn = 0; fn < NUM_VGFN; fn++)
+        {
+            double          e;
+
+            e = VgRelErr (VgTblValue (vgtbl, fn, satn),
+                VgFunc (fn, satn, vgtbl->alpha, vgtbl->beta));
+
+            if (e > err[fn])
+            {
+                err[fn] = e;
+                satn_max[fn] = satn;
+            }
+        }
+    }
+
+    PIHMprintf (VL_NORMAL, " Lookup tables of soil type %d (alpha = %.3f, "
+        "beta = %.3f) verified at %d saturation ratios:\n", k + 1,
+        vgtbl->alpha, vgtbl->beta, VGTBL_NVERIFY);
+    for (fn = 0; fn < NUM_VGFN; fn++)
+    {
+        PIHMprintf (VL_NORMAL, "  %-10s max relative error %.2e at "
+            "saturation ratio %.6g\n", fn_name[fn], err[fn], satn_max[fn]);
+    }
+}
+
+void FreeVgTbl (vgtbl_struct *vgtbl, int ntbl)
+{
+    int             k, fn, side;
+
+    for (k = 0; k < ntbl; k++)
+    {
+        for (fn = 0; fn < NUM_VGFN; fn++)
+        {
+            for (side = 0; side < 2; side++)
+            {
+                free (vgtbl[k].value[fn][side]);
+                free (vgtbl[k].slope[fn][side]);
+            }
+        }
+#ifdef _NOAH_
+        free (vgtbl[k].frz);
+#endif
+    }
+
+    free (vgtbl);
+}
+
+#ifdef _NOAH_
+void BuildFrzTbl (vgtbl_struct *vgtbl, double smcmin, double smcmax)
+{
+    int             it, is;
+
+    /* Equilibrium liquid water saturation ratios are solved at nodes evenly
+     * spaced in log supercooling and in total saturation ratio */
+    vgtbl->frz = (double *)malloc ((FRZTBL_NT + 1) * (FRZTBL_NS + 1) *
+        sizeof (double));
+
+    for (it = 0; it <= FRZTBL_NT; it++)
+    {
+        double          lnsc;
+
+        lnsc = FRZTBL_LNMIN +
+            (FRZTBL_LNMAX - FRZTBL_LNMIN) * (double)it / (double)FRZTBL_NT;
+
+        for (is = 0; is <= FRZTBL_NS; is++)
+        {
+            double          smc;
+            double          freew;
+
+            smc = smcmin + (smcmax - smcmin) * (double)is / (double)FRZTBL_NS;
+            freew = 0.5 * (smcmin + smc);
+
+            FrH2ONewton (lnsc, smc, smcmin, smcmax, vgtbl->alpha,
+                vgtbl->beta, FRZTBL_NITER, &freew);
+
+            vgtbl->frz[it * (FRZTBL_NS + 1) + is] =
+                (freew - smcmin) / (smcmax - smcmin);
+        }
+    }
+}
+
+double FrzTblValue (const vgtbl_struct *vgtbl, double lnsc, double smc,
+    double smcmin, double smcmax)
+{
+    int             it, is;
+    double          x, y;
+    const double   *v;
+
+    /* Bilinear interpolation. Values beyond the table are extrapolated
+     * constantly, as they are only used as initial guesses */
+    x = (lnsc - FRZTBL_LNMIN) / (FRZTBL_LNMAX - FRZTBL_LNMIN) *
+        (double)FRZTBL_NT;
+    x = (x < 0.0) ? 0.0 : x;
+    x = (x > (double)FRZTBL_NT) ? (double)FRZTBL_NT : x;
+    it = (int)x;
+    it = (it > FRZTBL_NT - 1) ? FRZTBL_NT - 1 : it;
+    x -= (double)it;
+
+    y = (smc - smcmin) / (smcmax - smcmin) * (double)FRZTBL_NS;
+    y = (y < 0.0) ? 0.0 : y;
+    y = (y > (double)FRZTBL_NS) ? (double)FRZTBL_NS : y;
+    is = (int)y;
+    is = (is > FRZTBL_NS - 1) ? FRZTBL_NS - 1 : is;
+    y -= (double)is;
+
+    v = &vgtbl->frz[it * (FRZTBL_NS + 1) + is];
+
+    return (smcmin + (smcmax - smcmin) *
+        ((1.0 - x) * ((1.0 - y) * v[0] + y * v[1]) +
+        x * ((1.0 - y) * v[FRZTBL_NS + 1] + y * v[FRZTBL_NS + 2])));
+}
+
+void PrtFrzStats (const elem_struct *elem)
+{
+    int             i;
+    long int        nfrz = 0;
+    long int        nfallback = 0;
+
+    for (i = 0; i < nelem; i++)
+    {
+        nfrz += elem[i].ps.nfrz;
+        nfallback += elem[i].ps.nfrz_fallback;
+    }
+
+    if (nfrz > 0)
+    {
+        PIHMprintf (VL_NORMAL, "Supercooled water solves using lookup tables: "
+            "%ld, falling back to iterations: %ld (%.2f%%)\n", nfrz,
+            nfallback, 100.0 * (double)nfallback / (double)nfrz);
+    }
+}
+#endif
+
+double KrFuncSoil (const soil_struct *soil, double satn)
+{
+    return ((NULL == soil->vgtbl) ?
+        KrFunc (soil->alpha, soil->beta, satn) :
+        VgTblValue (soil->vgtbl, KR_FN, satn));
+}
+
+double PsiSoil (const soil_struct *soil, double satn)
+{
+    return ((NULL == soil->vgtbl) ?
+        Psi (satn, soil->alpha, soil->beta) :
+        VgTblValue (soil->vgtbl, PSI_FN, satn));
+}
+
+double DPsiDSmc (const soil_struct *soil, double satn)
+{
+    double          expon;
+
+    if (NULL != soil->vgtbl)
+    {
+        return (VgTblValue (soil->vgtbl, DPSI_FN, satn) /
+            (soil->smcmax - soil->smcmin));
+    }
+
+    expon = 1.0 - 1.0 / soil->beta;
+
+    return ((1.0 - expon) / soil->alpha / expon /
+        (soil->smcmax - soil->smcmin) *
+        pow (pow (satn, -1.0 / expon) - 1.0, -expon) *
+        pow (satn, -(1.0 / expon + 1.0)));
+}
+
+void ReadSoilTblCtrl (char *cmdstr, ctrl_struct *ctrl, char *filename,
+    int lno)
+{
+    char            optstr[MAXSTRING];
+
+    sscanf (cmdstr, "%s", optstr);
+
+    if (strcasecmp (optstr, "SOIL_TBL") == 0)
+    {
+        ReadKeyword (cmdstr, "SOIL_TBL", &ctrl->soil_tbl, 'i', filename, lno);
+    }
+    else if (strcasecmp (optstr, "SOIL_TBL_TOL") == 0)
+    {
+        ReadKeyword (cmdstr, "SOIL_TBL_TOL", &ctrl->soil_tbl_tol, 'd',
+            filename, lno);
+        if (ctrl->soil_tbl_tol <= 0.0)
+        {
+            PIHMprintf (VL_ERROR, "Error: SOIL_TBL_TOL should be positive.\n");
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename,
+                lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+    }
+    else if (strcasecmp (optstr, "SOIL_TBL_VERIFY") == 0)
+    {
+        ReadKeyword (cmdstr, "SOIL_TBL_VERIFY", &ctrl->soil_tbl_verify, 'i',
+            filename, lno);
+    }
+    else
+    {
+        PIHMprintf (VL_ERROR, "Error: Unknown keyword \"%s\".\n", optstr);
+        PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename, lno);
+        PIHMexit (EXIT_FAILURE);
+    }
+}
@@ -2,16 +2,19 @@
 
 #if defined(_MSC_VER)
 #define timegm _mkgmtime
+#define gmtime_r(rawtime, buf)  (gmtime_s (buf, rawtime) == 0 ? buf : NULL)
 #endif
 
 pihm_t_struct PIHMTime (int t)
 {
     pihm_t_struct   pihm_time;
+    struct tm       tm_buf;
     struct tm      *timestamp;
     time_t          rawtime;
 
+    /* Reentrant version, as solar positions are calculated in parallel */
     rawtime = (time_t)t;
-    timestamp = gmtime (&rawtime);
+    timestamp = gmtime_r (&rawtime, &tm_buf);
 
     pihm_time.t = t;
     pihm_time.year = timestamp->tm_year + 1900;
@@ -0,0 +1,985 @@
+#include "pihm.h"
+
+#define TR_MAXSWEEP     100
+#define TR_TOL          1.0E-10
+#define TR_NCHECK       4
+
+static void AddPath (tracer_struct *tracer, int *next, int owner, int nabr,
+    const double *q, double qscale, int mob, int mob_nabr)
+{
+    int             n;
+
+    if (next == NULL)
+    {
+        /* Counting pass */
+        tracer->start[owner + 1]++;
+        return;
+    }
+
+    n = next[owner]++;
+
+    tracer->nabr[n] = nabr;
+    tracer->q[n] = q;
+    tracer->qscale[n] = qscale;
+    tracer->mobk[n] = mob;
+    tracer->mobm[n] = mob_nabr;
+}
+
+static void BuildPaths (const elem_struct *elem, const river_struct *riv,
+    tracer_struct *tracer, int *next)
+{
+    int             i, j;
+
+    /* Each path carries the fully mobile amount (0) or the mobile fraction
+     * (1) of each species out of its owner and its neighbor. Only the mobile
+     * fraction is carried by overland flow between elements and to rivers,
+     * and by subsurface flows */
+    for (i = 0; i < nelem; i++)
+    {
+        /* Infiltration and recharge, positive downward. Without separate
+         * unsaturated zones, recharge is internal to the subsurface
+         * compartment */
+        if (tracer->split)
+        {
+            AddPath (tracer, next, TR_SURF (i), TR_UNSAT (i),
+                &elem[i].wf.infil, elem[i].topo.area, 0, 1);
+            AddPath (tracer, next, TR_UNSAT (i), TR_SURF (i),
+                &elem[i].wf.infil, -elem[i].topo.area, 1, 0);
+
+            AddPath (tracer, next, TR_UNSAT (i), TR_SUB (i),
+                &elem[i].wf.rechg, elem[i].topo.area, 1, 1);
+            AddPath (tracer, next, TR_SUB (i), TR_UNSAT (i),
+                &elem[i].wf.rechg, -elem[i].topo.area, 1, 1);
+        }
+        else
+        {
+            AddPath (tracer, next, TR_SURF (i), TR_SUB (i), &elem[i].wf.infil,
+                elem[i].topo.area, 0, 1);
+            AddPath (tracer, next, TR_SUB (i), TR_SURF (i), &elem[i].wf.infil,
+                -elem[i].topo.area, 1, 0);
+        }
+
+        /* Exchange of residual water between unsaturated and saturated
+         * zones as the water table moves, positive downward */
+        if (tracer->split)
+        {
+            AddPath (tracer, next, TR_UNSAT (i), TR_SUB (i), &tracer->wtex[i],
+                elem[i].topo.area, 1, 1);
+            AddPath (tracer, next, TR_SUB (i), TR_UNSAT (i), &tracer->wtex[i],
+                -elem[i].topo.area, 1, 1);
+        }
+
+        /* Element to element. Fluxes between two elements are computed by
+         * both elements, and are not always antisymmetric. Both paths of a
+         * pair use the fluxes of the element with the smaller index, so that
+         * tracers that leave one element enter the other. Element to river
+         * fluxes are added from rivers below, and no tracer is exchanged
+         * through boundary edges */
+        for (j = 0; j < NUM_EDGE; j++)
+        {
+            int             m;
+
+            m = elem[i].nabr[j] - 1;
+
+            if (m > i)
+            {
+                AddPath (tracer, next, TR_SURF (i), TR_SURF (m),
+                    &elem[i].wf.ovlflow[j], 1.0, 1, 1);
+                AddPath (tracer, next, TR_SURF (m), TR_SURF (i),
+                    &elem[i].wf.ovlflow[j], -1.0, 1, 1);
+
+                AddPath (tracer, next, TR_SUB (i), TR_SUB (m),
+                    &elem[i].wf.subsurf[j], 1.0, 1, 1);
+                AddPath (tracer, next, TR_SUB (m), TR_SUB (i),
+                    &elem[i].wf.subsurf[j], -1.0, 1, 1);
+            }
+        }
+    }
+
+    for (i = 0; i < nriver; i++)
+    {
+        const double   *rivflow;
+
+        rivflow = riv[i].wf.rivflow;
+
+        /* Downstream and upstream. Downstream segments use the negative
+         * downstream fluxes of their upstream segments, so that tracers from
+         * all tributaries are conserved */
+        if (riv[i].down > 0)
+        {
+            AddPath (tracer, next, TR_STREAM (i), TR_STREAM (riv[i].down - 1),
+                &rivflow[DOWN_CHANL2CHANL], 1.0, 0, 0);
+            AddPath (tracer, next, TR_STREAM (riv[i].down - 1), TR_STREAM (i),
+                &rivflow[DOWN_CHANL2CHANL], -1.0, 0, 0);
+
+            AddPath (tracer, next, TR_BED (i), TR_BED (riv[i].down - 1),
+                &rivflow[DOWN_AQUIF2AQUIF], 1.0, 1, 1);
+            AddPath (tracer, next, TR_BED (riv[i].down - 1), TR_BED (i),
+                &rivflow[DOWN_AQUIF2AQUIF], -1.0, 1, 1);
+        }
+        else
+        {
+            /* Outlet. Water that flows in through the outlet carries no
+             * tracer */
+            AddPath (tracer, next, TR_STREAM (i), -1,
+                &rivflow[DOWN_CHANL2CHANL], 1.0, 0, 0);
+            AddPath (tracer, next, TR_BED (i), -1,
+                &rivflow[DOWN_AQUIF2AQUIF], 1.0, 1, 0);
+        }
+
+        /* Left and right banks */
+        if (riv[i].leftele > 0)
+        {
+            j = riv[i].leftele - 1;
+
+            AddPath (tracer, next, TR_STREAM (i), TR_SURF (j),
+                &rivflow[LEFT_SURF2CHANL], 1.0, 0, 1);
+            AddPath (tracer, next, TR_STREAM (i), TR_SUB (j),
+                &rivflow[LEFT_AQUIF2CHANL], 1.0, 0, 1);
+            AddPath (tracer, next, TR_BED (i), TR_SUB (j),
+                &rivflow[LEFT_AQUIF2AQUIF], 1.0, 1, 1);
+
+            AddPath (tracer, next, TR_SURF (j), TR_STREAM (i),
+                &rivflow[LEFT_SURF2CHANL], -1.0, 1, 0);
+            AddPath (tracer, next, TR_SUB (j), TR_STREAM (i),
+                &rivflow[LEFT_AQUIF2CHANL], -1.0, 1, 0);
+            AddPath (tracer, next, TR_SUB (j), TR_BED (i),
+                &rivflow[LEFT_AQUIF2AQUIF], -1.0, 1, 1);
+        }
+
+        if (riv[i].rightele > 0)
+        {
+            j = riv[i].rightele - 1;
+
+            AddPath (tracer, next, TR_STREAM (i), TR_SURF (j),
+                &rivflow[RIGHT_SURF2CHANL], 1.0, 0, 1);
+            AddPath (tracer, next, TR_STREAM (i), TR_SUB (j),
+                &rivflow[RIGHT_AQUIF2CHANL], 1.0, 0, 1);
+            AddPath (tracer, next, TR_BED (i), TR_SUB (j),
+                &rivflow[RIGHT_AQUIF2AQUIF], 1.0, 1, 1);
+
+            AddPath (tracer, next, TR_SURF (j), TR_STREAM (i),
+                &rivflow[RIGHT_SURF2CHANL], -1.0, 1, 0);
+            AddPath (tracer, next, TR_SUB (j), TR_STREAM (i),
+                &rivflow[RIGHT_AQUIF2CHANL], -1.0, 1, 0);
+            AddPath (tracer, next, TR_SUB (j), TR_BED (i),
+                &rivflow[RIGHT_AQUIF2AQUIF], -1.0, 1, 1);
+        }
+
+        /* Leakage, positive from stream to bed */
+        AddPath (tracer, next, TR_STREAM (i), TR_BED (i), &rivflow[CHANL_LKG],
+            1.0, 0, 1);
+        AddPath (tracer, next, TR_BED (i), TR_STREAM (i), &rivflow[CHANL_LKG],
+            -1.0, 1, 0);
+    }
+}
+
+static int CompGroup (int i, int *rank)
+{
+    /* Group of a compartment, which is its element or the river network,
+     * and rank of the compartment in the group from top to bottom. River
+     * compartments keep their order, so that tracers pass down the network
+     * in one sweep */
+    if (i < nelem)
+    {
+        *rank = 0;
+        return (i);
+    }
+    else if (i < 2 * nelem)
+    {
+        *rank = 2;
+        return (i - nelem);
+    }
+    else if (i < 2 * nelem + 2 * nriver)
+    {
+        *rank = 0;
+        return (nelem);
+    }
+    else
+    {
+        *rank = 1;
+        return (i - 2 * nelem - 2 * nriver);
+    }
+}
+
+static void ColorGroups (tracer_struct *tracer)
+{
+    int             i, k, n, c, g, m, rank;
+    int             ngroup;
+    int            *adj, *astart, *next, *color, *used, *group, *slot;
+
+    /*
+     * Compartments of an element, or of the river network, are a group,
+     * which is updated in order by one thread. Groups are colored so that
+     * no two groups connected by a path have the same color, and groups of
+     * a color can be updated at the same time. Paths are made symmetric
+     * first, as a compartment reads the neighbors of its own paths
+     */
+    ngroup = nelem + 1;
+    group = (int *)malloc (tracer->ncomp * sizeof (int));
+    for (i = 0; i < tracer->ncomp; i++)
+    {
+        group[i] = CompGroup (i, &rank);
+    }
+
+    astart = (int *)calloc (ngroup + 1, sizeof (int));
+    for (i = 0; i < tracer->ncomp; i++)
+    {
+        for (n = tracer->start[i]; n < tracer->start[i + 1]; n++)
+        {
+            m = tracer->nabr[n];
+            if (m >= 0 && group[m] != group[i])
+            {
+                astart[group[i] + 1]++;
+                astart[group[m] + 1]++;
+            }
+        }
+    }
+    for (g = 0; g < ngroup; g++)
+    {
+        astart[g + 1] += astart[g];
+    }
+
+    adj = (int *)malloc (astart[ngroup] * sizeof (int));
+    next = (int *)malloc ((ngroup + 1) * sizeof (int));
+    memcpy (next, astart, ngroup * sizeof (int));
+    for (i = 0; i < tracer->ncomp; i++)
+    {
+        for (n = tracer->start[i]; n < tracer->start[i + 1]; n++)
+        {
+            m = tracer->nabr[n];
+            if (m >= 0 && group[m] != group[i])
+            {
+                adj[next[group[i]]++] = group[m];
+                adj[next[group[m]]++] = group[i];
+            }
+        }
+    }
+
+    /* Greedy coloring in group order */
+    color = (int *)malloc (ngroup * sizeof (int));
+    used = (int *)malloc ((ngroup + 1) * sizeof (int));
+    for (g = 0; g < ngroup + 1; g++)
+    {
+        used[g] = -1;
+    }
+    tracer->ncolor = 0;
+    for (g = 0; g < ngroup; g++)
+    {
+        for (n = astart[g]; n < astart[g + 1]; n++)
+        {
+            if (adj[n] < g)
+            {
+                used[color[adj[n]]] = g;
+            }
+        }
+        for (c = 0; used[c] == g; c++)
+        {
+        }
+        color[g] = c;
+        tracer->ncolor = (c + 1 > tracer->ncolor) ? c + 1 : tracer->ncolor;
+    }
+
+    /* Groups ordered by color, in ascending order within each color */
+    tracer->cstart = (int *)calloc (tracer->ncolor + 1, sizeof (int));
+    slot = (int *)malloc (ngroup * sizeof (int));
+    for (g = 0; g < ngroup; g++)
+    {
+        tracer->cstart[color[g] + 1]++;
+    }
+    for (c = 0; c < tracer->ncolor; c++)
+    {
+        tracer->cstart[c + 1] += tracer->cstart[c];
+    }
+    memcpy (next, tracer->cstart, tracer->ncolor * sizeof (int));
+    for (g = 0; g < ngroup; g++)
+    {
+        slot[g] = next[color[g]]++;
+    }
+
+    /* Compartments ordered by group slot, from top to bottom within each
+     * group */
+    tracer->gstart = (int *)calloc (ngroup + 1, sizeof (int));
+    tracer->corder = (int *)malloc (tracer->ncomp * sizeof (int));
+    for (i = 0; i < tracer->ncomp; i++)
+    {
+        tracer->gstart[slot[group[i]] + 1]++;
+    }
+    for (g = 0; g < ngroup; g++)
+    {
+        tracer->gstart[g + 1] += tracer->gstart[g];
+    }
+    memcpy (next, tracer->gstart, ngroup * sizeof (int));
+    for (k = 0; k < 3; k++)
+    {
+        for (i = 0; i < tracer->ncomp; i++)
+        {
+            CompGroup (i, &rank);
+            if (rank == k)
+            {
+                tracer->corder[next[slot[group[i]]]++] = i;
+            }
+        }
+    }
+
+    free (astart);
+    free (adj);
+    free (next);
+    free (color);
+    free (used);
+    free (group);
+    free (slot);
+}
+
+void InitTracer (const elem_struct *elem, const river_struct *riv, int nsp,
+    const double *mobile, int split, tracer_struct *tracer)
+{
+    int             i, s;
+    int            *next;
+
+    tracer->split = split;
+    tracer->ncomp = 2 * nelem + 2 * nriver + ((split) ? nelem : 0);
+    tracer->nsp = nsp;
+
+    /* Paths are stored by owner compartment, so that each row of the
+     * transport equations is assembled from consecutive paths */
+    tracer->start = (int *)calloc (tracer->ncomp + 1, sizeof (int));
+
+    if (split)
+    {
+        tracer->dsat = (double *)malloc (nelem * sizeof (double));
+        tracer->dsat0 = (double *)malloc (nelem * sizeof (double));
+        tracer->wtex = (double *)calloc (nelem, sizeof (double));
+    }
+    else
+    {
+        tracer->dsat = NULL;
+        tracer->dsat0 = NULL;
+        tracer->wtex = NULL;
+    }
+
+    BuildPaths (elem, riv, tracer, NULL);
+
+    for (i = 0; i < tracer->ncomp; i++)
+    {
+        tracer->start[i + 1] += tracer->start[i];
+    }
+    tracer->npath = tracer->start[tracer->ncomp];
+
+    tracer->nabr = (int *)malloc (tracer->npath * sizeof (int));
+    tracer->q = (const double **)malloc (tracer->npath *
+        sizeof (const double *));
+    tracer->qscale = (double *)malloc (tracer->npath * sizeof (double));
+    tracer->mobk = (int *)malloc (tracer->npath * sizeof (int));
+    tracer->mobm = (int *)malloc (tracer->npath * sizeof (int));
+    tracer->cin = (double *)malloc (tracer->npath * sizeof (double));
+
+    next = (int *)malloc (tracer->ncomp * sizeof (int));
+    memcpy (next, tracer->start, tracer->ncomp * sizeof (int));
+
+    BuildPaths (elem, riv, tracer, next);
+
+    free (next);
+
+    ColorGroups (tracer);
+
+    tracer->area = (double *)malloc (tracer->ncomp * sizeof (double));
+    tracer->strg = (double *)malloc (tracer->ncomp * sizeof (double));
+    tracer->strg0 = (double *)malloc (tracer->ncomp * sizeof (double));
+
+    for (i = 0; i < nelem; i++)
+    {
+        tracer->area[TR_SURF (i)] = elem[i].topo.area;
+        tracer->area[TR_SUB (i)] = elem[i].topo.area;
+        if (split)
+        {
+            tracer->area[TR_UNSAT (i)] = elem[i].topo.area;
+        }
+    }
+    for (i = 0; i < nriver; i++)
+    {
+        tracer->area[TR_STREAM (i)] = riv[i].topo.area;
+        tracer->area[TR_BED (i)] = riv[i].topo.area;
+    }
+
+    tracer->mob = (double *)malloc (2 * nsp * sizeof (double));
+    for (s = 0; s < nsp; s++)
+    {
+        tracer->mob[s] = 1.0;
+        tracer->mob[nsp + s] = mobile[s];
+    }
+
+    tracer->x = (double *)calloc (tracer->ncomp * nsp, sizeof (double));
+    tracer->src = (double *)calloc (tracer->ncomp * nsp, sizeof (double));
+    tracer->sink = (double *)calloc (tracer->ncomp, sizeof (double));
+    tracer->evap = (double *)calloc (tracer->ncomp, sizeof (double));
+    tracer->dout = (double *)calloc (tracer->ncomp, sizeof (double));
+    tracer->rhs = (double *)malloc (tracer->ncomp * nsp * sizeof (double));
+    tracer->diag = (double *)malloc (tracer->ncomp * nsp * sizeof (double));
+#ifdef _OPENMP
+    tracer->work = (double *)malloc (omp_get_max_threads () * nsp *
+        sizeof (double));
+#else
+    tracer->work = (double *)malloc (nsp * sizeof (double));
+#endif
+
+    tracer->mass = (double *)calloc (nsp, sizeof (double));
+    tracer->gain = (double *)calloc (nsp, sizeof (double));
+    tracer->loss = (double *)calloc (nsp, sizeof (double));
+
+    tracer->nsweep = 0;
+    tracer->time = 0.0;
+    tracer->errmax = 0.0;
+
+    /* Storages at the beginning of the first step */
+    TracerStorage (elem, riv, tracer);
+    memcpy (tracer->strg0, tracer->strg, tracer->ncomp * sizeof (double));
+    if (split)
+    {
+        memcpy (tracer->dsat0, tracer->dsat, nelem * sizeof (double));
+    }
+}
+
+static void SweepComp (tracer_struct *tracer, int i, double *acc,
+    double *dc, double *cmax)
+{
+    int             n, s;
+    int             nsp;
+    double         *x;
+    const double   *rhs;
+    const double   *diag;
+
+    /* Gauss-Seidel update of all species of a compartment. Species are
+     * innermost, so that the same coefficients are applied to all species
+     * in contiguous loops */
+    nsp = tracer->nsp;
+    x = &tracer->x[i * nsp];
+    rhs = &tracer->rhs[i * nsp];
+    diag = &tracer->diag[i * nsp];
+
+    for (s = 0; s < nsp; s++)
+    {
+        acc[s] = rhs[s];
+    }
+
+    for (n = tracer->start[i]; n < tracer->start[i + 1]; n++)
+    {
+        const double   *xm;
+        const double   *mob;
+        double          c;
+
+        c = tracer->cin[n];
+        if (c > 0.0)
+        {
+            xm = &tracer->x[tracer->nabr[n] * nsp];
+            mob = &tracer->mob[tracer->mobm[n] * nsp];
+
+            for (s = 0; s < nsp; s++)
+            {
+                acc[s] += c * mob[s] * xm[s];
+            }
+        }
+    }
+
+    for (s = 0; s < nsp; s++)
+    {
+        double          xnew;
+
+        xnew = acc[s] / diag[s];
+        xnew = (xnew > 0.0) ? xnew : 0.0;
+
+        if (tracer->strg[i] > 0.0)
+        {
+            double          d;
+
+            d = fabs (xnew - x[s]) / tracer->strg[i];
+            *dc = (d > *dc) ? d : *dc;
+            *cmax = (xnew / tracer->strg[i] > *cmax) ?
+                xnew / tracer->strg[i] : *cmax;
+        }
+
+        x[s] = xnew;
+    }
+}
+
+void TracerStorage (const elem_struct *elem, const river_struct *riv,
+    tracer_struct *tracer)
+{
+    int             i;
+
+    /* Water storages at the end of the hydrology step, including residual
+     * water, in which tracers are mixed. Residual water below the water
+     * table belongs to saturated zones */
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < nelem; i++)
+    {
+        tracer->strg[TR_SURF (i)] = (elem[i].ws.surf > 0.0) ?
+            elem[i].ws.surf : 0.0;
+
+        if (tracer->split)
+        {
+            double          dsat;
+
+            dsat = (elem[i].ws.gw < elem[i].soil.depth) ?
+                elem[i].ws.gw : elem[i].soil.depth;
+            dsat = (dsat > 0.0) ? dsat : 0.0;
+
+            tracer->dsat[i] = dsat;
+            tracer->strg[TR_UNSAT (i)] = ((elem[i].ws.unsat > 0.0) ?
+                elem[i].ws.unsat : 0.0) * elem[i].soil.porosity +
+                (elem[i].soil.depth - dsat) * elem[i].soil.smcmin;
+            tracer->strg[TR_SUB (i)] = ((elem[i].ws.gw > 0.0) ?
+                elem[i].ws.gw : 0.0) * elem[i].soil.porosity +
+                dsat * elem[i].soil.smcmin;
+        }
+        else
+        {
+            double          sat;
+
+            sat = elem[i].ws.unsat + elem[i].ws.gw;
+            tracer->strg[TR_SUB (i)] = ((sat > 0.0) ? sat : 0.0) *
+                elem[i].soil.porosity +
+                elem[i].soil.depth * elem[i].soil.smcmin;
+        }
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < nriver; i++)
+    {
+        tracer->strg[TR_STREAM (i)] = (riv[i].ws.stage > 0.0) ?
+            riv[i].ws.stage : 0.0;
+        tracer->strg[TR_BED (i)] = ((riv[i].ws.gw > 0.0) ?
+            riv[i].ws.gw : 0.0) * riv[i].matl.porosity +
+            riv[i].matl.bedthick * riv[i].matl.smcmin;
+    }
+}
+
+void TracerSinks (const elem_struct *elem, int et_tracer,
+    tracer_struct *tracer)
+{
+    int             i;
+
+    /* Evapotranspiration either removes tracers at their mean
+     * concentrations (e.g., water age), or leaves tracers behind (e.g.,
+     * solutes). Outflows through domain boundaries always remove tracers */
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < nelem; i++)
+    {
+        int             j;
+        double          surf = 0.0;
+        double          gw = 0.0;
+        double          et_surf, et_unsat, et_gw;
+
+        for (j = 0; j < NUM_EDGE; j++)
+        {
+            if (elem[i].nabr[j] == 0)
+            {
+                surf += (elem[i].wf.ovlflow[j] > 0.0) ?
+                    elem[i].wf.ovlflow[j] / elem[i].topo.area : 0.0;
+                gw += (elem[i].wf.subsurf[j] > 0.0) ?
+                    elem[i].wf.subsurf[j] / elem[i].topo.area : 0.0;
+            }
+        }
+
+        et_surf = (elem[i].wf.edir_surf > 0.0) ? elem[i].wf.edir_surf : 0.0;
+        et_unsat = (elem[i].wf.edir_unsat + elem[i].wf.ett_unsat > 0.0) ?
+            elem[i].wf.edir_unsat + elem[i].wf.ett_unsat : 0.0;
+        et_gw = (elem[i].wf.edir_gw + elem[i].wf.ett_gw > 0.0) ?
+            elem[i].wf.edir_gw + elem[i].wf.ett_gw : 0.0;
+
+        if (!tracer->split)
+        {
+            et_gw += et_unsat;
+        }
+
+        tracer->sink[TR_SURF (i)] = surf + ((et_tracer) ? et_surf : 0.0);
+        tracer->sink[TR_SUB (i)] = gw + ((et_tracer) ? et_gw : 0.0);
+        tracer->evap[TR_SURF (i)] = (et_tracer) ? 0.0 : et_surf;
+        tracer->evap[TR_SUB (i)] = (et_tracer) ? 0.0 : et_gw;
+
+        if (tracer->split)
+        {
+            tracer->sink[TR_UNSAT (i)] = (et_tracer) ? et_unsat : 0.0;
+            tracer->evap[TR_UNSAT (i)] = (et_tracer) ? 0.0 : et_unsat;
+        }
+    }
+}
+
+static void TracerBudget (double stepsize, tracer_struct *tracer)
+{
+    int             i, n, s;
+    int             nsp;
+
+    /*
+     * Tracers that leave the domain with sinks and through the outlet, and
+     * the balance of the step, in which right hand sides are tracers at the
+     * beginning of the step plus sources
+     */
+    nsp = tracer->nsp;
+
+    for (s = 0; s < nsp; s++)
+    {
+        double          before = 0.0;
+        double          after = 0.0;
+        double          gain = 0.0;
+        double          loss = 0.0;
+        double          err;
+
+        for (i = 0; i < tracer->ncomp; i++)
+        {
+            double          x;
+
+            x = tracer->x[i * nsp + s];
+
+            before += tracer->rhs[i * nsp + s];
+            gain += tracer->area[i] * tracer->src[i * nsp + s] * stepsize;
+            after += tracer->area[i] * x;
+            loss += tracer->dout[i] * x;
+
+            for (n = tracer->start[i]; n < tracer->start[i + 1]; n++)
+            {
+                double          q;
+
+                q = *tracer->q[n] * tracer->qscale[n];
+
+                if (tracer->nabr[n] < 0 && q > 0.0 && tracer->strg[i] > 0.0)
+                {
+                    loss += stepsize * q / tracer->strg[i] *
+                        tracer->mob[tracer->mobk[n] * nsp + s] * x;
+                }
+            }
+        }
+
+        err = fabs (after + loss - before);
+        err /= (fabs (before) > 0.0) ? fabs (before) : 1.0;
+
+        tracer->gain[s] += gain;
+        tracer->loss[s] += loss;
+        tracer->mass[s] = after;
+        tracer->errmax = (err > tracer->errmax) ? err : tracer->errmax;
+    }
+}
+
+void TracerTransport (const elem_struct *elem, const river_struct *riv,
+    double stepsize, tracer_struct *tracer)
+{
+    int             i;
+    int             nsp;
+    int             nsweep = 0;
+    double          dcmax, cmax;
+
+    nsp = tracer->nsp;
+
+    /*
+     * Tracers are transported with water fluxes of the step using a backward
+     * Euler upwind scheme, so that tracers are conserved and stay
+     * non-negative for any step size
+     */
+    TracerStorage (elem, riv, tracer);
+
+    if (tracer->split)
+    {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (i = 0; i < nelem; i++)
+        {
+            tracer->wtex[i] = elem[i].soil.smcmin *
+                (tracer->dsat[i] - tracer->dsat0[i]) / stepsize;
+        }
+    }
+
+    /*
+     * Inflow coefficients of paths, which are shared by all species, and
+     * diagonal coefficients from outflows of each compartment.
+     * Water fluxes are those of the last evaluation of the hydrology step,
+     * so that storage changes are not exactly explained by paths. Water
+     * that is not explained by paths enters without tracers, or leaves as
+     * a sink
+     */
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < tracer->ncomp; i++)
+    {
+        int             n, m, s;
+        double          q;
+        double          wbal;
+        double          out;
+        double         *diag;
+
+        diag = &tracer->diag[i * nsp];
+
+        for (s = 0; s < nsp; s++)
+        {
+            diag[s] = 0.0;
+        }
+
+        /* Storage explained by paths and sinks [m3] */
+        wbal = tracer->area[i] * (tracer->strg0[i] -
+            stepsize * (tracer->sink[i] + tracer->evap[i]));
+
+        for (n = tracer->start[i]; n < tracer->start[i + 1]; n++)
+        {
+            m = tracer->nabr[n];
+            q = *tracer->q[n] * tracer->qscale[n];
+
+            if (q < 0.0 && m >= 0 && tracer->strg[m] > 0.0)
+            {
+                tracer->cin[n] = -stepsize * q / tracer->strg[m];
+                wbal -= stepsize * q;
+            }
+            else
+            {
+                tracer->cin[n] = 0.0;
+            }
+
+            if (q > 0.0 && tracer->strg[i] > 0.0)
+            {
+                const double   *mob;
+                double          c;
+
+                c = stepsize * q / tracer->strg[i];
+                mob = &tracer->mob[tracer->mobk[n] * nsp];
+
+                for (s = 0; s < nsp; s++)
+                {
+                    diag[s] += c * mob[s];
+                }
+
+                wbal -= stepsize * q;
+            }
+        }
+
+        /* Sinks leave with fully mobile tracers */
+        out = stepsize * tracer->sink[i] * tracer->area[i];
+        out += (tracer->area[i] * tracer->strg[i] < wbal) ?
+            wbal - tracer->area[i] * tracer->strg[i] : 0.0;
+        tracer->dout[i] = (tracer->strg[i] > 0.0) ?
+            out / tracer->strg[i] : 0.0;
+
+        for (s = 0; s < nsp; s++)
+        {
+            diag[s] += tracer->area[i] + tracer->dout[i];
+            tracer->rhs[i * nsp + s] = tracer->area[i] *
+                (tracer->x[i * nsp + s] + tracer->src[i * nsp + s] * stepsize);
+        }
+    }
+
+    /*
+     * Symmetric Gauss-Seidel sweeps, forward and backward over colors, and
+     * in order and back within groups. Groups of a color are not connected
+     * by paths, so that they are updated in parallel, and results do not
+     * depend on the number of threads. The matrix is an M-matrix, so that
+     * sweeps converge from any non-negative initial guess. Convergence is
+     * tested on concentrations, so that compartments with little water
+     * converge as well as others
+     */
+    dcmax = 0.0;
+    cmax = 0.0;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        int             sweep, dir, c, g, k;
+        int             conv;
+        double         *acc;
+
+#ifdef _OPENMP
+        acc = &tracer->work[omp_get_thread_num () * nsp];
+#else
+        acc = tracer->work;
+#endif
+
+        for (sweep = 0; sweep < TR_MAXSWEEP; sweep++)
+        {
+            double          dc_thr = 0.0;
+            double          cmax_thr = 0.0;
+
+            for (dir = 0; dir < 2; dir++)
+            {
+                for (c = 0; c < tracer->ncolor; c++)
+                {
+                    int             cc;
+
+                    cc = (dir == 0) ? c : tracer->ncolor - 1 - c;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+                    for (g = tracer->cstart[cc]; g < tracer->cstart[cc + 1];
+                        g++)
+                    {
+                        int             k0, k1;
+
+                        k0 = tracer->gstart[g];
+                        k1 = tracer->gstart[g + 1];
+                        for (k = 0; k < k1 - k0; k++)
+                        {
+                            SweepComp (tracer, tracer->corder[(dir == 0) ?
+                                k0 + k : k1 - 1 - k], acc, &dc_thr,
+                                &cmax_thr);
+                        }
+                    }
+                }
+            }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            {
+                dcmax = (dc_thr > dcmax) ? dc_thr : dcmax;
+                cmax = (cmax_thr > cmax) ? cmax_thr : cmax;
+            }
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+            conv = (dcmax <= TR_TOL * cmax);
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+            {
+                dcmax = 0.0;
+                cmax = 0.0;
+            }
+
+            if (conv)
+            {
+                break;
+            }
+        }
+#ifdef _OPENMP
+#pragma omp single
+#endif
+        {
+            nsweep = sweep;
+        }
+    }
+
+    tracer->nsweep = nsweep;
+
+    if (nsweep == TR_MAXSWEEP)
+    {
+        PIHMprintf (VL_VERBOSE,
+            "Warning: Tracer transport did not converge in %d sweeps.\n",
+            TR_MAXSWEEP);
+    }
+
+    TracerBudget (stepsize, tracer);
+
+    /* Storages at the beginning of the next step */
+    memcpy (tracer->strg0, tracer->strg, tracer->ncomp * sizeof (double));
+    if (tracer->split)
+    {
+        memcpy (tracer->dsat0, tracer->dsat, nelem * sizeof (double));
+    }
+    tracer->time += stepsize;
+}
+
+void CheckTracerSpecies (const elem_struct *elem, const river_struct *riv,
+    double stepsize, const tracer_struct *tracer)
+{
+    int             i, s;
+    int             nerr = 0;
+    double          mobile[TR_NCHECK];
+    tracer_struct   ref;
+    tracer_struct   multi;
+
+    /*
+     * Species are solved in blocks that share coefficients, so that
+     * TR_NCHECK copies of the first species must reproduce the result of
+     * the first species alone bit by bit. Tracers of the step are not
+     * changed
+     */
+    for (s = 0; s < TR_NCHECK; s++)
+    {
+        mobile[s] = tracer->mob[tracer->nsp];
+    }
+
+    InitTracer (elem, riv, 1, mobile, tracer->split, &ref);
+    InitTracer (elem, riv, TR_NCHECK, mobile, tracer->split, &multi);
+
+    memcpy (ref.strg0, tracer->strg0, tracer->ncomp * sizeof (double));
+    memcpy (multi.strg0, tracer->strg0, tracer->ncomp * sizeof (double));
+    memcpy (ref.sink, tracer->sink, tracer->ncomp * sizeof (double));
+    memcpy (multi.sink, tracer->sink, tracer->ncomp * sizeof (double));
+    memcpy (ref.evap, tracer->evap, tracer->ncomp * sizeof (double));
+    memcpy (multi.evap, tracer->evap, tracer->ncomp * sizeof (double));
+    if (tracer->split)
+    {
+        memcpy (ref.dsat0, tracer->dsat0, nelem * sizeof (double));
+        memcpy (multi.dsat0, tracer->dsat0, nelem * sizeof (double));
+    }
+
+    for (i = 0; i < tracer->ncomp; i++)
+    {
+        ref.x[i] = tracer->x[i * tracer->nsp];
+        ref.src[i] = tracer->src[i * tracer->nsp];
+
+        for (s = 0; s < TR_NCHECK; s++)
+        {
+            multi.x[i * TR_NCHECK + s] = ref.x[i];
+            multi.src[i * TR_NCHECK + s] = ref.src[i];
+        }
+    }
+
+    TracerTransport (elem, riv, stepsize, &ref);
+    TracerTransport (elem, riv, stepsize, &multi);
+
+    for (i = 0; i < tracer->ncomp; i++)
+    {
+        for (s = 0; s < TR_NCHECK; s++)
+        {
+            nerr += (multi.x[i * TR_NCHECK + s] != ref.x[i]);
+        }
+    }
+
+    FreeTracer (&ref);
+    FreeTracer (&multi);
+
+    if (nerr > 0)
+    {
+        PIHMprintf (VL_ERROR,
+            "Error: %d tracers of %d identical species differ from the "
+            "single species result.\n", nerr, TR_NCHECK);
+        PIHMexit (EXIT_FAILURE);
+    }
+}
+
+void FreeTracer (tracer_struct *tracer)
+{
+    free (tracer->start);
+    free (tracer->nabr);
+    free (tracer->q);
+    free (tracer->qscale);
+    free (tracer->mobk);
+    free (tracer->mobm);
+    free (tracer->cin);
+    free (tracer->area);
+    free (tracer->strg);
+    free (tracer->strg0);
+    free (tracer->dsat);
+    free (tracer->dsat0);
+    free (tracer->wtex);
+    free (tracer->mob);
+    free (tracer->x);
+    free (tracer->src);
+    free (tracer->sink);
+    free (tracer->evap);
+    free (tracer->dout);
+    free (tracer->rhs);
+    free (tracer->diag);
+    free (tracer->work);
+    free (tracer->cstart);
+    free (tracer->gstart);
+    free (tracer->corder);
+    free (tracer->mass);
+    free (tracer->gain);
+    free (tracer->loss);
+}
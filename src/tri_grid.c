@@ -0,0 +1,196 @@
+#include "pihm.h"
+
+static int InTri (const double *xv, const double *yv, double x, double y)
+{
+    double          dot00, dot01, dot02, dot11, dot12;
+    double          inv_denom;
+    double          u, v;
+
+    /* Barycentric coordinates of the point. Points on edges are outside */
+    dot00 = (xv[2] - xv[0]) * (xv[2] - xv[0]) +
+        (yv[2] - yv[0]) * (yv[2] - yv[0]);
+    dot01 = (xv[2] - xv[0]) * (xv[1] - xv[0]) +
+        (yv[2] - yv[0]) * (yv[1] - yv[0]);
+    dot02 = (xv[2] - xv[0]) * (x - xv[0]) + (yv[2] - yv[0]) * (y - yv[0]);
+    dot11 = (xv[1] - xv[0]) * (xv[1] - xv[0]) +
+        (yv[1] - yv[0]) * (yv[1] - yv[0]);
+    dot12 = (xv[1] - xv[0]) * (x - xv[0]) + (yv[1] - yv[0]) * (y - yv[0]);
+    inv_denom = 1 / (dot00 * dot11 - dot01 * dot01);
+    u = (dot11 * dot02 - dot01 * dot12) * inv_denom;
+    v = (dot00 * dot12 - dot01 * dot02) * inv_denom;
+
+    return (u > 0.0 && v > 0.0 && u + v < 1.0);
+}
+
+static void CellRange (const trigrid_struct *grid, const double *xv,
+    const double *yv, int *i0, int *i1, int *j0, int *j1)
+{
+    double          x0, x1, y0, y1;
+    double          pad;
+    int             k;
+
+    x0 = x1 = xv[0];
+    y0 = y1 = yv[0];
+    for (k = 1; k < 3; k++)
+    {
+        x0 = (xv[k] < x0) ? xv[k] : x0;
+        x1 = (xv[k] > x1) ? xv[k] : x1;
+        y0 = (yv[k] < y0) ? yv[k] : y0;
+        y1 = (yv[k] > y1) ? yv[k] : y1;
+    }
+
+    /* Bounding boxes are padded, so that points that are found inside
+     * triangles because of round-off errors near edges are not missed */
+    pad = 1.0E-6 * ((grid->dx > grid->dy) ? grid->dx : grid->dy);
+
+    *i0 = (int)floor ((x0 - pad - grid->xmin) / grid->dx);
+    *i1 = (int)floor ((x1 + pad - grid->xmin) / grid->dx);
+    *j0 = (int)floor ((y0 - pad - grid->ymin) / grid->dy);
+    *j1 = (int)floor ((y1 + pad - grid->ymin) / grid->dy);
+
+    *i0 = (*i0 > 0) ? *i0 : 0;
+    *j0 = (*j0 > 0) ? *j0 : 0;
+    *i1 = (*i1 < grid->nx - 1) ? *i1 : grid->nx - 1;
+    *j1 = (*j1 < grid->ny - 1) ? *j1 : grid->ny - 1;
+}
+
+void BuildTriGrid (int ntri, const double *xv, const double *yv,
+    trigrid_struct *grid)
+{
+    int             i, j, k, n;
+    int             i0, i1, j0, j1;
+    int            *next;
+    double          xmax, ymax;
+    double          size;
+
+    grid->ntri = ntri;
+    grid->xv = (double *)malloc (3 * ntri * sizeof (double));
+    grid->yv = (double *)malloc (3 * ntri * sizeof (double));
+    memcpy (grid->xv, xv, 3 * ntri * sizeof (double));
+    memcpy (grid->yv, yv, 3 * ntri * sizeof (double));
+
+    grid->xmin = xmax = xv[0];
+    grid->ymin = ymax = yv[0];
+    for (k = 1; k < 3 * ntri; k++)
+    {
+        grid->xmin = (xv[k] < grid->xmin) ? xv[k] : grid->xmin;
+        grid->ymin = (yv[k] < grid->ymin) ? yv[k] : grid->ymin;
+        xmax = (xv[k] > xmax) ? xv[k] : xmax;
+        ymax = (yv[k] > ymax) ? yv[k] : ymax;
+    }
+
+    /* Square cells, about one cell per triangle */
+    size = sqrt ((xmax - grid->xmin) * (ymax - grid->ymin) / (double)ntri);
+    if (size <= 0.0)
+    {
+        size = ((xmax - grid->xmin) > (ymax - grid->ymin)) ?
+            (xmax - grid->xmin) : (ymax - grid->ymin);
+        size = (size > 0.0) ? size : 1.0;
+    }
+
+    grid->nx = (int)ceil ((xmax - grid->xmin) / size);
+    grid->ny = (int)ceil ((ymax - grid->ymin) / size);
+    grid->nx = (grid->nx > 0) ? grid->nx : 1;
+    grid->ny = (grid->ny > 0) ? grid->ny : 1;
+    grid->dx = ((xmax - grid->xmin) > 0.0) ?
+        (xmax - grid->xmin) / (double)grid->nx : size;
+    grid->dy = ((ymax - grid->ymin) > 0.0) ?
+        (ymax - grid->ymin) / (double)grid->ny : size;
+
+    /* Count triangles of each cell, then fill cell lists in ascending
+     * triangle order */
+    grid->start = (int *)calloc (grid->nx * grid->ny + 1, sizeof (int));
+
+    for (k = 0; k < ntri; k++)
+    {
+        CellRange (grid, &xv[3 * k], &yv[3 * k], &i0, &i1, &j0, &j1);
+        for (j = j0; j <= j1; j++)
+        {
+            for (i = i0; i <= i1; i++)
+            {
+                grid->start[j * grid->nx + i + 1]++;
+            }
+        }
+    }
+
+    for (n = 0; n < grid->nx * grid->ny; n++)
+    {
+        grid->start[n + 1] += grid->start[n];
+    }
+
+    grid->tri = (int *)malloc (grid->start[grid->nx * grid->ny] *
+        sizeof (int));
+    next = (int *)malloc (grid->nx * grid->ny * sizeof (int));
+    memcpy (next, grid->start, grid->nx * grid->ny * sizeof (int));
+
+    for (k = 0; k < ntri; k++)
+    {
+        CellRange (grid, &xv[3 * k], &yv[3 * k], &i0, &i1, &j0, &j1);
+        for (j = j0; j <= j1; j++)
+        {
+            for (i = i0; i <= i1; i++)
+            {
+                grid->tri[next[j * grid->nx + i]++] = k;
+            }
+        }
+    }
+
+    free (next);
+}
+
+int LocateTri (const trigrid_struct *grid, double x, double y, int skip1,
+    int skip2)
+{
+    int             i, j, n;
+    double          pad;
+
+    /* Returns the triangle that contains the point, excluding two given
+     * triangles, or -1 if the point is not in any triangle. If the point is
+     * in more than one triangle, the one with the lowest index is returned,
+     * as in a linear search */
+    i = (int)floor ((x - grid->xmin) / grid->dx);
+    j = (int)floor ((y - grid->ymin) / grid->dy);
+
+    /* Points within the padding of triangle bounding boxes belong to the
+     * cells on grid edges */
+    pad = 1.0E-6 * ((grid->dx > grid->dy) ? grid->dx : grid->dy);
+    if (x >= grid->xmin - pad && x <= grid->xmin + grid->nx * grid->dx + pad)
+    {
+        i = (i > 0) ? i : 0;
+        i = (i < grid->nx - 1) ? i : grid->nx - 1;
+    }
+    if (y >= grid->ymin - pad && y <= grid->ymin + grid->ny * grid->dy + pad)
+    {
+        j = (j > 0) ? j : 0;
+        j = (j < grid->ny - 1) ? j : grid->ny - 1;
+    }
+
+    if (i < 0 || i >= grid->nx || j < 0 || j >= grid->ny)
+    {
+        return (-1);
+    }
+
+    for (n = grid->start[j * grid->nx + i];
+        n < grid->start[j * grid->nx + i + 1]; n++)
+    {
+        int             k;
+
+        k = grid->tri[n];
+
+        if (k != skip1 && k != skip2 &&
+            InTri (&grid->xv[3 * k], &grid->yv[3 * k], x, y))
+        {
+            return (k);
+        }
+    }
+
+    return (-1);
+}
+
+void FreeTriGrid (trigrid_struct *grid)
+{
+    free (grid->xv);
+    free (grid->yv);
+    free (grid->start);
+    free (grid->tri);
+}
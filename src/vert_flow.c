@@ -8,7 +8,9 @@ void VerticalFlow (pihm_struct pihm)
     dt = (double)pihm->ctrl.stepsize;
 
 #ifdef _OPENMP
-#pragma omp parallel for
+    KernelStart (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[VERTFLOW_KERNEL]);
+#pragma omp parallel for schedule(runtime) \
+    num_threads(pihm->ctrl.kernel[VERTFLOW_KERNEL].nthreads)
 #endif
     for (i = 0; i < nelem; i++)
     {
@@ -41,7 +43,7 @@ void VerticalFlow (pihm_struct pihm)
             dh_by_dz = (dh_by_dz < 1.0 && dh_by_dz > 0.0) ? 1.0 : dh_by_dz;
 
             satn = 1.0;
-            satkfunc = KrFunc (elem->soil.alpha, elem->soil.beta, satn);
+            satkfunc = KrFuncSoil (&elem->soil, satn);
 
             if (elem->soil.areafh == 0.0)
             {
@@ -91,7 +93,7 @@ void VerticalFlow (pihm_struct pihm)
             satn = (satn > 1.0) ? 1.0 : satn;
             satn = (satn < SATMIN) ? SATMIN : satn;
 
-            psi_u = Psi (satn, elem->soil.alpha, elem->soil.beta);
+            psi_u = PsiSoil (&elem->soil, satn);
             /* Note: for psi calculation using van genuchten relation, cutting
              * the psi-sat tail at small saturation can be performed for
              * computational advantage. if you dont' want to perform this,
@@ -105,7 +107,7 @@ void VerticalFlow (pihm_struct pihm)
             dh_by_dz = (elem->ws.surfh < 0.0 && dh_by_dz > 0.0) ?
                 0.0 : dh_by_dz;
 
-            satkfunc = KrFunc (elem->soil.alpha, elem->soil.beta, satn);
+            satkfunc = KrFuncSoil (&elem->soil, satn);
 
             if (elem->soil.areafh == 0.0)
             {
@@ -138,9 +140,9 @@ void VerticalFlow (pihm_struct pihm)
             satn = (satn > 1.0) ? 1.0 : satn;
             satn = (satn < SATMIN) ? SATMIN : satn;
 
-            satkfunc = KrFunc (elem->soil.alpha, elem->soil.beta, satn);
+            satkfunc = KrFuncSoil (&elem->soil, satn);
 
-            psi_u = Psi (satn, elem->soil.alpha, elem->soil.beta);
+            psi_u = PsiSoil (&elem->soil, satn);
 
             dh_by_dz =
                 (0.5 * deficit + psi_u) / (0.5 * (deficit + elem->ws.gw));
@@ -157,6 +159,9 @@ void VerticalFlow (pihm_struct pihm)
                 0.0 : elem->wf.rechg;
         }
     }
+#ifdef _OPENMP
+    KernelEnd (pihm->ctrl.omp_tune, &pihm->ctrl.kernel[VERTFLOW_KERNEL]);
+#endif
 }
 
 double AvgKV (double dmac, double deficit, double gw, double macp_status,
@@ -287,3 +292,15 @@ double Psi (double satn, double alpha, double beta)
         pow (pow (1.0 / satn, beta / (beta - 1.0)) - 1.0,
             1.0 / beta) / alpha);
 }
+
+double DPsi (double satn, double alpha, double beta)
+{
+    double          expon;
+
+    /* Derivative of soil water potential with respect to saturation ratio */
+    expon = 1.0 - 1.0 / beta;
+
+    return ((1.0 - expon) / alpha / expon *
+        pow (pow (satn, -1.0 / expon) - 1.0, -expon) *
+        pow (satn, -(1.0 / expon + 1.0)));
+}
@@ -0,0 +1,459 @@
+#include "pihm.h"
+
+#define AGE_TOL         1.0E-6
+
+void ReadAgeCtrl (char *cmdstr, ctrl_struct *ctrl, char *filename, int lno)
+{
+    char            optstr[MAXSTRING];
+
+    sscanf (cmdstr, "%s", optstr);
+
+    if (strcasecmp (optstr, "WATER_AGE") == 0)
+    {
+        ReadKeyword (cmdstr, "WATER_AGE", &ctrl->water_age, 'i', filename,
+            lno);
+#ifdef _MPI_
+        if (ctrl->water_age)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error: Water age tracking is not supported in PIHM-MPI.\n");
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename,
+                lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+#endif
+    }
+    else if (strcasecmp (optstr, "AGE_NBIN") == 0)
+    {
+        ReadKeyword (cmdstr, "AGE_NBIN", &ctrl->age_nbin, 'i', filename, lno);
+        if (ctrl->age_nbin == 1 || ctrl->age_nbin < 0 ||
+            ctrl->age_nbin > MAXAGEBIN)
+        {
+            PIHMprintf (VL_ERROR,
+                "Error: AGE_NBIN should be 0, or between 2 and %d.\n",
+                MAXAGEBIN);
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename,
+                lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+    }
+    else if (strcasecmp (optstr, "AGE_BIN_WIDTH") == 0)
+    {
+        ReadKeyword (cmdstr, "AGE_BIN_WIDTH", &ctrl->age_binw, 'd', filename,
+            lno);
+        if (ctrl->age_binw <= 0.0)
+        {
+            PIHMprintf (VL_ERROR, "Error: AGE_BIN_WIDTH should be positive.\n");
+            PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename,
+                lno);
+            PIHMexit (EXIT_FAILURE);
+        }
+    }
+    else if (strcasecmp (optstr, "AGE_SURF") == 0)
+    {
+        ctrl->prtvrbl[AGE_SURF_CTRL] = ReadPrtCtrl (cmdstr, "AGE_SURF",
+            filename, lno);
+    }
+    else if (strcasecmp (optstr, "AGE_UNSAT") == 0)
+    {
+        ctrl->prtvrbl[AGE_UNSAT_CTRL] = ReadPrtCtrl (cmdstr, "AGE_UNSAT",
+            filename, lno);
+    }
+    else if (strcasecmp (optstr, "AGE_GW") == 0)
+    {
+        ctrl->prtvrbl[AGE_GW_CTRL] = ReadPrtCtrl (cmdstr, "AGE_GW",
+            filename, lno);
+    }
+    else if (strcasecmp (optstr, "AGE_RIVSTG") == 0)
+    {
+        ctrl->prtvrbl[AGE_RIVSTG_CTRL] = ReadPrtCtrl (cmdstr, "AGE_RIVSTG",
+            filename, lno);
+    }
+    else if (strcasecmp (optstr, "AGE_RIVGW") == 0)
+    {
+        ctrl->prtvrbl[AGE_RIVGW_CTRL] = ReadPrtCtrl (cmdstr, "AGE_RIVGW",
+            filename, lno);
+    }
+    else if (strcasecmp (optstr, "TTD_SURF") == 0)
+    {
+        ctrl->prtvrbl[TTD_SURF_CTRL] = ReadPrtCtrl (cmdstr, "TTD_SURF",
+            filename, lno);
+    }
+    else if (strcasecmp (optstr, "TTD_UNSAT") == 0)
+    {
+        ctrl->prtvrbl[TTD_UNSAT_CTRL] = ReadPrtCtrl (cmdstr, "TTD_UNSAT",
+            filename, lno);
+    }
+    else if (strcasecmp (optstr, "TTD_GW") == 0)
+    {
+        ctrl->prtvrbl[TTD_GW_CTRL] = ReadPrtCtrl (cmdstr, "TTD_GW",
+            filename, lno);
+    }
+    else if (strcasecmp (optstr, "TTD_RIVSTG") == 0)
+    {
+        ctrl->prtvrbl[TTD_RIVSTG_CTRL] = ReadPrtCtrl (cmdstr, "TTD_RIVSTG",
+            filename, lno);
+    }
+    else if (strcasecmp (optstr, "TTD_RIVGW") == 0)
+    {
+        ctrl->prtvrbl[TTD_RIVGW_CTRL] = ReadPrtCtrl (cmdstr, "TTD_RIVGW",
+            filename, lno);
+    }
+    else
+    {
+        PIHMprintf (VL_ERROR, "Error: Unknown keyword \"%s\".\n", optstr);
+        PIHMprintf (VL_ERROR, "Error in %s near Line %d.\n", filename, lno);
+        PIHMexit (EXIT_FAILURE);
+    }
+}
+
+void InitWaterAge (elem_struct *elem, river_struct *riv,
+    const ctrl_struct *ctrl, tracer_struct *age)
+{
+    int             i, k;
+    int             nsp;
+    double          mobile[MAXAGEBIN];
+
+    /* Age is tracked as age-weighted storage [m day], a fully mobile tracer
+     * with unsaturated and saturated zones as separate compartments. With
+     * age bins, water of each bin but the youngest is another species [m],
+     * and the youngest bin is the rest of the storage. All water is new at
+     * the beginning of the simulation */
+    nsp = (ctrl->age_nbin > 0) ? ctrl->age_nbin : 1;
+
+    /* Bins are shifted at the end of model steps */
+    if (nsp > 1 && fmod (ctrl->age_binw * DAYINSEC, ctrl->stepsize) != 0.0)
+    {
+        PIHMprintf (VL_ERROR, "Error: AGE_BIN_WIDTH should be an integral "
+            "multiple of model step size.\n");
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    for (k = 0; k < nsp; k++)
+    {
+        mobile[k] = 1.0;
+    }
+
+    InitTracer (elem, riv, nsp, mobile, 1, age);
+
+    for (i = 0; i < nelem; i++)
+    {
+        elem[i].age.surf = 0.0;
+        elem[i].age.unsat = 0.0;
+        elem[i].age.gw = 0.0;
+
+        for (k = 0; k < MAXAGEBIN; k++)
+        {
+            elem[i].age.surf_ttd[k] = (k == 0) ? 1.0 : 0.0;
+            elem[i].age.unsat_ttd[k] = (k == 0) ? 1.0 : 0.0;
+            elem[i].age.gw_ttd[k] = (k == 0) ? 1.0 : 0.0;
+        }
+    }
+
+    for (i = 0; i < nriver; i++)
+    {
+        riv[i].age.stage = 0.0;
+        riv[i].age.gw = 0.0;
+
+        for (k = 0; k < MAXAGEBIN; k++)
+        {
+            riv[i].age.stage_ttd[k] = (k == 0) ? 1.0 : 0.0;
+            riv[i].age.gw_ttd[k] = (k == 0) ? 1.0 : 0.0;
+        }
+    }
+}
+
+static void AgeBins (const tracer_struct *age, int i, double strg,
+    double *ttd)
+{
+    int             k;
+    double          old = 0.0;
+
+    /* Fractions of storage in age bins. Water of the youngest bin is the
+     * rest of the storage */
+    for (k = 1; k < age->nsp; k++)
+    {
+        ttd[k] = age->x[i * age->nsp + k];
+        old += ttd[k];
+    }
+    ttd[0] = (strg > old) ? strg - old : 0.0;
+
+    if (strg > 0.0)
+    {
+        for (k = 0; k < age->nsp; k++)
+        {
+            ttd[k] /= strg;
+        }
+    }
+}
+
+void WaterAge (elem_struct *elem, river_struct *riv, ctrl_struct *ctrl,
+    tracer_struct *age)
+{
+    int             i, k;
+    int             nsp;
+    double          dry[MAXAGEBIN];
+    double          excess = 0.0;
+    double          overfill = 0.0;
+    double          outside = 0.0;
+    double          elapsed;
+    double          tau;
+
+    nsp = age->nsp;
+
+    /*
+     * All water present at the beginning of the step ages one day per day.
+     * Precipitation and other water that is not explained by paths bring in
+     * water of age zero, and evapotranspiration and outflows through domain
+     * boundaries remove water of the mean age and of the age distribution
+     */
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < age->ncomp; i++)
+    {
+        age->src[i * nsp] = age->strg0[i] / DAYINSEC;
+    }
+
+    /*
+     * Age bins are shifted every bin width, so that bin k holds water that
+     * entered the domain k bin widths before the last shift, and the oldest
+     * bin collects older water. Water of the youngest bin is the rest of the
+     * storage, which is new water since the last shift
+     */
+    if (nsp > 1 && age->time > 0.0 &&
+        fmod (age->time, ctrl->age_binw * DAYINSEC) == 0.0)
+    {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (i = 0; i < age->ncomp; i++)
+        {
+            int             j;
+            double         *x;
+            double          young;
+
+            x = &age->x[i * nsp];
+
+            young = age->strg0[i];
+            for (j = 1; j < nsp; j++)
+            {
+                young -= x[j];
+            }
+            young = (young > 0.0) ? young : 0.0;
+
+            x[nsp - 1] += (nsp > 2) ? x[nsp - 2] : young;
+            for (j = nsp - 2; j > 0; j--)
+            {
+                x[j] = (j > 1) ? x[j - 1] : young;
+            }
+        }
+    }
+
+    TracerSinks (elem, 1, age);
+
+    if (debug_mode)
+    {
+        CheckTracerSpecies (elem, riv, (double)ctrl->stepsize, age);
+    }
+
+    TracerTransport (elem, riv, (double)ctrl->stepsize, age);
+
+    /*
+     * Storages that dry up lose their age-weighted storage and aged water
+     */
+    for (k = 0; k < nsp; k++)
+    {
+        dry[k] = 0.0;
+    }
+
+    for (i = 0; i < age->ncomp; i++)
+    {
+        if (age->strg[i] <= 0.0)
+        {
+            for (k = 0; k < nsp; k++)
+            {
+                dry[k] += age->area[i] * age->x[i * nsp + k];
+                age->x[i * nsp + k] = 0.0;
+            }
+        }
+    }
+
+    for (k = 0; k < nsp; k++)
+    {
+        age->mass[k] -= dry[k];
+        age->loss[k] += dry[k];
+    }
+
+    /*
+     * Mean ages
+     */
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < nelem; i++)
+    {
+        elem[i].age.surf = (age->strg[TR_SURF (i)] > 0.0) ?
+            age->x[TR_SURF (i) * nsp] / age->strg[TR_SURF (i)] : 0.0;
+        elem[i].age.unsat = (age->strg[TR_UNSAT (i)] > 0.0) ?
+            age->x[TR_UNSAT (i) * nsp] / age->strg[TR_UNSAT (i)] : 0.0;
+        elem[i].age.gw = (age->strg[TR_SUB (i)] > 0.0) ?
+            age->x[TR_SUB (i) * nsp] / age->strg[TR_SUB (i)] : 0.0;
+
+        if (nsp > 1)
+        {
+            AgeBins (age, TR_SURF (i), age->strg[TR_SURF (i)],
+                elem[i].age.surf_ttd);
+            AgeBins (age, TR_UNSAT (i), age->strg[TR_UNSAT (i)],
+                elem[i].age.unsat_ttd);
+            AgeBins (age, TR_SUB (i), age->strg[TR_SUB (i)],
+                elem[i].age.gw_ttd);
+        }
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < nriver; i++)
+    {
+        riv[i].age.stage = (age->strg[TR_STREAM (i)] > 0.0) ?
+            age->x[TR_STREAM (i) * nsp] / age->strg[TR_STREAM (i)] : 0.0;
+        riv[i].age.gw = (age->strg[TR_BED (i)] > 0.0) ?
+            age->x[TR_BED (i) * nsp] / age->strg[TR_BED (i)] : 0.0;
+
+        if (nsp > 1)
+        {
+            AgeBins (age, TR_STREAM (i), age->strg[TR_STREAM (i)],
+                riv[i].age.stage_ttd);
+            AgeBins (age, TR_BED (i), age->strg[TR_BED (i)],
+                riv[i].age.gw_ttd);
+        }
+    }
+
+    /*
+     * All water is new at the beginning of the simulation, so that no mean
+     * age exceeds the elapsed time, and the age-weighted storage of the
+     * domain is aging minus outflows. Water of age bins other than the
+     * youngest cannot exceed the storage, and mean ages are within the age
+     * ranges of bins. With tau the time since the last shift, ages of the
+     * youngest bin are from 0 to tau, ages of bin k from (k - 1) bin widths
+     * plus tau to k bin widths plus tau, and ages of the oldest bin up to the
+     * elapsed time
+     */
+    elapsed = age->time / DAYINSEC;
+    tau = fmod (elapsed, ctrl->age_binw);
+    tau = (tau > 0.0 || elapsed == 0.0) ? tau : ctrl->age_binw;
+
+#ifdef _OPENMP
+#pragma omp parallel for reduction(max:excess, overfill, outside)
+#endif
+    for (i = 0; i < age->ncomp; i++)
+    {
+        int             j;
+        double          mean;
+        double          ttd[MAXAGEBIN];
+        double          old = 0.0;
+        double          lo = 0.0;
+        double          hi;
+
+        if (age->strg[i] > 0.0)
+        {
+            mean = age->x[i * nsp] / age->strg[i];
+
+            excess = (mean - elapsed > excess) ? mean - elapsed : excess;
+
+            if (nsp > 1)
+            {
+                for (j = 1; j < nsp; j++)
+                {
+                    old += age->x[i * nsp + j];
+                }
+                overfill = ((old - age->strg[i]) / age->strg[i] > overfill) ?
+                    (old - age->strg[i]) / age->strg[i] : overfill;
+
+                AgeBins (age, i, age->strg[i], ttd);
+
+                hi = ttd[0] * tau;
+                for (j = 1; j < nsp; j++)
+                {
+                    lo += ttd[j] * ((j - 1) * ctrl->age_binw + tau);
+                    hi += ttd[j] * ((j < nsp - 1) ?
+                        j * ctrl->age_binw + tau : elapsed);
+                }
+
+                outside = (lo - mean > outside) ? lo - mean : outside;
+                outside = (mean - hi > outside) ? mean - hi : outside;
+            }
+        }
+    }
+
+    ctrl->age_excess = (excess > ctrl->age_excess) ?
+        excess : ctrl->age_excess;
+
+    if (debug_mode &&
+        (excess > AGE_TOL * elapsed || age->errmax > AGE_TOL))
+    {
+        PIHMprintf (VL_ERROR,
+            "Error: Water ages are not conserved after %.0lf s.\n"
+            "Mean ages exceed the elapsed time by %.3le day, and the relative "
+            "balance error is %.3le.\n", age->time, excess, age->errmax);
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    if (debug_mode && (overfill > AGE_TOL || outside > AGE_TOL * elapsed))
+    {
+        PIHMprintf (VL_ERROR,
+            "Error: Water age distributions are not consistent after %.0lf "
+            "s.\n"
+            "Water of age bins exceeds storage by %.3le, and mean ages are "
+            "outside of the age ranges of bins by %.3le day.\n", age->time,
+            overfill, outside);
+        PIHMexit (EXIT_FAILURE);
+    }
+}
+
+void PrtAgeStats (const ctrl_struct *ctrl, const tracer_struct *age,
+    double cputime)
+{
+    if (ctrl->water_age)
+    {
+        PIHMprintf (VL_NORMAL, "Water age tracking: %.2f s (%.1f%% of run "
+            "time)\n", ctrl->age_cputime,
+            (cputime > 0.0) ? 100.0 * ctrl->age_cputime / cputime : 0.0);
+        PIHMprintf (VL_NORMAL, "  Age-weighted storage %.6le m3 day, aging "
+            "%.6le, outflows %.6le\n", age->mass[0], age->gain[0],
+            age->loss[0]);
+        PIHMprintf (VL_NORMAL, "  Maximum relative balance error %.2le, "
+            "maximum mean age over elapsed time %.2le day\n", age->errmax,
+            ctrl->age_excess);
+
+        if (ctrl->age_nbin > 0)
+        {
+            int             i, k;
+            int             len = 0;
+            double          total = 0.0;
+            double          old = 0.0;
+            char            str[MAXSTRING];
+
+            for (i = 0; i < age->ncomp; i++)
+            {
+                total += age->area[i] * age->strg[i];
+            }
+            for (k = 1; k < age->nsp; k++)
+            {
+                old += age->mass[k];
+            }
+
+            /* Fractions of domain water in age bins, youngest first */
+            for (k = 0; k < age->nsp; k++)
+            {
+                len += snprintf (str + len, MAXSTRING - len, " %.3f",
+                    (total > 0.0) ?
+                    ((k == 0) ? total - old : age->mass[k]) / total : 0.0);
+            }
+
+            PIHMprintf (VL_NORMAL, "  Domain water in age bins of %g "
+                "days:%s\n", ctrl->age_binw, str);
+        }
+    }
+}
@@ -0,0 +1,358 @@
+/*****************************************************************************
+ * Checks the block kernels of daily BGC against the original scalar
+ * routines. Photosynthesis and decomposition rate scalars of random lanes
+ * are calculated by PhotosynthesisBlk and DecompScalarBlk, and every output
+ * must be identical to that of the scalar routines of each lane.
+ *
+ * Build and run with "make test-bgc"
+ ****************************************************************************/
+#include "pihm.h"
+
+#define NTEST   10000
+
+/* Globals defined in main.c */
+int             verbose_mode;
+int             debug_mode;
+int             corr_mode;
+int             spinup_mode;
+int             ensemble_mode;
+int             nelem;
+int             nriver;
+int             nthreads = 1;
+char            project[MAXSTRING];
+int             first_balance;
+
+static double   Rand (void);
+static void     Photosynthesis (psn_struct *);
+static void     DecompScalar (double, double, double *, double *);
+
+static unsigned long seed = 12345;
+
+static double Rand (void)
+{
+    /* Uniform random numbers in [0, 1), the same on all platforms */
+    seed = (seed * 1103515245 + 12345) % 2147483648UL;
+
+    return ((double)seed / 2147483648.0);
+}
+
+int main (void)
+{
+    bgcblk_struct   blk;
+    psn_struct      psn[2 * NOAH_BLOCK];
+    epvar_struct    epv[NOAH_BLOCK];
+    int             itest, k, nlane = 0, nfail = 0;
+
+    for (itest = 0; itest < NTEST; itest++)
+    {
+        /* Partial blocks are tested as well as full blocks */
+        blk.npsn = 1 + (int)(Rand () * 2 * NOAH_BLOCK);
+        blk.ndcmp = 1 + (int)(Rand () * NOAH_BLOCK);
+
+        for (k = 0; k < blk.npsn; k++)
+        {
+            memset (&psn[k], 0, sizeof (psn_struct));
+            psn[k].c3 = (Rand () < 0.5);
+            psn[k].pa = 60000.0 + 42000.0 * Rand ();
+            psn[k].co2 = 280.0 + 500.0 * Rand ();
+            psn[k].t = -20.0 + 60.0 * Rand ();
+            psn[k].lnc = 0.0005 + 0.003 * Rand ();
+            psn[k].flnr = 0.02 + 0.2 * Rand ();
+            psn[k].ppfd = (Rand () < 0.1) ? 0.0 : 2000.0 * Rand ();
+            psn[k].g = 0.001 + 2.0 * Rand ();
+            psn[k].dlmr = Rand ();
+            blk.psn[k] = &psn[k];
+        }
+
+        for (k = 0; k < blk.ndcmp; k++)
+        {
+            memset (&epv[k], 0, sizeof (epvar_struct));
+            /* Water potentials and temperatures outside the limits of the
+             * rate scalars are included */
+            epv[k].psi = -15.0 * Rand () * Rand ();
+            blk.tsoil[k] = -20.0 + 55.0 * Rand ();
+            blk.epv[k] = &epv[k];
+        }
+
+        PhotosynthesisBlk (&blk);
+
+        DecompScalarBlk (&blk);
+
+        for (k = 0; k < blk.npsn; k++)
+        {
+            psn_struct      ref;
+
+            ref = psn[k];
+
+            Photosynthesis (&ref);
+
+            if (ref.Ci != psn[k].Ci || ref.O2 != psn[k].O2 ||
+                ref.Ca != psn[k].Ca || ref.gamma != psn[k].gamma ||
+                ref.Kc != psn[k].Kc || ref.Ko != psn[k].Ko ||
+                ref.Vmax != psn[k].Vmax || ref.Jmax != psn[k].Jmax ||
+                ref.J != psn[k].J || ref.Av != psn[k].Av ||
+                ref.Aj != psn[k].Aj || ref.A != psn[k].A)
+            {
+                printf ("Test %d: photosynthesis of lane %d differs from "
+                    "the scalar result (%.17lg vs. %.17lg).\n", itest, k,
+                    psn[k].A, ref.A);
+                nfail++;
+            }
+        }
+
+        for (k = 0; k < blk.ndcmp; k++)
+        {
+            double          t_scalar, w_scalar;
+
+            DecompScalar (blk.tsoil[k], epv[k].psi, &t_scalar, &w_scalar);
+
+            if (t_scalar != epv[k].t_scalar || w_scalar != epv[k].w_scalar ||
+                w_scalar * t_scalar != epv[k].rate_scalar)
+            {
+                printf ("Test %d: decomposition rate scalar of lane %d "
+                    "differs from the scalar result (%.17lg vs. %.17lg).\n",
+                    itest, k, epv[k].rate_scalar, w_scalar * t_scalar);
+                nfail++;
+            }
+        }
+
+        nlane += blk.npsn + blk.ndcmp;
+    }
+
+    printf ("BGC blocks: %d blocks, %d lanes, %d differences.\n", NTEST,
+        nlane, nfail);
+
+    return ((nfail > 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static void Photosynthesis (psn_struct *psn)
+{
+    /*
+     * Photosynthesis of a single lane, the original scalar routine
+     *
+     * The following variables are assumed to be defined in the psn struct
+     * at the time of the function call:
+     * c3         (flag) set to 1 for C3 model, 0 for C4 model
+     * pa         (Pa) atmospheric pressure
+     * co2        (ppm) atmospheric [CO2]
+     * t          (deg C) air temperature
+     * lnc        (kg Nleaf/m2) leaf N concentration, per unit projected LAI
+     * flnr       (kg NRub/kg Nleaf) fraction of leaf N in Rubisco
+     * ppfd       (umol photons/m2/s) PAR flux density, per unit projected LAI
+     * g          (umol CO2/m2/s/Pa) leaf-scale conductance to CO2, proj area
+     *              basis
+     * dlmr       (umol CO2/m2/s) day leaf maint resp, on projected leaf area
+     *              basis
+     *
+     * The following variables in psn struct are defined upon function return:
+     * Ci         (Pa) intercellular [CO2]
+     * Ca         (Pa) atmospheric [CO2]
+     * O2         (Pa) atmospheric [O2]
+     * gamma      (Pa) CO2 compensation point, in the absence of maint resp.
+     * Kc         (Pa) MM constant for carboxylation
+     * Ko         (Pa) MM constant for oxygenation
+     * Vmax       (umol CO2/m2/s) max rate of carboxylation
+     * Jmax       (umol electrons/m2/s) max rate electron transport
+     * J          (umol RuBP/m2/s) rate of RuBP regeneration
+     * Av         (umol CO2/m2/s) carboxylation limited assimilation
+     * Aj         (umol CO2/m2/s) RuBP regen limited assimilation
+     * A          (umol CO2/m2/s) final assimilation rate
+     */
+
+    /* the weight proportion of Rubisco to its nitrogen content, fnr, is
+     * calculated from the relative proportions of the basic amino acids that
+     * make up the enzyme, as listed in the Handbook of Biochemistry,
+     * Proteins, Vol III, p. 510, which references: Kuehn and McFadden,
+     * Biochemistry, 8:2403, 1969 */
+    static double   fnr = 7.16; /* kg Rub/kg NRub */
+
+    /* the following enzyme kinetic constants are from:
+     * Woodrow, I.E., and J.A. Berry, 1980. Enzymatic regulation of
+     * photosynthetic CO2 fixation in C3 plants. Ann. Rev. Plant Physiol.
+     * Plant Mol. Biol., 39:533-594.
+     * Note that these values are given in the units used in the paper, and
+     * that they are converted to units appropriate to the rest of this
+     * function before they are used. */
+    /* I've changed the values for Kc and Ko from the Woodrow and Berry
+     * reference, and am now using the values from De Pury and Farquhar, 1997.
+     * Simple scaling of photosynthesis from leaves to canopies without the
+     * errors of big-leaf models. Plant, Cell and Env. 20: 537-557.
+     * All other parameters, including the q10's for Kc and Ko are the same as
+     * in Woodrow and Berry. */
+
+    static double   Kc25 = 404.0;       /* (ubar) MM const carboxylase,
+                                            25 deg C */
+    static double   q10Kc = 2.1;        /* (DIM) Q_10 for Kc */
+    static double   Ko25 = 248.0;       /* (mbar) MM const oxygenase,
+                                            25 deg C */
+    static double   q10Ko = 1.2;        /* (DIM) Q_10 for Ko */
+    static double   act25 = 3.6;        /* (umol/mgRubisco/min) Rubisco
+                                            activity */
+    static double   q10act = 2.4;       /* (DIM) Q_10 for Rubisco activity */
+    static double   pabs = 0.85;        /* (DIM) fPAR effectively absorbed by
+                                            PSII */
+
+    /* local variables */
+    double          t;          /* (deg C) temperature */
+    double          Kc;         /* (Pa) MM constant for carboxylase reaction*/
+    double          Ko;         /* (Pa) MM constant for oxygenase reaction */
+    double          act;        /* (umol CO2/kgRubisco/s) Rubisco activity */
+    double          Jmax;       /* (umol/m2/s) max rate electron transport */
+    double          ppe;        /* (mol/mol) photons absorbed by PSII per e-
+                                    transported */
+    double          Vmax, J, gamma, Ca, Rd, O2, g;
+    double          a, b, c, det;
+    double          Av, Aj, A;
+
+    /* begin by assigning local variables */
+    g = psn->g;
+    t = psn->t;
+    Rd = psn->dlmr;
+
+    /* convert atmospheric CO2 from ppm --> Pa */
+    Ca = psn->co2 * psn->pa / 1e6;
+
+    /* set parameters for C3 vs C4 model */
+    if (psn->c3)
+    {
+        ppe = 2.6;
+    }
+    else                        /* C4 */
+    {
+        ppe = 3.5;
+        Ca *= 10.0;
+    }
+    psn->Ca = Ca;
+
+    /* calculate atmospheric O2 in Pa, assumes 21% O2 by volume */
+    psn->O2 = O2 = 0.21 * psn->pa;
+
+    /* correct kinetic constants for temperature, and do unit conversions */
+    Ko = Ko25 * pow (q10Ko, (t - 25.0) / 10.0);
+    psn->Ko = Ko = Ko * 100.0;  /* mbar --> Pa */
+    if (t > 15.0)
+    {
+        Kc = Kc25 * pow (q10Kc, (t - 25.0) / 10.0);
+        act = act25 * pow (q10act, (t - 25.0) / 10.0);
+    }
+    else
+    {
+        Kc = Kc25 * pow (1.8 * q10Kc, (t - 15.0) / 10.0) / q10Kc;
+        act = act25 * pow (1.8 * q10act, (t - 15.0) / 10.0) / q10act;
+    }
+    psn->Kc = Kc = Kc * 0.10;   /* ubar --> Pa */
+    act = act * 1e6 / 60.0;     /* umol/mg/min --> umol/kg/s */
+
+    /* calculate gamma (Pa), assumes Vomax/Vcmax = 0.21 */
+    psn->gamma = gamma = 0.5 * 0.21 * Kc * psn->O2 / Ko;
+
+    /* calculate Vmax from leaf nitrogen data and Rubisco activity */
+
+    /* kg Nleaf   kg NRub    kg Rub      umol            umol
+     * -------- X -------  X ------- X ---------   =   --------
+     *  m2         kg Nleaf   kg NRub   kg RUB * s       m2 * s
+     *
+     * (lnc)  X  (flnr)  X  (fnr)  X   (act)     =    (Vmax) */
+    psn->Vmax = Vmax = psn->lnc * psn->flnr * fnr * act;
+
+    /* calculate Jmax = f(Vmax), reference:
+     * Wullschleger, S.D., 1993.  Biochemical limitations to carbon
+     * assimilation in C3 plants - A retrospective analysis of the A/Ci curves
+     * from 109 species. Journal of Experimental Botany, 44:907-920. */
+    psn->Jmax = Jmax = 2.1 * Vmax;
+
+    /* calculate J = f(Jmax, ppfd), reference:
+     * de Pury and Farquhar 1997 Plant Cell and Env. */
+    a = 0.7;
+    b = -Jmax - (psn->ppfd * pabs / ppe);
+    c = Jmax * psn->ppfd * pabs / ppe;
+    psn->J = J = (-b - sqrt (b * b - 4.0 * a * c)) / (2.0 * a);
+
+    /* solve for Av and Aj using the quadratic equation, substitution for Ci
+     * from A = g(Ca-Ci) into the equations from Farquhar and von Caemmerer:
+     *
+     *        Vmax (Ci - gamma)
+     * Av =  -------------------   -   Rd
+     *        Ci + Kc (1 + O2/Ko)
+     *
+     *          J (Ci - gamma)
+     * Aj  =  -------------------  -   Rd
+     *        4.5 Ci + 10.5 gamma
+     */
+
+    /* quadratic solution for Av */
+    a = -1.0 / g;
+    b = Ca + (Vmax - Rd) / g + Kc * (1.0 + O2 / Ko);
+    c = Vmax * (gamma - Ca) + Rd * (Ca + Kc * (1.0 + O2 / Ko));
+
+    if ((det = b * b - 4.0 * a * c) < 0.0)
+    {
+        PIHMprintf (VL_ERROR,
+            "ERROR: negative root error in psn routine\n");
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    psn->Av = Av = (-b + sqrt (det)) / (2.0 * a);
+
+    /* quadratic solution for Aj */
+    a = -4.5 / g;
+    b = 4.5 * Ca + 10.5 * gamma + J / g - 4.5 * Rd / g;
+    c = J * (gamma - Ca) + Rd * (4.5 * Ca + 10.5 * gamma);
+
+    if ((det = b * b - 4.0 * a * c) < 0.0)
+    {
+        PIHMprintf (VL_ERROR,
+            "ERROR: negative root error in psn routine\n");
+        PIHMexit (EXIT_FAILURE);
+    }
+
+    psn->Aj = Aj = (-b + sqrt (det)) / (2.0 * a);
+
+    /* estimate A as the minimum of (Av,Aj) */
+    if (Av < Aj)
+    {
+        A = Av;
+    }
+    else
+    {
+        A = Aj;
+    }
+    psn->A = A;
+    psn->Ci = Ca - (A / g);
+}
+
+static void DecompScalar (double tsoil, double psi, double *t_scalar,
+    double *w_scalar)
+{
+    /*
+     * Decomposition rate scalars of a single lane, the original scalar
+     * routine
+     */
+    const double    minpsi = -10.0;
+    const double    maxpsi = -0.005;
+
+    /* No decomp processes for tsoil < -10.0 C */
+    if (tsoil < -10.0)
+    {
+        *t_scalar = 0.0;
+    }
+    else
+    {
+        *t_scalar = exp (308.56 * ((1.0 / 71.02) -
+            (1.0 / (tsoil + 273.15 - 227.13))));
+    }
+
+    /* No decomp below the minimum soil water potential */
+    if (psi < minpsi)
+    {
+        *w_scalar = 0.0;
+    }
+    else if (psi > maxpsi)
+    {
+        *w_scalar = 1.0;
+    }
+    else
+    {
+        *w_scalar = log (minpsi / psi) / log (minpsi / maxpsi);
+    }
+}
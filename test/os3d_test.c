@@ -0,0 +1,434 @@
+/*****************************************************************************
+ * Checks OS3D against the original OS3D, which loops over faces with species
+ * innermost and updates grid blocks in order. Transport steps are taken on
+ * synthetic grids with and without TVD, local time stepping and
+ * precipitation, and concentrations, face mass changes and illness counters
+ * must be identical.
+ *
+ * Build and run with "make test-os3d"
+ ****************************************************************************/
+#include "pihm.h"
+
+#define EPSILON 1.0E-20
+#define NTEST   16
+#define NSTEP   20
+
+/* Globals defined in main.c */
+int             verbose_mode;
+int             debug_mode;
+int             corr_mode;
+int             spinup_mode;
+int             ensemble_mode;
+int             nelem;
+int             nriver;
+int             nthreads = 1;
+char            project[MAXSTRING];
+
+void            OS3DAlloc (Chem_Data);
+void            OS3D (realtype, realtype, Chem_Data);
+
+static double   Rand (void);
+static int      RandInt (int);
+static Chem_Data SynGrid (int, int, int, int, int);
+static void     FreeGrid (Chem_Data);
+static double   RefFaceFlux (const Chem_Data, int, int);
+static void     OS3DRef (realtype, realtype, Chem_Data);
+
+static unsigned long seed = 12345;
+
+static double Rand (void)
+{
+    /* Uniform random numbers in [0, 1), the same on all platforms */
+    seed = (seed * 1103515245 + 12345) % 2147483648UL;
+
+    return ((double)seed / 2147483648.0);
+}
+
+static int RandInt (int n)
+{
+    return ((int)(Rand () * n));
+}
+
+static Chem_Data SynGrid (int nele, int nriv, int tvd, int cpt, int prp)
+{
+    /* A grid of nele elements and nriv river segments, with ghost blocks
+     * after the os3d grid blocks, and random faces between them */
+    Chem_Data       CD;
+    int             i, j, k;
+
+    CD = (Chem_Data)calloc (1, sizeof (*CD));
+    CD->NumEle = nele;
+    CD->NumRiv = nriv;
+    CD->RivOff = RandInt (2);
+    CD->NumOsv = 2 * nele + 2 * nriv;
+    CD->NumVol = CD->NumOsv + 2;
+    CD->NumSpc = 4;
+    CD->NumStc = 6;
+    CD->TVDFlg = tvd;
+    CD->CptFlg = cpt;
+    CD->PrpFlg = prp;
+    CD->Cementation = 1.0 + Rand ();
+    CD->Condensation = 1.0 + Rand ();
+
+    CD->chemtype = (species *)calloc (CD->NumStc, sizeof (species));
+    for (j = 0; j < CD->NumStc; j++)
+    {
+        CD->chemtype[j].DiffCoe = 1.0E-5 * Rand ();
+        CD->chemtype[j].DispCoe = 0.1 * Rand ();
+        CD->chemtype[j].ChemName = (char *)malloc (MAXSTRING * sizeof (char));
+        if (j == 1)
+            strcpy (CD->chemtype[j].ChemName, "'H+'");
+        else
+            sprintf (CD->chemtype[j].ChemName, "'S%d'", j);
+    }
+
+    CD->Trans.conc =
+        (double *)malloc (CD->NumVol * CD->NumStc * sizeof (double));
+    CD->Vcele = (vol_conc *)calloc (CD->NumVol, sizeof (vol_conc));
+    for (i = 0; i < CD->NumVol; i++)
+    {
+        vol_conc       *cell = &CD->Vcele[i];
+
+        cell->index = i + 1;
+        cell->BC = (RandInt (10) == 0) ? 2 : 0;
+        cell->t_conc = &CD->Trans.conc[i * CD->NumStc];
+        for (j = 0; j < CD->NumStc; j++)
+            cell->t_conc[j] = 1.0E-4 + Rand ();
+        cell->area = 1000.0 * (0.5 + Rand ());
+        cell->height_o = 0.5 + Rand ();
+        cell->height_t = 0.5 + Rand ();
+        /* Grid blocks that are dry or small enough to become ill */
+        if (RandInt (10) == 0)
+            cell->height_t = 1.0E-3 * Rand ();
+        else if (RandInt (10) == 0)
+            cell->area = 0.1;
+        cell->vol_o = cell->area * cell->height_o;
+        cell->vol = cell->area * cell->height_t;
+        cell->porosity = 0.2 + 0.3 * Rand ();
+        cell->q = Rand () - 0.3;
+        cell->rt_step = (RandInt (3) == 0) ? 0.3 + 3.0 * Rand () : 100.0;
+    }
+
+    CD->Precipitation.t_conc = (double *)malloc (CD->NumStc * sizeof (double));
+    for (j = 0; j < CD->NumStc; j++)
+        CD->Precipitation.t_conc[j] = 1.0E-3 * Rand ();
+
+    CD->NumFac = 4 * CD->NumOsv;
+    CD->Flux = (face *)calloc (CD->NumFac, sizeof (face));
+    for (k = 0; k < CD->NumFac; k++)
+    {
+        face           *f = &CD->Flux[k];
+
+        f->nodeup = 1 + RandInt (CD->NumOsv);
+        f->nodelo = 1 + RandInt (CD->NumVol);
+        f->nodeuu = RandInt (CD->NumVol + 1);
+        f->nodell = RandInt (CD->NumVol + 1);
+        f->BC = RandInt (3);
+        f->distance = 1.0 + 100.0 * Rand ();
+        f->flux = 100.0 * (Rand () - 0.5);
+        f->velocity = f->flux / (10.0 + 100.0 * Rand ());
+        f->s_area = 10.0 + 100.0 * Rand ();
+    }
+
+    OS3DAlloc (CD);
+
+    return (CD);
+}
+
+static void FreeGrid (Chem_Data CD)
+{
+    int             j;
+
+    for (j = 0; j < CD->NumStc; j++)
+        free (CD->chemtype[j].ChemName);
+    free (CD->chemtype);
+    free (CD->Vcele);
+    free (CD->Flux);
+    free (CD->Precipitation.t_conc);
+    free (CD->Trans.conc);
+    free (CD->Trans.fconc);
+    free (CD->Trans.dconc);
+    free (CD->Trans.tmpconc);
+    free (CD->Trans.diff_coe);
+    free (CD->Trans.disp_coe);
+    free (CD->Trans.fstart);
+    free (CD->Trans.face);
+    free (CD);
+}
+
+static double RefFaceFlux (const Chem_Data CD, int k, int j)
+{
+    /* Mass change of species j of the upstream grid block from face k,
+     * computed species by species as in the original OS3D */
+    int             node_1, node_2, node_3, node_4;
+    double          flux_t, diff_flux, disp_flux, velocity, temp_conc,
+        temp_dconc, inv_dist, diff_conc, area, r_, beta_;
+
+    node_1 = CD->Flux[k].nodeup - 1;
+    node_2 = CD->Flux[k].nodelo - 1;
+    node_3 = CD->Flux[k].nodeuu - 1;
+    node_4 = CD->Flux[k].nodell - 1;
+    flux_t = -CD->Flux[k].flux;
+    velocity = -CD->Flux[k].velocity;
+    area = CD->Flux[k].s_area;
+    inv_dist = 1.0 / CD->Flux[k].distance;
+
+    diff_conc = CD->Vcele[node_2].t_conc[j] - CD->Vcele[node_1].t_conc[j];
+    diff_flux = 0.0;
+    disp_flux = 0.0;
+    if (CD->Flux[k].BC == 0)
+    {
+        diff_flux =
+            CD->chemtype[j].DiffCoe * pow (CD->Vcele[node_1].porosity,
+            CD->Cementation);
+        if (velocity < 0.0)
+            disp_flux = velocity * CD->chemtype[j].DispCoe;
+        else
+            disp_flux = -velocity * CD->chemtype[j].DispCoe;
+        diff_flux = -diff_flux * inv_dist * diff_conc * area;
+        disp_flux = disp_flux * inv_dist * diff_conc * area;
+    }
+
+    if (flux_t > 0)
+    {
+        temp_conc = CD->Vcele[node_2].t_conc[j];
+        if (CD->TVDFlg == 1 && node_4 > 0)
+        {
+            r_ = (CD->Vcele[node_2].t_conc[j] - CD->Vcele[node_4].t_conc[j] +
+                EPSILON) / (CD->Vcele[node_1].t_conc[j] -
+                CD->Vcele[node_2].t_conc[j] + EPSILON);
+            beta_ = MAX (0, MIN (MIN (2, 2 * r_), (2 + r_) / 3));
+            temp_conc = CD->Vcele[node_2].t_conc[j] + beta_ *
+                (CD->Vcele[node_1].t_conc[j] -
+                CD->Vcele[node_2].t_conc[j]) * 0.5;
+        }
+    }
+    else
+    {
+        temp_conc = CD->Vcele[node_1].t_conc[j];
+        if (CD->TVDFlg == 1 && node_3 > 0)
+        {
+            r_ = (CD->Vcele[node_1].t_conc[j] - CD->Vcele[node_3].t_conc[j] +
+                EPSILON) / (CD->Vcele[node_2].t_conc[j] -
+                CD->Vcele[node_1].t_conc[j] + EPSILON);
+            beta_ = MAX (0, MIN (MIN (2, 2 * r_), (2 + r_) / 3));
+            temp_conc = CD->Vcele[node_1].t_conc[j] + beta_ *
+                (CD->Vcele[node_2].t_conc[j] -
+                CD->Vcele[node_1].t_conc[j]) * 0.5;
+        }
+    }
+
+    temp_dconc = 0.0;
+    if (CD->Flux[k].BC != 2)
+        temp_dconc += temp_conc * flux_t;
+    if (CD->Flux[k].BC == 0)
+        temp_dconc -= diff_flux + disp_flux;
+
+    return (temp_dconc * (1.0 / 1440));
+}
+
+static void OS3DRef (realtype t, realtype stepsize, Chem_Data CD)
+{
+    /* The original OS3D, with a loop over faces and species innermost, and
+     * grid blocks updated in order. It is kept to check OS3D */
+    vol_conc       *cell;
+    double         *dconc, *tmpconc;
+    double          diff_conc, unit_c, timelps, adpstep;
+    int             i, j, k, nspc;
+
+    nspc = CD->NumSpc;
+    unit_c = 1.0 / 1440;
+    dconc = (double *)calloc (CD->NumOsv * nspc, sizeof (double));
+    tmpconc = (double *)malloc (nspc * sizeof (double));
+
+    for (k = 0; k < CD->NumFac; k++)
+    {
+        CD->Flux[k].q = 0.0;
+        for (j = 0; j < nspc; j++)
+        {
+            CD->Flux[k].q = RefFaceFlux (CD, k, j);
+            dconc[(CD->Flux[k].nodeup - 1) * nspc + j] += CD->Flux[k].q;
+        }
+    }
+
+    for (i = 0; i < CD->NumOsv; i++)
+    {
+        cell = &CD->Vcele[i];
+
+        if (CD->CptFlg == 1 && cell->rt_step < stepsize &&
+            cell->height_t > 1.0E-3 && cell->height_o > 1.0E-3 &&
+            i < 2 * CD->NumEle + CD->NumRiv - CD->RivOff)
+        {
+            timelps = t;
+            adpstep = cell->rt_step;
+            while (timelps < t + stepsize)
+            {
+                if (adpstep > t + stepsize - timelps)
+                    adpstep = t + stepsize - timelps;
+                diff_conc = 0.0;
+                for (j = 0; j < nspc; j++)
+                {
+                    tmpconc[j] = dconc[i * nspc + j] * adpstep +
+                        cell->t_conc[j] * (cell->porosity * 0.5 *
+                        (cell->vol_o + cell->vol));
+                    if (CD->PrpFlg && cell->q > 0.0)
+                        tmpconc[j] += CD->Precipitation.t_conc[j] * cell->q *
+                            adpstep * unit_c * CD->Condensation;
+                    if (tmpconc[j] < 0.0 &&
+                        strcmp (CD->chemtype[j].ChemName, "'H+'"))
+                        cell->illness++;
+                    tmpconc[j] = tmpconc[j] / (cell->porosity * 0.5 *
+                        (cell->vol + cell->vol_o));
+                    if (cell->illness < 20)
+                    {
+                        diff_conc = MAX (fabs (cell->t_conc[j] - tmpconc[j]),
+                            diff_conc);
+                        cell->t_conc[j] = tmpconc[j];
+                    }
+                }
+                if (diff_conc > 1.0E-6)
+                {
+                    for (j = 0; j < nspc; j++)
+                    {
+                        dconc[i * nspc + j] = 0.0;
+                        for (k = 0; k < CD->NumFac; k++)
+                            if (CD->Flux[k].nodeup == cell->index)
+                                dconc[i * nspc + j] += RefFaceFlux (CD, k, j);
+                    }
+                }
+
+                timelps += adpstep;
+                if (timelps >= t + stepsize)
+                    break;
+            }
+        }
+
+        if (cell->height_t > 1.0E-3 && cell->height_o > 1.0E-3)
+        {
+            if (CD->CptFlg && (cell->rt_step < stepsize ||
+                    (i >= 2 * CD->NumEle && i < 2 * CD->NumEle + CD->NumRiv)))
+                continue;
+            if (cell->BC != 2)
+            {
+                for (j = 0; j < nspc; j++)
+                {
+                    tmpconc[j] = dconc[i * nspc + j] * stepsize +
+                        cell->t_conc[j] * (cell->porosity * cell->vol_o);
+                    if (CD->PrpFlg && cell->q > 0.0)
+                        tmpconc[j] += CD->Precipitation.t_conc[j] * cell->q *
+                            stepsize * unit_c * CD->Condensation;
+                    tmpconc[j] = tmpconc[j] / (cell->porosity * cell->vol);
+                }
+                if (cell->illness < 20)
+                    for (j = 0; j < nspc; j++)
+                    {
+                        if (tmpconc[j] < 0.0 &&
+                            strcmp (CD->chemtype[j].ChemName, "'H+'") &&
+                            i < CD->NumEle * 2)
+                            cell->illness++;
+                        cell->t_conc[j] = tmpconc[j];
+                    }
+            }
+        }
+    }
+
+    free (dconc);
+    free (tmpconc);
+}
+
+int main (void)
+{
+    Chem_Data       CD;
+    double         *conc0, *conc_ref, *q_ref;
+    int            *ill0, *ill_ref;
+    int             itest, istep, i, k, n, nill = 0, nfail = 0;
+    double          t;
+
+    /* Negative concentrations of small grid blocks are reported by both
+     * versions, and are expected here */
+    if (freopen ("/dev/null", "w", stderr) == NULL)
+    {
+        printf ("Error opening /dev/null.\n");
+        exit (EXIT_FAILURE);
+    }
+
+    for (itest = 0; itest < NTEST; itest++)
+    {
+        /* All combinations of TVD, local time stepping and precipitation */
+        CD = SynGrid (5 + RandInt (50), 1 + RandInt (10), itest % 2,
+            (itest / 2) % 2, (itest / 4) % 2);
+
+        n = CD->NumVol * CD->NumStc;
+        conc0 = (double *)malloc (n * sizeof (double));
+        conc_ref = (double *)malloc (n * sizeof (double));
+        q_ref = (double *)malloc (CD->NumFac * sizeof (double));
+        ill0 = (int *)malloc (CD->NumOsv * sizeof (int));
+        ill_ref = (int *)malloc (CD->NumOsv * sizeof (int));
+
+        t = 0.0;
+        for (istep = 0; istep < NSTEP; istep++)
+        {
+            memcpy (conc0, CD->Trans.conc, n * sizeof (double));
+            for (i = 0; i < CD->NumOsv; i++)
+                ill0[i] = CD->Vcele[i].illness;
+
+            OS3DRef (t, 10.0, CD);
+
+            memcpy (conc_ref, CD->Trans.conc, n * sizeof (double));
+            for (k = 0; k < CD->NumFac; k++)
+                q_ref[k] = CD->Flux[k].q;
+            for (i = 0; i < CD->NumOsv; i++)
+            {
+                ill_ref[i] = CD->Vcele[i].illness;
+                CD->Vcele[i].illness = ill0[i];
+            }
+            memcpy (CD->Trans.conc, conc0, n * sizeof (double));
+
+            OS3D (t, 10.0, CD);
+
+            if (memcmp (conc_ref, CD->Trans.conc, n * sizeof (double)) != 0)
+            {
+                printf ("Test %d step %d: concentrations differ.\n",
+                    itest, istep);
+                nfail++;
+            }
+            for (k = 0; k < CD->NumFac; k++)
+            {
+                if (memcmp (&q_ref[k], &CD->Flux[k].q, sizeof (double)) != 0)
+                {
+                    printf ("Test %d step %d: mass changes of face %d "
+                        "differ.\n", itest, istep, k);
+                    nfail++;
+                    break;
+                }
+            }
+            for (i = 0; i < CD->NumOsv; i++)
+            {
+                if (ill_ref[i] != CD->Vcele[i].illness)
+                {
+                    printf ("Test %d step %d: illness of grid block %d "
+                        "differs.\n", itest, istep, i + 1);
+                    nfail++;
+                    break;
+                }
+            }
+
+            t += 10.0;
+        }
+
+        for (i = 0; i < CD->NumOsv; i++)
+            nill += (CD->Vcele[i].illness > 0);
+
+        free (conc0);
+        free (conc_ref);
+        free (q_ref);
+        free (ill0);
+        free (ill_ref);
+        FreeGrid (CD);
+    }
+
+    printf ("OS3D: %d grids, %d steps each, %d ill grid blocks, "
+        "%d differences.\n", NTEST, NSTEP, nill, nfail);
+
+    return ((nfail > 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,216 @@
+/*****************************************************************************
+ * Checks point location with the uniform grid index of mesh triangles
+ * (LocateTri) against a search over all triangles. Random meshes with holes
+ * are located at random points, at vertices and edge midpoints, and at the
+ * upstream points of neighboring triangles used by RT-Flux-PIHM, and every
+ * point must be found in the same triangle.
+ *
+ * Build and run with "make test-tri-grid"
+ ****************************************************************************/
+#include "pihm.h"
+
+#define NTEST   200
+#define NPOINT  2000
+
+/* Globals defined in main.c */
+int             verbose_mode;
+int             debug_mode;
+int             corr_mode;
+int             spinup_mode;
+int             ensemble_mode;
+int             nelem;
+int             nriver;
+int             nthreads = 1;
+char            project[MAXSTRING];
+
+static double   Rand (void);
+static int      InTri (const double *, const double *, double, double);
+static int      LocateTriLinear (const trigrid_struct *, double, double, int,
+    int);
+static int      Check (const trigrid_struct *, double, double, int, int);
+
+static unsigned long seed = 12345;
+
+static double Rand (void)
+{
+    /* Uniform random numbers in [0, 1), the same on all platforms */
+    seed = (seed * 1103515245 + 12345) % 2147483648UL;
+
+    return ((double)seed / 2147483648.0);
+}
+
+static int InTri (const double *xv, const double *yv, double x, double y)
+{
+    double          dot00, dot01, dot02, dot11, dot12;
+    double          inv_denom;
+    double          u, v;
+
+    /* The inside test of tri_grid.c. Points on edges are outside */
+    dot00 = (xv[2] - xv[0]) * (xv[2] - xv[0]) +
+        (yv[2] - yv[0]) * (yv[2] - yv[0]);
+    dot01 = (xv[2] - xv[0]) * (xv[1] - xv[0]) +
+        (yv[2] - yv[0]) * (yv[1] - yv[0]);
+    dot02 = (xv[2] - xv[0]) * (x - xv[0]) + (yv[2] - yv[0]) * (y - yv[0]);
+    dot11 = (xv[1] - xv[0]) * (xv[1] - xv[0]) +
+        (yv[1] - yv[0]) * (yv[1] - yv[0]);
+    dot12 = (xv[1] - xv[0]) * (x - xv[0]) + (yv[1] - yv[0]) * (y - yv[0]);
+    inv_denom = 1 / (dot00 * dot11 - dot01 * dot01);
+    u = (dot11 * dot02 - dot01 * dot12) * inv_denom;
+    v = (dot00 * dot12 - dot01 * dot02) * inv_denom;
+
+    return (u > 0.0 && v > 0.0 && u + v < 1.0);
+}
+
+static int LocateTriLinear (const trigrid_struct *grid, double x, double y,
+    int skip1, int skip2)
+{
+    int             k;
+
+    /* Search over all triangles */
+    for (k = 0; k < grid->ntri; k++)
+    {
+        if (k != skip1 && k != skip2 &&
+            InTri (&grid->xv[3 * k], &grid->yv[3 * k], x, y))
+        {
+            return (k);
+        }
+    }
+
+    return (-1);
+}
+
+static int Check (const trigrid_struct *grid, double x, double y, int skip1,
+    int skip2)
+{
+    int             k, ref;
+
+    k = LocateTri (grid, x, y, skip1, skip2);
+    ref = LocateTriLinear (grid, x, y, skip1, skip2);
+
+    if (k != ref)
+    {
+        printf ("Point (%.17lg, %.17lg) is located in triangle %d instead "
+            "of %d.\n", x, y, k, ref);
+        return (1);
+    }
+
+    return (0);
+}
+
+int main (void)
+{
+    trigrid_struct  grid;
+    double         *px, *py, *xv, *yv;
+    int             itest, nx, ny, ntri, i, j, k, m, n;
+    int             npoint = 0, nfail = 0;
+
+    for (itest = 0; itest < NTEST; itest++)
+    {
+        /* Jittered points of a structured grid, including grids of one row
+         * or column, with cells split along random diagonals */
+        nx = 1 + (int)(Rand () * 30);
+        ny = 1 + (int)(Rand () * 30);
+
+        px = (double *)malloc ((nx + 1) * (ny + 1) * sizeof (double));
+        py = (double *)malloc ((nx + 1) * (ny + 1) * sizeof (double));
+        for (j = 0; j <= ny; j++)
+        {
+            for (i = 0; i <= nx; i++)
+            {
+                px[j * (nx + 1) + i] = 1.0E5 + 100.0 * (i + 0.4 * Rand ());
+                py[j * (nx + 1) + i] = 4.0E6 + 70.0 * (j + 0.4 * Rand ());
+            }
+        }
+
+        xv = (double *)malloc (6 * nx * ny * sizeof (double));
+        yv = (double *)malloc (6 * nx * ny * sizeof (double));
+        ntri = 0;
+        for (j = 0; j < ny; j++)
+        {
+            for (i = 0; i < nx; i++)
+            {
+                int             v[4], diag;
+
+                v[0] = j * (nx + 1) + i;
+                v[1] = v[0] + 1;
+                v[2] = v[1] + nx + 1;
+                v[3] = v[0] + nx + 1;
+                diag = (Rand () < 0.5);
+
+                for (m = 0; m < 2; m++)
+                {
+                    /* Holes in the mesh */
+                    if (Rand () < 0.15 && (nx * ny > 1 || m == 1))
+                    {
+                        continue;
+                    }
+                    for (n = 0; n < 3; n++)
+                    {
+                        k = v[(diag + 2 * m + n) % 4];
+                        xv[3 * ntri + n] = px[k];
+                        yv[3 * ntri + n] = py[k];
+                    }
+                    ntri++;
+                }
+            }
+        }
+
+        BuildTriGrid (ntri, xv, yv, &grid);
+
+        for (n = 0; n < NPOINT; n++)
+        {
+            double          x, y;
+            int             skip1, skip2;
+
+            skip1 = (Rand () < 0.5) ? (int)(Rand () * ntri) : -1;
+            skip2 = (Rand () < 0.5) ? (int)(Rand () * ntri) : -1;
+
+            /* Random points, including points outside the mesh */
+            x = px[0] - 50.0 + (px[nx] - px[0] + 150.0) * Rand ();
+            y = py[0] - 50.0 + (py[ny * (nx + 1)] - py[0] + 120.0) * Rand ();
+            nfail += Check (&grid, x, y, skip1, skip2);
+
+            /* Vertices and edge midpoints */
+            k = (int)(Rand () * ntri);
+            m = (int)(Rand () * 3);
+            nfail += Check (&grid, xv[3 * k + m], yv[3 * k + m], skip1, skip2);
+            nfail += Check (&grid, 0.5 * (xv[3 * k + m] +
+                    xv[3 * k + (m + 1) % 3]), 0.5 * (yv[3 * k + m] +
+                    yv[3 * k + (m + 1) % 3]), skip1, skip2);
+
+            npoint += 3;
+        }
+
+        /* Upstream points of flows between neighboring triangles, as in
+         * upstream () of RT-Flux-PIHM */
+        for (k = 0; k + 1 < ntri; k++)
+        {
+            double          xc[2], yc[2];
+
+            for (m = 0; m < 2; m++)
+            {
+                xc[m] = (xv[3 * (k + m)] + xv[3 * (k + m) + 1] +
+                    xv[3 * (k + m) + 2]) / 3.0;
+                yc[m] = (yv[3 * (k + m)] + yv[3 * (k + m) + 1] +
+                    yv[3 * (k + m) + 2]) / 3.0;
+            }
+
+            nfail += Check (&grid, 2 * xc[0] - xc[1], 2 * yc[0] - yc[1], k,
+                k + 1);
+            nfail += Check (&grid, 2 * xc[1] - xc[0], 2 * yc[1] - yc[0],
+                k + 1, k);
+            npoint += 2;
+        }
+
+        FreeTriGrid (&grid);
+        free (px);
+        free (py);
+        free (xv);
+        free (yv);
+    }
+
+    printf ("Triangle grid: %d meshes, %d points, %d differences.\n", NTEST,
+        npoint, nfail);
+
+    return ((nfail > 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+}